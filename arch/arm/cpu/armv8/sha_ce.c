@@ -0,0 +1,58 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * SHA-1 and SHA-256 using the ARMv8 Crypto Extensions
+ */
+
+#include <common.h>
+#include <u-boot/sha1.h>
+#include <u-boot/sha256.h>
+
+/* ID_AA64ISAR0_EL1 fields */
+#define ID_AA64ISAR0_SHA1_SHIFT		8
+#define ID_AA64ISAR0_SHA2_SHIFT		12
+
+void sha1_ce_transform(u32 state[5], const u8 *data, unsigned int blocks);
+void sha256_ce_transform(u32 state[8], const u8 *data, unsigned int blocks);
+
+/*
+ * This is read on each call rather than cached, as hashing may happen
+ * before relocation when global variables cannot be written.
+ */
+static bool sha_ce_present(int shift)
+{
+	u64 isar0;
+
+	asm volatile("mrs %0, id_aa64isar0_el1" : "=r" (isar0));
+
+	return (isar0 >> shift) & 0xf;
+}
+
+bool sha1_blocks_arch(unsigned long state[5], const unsigned char *data,
+		      unsigned int blocks)
+{
+	u32 st[5];
+	int i;
+
+	if (!sha_ce_present(ID_AA64ISAR0_SHA1_SHIFT))
+		return false;
+
+	/* sha1_context keeps the state in longs */
+	for (i = 0; i < 5; i++)
+		st[i] = state[i];
+	sha1_ce_transform(st, data, blocks);
+	for (i = 0; i < 5; i++)
+		state[i] = st[i];
+
+	return true;
+}
+
+bool sha256_blocks_arch(uint32_t state[8], const uint8_t *data,
+			unsigned int blocks)
+{
+	if (!sha_ce_present(ID_AA64ISAR0_SHA2_SHIFT))
+		return false;
+
+	sha256_ce_transform(state, data, blocks);
+
+	return true;
+}
@@ -7,6 +7,7 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <getopt.h>
+#include <pthread.h>
 #include <setjmp.h>
 #include <stdio.h>
 #include <stdint.h>
@@ -266,6 +267,56 @@ void os_usleep(unsigned long usec)
 	usleep(usec);
 }
 
+int os_cpu_count(void)
+{
+	long count = sysconf(_SC_NPROCESSORS_ONLN);
+
+	return count > 0 ? count : 1;
+}
+
+struct os_thread {
+	void (*entry)(void *arg);
+	void *arg;
+};
+
+static void *os_thread_start(void *data)
+{
+	struct os_thread thread = *(struct os_thread *)data;
+
+	os_free(data);
+	thread.entry(thread.arg);
+
+	return NULL;
+}
+
+int os_thread_create(void (*entry)(void *arg), void *arg, void *stack,
+		     size_t stack_size)
+{
+	struct os_thread *thread;
+	pthread_attr_t attr;
+	pthread_t id;
+	int ret;
+
+	thread = os_malloc(sizeof(*thread));
+	if (!thread)
+		return -ENOMEM;
+	thread->entry = entry;
+	thread->arg = arg;
+
+	pthread_attr_init(&attr);
+	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+	ret = stack ? pthread_attr_setstack(&attr, stack, stack_size) : 0;
+	if (!ret)
+		ret = pthread_create(&id, &attr, os_thread_start, thread);
+	pthread_attr_destroy(&attr);
+	if (ret) {
+		os_free(thread);
+		return -ret;
+	}
+
+	return 0;
+}
+
 uint64_t __attribute__((no_instrument_function)) os_get_nsec(void)
 {
 #if defined(CLOCK_MONOTONIC) && defined(_POSIX_MONOTONIC_CLOCK)
@@ -0,0 +1,233 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * SHA-1 and SHA-256 using the x86 SHA extensions, when sandbox runs on a
+ * host which has them
+ */
+
+#include <common.h>
+#include <u-boot/sha1.h>
+#include <u-boot/sha256.h>
+
+#ifdef __x86_64__
+#include <cpuid.h>
+#include <immintrin.h>
+
+#define SHA_NI_TARGET	__attribute__((target("sha,ssse3,sse4.1")))
+
+static const uint32_t sha256_k[64] __aligned(16) = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+	0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+	0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+	0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+	0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+	0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+	0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+	0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+	0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+	0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+static bool sha_ni_present(void)
+{
+	static int present = -1;
+	unsigned int eax, ebx, ecx, edx;
+
+	if (present < 0) {
+		present = 0;
+		if (__get_cpuid(1, &eax, &ebx, &ecx, &edx) &&
+		    (ecx & bit_SSSE3) && (ecx & bit_SSE4_1) &&
+		    __get_cpuid_max(0, NULL) >= 7) {
+			__cpuid_count(7, 0, eax, ebx, ecx, edx);
+			present = !!(ebx & bit_SHA);
+		}
+	}
+
+	return present;
+}
+
+/*
+ * Four rounds with W[i..i+3] in @m0, also computing W[i+4..i+7] into @m1
+ * and starting on the schedule for @m3 which holds W[i-4..i-1]
+ */
+#define SHA256_QUAD(i, m0, m1, m2, m3)					\
+	do {								\
+		msg = _mm_add_epi32(m0, _mm_load_si128((const __m128i *)\
+						&sha256_k[4 * (i)]));	\
+		state1 = _mm_sha256rnds2_epu32(state1, state0, msg);	\
+		if ((i) >= 3 && (i) <= 14) {				\
+			m1 = _mm_add_epi32(m1, _mm_alignr_epi8(m0, m3, 4)); \
+			m1 = _mm_sha256msg2_epu32(m1, m0);		\
+		}							\
+		msg = _mm_shuffle_epi32(msg, 0x0e);			\
+		state0 = _mm_sha256rnds2_epu32(state0, state1, msg);	\
+		if ((i) >= 1 && (i) <= 12)				\
+			m3 = _mm_sha256msg1_epu32(m3, m0);		\
+	} while (0)
+
+static SHA_NI_TARGET void sha256_ni_transform(uint32_t state[8],
+					      const uint8_t *data,
+					      unsigned int blocks)
+{
+	const __m128i bswap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL,
+					     0x0405060700010203ULL);
+	__m128i state0, state1, save0, save1, msg, tmp;
+	__m128i m0, m1, m2, m3;
+
+	/* The instructions want the state as ABEF and CDGH */
+	tmp = _mm_shuffle_epi32(_mm_loadu_si128((__m128i *)&state[0]), 0xb1);
+	state1 = _mm_shuffle_epi32(_mm_loadu_si128((__m128i *)&state[4]),
+				   0x1b);
+	state0 = _mm_alignr_epi8(tmp, state1, 8);
+	state1 = _mm_blend_epi16(state1, tmp, 0xf0);
+
+	for (; blocks; blocks--, data += 64) {
+		save0 = state0;
+		save1 = state1;
+
+		m0 = _mm_shuffle_epi8(_mm_loadu_si128((__m128i *)data), bswap);
+		m1 = _mm_shuffle_epi8(_mm_loadu_si128((__m128i *)(data + 16)),
+				      bswap);
+		m2 = _mm_shuffle_epi8(_mm_loadu_si128((__m128i *)(data + 32)),
+				      bswap);
+		m3 = _mm_shuffle_epi8(_mm_loadu_si128((__m128i *)(data + 48)),
+				      bswap);
+
+		SHA256_QUAD(0, m0, m1, m2, m3);
+		SHA256_QUAD(1, m1, m2, m3, m0);
+		SHA256_QUAD(2, m2, m3, m0, m1);
+		SHA256_QUAD(3, m3, m0, m1, m2);
+		SHA256_QUAD(4, m0, m1, m2, m3);
+		SHA256_QUAD(5, m1, m2, m3, m0);
+		SHA256_QUAD(6, m2, m3, m0, m1);
+		SHA256_QUAD(7, m3, m0, m1, m2);
+		SHA256_QUAD(8, m0, m1, m2, m3);
+		SHA256_QUAD(9, m1, m2, m3, m0);
+		SHA256_QUAD(10, m2, m3, m0, m1);
+		SHA256_QUAD(11, m3, m0, m1, m2);
+		SHA256_QUAD(12, m0, m1, m2, m3);
+		SHA256_QUAD(13, m1, m2, m3, m0);
+		SHA256_QUAD(14, m2, m3, m0, m1);
+		SHA256_QUAD(15, m3, m0, m1, m2);
+
+		state0 = _mm_add_epi32(state0, save0);
+		state1 = _mm_add_epi32(state1, save1);
+	}
+
+	tmp = _mm_shuffle_epi32(state0, 0x1b);
+	state1 = _mm_shuffle_epi32(state1, 0xb1);
+	_mm_storeu_si128((__m128i *)&state[0],
+			 _mm_blend_epi16(tmp, state1, 0xf0));
+	_mm_storeu_si128((__m128i *)&state[4],
+			 _mm_alignr_epi8(state1, tmp, 8));
+}
+
+/*
+ * Four rounds with W[i..i+3] in @m0 and E in @e, saving ABCD to @en for
+ * the next four. This also completes W[i+4..i+7] in @m1 and works on the
+ * schedule for @m2 and @m3.
+ */
+#define SHA1_QUAD(i, e, en, m0, m1, m2, m3)				\
+	do {								\
+		if ((i) == 0)						\
+			e = _mm_add_epi32(e, m0);			\
+		else							\
+			e = _mm_sha1nexte_epu32(e, m0);			\
+		en = abcd;						\
+		if ((i) >= 3 && (i) <= 18)				\
+			m1 = _mm_sha1msg2_epu32(m1, m0);		\
+		abcd = _mm_sha1rnds4_epu32(abcd, e, (i) / 5);		\
+		if ((i) >= 1 && (i) <= 16)				\
+			m3 = _mm_sha1msg1_epu32(m3, m0);		\
+		if ((i) >= 2 && (i) <= 17)				\
+			m2 = _mm_xor_si128(m2, m0);			\
+	} while (0)
+
+static SHA_NI_TARGET void sha1_ni_transform(uint32_t state[5],
+					    const uint8_t *data,
+					    unsigned int blocks)
+{
+	const __m128i bswap = _mm_set_epi64x(0x0001020304050607ULL,
+					     0x08090a0b0c0d0e0fULL);
+	__m128i abcd, e0, e1, save_abcd, save_e;
+	__m128i m0, m1, m2, m3;
+
+	abcd = _mm_shuffle_epi32(_mm_loadu_si128((__m128i *)state), 0x1b);
+	e0 = _mm_set_epi32(state[4], 0, 0, 0);
+
+	for (; blocks; blocks--, data += 64) {
+		save_abcd = abcd;
+		save_e = e0;
+
+		m0 = _mm_shuffle_epi8(_mm_loadu_si128((__m128i *)data), bswap);
+		m1 = _mm_shuffle_epi8(_mm_loadu_si128((__m128i *)(data + 16)),
+				      bswap);
+		m2 = _mm_shuffle_epi8(_mm_loadu_si128((__m128i *)(data + 32)),
+				      bswap);
+		m3 = _mm_shuffle_epi8(_mm_loadu_si128((__m128i *)(data + 48)),
+				      bswap);
+
+		SHA1_QUAD(0, e0, e1, m0, m1, m2, m3);
+		SHA1_QUAD(1, e1, e0, m1, m2, m3, m0);
+		SHA1_QUAD(2, e0, e1, m2, m3, m0, m1);
+		SHA1_QUAD(3, e1, e0, m3, m0, m1, m2);
+		SHA1_QUAD(4, e0, e1, m0, m1, m2, m3);
+		SHA1_QUAD(5, e1, e0, m1, m2, m3, m0);
+		SHA1_QUAD(6, e0, e1, m2, m3, m0, m1);
+		SHA1_QUAD(7, e1, e0, m3, m0, m1, m2);
+		SHA1_QUAD(8, e0, e1, m0, m1, m2, m3);
+		SHA1_QUAD(9, e1, e0, m1, m2, m3, m0);
+		SHA1_QUAD(10, e0, e1, m2, m3, m0, m1);
+		SHA1_QUAD(11, e1, e0, m3, m0, m1, m2);
+		SHA1_QUAD(12, e0, e1, m0, m1, m2, m3);
+		SHA1_QUAD(13, e1, e0, m1, m2, m3, m0);
+		SHA1_QUAD(14, e0, e1, m2, m3, m0, m1);
+		SHA1_QUAD(15, e1, e0, m3, m0, m1, m2);
+		SHA1_QUAD(16, e0, e1, m0, m1, m2, m3);
+		SHA1_QUAD(17, e1, e0, m1, m2, m3, m0);
+		SHA1_QUAD(18, e0, e1, m2, m3, m0, m1);
+		SHA1_QUAD(19, e1, e0, m3, m0, m1, m2);
+
+		e0 = _mm_sha1nexte_epu32(e0, save_e);
+		abcd = _mm_add_epi32(abcd, save_abcd);
+	}
+
+	_mm_storeu_si128((__m128i *)state, _mm_shuffle_epi32(abcd, 0x1b));
+	state[4] = _mm_extract_epi32(e0, 3);
+}
+
+bool sha1_blocks_arch(unsigned long state[5], const unsigned char *data,
+		      unsigned int blocks)
+{
+	uint32_t st[5];
+	int i;
+
+	if (!sha_ni_present())
+		return false;
+
+	/* sha1_context keeps the state in longs */
+	for (i = 0; i < 5; i++)
+		st[i] = state[i];
+	sha1_ni_transform(st, data, blocks);
+	for (i = 0; i < 5; i++)
+		state[i] = st[i];
+
+	return true;
+}
+
+bool sha256_blocks_arch(uint32_t state[8], const uint8_t *data,
+			unsigned int blocks)
+{
+	if (!sha_ni_present())
+		return false;
+
+	sha256_ni_transform(state, data, blocks);
+
+	return true;
+}
+#endif
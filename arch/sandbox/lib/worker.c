@@ -0,0 +1,29 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Workers for sandbox, run as host threads
+ */
+
+#include <common.h>
+#include <os.h>
+#include <worker.h>
+
+int worker_arch_cpus(void)
+{
+	/* Always have at least one worker, so that it can be tested */
+	return max(os_cpu_count() - 1, 1);
+}
+
+int worker_arch_start(int cpu, void (*entry)(void *arg), void *arg,
+		      void *stack, ulong stack_size)
+{
+	return os_thread_create(entry, arg, stack, stack_size);
+}
+
+void worker_arch_idle(void)
+{
+	os_usleep(100);
+}
+
+void worker_arch_wake(void)
+{
+}
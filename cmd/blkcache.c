@@ -17,32 +17,63 @@ static int blkc_show(cmd_tbl_t *cmdtp, int flag,
 
 	printf("hits: %u\n"
 	       "misses: %u\n"
+	       "evictions: %u\n"
 	       "entries: %u\n"
-	       "max blocks/entry: %u\n"
-	       "max cache entries: %u\n",
-	       stats.hits, stats.misses, stats.entries,
-	       stats.max_blocks_per_entry, stats.max_entries);
+	       "bytes: %u\n"
+	       "max blocks/read: %u\n"
+	       "max cache bytes: %u\n",
+	       stats.hits, stats.misses, stats.evictions, stats.entries,
+	       stats.bytes, stats.max_blocks_per_read, stats.max_bytes);
 	return 0;
 }
 
 static int blkc_configure(cmd_tbl_t *cmdtp, int flag,
 			  int argc, char * const argv[])
 {
-	unsigned blocks_per_entry, max_entries;
+	unsigned blocks_per_read, max_bytes;
 	if (argc != 3)
 		return CMD_RET_USAGE;
 
-	blocks_per_entry = simple_strtoul(argv[1], 0, 0);
-	max_entries = simple_strtoul(argv[2], 0, 0);
-	blkcache_configure(blocks_per_entry, max_entries);
-	printf("changed to max of %u entries of %u blocks each\n",
-	       max_entries, blocks_per_entry);
+	blocks_per_read = simple_strtoul(argv[1], 0, 0);
+	max_bytes = simple_strtoul(argv[2], 0, 0);
+	blkcache_configure(blocks_per_read, max_bytes);
+	printf("changed to max of %u bytes, caching reads of up to %u blocks\n",
+	       max_bytes, blocks_per_read);
 	return 0;
 }
 
+#if CONFIG_IS_ENABLED(BLK_READAHEAD)
+static int blkc_readahead(cmd_tbl_t *cmdtp, int flag,
+			  int argc, char * const argv[])
+{
+	struct blk_readahead_stats stats;
+
+	if (argc > 2)
+		return CMD_RET_USAGE;
+
+	if (argc == 2) {
+		blk_readahead_configure(simple_strtoul(argv[1], 0, 0));
+		return 0;
+	}
+
+	blk_readahead_stats(&stats);
+	printf("hits: %u\n"
+	       "misses: %u\n"
+	       "fetched: %u\n"
+	       "windows: %u\n"
+	       "window blocks: %u\n",
+	       stats.hits, stats.misses, stats.fetched, stats.windows,
+	       stats.max_blocks);
+	return 0;
+}
+#endif
+
 static cmd_tbl_t cmd_blkc_sub[] = {
 	U_BOOT_CMD_MKENT(show, 0, 0, blkc_show, "", ""),
 	U_BOOT_CMD_MKENT(configure, 3, 0, blkc_configure, "", ""),
+#if CONFIG_IS_ENABLED(BLK_READAHEAD)
+	U_BOOT_CMD_MKENT(readahead, 2, 0, blkc_readahead, "", ""),
+#endif
 };
 
 static __maybe_unused void blkc_reloc(void)
@@ -82,5 +113,10 @@ U_BOOT_CMD(
 	blkcache, 4, 0, do_blkcache,
 	"block cache diagnostics and control",
 	"show - show and reset statistics\n"
-	"blkcache configure blocks entries\n"
+	"blkcache configure blocks bytes - cache reads of up to 'blocks'\n"
+	"    blocks, using at most 'bytes' of memory\n"
+#if CONFIG_IS_ENABLED(BLK_READAHEAD)
+	"blkcache readahead [blocks] - show and reset readahead statistics,\n"
+	"    or set the readahead window size (0 to disable)\n"
+#endif
 );
@@ -0,0 +1,59 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Benchmark for the crc32 implementations
+ */
+
+#include <common.h>
+#include <command.h>
+#include <div64.h>
+#include <malloc.h>
+#include <time.h>
+#include <u-boot/crc.h>
+
+static int do_crc32_bench(cmd_tbl_t *cmdtp, int flag, int argc,
+			  char * const argv[])
+{
+	ulong size = 16 << 20, start, us;
+	uint32_t crc, expect = 0;
+	enum crc32_impl impl;
+	unsigned char *buf;
+	int ret = CMD_RET_SUCCESS;
+
+	if (argc > 1)
+		size = simple_strtoul(argv[1], NULL, 16);
+	if (!size)
+		return CMD_RET_USAGE;
+
+	buf = malloc(size);
+	if (!buf) {
+		printf("Cannot allocate %#lx bytes\n", size);
+		return CMD_RET_FAILURE;
+	}
+	memset(buf, 0xa5, size);
+
+	for (impl = 0; impl < CRC32_IMPL_COUNT; impl++) {
+		start = timer_get_us();
+		if (crc32_impl_calc(impl, 0, buf, size, &crc))
+			continue;
+		us = max(timer_get_us() - start, 1UL);
+		printf("crc32 %-12s %08x %6lu MiB/s%s\n", crc32_impl_name(impl),
+		       crc, (ulong)(lldiv((u64)size * 1000000, us) >> 20),
+		       impl == crc32_impl_default() ? " (default)" : "");
+		if (impl == CRC32_IMPL_BYTE)
+			expect = crc;
+		else if (crc != expect)
+			ret = CMD_RET_FAILURE;
+	}
+	free(buf);
+	if (ret)
+		printf("Implementations do not agree\n");
+
+	return ret;
+}
+
+U_BOOT_CMD(
+	crc32bench,	2,	1,	do_crc32_bench,
+	"[size] - measure the speed of each crc32 implementation",
+	"\n    - compute the CRC32 of a buffer of 'size' bytes (hex, default\n"
+	"      16MiB) with each implementation available on this CPU\n"
+);
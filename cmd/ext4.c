@@ -91,3 +91,22 @@ U_BOOT_CMD(ext4load, 7, 0, do_ext4_load,
 	   "<interface> [<dev[:part]> [addr [filename [bytes [pos]]]]]\n"
 	   "    - load binary file 'filename' from 'dev' on 'interface'\n"
 	   "      to address 'addr' from ext4 filesystem");
+
+static int do_ext4_cache(cmd_tbl_t *cmdtp, int flag, int argc,
+			 char *const argv[])
+{
+	struct ext4fs_cache_stats stats;
+
+	ext4fs_cache_stats(&stats);
+	printf("hits: %u\n"
+	       "misses: %u\n"
+	       "evictions: %u\n"
+	       "invalidations: %u\n",
+	       stats.hits, stats.misses, stats.evictions, stats.invalidations);
+
+	return 0;
+}
+
+U_BOOT_CMD(ext4cache, 1, 0, do_ext4_cache,
+	   "show and reset ext4 metadata cache statistics",
+	   "");
@@ -8,6 +8,7 @@
 #include <common.h>
 #include <command.h>
 #include <fs.h>
+#include <fs_internal.h>
 
 static int do_size_wrapper(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 {
@@ -40,6 +41,25 @@ U_BOOT_CMD(
 	"      If 'pos' is 0 or omitted, the file is read from the start."
 )
 
+#ifdef CONFIG_CMD_LOADZ
+static int do_loadz_wrapper(cmd_tbl_t *cmdtp, int flag, int argc,
+			    char * const argv[])
+{
+	return do_loadz(cmdtp, flag, argc, argv, FS_TYPE_ANY);
+}
+
+U_BOOT_CMD(
+	loadz,	6,	0,	do_loadz_wrapper,
+	"load and uncompress a gzip file from a filesystem",
+	"<interface> [<dev[:part]> [<addr> [<filename> [max_bytes]]]]\n"
+	"    - Load gzip file 'filename' from partition 'part' on device\n"
+	"       type 'interface' instance 'dev' and uncompress it to address\n"
+	"       'addr' in memory as it is read.\n"
+	"      The data may fill the memory up to the next reserved region,\n"
+	"      'max_bytes' limits the uncompressed size further."
+);
+#endif
+
 static int do_save_wrapper(cmd_tbl_t *cmdtp, int flag, int argc,
 				char * const argv[])
 {
@@ -99,3 +119,22 @@ U_BOOT_CMD(
 	"fstype <interface> <dev>:<part> <varname>\n"
 	"- set environment variable to filesystem type\n"
 );
+
+static int do_fsstat(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
+{
+	struct fs_devread_stats stats;
+
+	fs_devread_stats(&stats);
+	printf("direct: %llu bytes\n"
+	       "copied: %llu bytes\n",
+	       stats.direct, stats.copied);
+
+	return 0;
+}
+
+U_BOOT_CMD(
+	fsstat, 1, 0, do_fsstat,
+	"show and reset filesystem read statistics",
+	"- show how many bytes were read from block devices straight into\n"
+	"  their destination, and how many were copied through a bounce buffer"
+);
@@ -15,6 +15,7 @@
 #include <lmb.h>
 #include <malloc.h>
 #include <mapmem.h>
+#include <worker.h>
 #include <asm/io.h>
 #if defined(CONFIG_CMD_USB)
 #include <usb.h>
@@ -60,14 +61,22 @@ static void boot_start_lmb(bootm_headers_t *images)
 	lmb_init_and_reserve_range(&images->lmb, (phys_addr_t)mem_start,
 				   mem_size, NULL);
 }
+
+/* Drop the region tables of any previous boot attempt */
+static void boot_stop_lmb(bootm_headers_t *images)
+{
+	lmb_uninit(&images->lmb);
+}
 #else
 #define lmb_reserve(lmb, base, size)
 static inline void boot_start_lmb(bootm_headers_t *images) { }
+static inline void boot_stop_lmb(bootm_headers_t *images) { }
 #endif
 
 static int bootm_start(cmd_tbl_t *cmdtp, int flag, int argc,
 		       char * const argv[])
 {
+	boot_stop_lmb(&images);
 	memset((void *)&images, 0, sizeof(images));
 	images.verify = env_get_yesno("verify");
 
@@ -410,6 +419,9 @@ ulong bootm_disable_interrupts(void)
 	 * recover from any failures any more...
 	 */
 	iflag = disable_interrupts();
+
+	/* Park the secondary CPUs so that the OS can start them */
+	worker_uninit();
 #ifdef CONFIG_NETCONSOLE
 	/* Stop the ethernet stack if NetConsole could have left it up */
 	eth_halt();
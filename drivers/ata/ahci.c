@@ -52,6 +52,9 @@ struct ahci_uc_priv *probe_ent = NULL;
 #define WAIT_MS_LINKUP	200
 
 #define AHCI_CAP_S64A BIT(31)
+#define AHCI_CAP_SNCQ BIT(30)
+#define AHCI_CAP_SCLO BIT(24)
+#define AHCI_CAP_NCS(cap)	((((cap) >> 8) & 0x1f) + 1)
 
 __weak void __iomem *ahci_port_base(void __iomem *base, u32 port)
 {
@@ -93,6 +96,20 @@ static void ahci_dcache_flush_sata_cmd(struct ahci_ioports *pp)
 				AHCI_PORT_PRIV_DMA_SZ);
 }
 
+/*
+ * Size of the DMA memory of a port: the command list, the received-FIS
+ * area and one command table for each of @n_slots slots.
+ */
+static ulong ahci_port_dma_sz(u32 n_slots)
+{
+	return AHCI_PORT_PRIV_DMA_SZ + (n_slots - 1) * AHCI_CMD_TBL_SZ;
+}
+
+static ulong ahci_cmd_tbl(struct ahci_ioports *pp, u32 tag)
+{
+	return pp->cmd_tbl + tag * AHCI_CMD_TBL_SZ;
+}
+
 static int waiting_for_cmd_completed(void __iomem *offset,
 				     int timeout_msec,
 				     u32 sign)
@@ -491,14 +508,15 @@ static int ahci_init_one(struct ahci_uc_priv *uc_priv, pci_dev_t dev)
 
 #define MAX_DATA_BYTE_COUNT  (4*1024*1024)
 
-static int ahci_fill_sg(struct ahci_uc_priv *uc_priv, u8 port,
+static int ahci_fill_sg(struct ahci_uc_priv *uc_priv, u8 port, u32 tag,
 			unsigned char *buf, int buf_len)
 {
 	struct ahci_ioports *pp = &(uc_priv->port[port]);
-	struct ahci_sg *ahci_sg = pp->cmd_tbl_sg;
+	struct ahci_sg *ahci_sg;
 	u32 sg_count;
 	int i;
 
+	ahci_sg = (struct ahci_sg *)(ahci_cmd_tbl(pp, tag) + AHCI_CMD_TBL_HDR);
 	sg_count = ((buf_len - 1) / MAX_DATA_BYTE_COUNT) + 1;
 	if (sg_count > AHCI_MAX_SG) {
 		printf("Error:Too much sg!\n");
@@ -527,14 +545,16 @@ static int ahci_fill_sg(struct ahci_uc_priv *uc_priv, u8 port,
 }
 
 
-static void ahci_fill_cmd_slot(struct ahci_ioports *pp, u32 opts)
+static void ahci_fill_cmd_slot(struct ahci_ioports *pp, u32 tag, u32 opts)
 {
-	pp->cmd_slot->opts = cpu_to_le32(opts);
-	pp->cmd_slot->status = 0;
-	pp->cmd_slot->tbl_addr = cpu_to_le32((u32)pp->cmd_tbl & 0xffffffff);
+	struct ahci_cmd_hdr *cmd_hdr = pp->cmd_slot + tag;
+	ulong cmd_tbl = ahci_cmd_tbl(pp, tag);
+
+	cmd_hdr->opts = cpu_to_le32(opts);
+	cmd_hdr->status = 0;
+	cmd_hdr->tbl_addr = cpu_to_le32((u32)cmd_tbl & 0xffffffff);
 #ifdef CONFIG_PHYS_64BIT
-	pp->cmd_slot->tbl_addr_hi =
-	    cpu_to_le32((u32)(((pp->cmd_tbl) >> 16) >> 16));
+	cmd_hdr->tbl_addr_hi = cpu_to_le32((u32)((cmd_tbl >> 16) >> 16));
 #endif
 }
 
@@ -569,13 +589,19 @@ static int ahci_port_start(struct ahci_uc_priv *uc_priv, u8 port)
 		return -1;
 	}
 
-	mem = memalign(2048, AHCI_PORT_PRIV_DMA_SZ);
+	/* With NCQ every slot the host offers can be kept busy */
+	pp->n_slots = 1;
+	if (uc_priv->cap & AHCI_CAP_SNCQ)
+		pp->n_slots = AHCI_CAP_NCS(uc_priv->cap);
+	pp->ncq_depth = 0;
+
+	mem = memalign(2048, ahci_port_dma_sz(pp->n_slots));
 	if (!mem) {
 		free(pp);
 		printf("%s: No mem for table!\n", __func__);
 		return -ENOMEM;
 	}
-	memset(mem, 0, AHCI_PORT_PRIV_DMA_SZ);
+	memset(mem, 0, ahci_port_dma_sz(pp->n_slots));
 
 	/*
 	 * First item in chunk of DMA memory: 32-slot command table,
@@ -584,7 +610,7 @@ static int ahci_port_start(struct ahci_uc_priv *uc_priv, u8 port)
 	pp->cmd_slot =
 		(struct ahci_cmd_hdr *)(uintptr_t)virt_to_phys((void *)mem);
 	debug("cmd_slot = %p\n", pp->cmd_slot);
-	mem += (AHCI_CMD_SLOT_SZ + 224);
+	mem += AHCI_CMD_SLOT_SZ * AHCI_MAX_CMD_SLOT;
 
 	/*
 	 * Second item: Received-FIS area
@@ -593,8 +619,8 @@ static int ahci_port_start(struct ahci_uc_priv *uc_priv, u8 port)
 	mem += AHCI_RX_FIS_SZ;
 
 	/*
-	 * Third item: data area for storing a single command
-	 * and its scatter-gather table
+	 * Third item: data area for storing a command and its
+	 * scatter-gather table, for each slot in use
 	 */
 	pp->cmd_tbl = virt_to_phys((void *)mem);
 	debug("cmd_tbl_dma = %lx\n", pp->cmd_tbl);
@@ -653,9 +679,9 @@ static int ahci_device_data_io(struct ahci_uc_priv *uc_priv, u8 port, u8 *fis,
 
 	memcpy((unsigned char *)pp->cmd_tbl, fis, fis_len);
 
-	sg_count = ahci_fill_sg(uc_priv, port, buf, buf_len);
+	sg_count = ahci_fill_sg(uc_priv, port, 0, buf, buf_len);
 	opts = (fis_len >> 2) | (sg_count << 16) | (is_write << 6);
-	ahci_fill_cmd_slot(pp, opts);
+	ahci_fill_cmd_slot(pp, 0, opts);
 
 	ahci_dcache_flush_sata_cmd(pp);
 	ahci_dcache_flush_range((unsigned long)buf, (unsigned long)buf_len);
@@ -738,6 +764,13 @@ static int ata_scsiop_inquiry(struct ahci_uc_priv *uc_priv,
 	memcpy(idbuf, tmpid, ATA_ID_WORDS * 2);
 	ata_swap_buf_le16(idbuf, ATA_ID_WORDS);
 
+	/* Queue reads and writes if both the host and the device can */
+	uc_priv->port[port].ncq_depth = 0;
+	if ((uc_priv->cap & AHCI_CAP_SNCQ) && ata_id_has_ncq(idbuf))
+		uc_priv->port[port].ncq_depth =
+			min_t(u32, uc_priv->port[port].n_slots,
+			      ata_id_queue_depth(idbuf));
+
 	memcpy(&pccb->pdata[8], "ATA     ", 8);
 	ata_id_strcpy((u16 *)&pccb->pdata[16], &idbuf[ATA_ID_PROD], 16);
 	ata_id_strcpy((u16 *)&pccb->pdata[32], &idbuf[ATA_ID_FW_REV], 4);
@@ -749,6 +782,169 @@ static int ata_scsiop_inquiry(struct ahci_uc_priv *uc_priv,
 }
 
 
+/*
+ * Bring a port back after a queued command failed: restarting the command
+ * engine drops every outstanding command, and the device refuses new ones
+ * until its NCQ error log has been read.
+ */
+static void ahci_ncq_recover(struct ahci_uc_priv *uc_priv, u8 port)
+{
+	struct ahci_ioports *pp = &uc_priv->port[port];
+	void __iomem *port_mmio = pp->port_mmio;
+	ALLOC_CACHE_ALIGN_BUFFER(u8, log, ATA_SECT_SIZE);
+	u8 fis[20];
+	u32 cmd;
+
+	cmd = readl(port_mmio + PORT_CMD) & ~PORT_CMD_START;
+	writel_with_flush(cmd, port_mmio + PORT_CMD);
+	if (waiting_for_cmd_completed(port_mmio + PORT_CMD, 500,
+				      PORT_CMD_LIST_ON))
+		debug("scsi_ahci: port %d engine did not stop\n", port);
+
+	writel(readl(port_mmio + PORT_SCR_ERR), port_mmio + PORT_SCR_ERR);
+	writel(readl(port_mmio + PORT_IRQ_STAT), port_mmio + PORT_IRQ_STAT);
+
+	if ((readl(port_mmio + PORT_TFDATA) & (ATA_BUSY | ATA_DRQ)) &&
+	    (uc_priv->cap & AHCI_CAP_SCLO)) {
+		writel_with_flush(cmd | PORT_CMD_CLO, port_mmio + PORT_CMD);
+		waiting_for_cmd_completed(port_mmio + PORT_CMD, 500,
+					  PORT_CMD_CLO);
+	}
+	writel_with_flush(cmd | PORT_CMD_START, port_mmio + PORT_CMD);
+
+	memset(fis, 0, sizeof(fis));
+	fis[0] = 0x27;		 /* Host to device FIS. */
+	fis[1] = 1 << 7;	 /* Command FIS. */
+	fis[2] = ATA_CMD_READ_LOG_EXT;
+	fis[4] = ATA_LOG_SATA_NCQ;
+	fis[12] = 1;		 /* one page */
+
+	if (ahci_device_data_io(uc_priv, port, fis, sizeof(fis), log,
+				ATA_SECT_SIZE, 0))
+		debug("scsi_ahci: cannot read NCQ error log on port %d\n",
+		      port);
+	else
+		debug("scsi_ahci: tag %d failed, status %02x error %02x\n",
+		      log[0] & 0x1f, log[2], log[3]);
+}
+
+static int ahci_ncq_prep(struct ahci_uc_priv *uc_priv, u8 port, u32 tag,
+			 lbaint_t lba, u16 blocks, u8 *buf, u8 is_write)
+{
+	struct ahci_ioports *pp = &uc_priv->port[port];
+	u8 *fis = (u8 *)ahci_cmd_tbl(pp, tag);
+	int sg_count;
+
+	memset(fis, 0, 20);
+	fis[0] = 0x27;		 /* Host to device FIS. */
+	fis[1] = 1 << 7;	 /* Command FIS. */
+	fis[2] = is_write ? ATA_CMD_FPDMA_WRITE : ATA_CMD_FPDMA_READ;
+
+	/* The block count goes in the features registers */
+	fis[3] = (blocks >> 0) & 0xff;
+	fis[11] = (blocks >> 8) & 0xff;
+
+	fis[4] = (lba >> 0) & 0xff;
+	fis[5] = (lba >> 8) & 0xff;
+	fis[6] = (lba >> 16) & 0xff;
+	fis[7] = 1 << 6; /* device reg: set LBA mode */
+	fis[8] = ((lba >> 24) & 0xff);
+#ifdef CONFIG_SYS_64BIT_LBA
+	fis[9] = ((lba >> 32) & 0xff);
+	fis[10] = ((lba >> 40) & 0xff);
+#endif
+
+	/* and the tag in the sector count register */
+	fis[12] = tag << 3;
+
+	sg_count = ahci_fill_sg(uc_priv, port, tag, buf,
+				blocks * ATA_SECT_SIZE);
+	if (sg_count < 0)
+		return -EIO;
+	ahci_fill_cmd_slot(pp, tag, 5 | (sg_count << 16) | (is_write << 6));
+
+	return 0;
+}
+
+/*
+ * Transfer blocks with READ/WRITE FPDMA QUEUED. The transfer is split into
+ * commands of MAX_SATA_BLOCKS_READ_WRITE blocks and as many of them as the
+ * queue depth allows are kept outstanding. A command has completed once the
+ * device has cleared its tag in SActive, and its slot is refilled at once.
+ */
+static int ahci_ncq_read_write(struct ahci_uc_priv *uc_priv, u8 port,
+			       lbaint_t lba, u16 blocks, u8 *buf, u8 is_write)
+{
+	struct ahci_ioports *pp = &uc_priv->port[port];
+	void __iomem *port_mmio = pp->port_mmio;
+	ulong addr = (ulong)buf, len = blocks * ATA_SECT_SIZE;
+	u32 idle, busy = 0, issue, done, tag;
+	ulong start;
+	u16 now_blocks;
+
+	if ((readl(port_mmio + PORT_SCR_STAT) & 0xf) != 0x03) {
+		debug("No Link on port %d!\n", port);
+		return -EIO;
+	}
+
+	idle = GENMASK(pp->ncq_depth - 1, 0);
+	writel(readl(port_mmio + PORT_IRQ_STAT), port_mmio + PORT_IRQ_STAT);
+	ahci_dcache_flush_range(addr, len);
+
+	while (blocks || busy) {
+		issue = 0;
+		while (blocks && idle) {
+			tag = ffs(idle) - 1;
+			now_blocks = min((u16)MAX_SATA_BLOCKS_READ_WRITE,
+					 blocks);
+			if (ahci_ncq_prep(uc_priv, port, tag, lba, now_blocks,
+					  buf, is_write))
+				goto err;
+			issue |= BIT(tag);
+			idle &= ~BIT(tag);
+			buf += now_blocks * ATA_SECT_SIZE;
+			blocks -= now_blocks;
+			lba += now_blocks;
+		}
+
+		if (issue) {
+			ahci_dcache_flush_range((unsigned long)pp->cmd_slot,
+						ahci_port_dma_sz(pp->n_slots));
+			writel(issue, port_mmio + PORT_SCR_ACT);
+			writel_with_flush(issue, port_mmio + PORT_CMD_ISSUE);
+			busy |= issue;
+		}
+
+		start = get_timer(0);
+		do {
+			done = busy & ~readl(port_mmio + PORT_SCR_ACT);
+			if (readl(port_mmio + PORT_IRQ_STAT) &
+			    (PORT_IRQ_FATAL)) {
+				debug("scsi_ahci: NCQ error, tasks %08x\n",
+				      busy);
+				goto err;
+			}
+			if (!done && get_timer(start) > WAIT_MS_DATAIO) {
+				printf("timeout exit!\n");
+				goto err;
+			}
+		} while (!done);
+
+		busy &= ~done;
+		idle |= done;
+	}
+
+	writel(readl(port_mmio + PORT_IRQ_STAT), port_mmio + PORT_IRQ_STAT);
+	ahci_dcache_invalidate_range(addr, len);
+
+	return 0;
+
+err:
+	ahci_ncq_recover(uc_priv, port);
+
+	return -EIO;
+}
+
 /*
  * SCSI READ10/WRITE10 command operation.
  */
@@ -790,6 +986,24 @@ static int ata_scsiop_read_write(struct ahci_uc_priv *uc_priv,
 	debug("scsi_ahci: %s %u blocks starting from lba 0x" LBAFU "\n",
 	      is_write ?  "write" : "read", blocks, lba);
 
+	if (uc_priv->port[pccb->target].ncq_depth) {
+		if (ATA_SECT_SIZE * blocks > user_buffer_size) {
+			printf("scsi_ahci: Error: buffer too small.\n");
+			return -EIO;
+		}
+		if (ahci_ncq_read_write(uc_priv, pccb->target, lba, blocks,
+					user_buffer, is_write)) {
+			debug("scsi_ahci: SCSI %s10 command failure.\n",
+			      is_write ? "WRITE" : "READ");
+			return -EIO;
+		}
+
+		/* One flush covers all the queued writes */
+		if (is_write)
+			return ata_io_flush(uc_priv, pccb->target);
+		return 0;
+	}
+
 	/* Preset the FIS */
 	memset(fis, 0, sizeof(fis));
 	fis[0] = 0x27;		 /* Host to device FIS. */
@@ -1122,7 +1336,7 @@ static int ata_io_flush(struct ahci_uc_priv *uc_priv, u8 port)
 	fis[2] = ATA_CMD_FLUSH_EXT;
 
 	memcpy((unsigned char *)pp->cmd_tbl, fis, 20);
-	ahci_fill_cmd_slot(pp, cmd_fis_len);
+	ahci_fill_cmd_slot(pp, 0, cmd_fis_len);
 	ahci_dcache_flush_sata_cmd(pp);
 	writel_with_flush(1, port_mmio + PORT_CMD_ISSUE);
 
@@ -0,0 +1,291 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Sequential readahead for block devices
+ *
+ * When a device is read sequentially (each read starting where the
+ * previous one ended), the blocks which follow are read ahead into a
+ * per-device buffer, so that the next reads are served from memory.
+ *
+ * Drivers which provide read_start() and read_wait() get a queued
+ * readahead: after each sequential read the next window is started and
+ * the read returns at once, so the device transfers the window while the
+ * caller (e.g. a filesystem) works on the data it already has. There are
+ * two buffers; one holds the window being read from and the other the
+ * window in flight. Once a read reaches the window in flight, it is
+ * waited for, the buffers swap and the window after it is started.
+ *
+ * Other drivers get a synchronous readahead: a sequential read is
+ * extended by a window of blocks in the same, larger transfer.
+ */
+
+#include <common.h>
+#include <blk.h>
+#include <dm.h>
+#include <malloc.h>
+#include <linux/err.h>
+
+static struct blk_readahead_stats _stats = {
+	.max_blocks = CONFIG_BLK_READAHEAD_BLOCKS,
+};
+
+static bool ra_holds(lbaint_t start, lbaint_t count, lbaint_t blk)
+{
+	return count && blk >= start && blk < start + count;
+}
+
+/* Make sure @ra has two buffers of one window each */
+static int ra_get_buf(struct blk_readahead *ra, struct blk_desc *desc)
+{
+	lbaint_t size = _stats.max_blocks;
+
+	if (ra->mem && ra->size == size)
+		return 0;
+
+	free(ra->mem);
+	ra->count = 0;
+	ra->size = 0;
+	ra->mem = memalign(ARCH_DMA_MINALIGN, 2 * size * desc->blksz);
+	if (!ra->mem)
+		return -ENOMEM;
+	ra->size = size;
+	ra->buf = ra->mem;
+	ra->ahead_buf = ra->mem + size * desc->blksz;
+
+	return 0;
+}
+
+/* Wait for the read in flight, if any, and drop it if it failed */
+static void ra_wait(struct udevice *dev, struct blk_readahead *ra)
+{
+	ulong n;
+
+	if (!ra->busy)
+		return;
+	ra->busy = false;
+	n = blk_get_ops(dev)->read_wait(dev);
+	if (n != ra->ahead_count) {
+		debug("%s: readahead of " LBAFU " blocks at " LBAF
+		      " failed\n", __func__, ra->ahead_count, ra->ahead_start);
+		ra->ahead_count = 0;
+	}
+}
+
+/* Copy the blocks at @start which are in the window */
+static lbaint_t ra_copy(struct blk_readahead *ra, unsigned long blksz,
+			lbaint_t start, lbaint_t blkcnt, void *buffer)
+{
+	lbaint_t count;
+
+	if (!ra_holds(ra->start, ra->count, start))
+		return 0;
+	count = min(blkcnt, ra->start + ra->count - start);
+	memcpy(buffer, ra->buf + (start - ra->start) * blksz, count * blksz);
+	_stats.hits += count;
+
+	return count;
+}
+
+/* Start reading the window which follows the last read, if not done yet */
+static void ra_start(struct udevice *dev, struct blk_readahead *ra,
+		     struct blk_desc *desc)
+{
+	lbaint_t start = ra->next;
+	lbaint_t count = _stats.max_blocks;
+
+	if (ra->busy || !count)
+		return;
+	if (ra_holds(ra->start, ra->count, start))
+		start = ra->start + ra->count;
+	/* A window read ahead for an earlier stream is replaced */
+	if (ra_holds(ra->ahead_start, ra->ahead_count, start))
+		return;
+	if (desc->lba && start + count > desc->lba)
+		count = desc->lba > start ? desc->lba - start : 0;
+	if (!count || ra_get_buf(ra, desc))
+		return;
+
+	if (blk_get_ops(dev)->read_start(dev, start, count, ra->ahead_buf)) {
+		debug("%s: cannot start readahead at " LBAF "\n", __func__,
+		      start);
+		return;
+	}
+	ra->ahead_start = start;
+	ra->ahead_count = count;
+	ra->busy = true;
+	_stats.fetched += count;
+	_stats.windows++;
+}
+
+static ulong ra_read_queued(struct udevice *dev, lbaint_t start,
+			    lbaint_t blkcnt, void *buffer, bool sequential)
+{
+	struct blk_desc *desc = dev_get_uclass_platdata(dev);
+	struct blk_readahead *ra = dev_get_uclass_priv(dev);
+	unsigned long blksz = desc->blksz;
+	lbaint_t done = 0;
+	void *buf;
+	ulong n;
+
+	for (;;) {
+		done += ra_copy(ra, blksz, start + done, blkcnt - done,
+				buffer + done * blksz);
+		if (done == blkcnt ||
+		    !ra_holds(ra->ahead_start, ra->ahead_count, start + done))
+			break;
+
+		/* The read continues into the next window */
+		ra_wait(dev, ra);
+		if (!ra->ahead_count)
+			break;
+		buf = ra->buf;
+		ra->buf = ra->ahead_buf;
+		ra->ahead_buf = buf;
+		ra->start = ra->ahead_start;
+		ra->count = ra->ahead_count;
+		ra->ahead_count = 0;
+	}
+
+	/* A read which used a window continues the stream */
+	if (done)
+		sequential = true;
+
+	if (done < blkcnt) {
+		/* The device handles one request at a time */
+		ra_wait(dev, ra);
+		n = blk_get_ops(dev)->read(dev, start + done, blkcnt - done,
+					   buffer + done * blksz);
+		if (IS_ERR_VALUE(n))
+			return done ? done : n;
+		_stats.misses += n;
+		if (n < blkcnt - done)
+			return done + n;
+	}
+
+	if (sequential)
+		ra_start(dev, ra, desc);
+
+	return blkcnt;
+}
+
+static ulong ra_read_extend(struct udevice *dev, lbaint_t start,
+			    lbaint_t blkcnt, void *buffer, bool sequential)
+{
+	struct blk_desc *desc = dev_get_uclass_platdata(dev);
+	struct blk_readahead *ra = dev_get_uclass_priv(dev);
+	const struct blk_ops *ops = blk_get_ops(dev);
+	unsigned long blksz = desc->blksz;
+	lbaint_t done, want;
+	ulong n;
+
+	done = ra_copy(ra, blksz, start, blkcnt, buffer);
+	if (done == blkcnt)
+		return blkcnt;
+	if (done) {
+		/* we ran off the end of the window, keep going */
+		sequential = true;
+		start += done;
+		blkcnt -= done;
+		buffer += done * blksz;
+	}
+
+	want = blkcnt + _stats.max_blocks;
+	if (desc->lba && start + want > desc->lba)
+		want = desc->lba > start ? desc->lba - start : 0;
+
+	/* Without read_start() the buffers never swap: @buf spans both */
+	if (sequential && blkcnt < _stats.max_blocks && want > blkcnt &&
+	    !ra_get_buf(ra, desc)) {
+		ra->count = 0;
+		n = ops->read(dev, start, want, ra->buf);
+		if (n == want) {
+			memcpy(buffer, ra->buf, blkcnt * blksz);
+			ra->start = start;
+			ra->count = want;
+			_stats.misses += blkcnt;
+			_stats.fetched += want - blkcnt;
+			_stats.windows++;
+
+			return done + blkcnt;
+		}
+		debug("%s: readahead of " LBAFU " blocks at " LBAF
+		      " failed\n", __func__, want, start);
+	}
+
+	n = ops->read(dev, start, blkcnt, buffer);
+	if (IS_ERR_VALUE(n))
+		return done ? done : n;
+	_stats.misses += n;
+
+	return done + n;
+}
+
+ulong blk_readahead_read(struct udevice *dev, lbaint_t start,
+			 lbaint_t blkcnt, void *buffer)
+{
+	struct blk_readahead *ra = dev_get_uclass_priv(dev);
+	const struct blk_ops *ops = blk_get_ops(dev);
+	bool sequential = start == ra->next;
+
+	ra->next = start + blkcnt;
+	if (ops->read_start && ops->read_wait)
+		return ra_read_queued(dev, start, blkcnt, buffer, sequential);
+
+	return ra_read_extend(dev, start, blkcnt, buffer, sequential);
+}
+
+void blk_readahead_invalidate(struct blk_desc *desc)
+{
+	struct blk_readahead *ra;
+
+	if (!desc->bdev)
+		return;
+	ra = dev_get_uclass_priv(desc->bdev);
+	if (!ra)
+		return;
+	ra_wait(desc->bdev, ra);
+	ra->count = 0;
+	ra->ahead_count = 0;
+}
+
+void blk_readahead_remove(struct udevice *dev)
+{
+	struct blk_readahead *ra = dev_get_uclass_priv(dev);
+
+	ra_wait(dev, ra);
+	free(ra->mem);
+	ra->mem = NULL;
+	ra->buf = NULL;
+	ra->ahead_buf = NULL;
+	ra->size = 0;
+	ra->count = 0;
+	ra->ahead_count = 0;
+}
+
+void blk_readahead_configure(unsigned blocks)
+{
+	struct udevice *dev;
+	struct uclass *uc;
+
+	/* Drop the windows now, so that the next reads use the new size */
+	if (!uclass_get(UCLASS_BLK, &uc)) {
+		uclass_foreach_dev(dev, uc) {
+			if (device_active(dev))
+				blk_readahead_remove(dev);
+		}
+	}
+
+	_stats.max_blocks = blocks;
+	_stats.hits = 0;
+	_stats.misses = 0;
+	_stats.fetched = 0;
+	_stats.windows = 0;
+}
+
+void blk_readahead_stats(struct blk_readahead_stats *stats)
+{
+	memcpy(stats, &_stats, sizeof(*stats));
+	_stats.hits = 0;
+	_stats.misses = 0;
+	_stats.fetched = 0;
+	_stats.windows = 0;
+}
@@ -10,6 +10,7 @@
 #include <dm/device-internal.h>
 #include <dm/lists.h>
 #include <dm/uclass-internal.h>
+#include <linux/err.h>
 
 static const char *if_typename_str[IF_TYPE_COUNT] = {
 	[IF_TYPE_IDE]		= "ide",
@@ -343,6 +344,8 @@ int blk_select_hwpart(struct udevice *dev, int hwpart)
 	if (!ops->select_hwpart)
 		return 0;
 
+	blk_readahead_invalidate(dev_get_uclass_platdata(dev));
+
 	return ops->select_hwpart(dev, hwpart);
 }
 
@@ -426,25 +429,54 @@ int blk_get_device(int if_type, int devnum, struct udevice **devp)
 	return device_probe(*devp);
 }
 
+static ulong blk_read_dev(struct udevice *dev, lbaint_t start,
+			  lbaint_t blkcnt, void *buffer)
+{
+#if CONFIG_IS_ENABLED(BLK_READAHEAD)
+	return blk_readahead_read(dev, start, blkcnt, buffer);
+#else
+	return blk_get_ops(dev)->read(dev, start, blkcnt, buffer);
+#endif
+}
+
 unsigned long blk_dread(struct blk_desc *block_dev, lbaint_t start,
 			lbaint_t blkcnt, void *buffer)
 {
 	struct udevice *dev = block_dev->bdev;
 	const struct blk_ops *ops = blk_get_ops(dev);
+	unsigned long blksz = block_dev->blksz;
+	lbaint_t done = 0, count;
 	ulong blks_read;
 
 	if (!ops->read)
 		return -ENOSYS;
 
-	if (blkcache_read(block_dev->if_type, block_dev->devnum,
-			  start, blkcnt, block_dev->blksz, buffer))
-		return blkcnt;
-	blks_read = ops->read(dev, start, blkcnt, buffer);
-	if (blks_read == blkcnt)
+	/*
+	 * Alternate between the runs of blocks found in the cache and the
+	 * runs which have to be read from the device.
+	 */
+	while (done < blkcnt) {
+		done += blkcache_read(block_dev->if_type, block_dev->devnum,
+				      start + done, blkcnt - done, blksz,
+				      buffer + done * blksz);
+		if (done == blkcnt)
+			break;
+
+		count = blkcache_uncached(block_dev->if_type,
+					  block_dev->devnum, start + done,
+					  blkcnt - done, blksz);
+		blks_read = blk_read_dev(dev, start + done, count,
+				      buffer + done * blksz);
+		if (blks_read != count)
+			return IS_ERR_VALUE(blks_read) ? blks_read :
+			       done + blks_read;
 		blkcache_fill(block_dev->if_type, block_dev->devnum,
-			      start, blkcnt, block_dev->blksz, buffer);
+			      start + done, count, blksz,
+			      buffer + done * blksz);
+		done += count;
+	}
 
-	return blks_read;
+	return done;
 }
 
 unsigned long blk_dwrite(struct blk_desc *block_dev, lbaint_t start,
@@ -457,6 +489,7 @@ unsigned long blk_dwrite(struct blk_desc *block_dev, lbaint_t start,
 		return -ENOSYS;
 
 	blkcache_invalidate(block_dev->if_type, block_dev->devnum);
+	blk_readahead_invalidate(block_dev);
 	return ops->write(dev, start, blkcnt, buffer);
 }
 
@@ -470,6 +503,7 @@ unsigned long blk_derase(struct blk_desc *block_dev, lbaint_t start,
 		return -ENOSYS;
 
 	blkcache_invalidate(block_dev->if_type, block_dev->devnum);
+	blk_readahead_invalidate(block_dev);
 	return ops->erase(dev, start, blkcnt);
 }
 
@@ -649,9 +683,22 @@ static int blk_post_probe(struct udevice *dev)
 	return 0;
 }
 
+#if CONFIG_IS_ENABLED(BLK_READAHEAD)
+static int blk_pre_remove(struct udevice *dev)
+{
+	blk_readahead_remove(dev);
+
+	return 0;
+}
+#endif
+
 UCLASS_DRIVER(blk) = {
 	.id		= UCLASS_BLK,
 	.name		= "blk",
 	.post_probe	= blk_post_probe,
+#if CONFIG_IS_ENABLED(BLK_READAHEAD)
+	.pre_remove	= blk_pre_remove,
+	.per_device_auto_alloc_size = sizeof(struct blk_readahead),
+#endif
 	.per_device_platdata_auto_alloc_size = sizeof(struct blk_desc),
 };
@@ -11,157 +11,343 @@
 #include <linux/ctype.h>
 #include <linux/list.h>
 
-struct block_cache_node {
+/*
+ * The cache is made of fixed-size pages of BLKCACHE_PAGE_BLOCKS blocks,
+ * aligned on the page size within the device. Each device (iftype, devnum)
+ * has its own hash table of pages indexed by LBA, and all pages share one
+ * LRU list so that eviction is driven by a global byte budget. A page
+ * holds a bitmap of the blocks that are valid, so a page need not be read
+ * in full before it is cached and a read may be satisfied by any number
+ * of pages, in part from the cache and in part from the device.
+ */
+#define BLKCACHE_PAGE_BLOCKS	8
+#define BLKCACHE_HASH_SIZE	64
+
+struct block_cache_dev {
 	struct list_head lh;
 	int iftype;
 	int devnum;
-	lbaint_t start;
-	lbaint_t blkcnt;
 	unsigned long blksz;
-	char *cache;
+	struct hlist_head hash[BLKCACHE_HASH_SIZE];
+};
+
+struct block_cache_page {
+	struct hlist_node hash;
+	struct list_head lru;
+	struct block_cache_dev *dev;
+	lbaint_t index;		/* first block / BLKCACHE_PAGE_BLOCKS */
+	u32 valid;		/* bitmap of the blocks present in @data */
+	char *data;
 };
 
-static LIST_HEAD(block_cache);
+static LIST_HEAD(block_cache_devs);
+static LIST_HEAD(block_cache_lru);
 
 static struct block_cache_stats _stats = {
-	.max_blocks_per_entry = 8,
-	.max_entries = 32
+	.max_blocks_per_read = CONFIG_BLOCK_CACHE_MAX_BLOCKS,
+	.max_bytes = CONFIG_BLOCK_CACHE_SIZE,
 };
 
-static struct block_cache_node *cache_find(int iftype, int devnum,
-					   lbaint_t start, lbaint_t blkcnt,
-					   unsigned long blksz)
+static inline unsigned int page_hash(lbaint_t index)
+{
+	return (index ^ (index >> 6) ^ (index >> 12)) &
+		(BLKCACHE_HASH_SIZE - 1);
+}
+
+static inline unsigned long page_bytes(struct block_cache_dev *dev)
+{
+	return dev->blksz * BLKCACHE_PAGE_BLOCKS;
+}
+
+static void page_free(struct block_cache_page *page)
+{
+	hlist_del(&page->hash);
+	list_del(&page->lru);
+	_stats.entries--;
+	_stats.bytes -= page_bytes(page->dev);
+	free(page->data);
+	free(page);
+}
+
+static void dev_free(struct block_cache_dev *dev)
+{
+	struct block_cache_page *page;
+	struct hlist_node *pos, *n;
+	int i;
+
+	for (i = 0; i < BLKCACHE_HASH_SIZE; i++)
+		hlist_for_each_entry_safe(page, pos, n, &dev->hash[i], hash)
+			page_free(page);
+	list_del(&dev->lh);
+	free(dev);
+}
+
+static struct block_cache_dev *dev_find(int iftype, int devnum,
+					unsigned long blksz, bool create)
+{
+	struct block_cache_dev *dev;
+	int i;
+
+	list_for_each_entry(dev, &block_cache_devs, lh) {
+		if (dev->iftype != iftype || dev->devnum != devnum)
+			continue;
+		if (dev->blksz == blksz)
+			return dev;
+		/* the block size changed under us, drop what we have */
+		dev_free(dev);
+		break;
+	}
+
+	if (!create)
+		return NULL;
+
+	dev = malloc(sizeof(*dev));
+	if (!dev)
+		return NULL;
+	dev->iftype = iftype;
+	dev->devnum = devnum;
+	dev->blksz = blksz;
+	for (i = 0; i < BLKCACHE_HASH_SIZE; i++)
+		INIT_HLIST_HEAD(&dev->hash[i]);
+	list_add(&dev->lh, &block_cache_devs);
+
+	return dev;
+}
+
+static struct block_cache_page *page_find(struct block_cache_dev *dev,
+					  lbaint_t index)
+{
+	struct block_cache_page *page;
+	struct hlist_node *pos;
+
+	hlist_for_each_entry(page, pos, &dev->hash[page_hash(index)], hash)
+		if (page->index == index)
+			return page;
+
+	return NULL;
+}
+
+/*
+ * Get a new page for @dev, evicting least-recently-used pages until it
+ * fits in the byte budget. The buffer of an evicted page is reused when
+ * it has the right size.
+ */
+static struct block_cache_page *page_alloc(struct block_cache_dev *dev,
+					   lbaint_t index)
+{
+	unsigned long bytes = page_bytes(dev);
+	struct block_cache_page *page;
+	char *data = NULL;
+
+	if (bytes > _stats.max_bytes)
+		return NULL;
+
+	while (_stats.bytes + bytes > _stats.max_bytes) {
+		page = list_last_entry(&block_cache_lru,
+				       struct block_cache_page, lru);
+		debug("drop: page " LBAF "\n", page->index);
+		_stats.evictions++;
+		if (!data && page_bytes(page->dev) == bytes) {
+			data = page->data;
+			page->data = NULL;
+		}
+		page_free(page);
+	}
+
+	page = malloc(sizeof(*page));
+	if (!page)
+		goto err;
+	if (!data) {
+		data = malloc(bytes);
+		if (!data)
+			goto err;
+	}
+
+	page->dev = dev;
+	page->index = index;
+	page->valid = 0;
+	page->data = data;
+	hlist_add_head(&page->hash, &dev->hash[page_hash(index)]);
+	list_add(&page->lru, &block_cache_lru);
+	_stats.entries++;
+	_stats.bytes += bytes;
+
+	return page;
+err:
+	free(page);
+	free(data);
+	return NULL;
+}
+
+/* Number of blocks, from @start, that fall within the same page */
+static inline lbaint_t page_span(lbaint_t start, lbaint_t blkcnt)
+{
+	lbaint_t left = BLKCACHE_PAGE_BLOCKS -
+			(start & (BLKCACHE_PAGE_BLOCKS - 1));
+
+	return min(left, blkcnt);
+}
+
+static inline u32 page_mask(lbaint_t start, lbaint_t count)
+{
+	return ((1U << count) - 1) << (start & (BLKCACHE_PAGE_BLOCKS - 1));
+}
+
+lbaint_t blkcache_read(int iftype, int devnum,
+		       lbaint_t start, lbaint_t blkcnt,
+		       unsigned long blksz, void *buffer)
 {
-	struct block_cache_node *node;
-
-	list_for_each_entry(node, &block_cache, lh)
-		if ((node->iftype == iftype) &&
-		    (node->devnum == devnum) &&
-		    (node->blksz == blksz) &&
-		    (node->start <= start) &&
-		    (node->start + node->blkcnt >= start + blkcnt)) {
-			if (block_cache.next != &node->lh) {
-				/* maintain MRU ordering */
-				list_del(&node->lh);
-				list_add(&node->lh, &block_cache);
+	struct block_cache_dev *dev;
+	struct block_cache_page *page;
+	char *dst = buffer;
+	lbaint_t done = 0;
+
+	if (blkcnt > _stats.max_blocks_per_read)
+		return 0;
+
+	dev = dev_find(iftype, devnum, blksz, false);
+	if (!dev)
+		return 0;
+
+	while (done < blkcnt) {
+		lbaint_t blk = start + done;
+		lbaint_t count = page_span(blk, blkcnt - done);
+		u32 mask = page_mask(blk, count);
+		lbaint_t offset = blk & (BLKCACHE_PAGE_BLOCKS - 1);
+
+		page = page_find(dev, blk / BLKCACHE_PAGE_BLOCKS);
+		if (!page)
+			break;
+		/* serve the leading valid blocks of this page only */
+		if ((page->valid & mask) != mask) {
+			while (count && (page->valid & (1U << offset))) {
+				memcpy(dst, page->data + offset * blksz, blksz);
+				dst += blksz;
+				done++;
+				offset++;
+				count--;
 			}
-			return node;
+			list_move(&page->lru, &block_cache_lru);
+			break;
 		}
-	return 0;
+
+		memcpy(dst, page->data + offset * blksz, count * blksz);
+		list_move(&page->lru, &block_cache_lru);
+		dst += count * blksz;
+		done += count;
+	}
+
+	if (done)
+		debug("hit: start " LBAF ", count " LBAFU "\n", start, done);
+	_stats.hits += done;
+
+	return done;
 }
 
-int blkcache_read(int iftype, int devnum,
-		  lbaint_t start, lbaint_t blkcnt,
-		  unsigned long blksz, void *buffer)
+lbaint_t blkcache_uncached(int iftype, int devnum,
+			   lbaint_t start, lbaint_t blkcnt,
+			   unsigned long blksz)
 {
-	struct block_cache_node *node = cache_find(iftype, devnum, start,
-						   blkcnt, blksz);
-	if (node) {
-		const char *src = node->cache + (start - node->start) * blksz;
-		memcpy(buffer, src, blksz * blkcnt);
-		debug("hit: start " LBAF ", count " LBAFU "\n",
-		      start, blkcnt);
-		++_stats.hits;
-		return 1;
+	struct block_cache_dev *dev;
+	struct block_cache_page *page;
+	lbaint_t done = 0;
+
+	if (blkcnt > _stats.max_blocks_per_read)
+		return blkcnt;
+
+	dev = dev_find(iftype, devnum, blksz, false);
+	while (dev && done < blkcnt) {
+		lbaint_t blk = start + done;
+		lbaint_t count = page_span(blk, blkcnt - done);
+		lbaint_t offset = blk & (BLKCACHE_PAGE_BLOCKS - 1);
+
+		page = page_find(dev, blk / BLKCACHE_PAGE_BLOCKS);
+		if (page) {
+			while (count && !(page->valid & (1U << offset))) {
+				done++;
+				offset++;
+				count--;
+			}
+			if (count)
+				break;
+		} else {
+			done += count;
+		}
 	}
+	if (!dev)
+		done = blkcnt;
 
-	debug("miss: start " LBAF ", count " LBAFU "\n",
-	      start, blkcnt);
-	++_stats.misses;
-	return 0;
+	debug("miss: start " LBAF ", count " LBAFU "\n", start, done);
+	_stats.misses += done;
+
+	return done;
 }
 
 void blkcache_fill(int iftype, int devnum,
 		   lbaint_t start, lbaint_t blkcnt,
 		   unsigned long blksz, void const *buffer)
 {
-	lbaint_t bytes;
-	struct block_cache_node *node;
+	struct block_cache_dev *dev;
+	struct block_cache_page *page;
+	const char *src = buffer;
 
 	/* don't cache big stuff */
-	if (blkcnt > _stats.max_blocks_per_entry)
+	if (blkcnt > _stats.max_blocks_per_read || !_stats.max_bytes)
 		return;
 
-	if (_stats.max_entries == 0)
+	dev = dev_find(iftype, devnum, blksz, true);
+	if (!dev)
 		return;
 
-	bytes = blksz * blkcnt;
-	if (_stats.max_entries <= _stats.entries) {
-		/* pop LRU */
-		node = (struct block_cache_node *)block_cache.prev;
-		list_del(&node->lh);
-		_stats.entries--;
-		debug("drop: start " LBAF ", count " LBAFU "\n",
-		      node->start, node->blkcnt);
-		if (node->blkcnt * node->blksz < bytes) {
-			free(node->cache);
-			node->cache = 0;
-		}
-	} else {
-		node = malloc(sizeof(*node));
-		if (!node)
-			return;
-		node->cache = 0;
-	}
+	debug("fill: start " LBAF ", count " LBAFU "\n", start, blkcnt);
 
-	if (!node->cache) {
-		node->cache = malloc(bytes);
-		if (!node->cache) {
-			free(node);
-			return;
-		}
-	}
+	while (blkcnt) {
+		lbaint_t count = page_span(start, blkcnt);
+		lbaint_t offset = start & (BLKCACHE_PAGE_BLOCKS - 1);
+		lbaint_t index = start / BLKCACHE_PAGE_BLOCKS;
 
-	debug("fill: start " LBAF ", count " LBAFU "\n",
-	      start, blkcnt);
+		page = page_find(dev, index);
+		if (page)
+			list_move(&page->lru, &block_cache_lru);
+		else
+			page = page_alloc(dev, index);
+		if (!page)
+			return;
 
-	node->iftype = iftype;
-	node->devnum = devnum;
-	node->start = start;
-	node->blkcnt = blkcnt;
-	node->blksz = blksz;
-	memcpy(node->cache, buffer, bytes);
-	list_add(&node->lh, &block_cache);
-	_stats.entries++;
+		memcpy(page->data + offset * blksz, src, count * blksz);
+		page->valid |= page_mask(start, count);
+		src += count * blksz;
+		start += count;
+		blkcnt -= count;
+	}
 }
 
 void blkcache_invalidate(int iftype, int devnum)
 {
-	struct list_head *entry, *n;
-	struct block_cache_node *node;
-
-	list_for_each_safe(entry, n, &block_cache) {
-		node = (struct block_cache_node *)entry;
-		if ((node->iftype == iftype) &&
-		    (node->devnum == devnum)) {
-			list_del(entry);
-			free(node->cache);
-			free(node);
-			--_stats.entries;
-		}
-	}
+	struct block_cache_dev *dev, *n;
+
+	list_for_each_entry_safe(dev, n, &block_cache_devs, lh)
+		if (dev->iftype == iftype && dev->devnum == devnum)
+			dev_free(dev);
 }
 
-void blkcache_configure(unsigned blocks, unsigned entries)
+void blkcache_configure(unsigned blocks, unsigned bytes)
 {
-	struct block_cache_node *node;
-	if ((blocks != _stats.max_blocks_per_entry) ||
-	    (entries != _stats.max_entries)) {
+	struct block_cache_dev *dev, *n;
+
+	if (blocks != _stats.max_blocks_per_read ||
+	    bytes != _stats.max_bytes) {
 		/* invalidate cache */
-		while (!list_empty(&block_cache)) {
-			node = (struct block_cache_node *)block_cache.next;
-			list_del(&node->lh);
-			free(node->cache);
-			free(node);
-		}
-		_stats.entries = 0;
+		list_for_each_entry_safe(dev, n, &block_cache_devs, lh)
+			dev_free(dev);
 	}
 
-	_stats.max_blocks_per_entry = blocks;
-	_stats.max_entries = entries;
+	_stats.max_blocks_per_read = blocks;
+	_stats.max_bytes = bytes;
 
 	_stats.hits = 0;
 	_stats.misses = 0;
+	_stats.evictions = 0;
 }
 
 void blkcache_stats(struct block_cache_stats *stats)
@@ -169,4 +355,5 @@ void blkcache_stats(struct block_cache_stats *stats)
 	memcpy(stats, &_stats, sizeof(*stats));
 	_stats.hits = 0;
 	_stats.misses = 0;
+	_stats.evictions = 0;
 }
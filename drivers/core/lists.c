@@ -9,7 +9,9 @@
 #define LOG_CATEGORY LOGC_DM
 
 #include <common.h>
+#include <bootstage.h>
 #include <errno.h>
+#include <malloc.h>
 #include <dm/device.h>
 #include <dm/device-internal.h>
 #include <dm/lists.h>
@@ -19,6 +21,28 @@
 #include <fdtdec.h>
 #include <linux/compiler.h>
 
+DECLARE_GLOBAL_DATA_PTR;
+
+/* A free entry in the compatible string index */
+#define DM_COMPAT_FREE		0xffff
+
+/**
+ * struct dm_compat_index - open-addressed hash table of compatible strings
+ *
+ * Each entry holds the position in the driver linker list of the first
+ * driver with a compatible string that hashes there, found by checking that
+ * driver's of_match table. Keeping entries this small lets the table fit in
+ * the pre-relocation malloc() pool.
+ *
+ * @mask: Number of entries minus one, the number of entries being a power
+ *	of two at least 1.5 times the number of compatible strings
+ * @entries: Driver positions, DM_COMPAT_FREE if the entry is free
+ */
+struct dm_compat_index {
+	uint mask;
+	u16 entries[];
+};
+
 struct driver *lists_driver_lookup_name(const char *name)
 {
 	struct driver *drv =
@@ -124,11 +148,144 @@ static int driver_check_compatible(const struct udevice_id *of_match,
 	return -ENOENT;
 }
 
-int lists_bind_fdt(struct udevice *parent, ofnode node, struct udevice **devp,
-		   bool pre_reloc_only)
+/* FNV-1a */
+static uint compat_hash(const char *str)
+{
+	uint hash = 2166136261U;
+
+	while (*str)
+		hash = (hash ^ (u8)*str++) * 16777619U;
+
+	return hash;
+}
+
+/*
+ * Find the entry for a compatible string, i.e. the first entry on its probe
+ * sequence whose driver has the string, or the free entry ending it.
+ * Drivers are added in linker-list order, so this is the first driver with
+ * the string, as a scan of the drivers would find.
+ */
+static u16 *compat_index_find(struct dm_compat_index *index,
+			      const char *compat,
+			      const struct udevice_id **idp)
+{
+	struct driver *driver = ll_entry_start(struct driver, driver);
+	uint i = compat_hash(compat) & index->mask;
+
+	for (; index->entries[i] != DM_COMPAT_FREE;
+	     i = (i + 1) & index->mask) {
+		if (!driver_check_compatible(driver[index->entries[i]].of_match,
+					     idp, compat))
+			break;
+	}
+
+	return &index->entries[i];
+}
+
+int lists_compat_index_init(void)
 {
 	struct driver *driver = ll_entry_start(struct driver, driver);
 	const int n_ents = ll_entry_count(struct driver, driver);
+	const struct udevice_id *id, *match;
+	struct dm_compat_index *index;
+	struct driver *entry;
+	uint count = 0, size = 16;
+	size_t bytes;
+	u16 *ent;
+
+	gd->dm_compat_index = NULL;
+	if (!CONFIG_IS_ENABLED(DM_COMPAT_INDEX) || n_ents >= DM_COMPAT_FREE)
+		return 0;
+
+	bootstage_start(BOOTSTAGE_ID_ACCUM_DM_COMPAT, "dm_compat");
+	for (entry = driver; entry != driver + n_ents; entry++)
+		for (id = entry->of_match; id && id->compatible; id++)
+			count++;
+	while (size < count + count / 2)
+		size <<= 1;
+	bytes = sizeof(*index) + size * sizeof(index->entries[0]);
+
+#if CONFIG_VAL(SYS_MALLOC_F_LEN)
+	/* Leave most of the pre-relocation malloc() pool to binding */
+	if (!(gd->flags & GD_FLG_FULL_MALLOC_INIT) &&
+	    bytes > (gd->malloc_limit - gd->malloc_ptr) / 4) {
+		bootstage_accum(BOOTSTAGE_ID_ACCUM_DM_COMPAT);
+		log_debug("no space to index %u compatible strings\n", count);
+		return 0;
+	}
+#endif
+	index = malloc(bytes);
+	if (!index) {
+		bootstage_accum(BOOTSTAGE_ID_ACCUM_DM_COMPAT);
+		return -ENOMEM;
+	}
+	index->mask = size - 1;
+	memset(index->entries, '\xff', size * sizeof(index->entries[0]));
+
+	for (entry = driver; entry != driver + n_ents; entry++) {
+		for (id = entry->of_match; id && id->compatible; id++) {
+			ent = compat_index_find(index, id->compatible, &match);
+			if (*ent == DM_COMPAT_FREE)
+				*ent = entry - driver;
+		}
+	}
+	gd->dm_compat_index = index;
+	bootstage_accum(BOOTSTAGE_ID_ACCUM_DM_COMPAT);
+	log_debug("indexed %u compatible strings in %u entries\n", count,
+		  size);
+
+	return 0;
+}
+
+void lists_compat_index_free(void)
+{
+	free(gd->dm_compat_index);
+	gd->dm_compat_index = NULL;
+}
+
+static int driver_lookup_compatible(const char *compat, struct driver **drvp,
+				    const struct udevice_id **idp)
+{
+	struct driver *driver = ll_entry_start(struct driver, driver);
+	const int n_ents = ll_entry_count(struct driver, driver);
+	struct dm_compat_index *index = gd->dm_compat_index;
+	struct driver *entry;
+	u16 *ent;
+
+	if (index) {
+		ent = compat_index_find(index, compat, idp);
+		if (*ent == DM_COMPAT_FREE)
+			return -ENOENT;
+		*drvp = driver + *ent;
+
+		return 0;
+	}
+
+	for (entry = driver; entry != driver + n_ents; entry++) {
+		if (!driver_check_compatible(entry->of_match, idp, compat)) {
+			*drvp = entry;
+			return 0;
+		}
+	}
+
+	return -ENOENT;
+}
+
+int lists_driver_lookup_compatible(const char *compat, struct driver **drvp,
+				   const struct udevice_id **idp)
+{
+	int ret;
+
+	bootstage_start(BOOTSTAGE_ID_ACCUM_DM_LOOKUP, "dm_lookup");
+	ret = driver_lookup_compatible(compat, drvp, idp);
+	bootstage_accum(BOOTSTAGE_ID_ACCUM_DM_LOOKUP);
+
+	return ret;
+}
+
+int lists_bind_fdt(struct udevice *parent, ofnode node, struct udevice **devp,
+		   bool pre_reloc_only)
+{
 	const struct udevice_id *id;
 	struct driver *entry;
 	struct udevice *dev;
@@ -165,13 +322,8 @@ int lists_bind_fdt(struct udevice *parent, ofnode node, struct udevice **devp,
 		log_debug("   - attempt to match compatible string '%s'\n",
 			  compat);
 
-		for (entry = driver; entry != driver + n_ents; entry++) {
-			ret = driver_check_compatible(entry->of_match, &id,
-						      compat);
-			if (!ret)
-				break;
-		}
-		if (entry == driver + n_ents)
+		ret = lists_driver_lookup_compatible(compat, &entry, &id);
+		if (ret)
 			continue;
 
 		if (pre_reloc_only) {
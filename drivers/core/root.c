@@ -144,6 +144,12 @@ int dm_init(bool of_live)
 	fix_uclass();
 	fix_devices();
 #endif
+#if CONFIG_IS_ENABLED(OF_CONTROL) && !CONFIG_IS_ENABLED(OF_PLATDATA)
+	/* This is only an optimisation, binding still works without it */
+	ret = lists_compat_index_init();
+	if (ret)
+		dm_warn("Cannot index driver compatible strings: %d\n", ret);
+#endif
 
 	ret = device_bind_by_name(NULL, false, &root_info, &DM_ROOT_NON_CONST);
 	if (ret)
@@ -168,6 +174,9 @@ int dm_uninit(void)
 	device_remove(dm_root(), DM_REMOVE_NORMAL);
 	device_unbind(dm_root());
 	gd->dm_root = NULL;
+#if CONFIG_IS_ENABLED(OF_CONTROL) && !CONFIG_IS_ENABLED(OF_PLATDATA)
+	lists_compat_index_free();
+#endif
 
 	return 0;
 }
@@ -0,0 +1,244 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * eMMC Command Queue Host Controller Interface
+ *
+ * There are no interrupts, so the engine is polled: a request fills every
+ * free slot, rings the doorbell for all of them at once and refills slots
+ * as their tasks complete. The card keeps working through the queued tasks
+ * without waiting for a new command between them.
+ */
+
+#include <common.h>
+#include <cpu_func.h>
+#include <cqhci.h>
+#include <errno.h>
+#include <malloc.h>
+#include <memalign.h>
+#include <mmc.h>
+
+/* Time allowed for the engine to complete at least one more task */
+#define CQHCI_TIMEOUT_MS	2000
+#define CQHCI_HALT_TIMEOUT_MS	100
+
+static ulong cqhci_desc_size(struct cqhci_host *cq)
+{
+	return CQHCI_NUM_SLOTS * cq->slot_sz;
+}
+
+static ulong cqhci_trans_size(struct cqhci_host *cq)
+{
+	return CQHCI_NUM_SLOTS * CQHCI_SEGS_PER_TASK * cq->trans_desc_len;
+}
+
+static void cqhci_flush_desc(struct cqhci_host *cq)
+{
+	ulong desc = (ulong)cq->desc, trans = (ulong)cq->trans;
+
+	flush_dcache_range(desc, desc + cqhci_desc_size(cq));
+	flush_dcache_range(trans, trans + cqhci_trans_size(cq));
+}
+
+/* Writes a link or transfer descriptor */
+static void cqhci_set_desc(struct cqhci_host *cq, u8 *desc, u32 attr,
+			   dma_addr_t addr)
+{
+	__le32 *d = (__le32 *)desc;
+
+	d[0] = cpu_to_le32(attr);
+	d[1] = cpu_to_le32(lower_32_bits(addr));
+	if (cq->dma64)
+		d[2] = cpu_to_le32(upper_32_bits(addr));
+}
+
+static void cqhci_prep_task(struct cqhci_host *cq, uint tag, bool read,
+			    uint blkaddr, char *buf, uint blocks)
+{
+	u8 *slot = cq->desc + tag * cq->slot_sz;
+	u8 *trans = cq->trans + tag * CQHCI_SEGS_PER_TASK * cq->trans_desc_len;
+	uint len = blocks * 512, seg;
+	u64 task;
+
+	task = CQHCI_VALID(1) | CQHCI_END(1) | CQHCI_INT(1) |
+	       CQHCI_ACT(CQHCI_ACT_TASK) | CQHCI_DATA_DIR(read) |
+	       CQHCI_BLK_COUNT(blocks) | CQHCI_BLK_ADDR(blkaddr);
+	*(__le64 *)slot = cpu_to_le64(task);
+
+	cqhci_set_desc(cq, slot + CQHCI_TASK_DESC_LEN,
+		       CQHCI_VALID(1) | CQHCI_ACT(CQHCI_ACT_LINK),
+		       (dma_addr_t)trans);
+
+	for (; len; len -= seg, buf += seg, trans += cq->trans_desc_len) {
+		seg = min_t(uint, len, CQHCI_MAX_SEG_SIZE);
+		cqhci_set_desc(cq, trans,
+			       CQHCI_VALID(1) | CQHCI_END(seg == len) |
+			       CQHCI_ACT(CQHCI_ACT_TRAN) |
+			       CQHCI_DAT_LENGTH(seg), (dma_addr_t)buf);
+	}
+}
+
+static void cqhci_enable(struct cqhci_host *cq)
+{
+	dma_addr_t desc = (dma_addr_t)cq->desc;
+	u32 cfg;
+
+	cq->ops->enable(cq);
+
+	cfg = cqhci_readl(cq, CQHCI_CFG);
+	cfg &= ~(CQHCI_ENABLE | CQHCI_DCMD | CQHCI_TASK_DESC_SZ);
+	cqhci_writel(cq, cfg, CQHCI_CFG);
+
+	cqhci_writel(cq, lower_32_bits(desc), CQHCI_TDLBA);
+	cqhci_writel(cq, upper_32_bits(desc), CQHCI_TDLBAU);
+	cqhci_writel(cq, cq->mmc->rca, CQHCI_SSC2);
+
+	/* Report status but raise no interrupt */
+	cqhci_writel(cq, CQHCI_IS_MASK, CQHCI_ISTE);
+	cqhci_writel(cq, 0, CQHCI_ISGE);
+	cqhci_writel(cq, cqhci_readl(cq, CQHCI_IS), CQHCI_IS);
+	cqhci_writel(cq, cqhci_readl(cq, CQHCI_TCN), CQHCI_TCN);
+
+	cqhci_writel(cq, cfg | CQHCI_ENABLE, CQHCI_CFG);
+
+	/* The engine comes out of reset halted */
+	if (cqhci_readl(cq, CQHCI_CTL) & CQHCI_HALT)
+		cqhci_writel(cq, 0, CQHCI_CTL);
+}
+
+static int cqhci_wait_ctl(struct cqhci_host *cq, u32 mask, u32 val)
+{
+	ulong start = get_timer(0);
+
+	while ((cqhci_readl(cq, CQHCI_CTL) & mask) != val) {
+		if (get_timer(start) > CQHCI_HALT_TIMEOUT_MS)
+			return -ETIMEDOUT;
+		udelay(10);
+	}
+
+	return 0;
+}
+
+static void cqhci_disable(struct cqhci_host *cq, bool recovery)
+{
+	if (recovery) {
+		cqhci_writel(cq, CQHCI_HALT, CQHCI_CTL);
+		if (cqhci_wait_ctl(cq, CQHCI_HALT, CQHCI_HALT))
+			debug("%s: engine did not halt\n", __func__);
+		cqhci_writel(cq, CQHCI_HALT | CQHCI_CLEAR_ALL_TASKS, CQHCI_CTL);
+		if (cqhci_wait_ctl(cq, CQHCI_CLEAR_ALL_TASKS, 0))
+			debug("%s: tasks were not cleared\n", __func__);
+	}
+
+	cqhci_writel(cq, cqhci_readl(cq, CQHCI_CFG) & ~CQHCI_ENABLE,
+		     CQHCI_CFG);
+	cq->ops->disable(cq, recovery);
+}
+
+/* Waits for at least one task in @busy to complete and returns them */
+static int cqhci_wait_tasks(struct cqhci_host *cq, u32 busy, u32 *done)
+{
+	ulong start = get_timer(0);
+	int ret;
+
+	for (;;) {
+		if (cqhci_readl(cq, CQHCI_IS) & CQHCI_IS_RED)
+			return -EIO;
+		ret = cq->ops->error(cq);
+		if (ret)
+			return ret;
+
+		*done = cqhci_readl(cq, CQHCI_TCN) & busy;
+		if (*done)
+			break;
+
+		if (get_timer(start) > CQHCI_TIMEOUT_MS)
+			return -ETIMEDOUT;
+	}
+
+	cqhci_writel(cq, *done, CQHCI_TCN);
+	cqhci_writel(cq, CQHCI_IS_TCC, CQHCI_IS);
+
+	return 0;
+}
+
+int cqhci_request(struct cqhci_host *cq, struct mmc_data *data, uint blkaddr)
+{
+	bool read = data->flags & MMC_DATA_READ;
+	ulong addr = (ulong)data->dest;
+	ulong len = (ulong)data->blocks * data->blocksize;
+	char *buf = data->dest;
+	uint left = data->blocks, depth, blocks, tag;
+	u32 idle, busy = 0, ring, done;
+	int ret = 0;
+
+	depth = min_t(uint, cq->mmc->cmdq_depth, CQHCI_NUM_SLOTS);
+	if (!cq->desc || !depth)
+		return -ENOSYS;
+	if (data->blocksize != 512 || !IS_ALIGNED(addr, ARCH_DMA_MINALIGN))
+		return -EINVAL;
+
+	idle = GENMASK(depth - 1, 0);
+	flush_dcache_range(addr, addr + len);
+	cqhci_enable(cq);
+
+	while (left || busy) {
+		ring = 0;
+		while (left && idle) {
+			tag = ffs(idle) - 1;
+			blocks = min_t(uint, left, CQHCI_MAX_TASK_BLOCKS);
+			cqhci_prep_task(cq, tag, read, blkaddr, buf, blocks);
+			ring |= BIT(tag);
+			idle &= ~BIT(tag);
+			blkaddr += blocks;
+			buf += blocks * 512;
+			left -= blocks;
+		}
+
+		if (ring) {
+			cqhci_flush_desc(cq);
+			cqhci_writel(cq, ring, CQHCI_TDBR);
+			busy |= ring;
+		}
+
+		ret = cqhci_wait_tasks(cq, busy, &done);
+		if (ret) {
+			debug("%s: tasks %08x failed (%d), TERRI %08x\n",
+			      __func__, busy, ret,
+			      cqhci_readl(cq, CQHCI_TERRI));
+			break;
+		}
+		busy &= ~done;
+		idle |= done;
+	}
+
+	cqhci_disable(cq, ret != 0);
+	if (read)
+		invalidate_dcache_range(addr, addr + len);
+
+	return ret;
+}
+
+int cqhci_init(struct cqhci_host *cq, struct mmc *mmc, bool dma64)
+{
+	cq->mmc = mmc;
+	cq->dma64 = dma64;
+	cq->trans_desc_len = dma64 ? 16 : 8;
+	cq->slot_sz = CQHCI_TASK_DESC_LEN + cq->trans_desc_len;
+
+	/* The task descriptor list must be 1KiB aligned */
+	cq->desc = memalign(SZ_1K, cqhci_desc_size(cq));
+	cq->trans = memalign(ARCH_DMA_MINALIGN, cqhci_trans_size(cq));
+	if (!cq->desc || !cq->trans) {
+		free(cq->desc);
+		free(cq->trans);
+		cq->desc = NULL;
+		cq->trans = NULL;
+		return -ENOMEM;
+	}
+	memset(cq->desc, 0, cqhci_desc_size(cq));
+	memset(cq->trans, 0, cqhci_trans_size(cq));
+
+	debug("%s: CQHCI version %08x\n", __func__,
+	      cqhci_readl(cq, CQHCI_VER));
+
+	return 0;
+}
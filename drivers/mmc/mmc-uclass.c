@@ -136,6 +136,23 @@ int mmc_host_power_cycle(struct mmc *mmc)
 	return dm_mmc_host_power_cycle(mmc->dev);
 }
 
+#if CONFIG_IS_ENABLED(MMC_CQHCI)
+int dm_mmc_cqe_request(struct udevice *dev, struct mmc_data *data,
+		       uint blkaddr)
+{
+	struct dm_mmc_ops *ops = mmc_get_ops(dev);
+
+	if (!ops->cqe_request)
+		return -ENOSYS;
+	return ops->cqe_request(dev, data, blkaddr);
+}
+
+int mmc_cqe_request(struct mmc *mmc, struct mmc_data *data, uint blkaddr)
+{
+	return dm_mmc_cqe_request(mmc->dev, data, blkaddr);
+}
+#endif
+
 int mmc_of_parse(struct udevice *dev, struct mmc_config *cfg)
 {
 	int val;
@@ -304,6 +304,20 @@ int mmc_set_blocklen(struct mmc *mmc, int len)
 	return err;
 }
 
+int mmc_set_blockcount(struct mmc *mmc, unsigned int blockcount,
+		       bool is_rel_write)
+{
+	struct mmc_cmd cmd = {0};
+
+	cmd.cmdidx = MMC_CMD_SET_BLOCK_COUNT;
+	cmd.cmdarg = blockcount & 0x0000FFFF;
+	if (is_rel_write)
+		cmd.cmdarg |= 1 << 31;
+	cmd.resp_type = MMC_RSP_R1;
+
+	return mmc_send_cmd(mmc, &cmd, NULL);
+}
+
 #ifdef MMC_SUPPORTS_TUNING
 static const u8 tuning_blk_pattern_4bit[] = {
 	0xff, 0x0f, 0xff, 0x00, 0xff, 0xcc, 0xc3, 0xcc,
@@ -379,6 +393,11 @@ static int mmc_read_blocks(struct mmc *mmc, void *dst, lbaint_t start,
 {
 	struct mmc_cmd cmd;
 	struct mmc_data data;
+	bool cmd23 = mmc_use_cmd23(mmc, blkcnt);
+
+	/* A pre-defined block count lets the card stop without a CMD12 */
+	if (cmd23 && mmc_set_blockcount(mmc, blkcnt, false))
+		return 0;
 
 	if (blkcnt > 1)
 		cmd.cmdidx = MMC_CMD_READ_MULTIPLE_BLOCK;
@@ -400,7 +419,7 @@ static int mmc_read_blocks(struct mmc *mmc, void *dst, lbaint_t start,
 	if (mmc_send_cmd(mmc, &cmd, &data))
 		return 0;
 
-	if (blkcnt > 1) {
+	if (blkcnt > 1 && !cmd23) {
 		cmd.cmdidx = MMC_CMD_STOP_TRANSMISSION;
 		cmd.cmdarg = 0;
 		cmd.resp_type = MMC_RSP_R1b;
@@ -415,6 +434,48 @@ static int mmc_read_blocks(struct mmc *mmc, void *dst, lbaint_t start,
 	return blkcnt;
 }
 
+#if CONFIG_IS_ENABLED(MMC_CQHCI)
+/* Below this size the two mode switches cost more than queueing saves */
+#define MMC_CQE_MIN_BLOCKS	2048
+
+int mmc_cqe_rw(struct mmc *mmc, lbaint_t start, lbaint_t blkcnt, void *buf,
+	       bool write)
+{
+	struct mmc_cmd cmd;
+	struct mmc_data data;
+	int ret, err;
+
+	if (!mmc->cmdq_depth || !(mmc->cfg->host_caps & MMC_CAP_CQE) ||
+	    !mmc->high_capacity || mmc->read_bl_len != MMC_MAX_BLOCK_LEN ||
+	    blkcnt < MMC_CQE_MIN_BLOCKS ||
+	    start + blkcnt > mmc_get_blk_desc(mmc)->lba ||
+	    mmc_get_blk_desc(mmc)->hwpart == MMC_PART_RPMB ||
+	    !IS_ALIGNED((ulong)buf, ARCH_DMA_MINALIGN))
+		return -ENOSYS;
+
+	if (mmc_switch(mmc, EXT_CSD_CMD_SET_NORMAL, EXT_CSD_CMDQ_MODE_EN, 1))
+		return -ENOSYS;
+
+	data.dest = buf;
+	data.blocks = blkcnt;
+	data.blocksize = MMC_MAX_BLOCK_LEN;
+	data.flags = write ? MMC_DATA_WRITE : MMC_DATA_READ;
+
+	ret = mmc_cqe_request(mmc, &data, start);
+	if (ret && ret != -ENOSYS) {
+		/* Drop whatever the card still holds before leaving CQ mode */
+		cmd.cmdidx = MMC_CMD_CMDQ_TASK_MGMT;
+		cmd.cmdarg = MMC_CMDQ_DISCARD_QUEUE;
+		cmd.resp_type = MMC_RSP_R1b;
+		mmc_send_cmd(mmc, &cmd, NULL);
+	}
+
+	err = mmc_switch(mmc, EXT_CSD_CMD_SET_NORMAL, EXT_CSD_CMDQ_MODE_EN, 0);
+
+	return ret ? ret : err;
+}
+#endif
+
 #if CONFIG_IS_ENABLED(BLK)
 ulong mmc_bread(struct udevice *dev, lbaint_t start, lbaint_t blkcnt, void *dst)
 #else
@@ -457,6 +518,12 @@ ulong mmc_bread(struct blk_desc *block_dev, lbaint_t start, lbaint_t blkcnt,
 		return 0;
 	}
 
+	err = mmc_cqe_rw(mmc, start, blkcnt, dst, false);
+	if (!err)
+		return blkcnt;
+	if (err != -ENOSYS)
+		return 0;
+
 	do {
 		cur = (blocks_todo > mmc->cfg->b_max) ?
 			mmc->cfg->b_max : blocks_todo;
@@ -1299,6 +1366,8 @@ retry_scr:
 
 	if (mmc->scr[0] & SD_DATA_4BIT)
 		mmc->card_caps |= MMC_MODE_4BIT;
+	if (mmc->scr[0] & SD_SCR_CMD23_SUPPORT)
+		mmc->cmd23 = true;
 
 	/* Version 1.0 doesn't support switching */
 	if (mmc->version == SD_VERSION_1_0)
@@ -2228,6 +2297,12 @@ static int mmc_startup_v4(struct mmc *mmc)
 		return -EINVAL;
 
 	mmc->version = mmc_versions[ext_csd[EXT_CSD_REV]];
+	mmc->cmd23 = true;
+
+	if (mmc->version >= MMC_VERSION_5_1 &&
+	    (ext_csd[EXT_CSD_CMDQ_SUPPORT] & EXT_CSD_CMDQ_SUPPORTED))
+		mmc->cmdq_depth = (ext_csd[EXT_CSD_CMDQ_DEPTH] &
+				   EXT_CSD_CMDQ_DEPTH_MASK) + 1;
 
 	if (mmc->version >= MMC_VERSION_4_2) {
 		/*
@@ -2552,6 +2627,8 @@ static int mmc_startup(struct mmc *mmc)
 	mmc->erase_grp_size = 1;
 #endif
 	mmc->part_config = MMCPART_NOAVAILABLE;
+	mmc->cmd23 = false;
+	mmc->cmdq_depth = 0;
 
 	err = mmc_startup_v4(mmc);
 	if (err)
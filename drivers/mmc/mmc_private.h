@@ -16,6 +16,8 @@ int mmc_send_status(struct mmc *mmc, unsigned int *status);
 int mmc_poll_for_busy(struct mmc *mmc, int timeout);
 
 int mmc_set_blocklen(struct mmc *mmc, int len);
+int mmc_set_blockcount(struct mmc *mmc, unsigned int blockcount,
+		       bool is_rel_write);
 #ifdef CONFIG_FSL_ESDHC_ADAPTER_IDENT
 void mmc_adapter_card_type_ident(void);
 #endif
@@ -135,4 +137,41 @@ int mmc_switch_part(struct mmc *mmc, unsigned int part_num);
  */
 int mmc_switch(struct mmc *mmc, u8 set, u8 index, u8 value);
 
+/**
+ * mmc_use_cmd23() - Check whether a transfer can be bounded by CMD23
+ *
+ * @mmc:	MMC device
+ * @blkcnt:	Number of blocks in the transfer
+ * @return true to send SET_BLOCK_COUNT instead of STOP_TRANSMISSION
+ */
+static inline bool mmc_use_cmd23(struct mmc *mmc, lbaint_t blkcnt)
+{
+	return blkcnt > 1 && blkcnt <= 0xffff && mmc->cmd23 &&
+	       (mmc->cfg->host_caps & MMC_CAP_CMD23);
+}
+
+/**
+ * mmc_cqe_rw() - Transfer blocks through the host command queue engine
+ *
+ * The card is put in command queue mode for the duration of the transfer.
+ *
+ * @mmc:	MMC device
+ * @start:	First block to transfer
+ * @blkcnt:	Number of blocks to transfer
+ * @buf:	Buffer to read into or write from
+ * @write:	true to write to the card
+ * @return 0 if OK, -ENOSYS if the transfer should be done without the
+ * engine, other -ve on error
+ */
+#if CONFIG_IS_ENABLED(MMC_CQHCI)
+int mmc_cqe_rw(struct mmc *mmc, lbaint_t start, lbaint_t blkcnt, void *buf,
+	       bool write);
+#else
+static inline int mmc_cqe_rw(struct mmc *mmc, lbaint_t start,
+			     lbaint_t blkcnt, void *buf, bool write)
+{
+	return -ENOSYS;
+}
+#endif
+
 #endif /* _MMC_PRIVATE_H_ */
@@ -16,6 +16,8 @@
 
 /* 400KHz is max freq for card ID etc. Use that as min */
 #define EMMC_MIN_FREQ	400000
+/* Registers of the Arasan command queue engine, from the SDHCI base */
+#define ARASAN_CQE_BASE_ADDR	0x200
 
 struct rockchip_sdhc_plat {
 #if CONFIG_IS_ENABLED(OF_PLATDATA)
@@ -68,6 +70,10 @@ static int arasan_sdhci_probe(struct udevice *dev)
 	if (host->bus_width == 8)
 		host->host_caps |= MMC_MODE_8BIT;
 
+#if CONFIG_IS_ENABLED(MMC_CQHCI)
+	host->cqe.ioaddr = host->ioaddr + ARASAN_CQE_BASE_ADDR;
+#endif
+
 	host->mmc = &plat->mmc;
 	host->mmc->priv = &prv->host;
 	host->mmc->dev = dev;
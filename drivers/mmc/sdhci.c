@@ -618,6 +618,64 @@ static int sdhci_set_ios(struct mmc *mmc)
 	return 0;
 }
 
+#if CONFIG_IS_ENABLED(MMC_CQHCI)
+static void sdhci_cqe_enable(struct cqhci_host *cq)
+{
+	struct sdhci_host *host = container_of(cq, struct sdhci_host, cqe);
+	u8 ctrl;
+
+	/* The engine fetches data through ADMA2 descriptors */
+	ctrl = sdhci_readb(host, SDHCI_HOST_CONTROL);
+	ctrl &= ~SDHCI_CTRL_DMA_MASK;
+	ctrl |= cq->dma64 ? SDHCI_CTRL_ADMA64 : SDHCI_CTRL_ADMA32;
+	sdhci_writeb(host, ctrl, SDHCI_HOST_CONTROL);
+
+	sdhci_writew(host, SDHCI_MAKE_BLKSZ(SDHCI_DEFAULT_BOUNDARY_ARG, 512),
+		     SDHCI_BLOCK_SIZE);
+	sdhci_writeb(host, 0xe, SDHCI_TIMEOUT_CONTROL);
+
+	sdhci_writel(host, SDHCI_INT_ALL_MASK, SDHCI_INT_STATUS);
+	sdhci_writel(host, SDHCI_INT_CQE | SDHCI_CQE_INT_ERR_MASK,
+		     SDHCI_INT_ENABLE);
+}
+
+static void sdhci_cqe_disable(struct cqhci_host *cq, bool recovery)
+{
+	struct sdhci_host *host = container_of(cq, struct sdhci_host, cqe);
+
+	sdhci_writel(host, SDHCI_INT_ALL_MASK, SDHCI_INT_STATUS);
+	sdhci_writel(host, SDHCI_INT_DATA_MASK | SDHCI_INT_CMD_MASK,
+		     SDHCI_INT_ENABLE);
+
+	if (recovery) {
+		sdhci_reset(host, SDHCI_RESET_CMD);
+		sdhci_reset(host, SDHCI_RESET_DATA);
+	}
+}
+
+static int sdhci_cqe_error(struct cqhci_host *cq)
+{
+	struct sdhci_host *host = container_of(cq, struct sdhci_host, cqe);
+	u32 stat;
+
+	stat = sdhci_readl(host, SDHCI_INT_STATUS) & SDHCI_CQE_INT_ERR_MASK;
+	if (!stat)
+		return 0;
+
+	pr_debug("%s: Error detected in status(0x%X)!\n", __func__, stat);
+	sdhci_writel(host, stat, SDHCI_INT_STATUS);
+
+	return stat & (SDHCI_INT_TIMEOUT | SDHCI_INT_DATA_TIMEOUT) ?
+		-ETIMEDOUT : -EIO;
+}
+
+static const struct cqhci_host_ops sdhci_cqe_ops = {
+	.enable		= sdhci_cqe_enable,
+	.disable	= sdhci_cqe_disable,
+	.error		= sdhci_cqe_error,
+};
+#endif
+
 static int sdhci_init(struct mmc *mmc)
 {
 	struct sdhci_host *host = mmc->priv;
@@ -650,6 +708,16 @@ static int sdhci_init(struct mmc *mmc)
 	/* Mask all sdhci interrupt sources */
 	sdhci_writel(host, 0x0, SDHCI_SIGNAL_ENABLE);
 
+#if CONFIG_IS_ENABLED(MMC_CQHCI)
+	if ((mmc->cfg->host_caps & MMC_CAP_CQE) && !host->cqe.desc) {
+		host->cqe.ops = &sdhci_cqe_ops;
+		if (cqhci_init(&host->cqe, mmc,
+			       IS_ENABLED(CONFIG_DMA_ADDR_T_64BIT)))
+			printf("%s: Command queue engine alloc failed\n",
+			       __func__);
+	}
+#endif
+
 	return 0;
 }
 
@@ -691,6 +759,17 @@ static int sdhci_get_cd(struct udevice *dev)
 		return value;
 }
 
+#if CONFIG_IS_ENABLED(MMC_CQHCI)
+static int sdhci_cqe_request(struct udevice *dev, struct mmc_data *data,
+			     uint blkaddr)
+{
+	struct mmc *mmc = mmc_get_mmc_dev(dev);
+	struct sdhci_host *host = mmc->priv;
+
+	return cqhci_request(&host->cqe, data, blkaddr);
+}
+#endif
+
 const struct dm_mmc_ops sdhci_ops = {
 	.send_cmd	= sdhci_send_command,
 	.set_ios	= sdhci_set_ios,
@@ -698,6 +777,9 @@ const struct dm_mmc_ops sdhci_ops = {
 #ifdef MMC_SUPPORTS_TUNING
 	.execute_tuning	= sdhci_execute_tuning,
 #endif
+#if CONFIG_IS_ENABLED(MMC_CQHCI)
+	.cqe_request	= sdhci_cqe_request,
+#endif
 };
 #else
 static const struct mmc_ops sdhci_ops = {
@@ -817,6 +899,16 @@ int sdhci_setup_cfg(struct mmc_config *cfg, struct sdhci_host *host,
 
 	cfg->host_caps |= MMC_MODE_HS | MMC_MODE_HS_52MHz | MMC_MODE_4BIT;
 
+	/* Auto-CMD12 is never used, so CMD23 can bound transfers instead */
+	cfg->host_caps |= MMC_CAP_CMD23;
+
+#if CONFIG_IS_ENABLED(MMC_CQHCI)
+	/* The engine needs ADMA2, with 64-bit addressing if pointers are */
+	if (host->cqe.ioaddr && (caps & SDHCI_CAN_DO_ADMA2) &&
+	    (!IS_ENABLED(CONFIG_DMA_ADDR_T_64BIT) || (caps & SDHCI_CAN_64BIT)))
+		cfg->host_caps |= MMC_CAP_CQE;
+#endif
+
 	/* Since Host Controller Version3.0 */
 	if (SDHCI_GET_VERSION(host) >= SDHCI_SPEC_300) {
 		if (!(caps & SDHCI_CAN_DO_8BIT))
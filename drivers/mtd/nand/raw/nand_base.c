@@ -1110,6 +1110,31 @@ int nand_read_page_op(struct nand_chip *chip, unsigned int page,
 }
 EXPORT_SYMBOL_GPL(nand_read_page_op);
 
+/**
+ * nand_read_cache_op - Do a READ CACHE SEQUENTIAL or READ CACHE END operation
+ * @chip: The NAND chip
+ * @last: true to end the sequence, false to read the next page as well
+ *
+ * This function must follow a READ PAGE operation or another READ CACHE
+ * SEQUENTIAL one. It moves the page read by that operation to the cache
+ * register, where its data can be read from column 0 on. Unless @last is set,
+ * the chip then reads the next page from the array while the data is being
+ * transferred.
+ * This function does not select/unselect the CS line.
+ *
+ * Returns 0 on success, a negative error code otherwise.
+ */
+int nand_read_cache_op(struct nand_chip *chip, bool last)
+{
+	struct mtd_info *mtd = nand_to_mtd(chip);
+
+	chip->cmdfunc(mtd, last ? NAND_CMD_READCACHEEND : NAND_CMD_READCACHESEQ,
+		      -1, -1);
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(nand_read_cache_op);
+
 /**
  * nand_read_param_page_op - Do a READ PARAMETER PAGE operation
  * @chip: The NAND chip
@@ -2316,6 +2341,18 @@ static int nand_do_read_ops(struct mtd_info *mtd, loff_t from,
 	unsigned int max_bitflips = 0;
 	int retry_mode = 0;
 	bool ecc_fail = false;
+	const int ppb_mask = (1 << (chip->phys_erase_shift -
+				    chip->page_shift)) - 1;
+	bool cache_read, cache_busy = false, next;
+
+	/*
+	 * With cache reads, the chip reads the next page from the array while
+	 * the current one is transferred. Sequences stop at block boundaries,
+	 * which keeps them within a LUN, and before a page that is served
+	 * from the page buffer.
+	 */
+	cache_read = NAND_HAS_CACHEREAD(chip) &&
+		     nand_standard_page_accessors(&chip->ecc);
 
 	chipnr = (int)(from >> chip->chip_shift);
 	chip->select_chip(mtd, chipnr);
@@ -2354,7 +2391,21 @@ static int nand_do_read_ops(struct mtd_info *mtd, loff_t from,
 
 read_retry:
 			if (nand_standard_page_accessors(&chip->ecc)) {
-				ret = nand_read_page_op(chip, page, 0, NULL, 0);
+				/*
+				 * The next page must be read from the array,
+				 * not from the page buffer
+				 */
+				next = cache_read && readlen > bytes &&
+				       ((page + 1) & ppb_mask) &&
+				       (realpage + 1 != chip->pagebuf || oob);
+				/* ret may hold the last page's bitflips */
+				ret = 0;
+				if (!cache_busy)
+					ret = nand_read_page_op(chip, page, 0,
+								NULL, 0);
+				if (!ret && (cache_busy || next))
+					ret = nand_read_cache_op(chip, !next);
+				cache_busy = next;
 				if (ret)
 					break;
 			}
@@ -2418,6 +2469,12 @@ read_retry:
 
 			if (mtd->ecc_stats.failed - ecc_failures) {
 				if (retry_mode + 1 < chip->read_retries) {
+					/* Retry modes need an idle chip */
+					if (cache_busy)
+						nand_read_cache_op(chip, true);
+					cache_busy = false;
+					cache_read = false;
+
 					retry_mode++;
 					ret = nand_setup_read_retry(mtd,
 							retry_mode);
@@ -2467,6 +2524,9 @@ read_retry:
 			chip->select_chip(mtd, chipnr);
 		}
 	}
+	/* Let the chip finish reading ahead if the loop was left early */
+	if (cache_busy)
+		nand_read_cache_op(chip, true);
 	chip->select_chip(mtd, -1);
 
 	ops->retlen = ops->len - (size_t) readlen;
@@ -3945,6 +4005,9 @@ static int nand_flash_detect_onfi(struct mtd_info *mtd, struct nand_chip *chip,
 	if (!mtd->name)
 		mtd->name = p->model;
 
+	if (le16_to_cpu(p->opt_cmd) & ONFI_OPT_CMD_READ_CACHE)
+		chip->options |= NAND_CACHERD;
+
 	mtd->writesize = le32_to_cpu(p->byte_per_page);
 
 	/*
@@ -5258,6 +5321,16 @@ int nand_scan_tail(struct mtd_info *mtd)
 		break;
 	}
 
+	/*
+	 * Cache reads need a cmdfunc which knows the READ CACHE commands, and
+	 * ECC read methods which only ever change the read column.
+	 */
+	if ((chip->cmdfunc != nand_command_lp &&
+	     !(chip->options & NAND_CMDFUNC_CACHERD)) ||
+	    ecc->mode == NAND_ECC_HW_OOB_FIRST ||
+	    (chip->options & NAND_NEED_READRDY))
+		chip->options &= ~NAND_CACHERD;
+
 	/* Fill in remaining MTD driver data */
 	mtd->type = nand_is_slc(chip) ? MTD_NANDFLASH : MTD_MLCNANDFLASH;
 	mtd->flags = (chip->options & NAND_ROM) ? MTD_CAP_ROM :
@@ -799,6 +799,96 @@ out_unlock:
 	return err;
 }
 
+/**
+ * scan_is_bad - check if a PEB is bad when scanning.
+ * @ubi: UBI device description object
+ * @pnum: the physical eraseblock number
+ *
+ * This is 'ubi_io_is_bad()', except that the answer is taken from the attach
+ * cache if it is being replayed, and recorded in it otherwise.
+ */
+static int scan_is_bad(struct ubi_device *ubi, int pnum)
+{
+	struct ubi_ac_peb *acp = ubi_ac_peb(ubi, pnum);
+	int err;
+
+	if (acp && ubi->ac->replay)
+		return acp->bad;
+
+	err = ubi_io_is_bad(ubi, pnum);
+	if (acp && err >= 0) {
+		memset(acp, 0, sizeof(*acp));
+		acp->corrupt = -1;
+		if (err) {
+			acp->bad = 1;
+			acp->known = 1;
+		}
+	}
+
+	return err;
+}
+
+/**
+ * scan_read_hdrs - read the EC and VID headers of a PEB when scanning.
+ * @ubi: UBI device description object
+ * @pnum: the physical eraseblock number
+ * @vid_err: where to store the result of reading the VID header
+ *
+ * This function reads the headers of PEB @pnum to @ech and @vidh and returns
+ * the same codes as 'ubi_io_read_hdrs()'. Like 'scan_is_bad()', it replays
+ * the attach cache if there is one to replay, or records in it.
+ */
+static int scan_read_hdrs(struct ubi_device *ubi, int pnum, int *vid_err)
+{
+	struct ubi_ac_peb *acp = ubi_ac_peb(ubi, pnum);
+	int err;
+
+	if (acp && ubi->ac->replay) {
+		memset(ech, 0, UBI_EC_HDR_SIZE);
+		ech->version = acp->version;
+		ech->image_seq = acp->image_seq;
+		ech->ec = acp->ec;
+		memcpy(vidh, &acp->vid_hdr, UBI_VID_HDR_SIZE);
+		*vid_err = acp->vid_err;
+		return acp->ec_err;
+	}
+
+	err = ubi_io_read_hdrs(ubi, pnum, ech, vidh, vid_err);
+	if (acp && err >= 0) {
+		acp->known = 1;
+		acp->ec_err = err;
+		acp->vid_err = *vid_err;
+		acp->version = ech->version;
+		acp->image_seq = ech->image_seq;
+		acp->ec = ech->ec;
+		memcpy(&acp->vid_hdr, vidh, UBI_VID_HDR_SIZE);
+	}
+
+	return err;
+}
+
+/**
+ * scan_check_corruption - 'check_corruption()' going through the attach cache.
+ * @ubi: UBI device description object
+ * @vid_hdr: the (corrupted) VID header of this PEB
+ * @pnum: the physical eraseblock number to check
+ */
+static int scan_check_corruption(struct ubi_device *ubi,
+				 struct ubi_vid_hdr *vid_hdr, int pnum)
+{
+	struct ubi_ac_peb *acp = ubi_ac_peb(ubi, pnum);
+	int err;
+
+	if (acp && ubi->ac->replay && acp->corrupt >= 0)
+		return acp->corrupt;
+
+	err = check_corruption(ubi, vid_hdr, pnum);
+	if (acp)
+		acp->corrupt = err;
+
+	return err;
+}
+
 /**
  * scan_peb - scan and process UBI headers of a PEB.
  * @ubi: UBI device description object
@@ -816,12 +906,12 @@ static int scan_peb(struct ubi_device *ubi, struct ubi_attach_info *ai,
 		    int pnum, int *vid, unsigned long long *sqnum)
 {
 	long long uninitialized_var(ec);
-	int err, bitflips = 0, vol_id = -1, ec_err = 0;
+	int err, bitflips = 0, vol_id = -1, ec_err = 0, vid_err;
 
 	dbg_bld("scan PEB %d", pnum);
 
 	/* Skip bad physical eraseblocks */
-	err = ubi_io_is_bad(ubi, pnum);
+	err = scan_is_bad(ubi, pnum);
 	if (err < 0)
 		return err;
 	else if (err) {
@@ -829,7 +919,8 @@ static int scan_peb(struct ubi_device *ubi, struct ubi_attach_info *ai,
 		return 0;
 	}
 
-	err = ubi_io_read_ec_hdr(ubi, pnum, ech, 0);
+	/* Both headers are read at once, the VID header is looked at later */
+	err = scan_read_hdrs(ubi, pnum, &vid_err);
 	if (err < 0)
 		return err;
 	switch (err) {
@@ -912,7 +1003,7 @@ static int scan_peb(struct ubi_device *ubi, struct ubi_attach_info *ai,
 
 	/* OK, we've done with the EC header, let's look at the VID header */
 
-	err = ubi_io_read_vid_hdr(ubi, pnum, vidh, 0);
+	err = vid_err;
 	if (err < 0)
 		return err;
 	switch (err) {
@@ -950,7 +1041,7 @@ static int scan_peb(struct ubi_device *ubi, struct ubi_attach_info *ai,
 			 * The EC was OK, but the VID header is corrupted. We
 			 * have to check what is in the data area.
 			 */
-			err = check_corruption(ubi, vidh, pnum);
+			err = scan_check_corruption(ubi, vidh, pnum);
 
 		if (err < 0)
 			return err;
@@ -1248,6 +1339,7 @@ static int scan_all(struct ubi_device *ubi, struct ubi_attach_info *ai,
 	}
 
 	ubi_msg(ubi, "scanning is finished");
+	ubi_ac_scanned(ubi, 0);
 
 	/* Calculate mean erase counter */
 	if (ai->ec_count)
@@ -1293,6 +1385,7 @@ out_vidh:
 	ubi_free_vid_hdr(ubi, vidh);
 out_ech:
 	kfree(ech);
+	ubi_ac_scanned(ubi, err);
 	return err;
 }
 
@@ -1403,6 +1496,10 @@ int ubi_attach(struct ubi_device *ubi, int force_scan)
 	if (!ai)
 		return -ENOMEM;
 
+	/* Scan results kept from an earlier attach beat looking for fastmap */
+	if (ubi_ac_attach(ubi))
+		force_scan = 1;
+
 #ifdef CONFIG_MTD_UBI_FASTMAP
 	/* On small flash devices we disable fastmap in any case. */
 	if ((int)mtd_div_by_eb(ubi->mtd->size, ubi->mtd) <= UBI_FM_MAX_START) {
@@ -0,0 +1,292 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * UBI attach cache.
+ *
+ * Without fastmap, attaching an MTD device means reading the EC and VID
+ * headers of every physical eraseblock. U-Boot attaches and detaches the
+ * same devices over and over: "ubi part" detaches the current device before
+ * attaching another one, and so does the UBI environment code. This
+ * sub-system keeps what scanning found in each PEB after the device has been
+ * detached, so that attaching the same MTD device again replays those
+ * results instead of reading the flash.
+ *
+ * While the device is attached, the results are kept in step with the flash
+ * by applying every header written, every erasure and every bad block marking
+ * UBI does. Once the device has been detached, other writes are caught by the
+ * change count of the MTD device, see 'mtd_write_gen()'. That only works if
+ * they go through the MTD API, which in U-Boot is the case for NAND but not
+ * for NOR flash: "sf write" calls the SPI NOR driver directly and "cp" writes
+ * to CFI flash without MTD. So only NAND devices are cached. Before the
+ * results are replayed, the headers of the PEB with the highest sequence
+ * number are read back and compared, as that is the PEB most recently
+ * written by UBI.
+ *
+ * The results only live in memory. Keeping them on flash for the next boot
+ * would not be safe: after Linux has run, an unmapped LEB leaves behind an
+ * erased PEB that a check of the highest sequence number does not see, and
+ * only reading every EC header again would catch it.
+ */
+
+#include <ubi_uboot.h>
+#include <linux/compat.h>
+#include "ubi.h"
+
+static LIST_HEAD(ubi_attach_caches);
+
+static struct mtd_info *mtd_master(struct mtd_info *mtd)
+{
+	while (mtd->parent)
+		mtd = mtd->parent;
+
+	return mtd;
+}
+
+static u64 mtd_master_offset(struct mtd_info *mtd)
+{
+	u64 offset = 0;
+
+	for (; mtd->parent; mtd = mtd->parent)
+		offset += mtd->offset;
+
+	return offset;
+}
+
+/**
+ * find_cache - find the attach cache of the MTD device of a UBI device.
+ * @ubi: UBI device description object
+ */
+static struct ubi_attach_cache *find_cache(struct ubi_device *ubi)
+{
+	struct mtd_info *master = mtd_master(ubi->mtd);
+	u64 offset = mtd_master_offset(ubi->mtd);
+	struct ubi_attach_cache *ac;
+
+	list_for_each_entry(ac, &ubi_attach_caches, list) {
+		if (ac->master == master && ac->offset == offset &&
+		    ac->size == ubi->mtd->size &&
+		    ac->vid_hdr_offset == ubi->vid_hdr_offset &&
+		    ac->peb_size == ubi->peb_size &&
+		    ac->peb_count == ubi->peb_count)
+			return ac;
+	}
+
+	return NULL;
+}
+
+/**
+ * check_cache - check the attach cache against the flash.
+ * @ubi: UBI device description object
+ * @ac: the attach cache
+ *
+ * This function reads back the headers of the PEB holding the highest
+ * sequence number and returns zero if they are what the cache says, %1 if
+ * not and a negative error code in case of failure.
+ */
+static int check_cache(struct ubi_device *ubi, struct ubi_attach_cache *ac)
+{
+	unsigned long long sqnum, max_sqnum = 0;
+	int pnum, max_pnum = -1, err, vid_err;
+	struct ubi_ac_peb *acp;
+	struct ubi_ec_hdr *ec_hdr;
+	struct ubi_vid_hdr *vid_hdr;
+
+	for (pnum = 0; pnum < ac->peb_count; pnum++) {
+		acp = &ac->peb[pnum];
+		if (acp->bad || acp->ec_err == UBI_IO_FF ||
+		    acp->ec_err == UBI_IO_FF_BITFLIPS ||
+		    (acp->vid_err != 0 && acp->vid_err != UBI_IO_BITFLIPS))
+			continue;
+		sqnum = be64_to_cpu(acp->vid_hdr.sqnum);
+		if (max_pnum < 0 || sqnum > max_sqnum) {
+			max_sqnum = sqnum;
+			max_pnum = pnum;
+		}
+	}
+
+	/* Nothing has been written to the device yet */
+	if (max_pnum < 0)
+		return 0;
+
+	ec_hdr = kzalloc(ubi->ec_hdr_alsize, GFP_KERNEL);
+	if (!ec_hdr)
+		return -ENOMEM;
+
+	vid_hdr = ubi_zalloc_vid_hdr(ubi, GFP_KERNEL);
+	if (!vid_hdr) {
+		kfree(ec_hdr);
+		return -ENOMEM;
+	}
+
+	acp = &ac->peb[max_pnum];
+	err = ubi_io_read_hdrs(ubi, max_pnum, ec_hdr, vid_hdr, &vid_err);
+	if (err >= 0)
+		err = err != acp->ec_err || vid_err != acp->vid_err ||
+		      ec_hdr->ec != acp->ec ||
+		      memcmp(vid_hdr, &acp->vid_hdr, UBI_VID_HDR_SIZE);
+
+	ubi_free_vid_hdr(ubi, vid_hdr);
+	kfree(ec_hdr);
+
+	return err;
+}
+
+/**
+ * ubi_ac_attach - set up the attach cache for attaching an MTD device.
+ * @ubi: UBI device description object
+ *
+ * This function returns %1 if the MTD device has valid scan results which
+ * scanning should replay, and zero if it has to read the flash. In the latter
+ * case the results are recorded while scanning, if the device is NAND and
+ * memory allows.
+ */
+int ubi_ac_attach(struct ubi_device *ubi)
+{
+	struct ubi_attach_cache *ac;
+
+	ubi->ac = NULL;
+	if (!mtd_type_is_nand(ubi->mtd))
+		return 0;
+
+	ac = find_cache(ubi);
+	if (ac && ac->valid && ac->write_gen == mtd_write_gen(ubi->mtd)) {
+		ubi->ac = ac;
+		if (!check_cache(ubi, ac)) {
+			ubi_msg(ubi, "using scan results from the last attach");
+			ac->replay = 1;
+			return 1;
+		}
+	}
+
+	if (!ac) {
+		ac = vzalloc(sizeof(*ac) + ubi->peb_count * sizeof(ac->peb[0]));
+		if (!ac)
+			return 0;
+		ac->master = mtd_master(ubi->mtd);
+		ac->offset = mtd_master_offset(ubi->mtd);
+		ac->size = ubi->mtd->size;
+		ac->vid_hdr_offset = ubi->vid_hdr_offset;
+		ac->peb_size = ubi->peb_size;
+		ac->peb_count = ubi->peb_count;
+		list_add(&ac->list, &ubi_attach_caches);
+	}
+
+	ac->valid = 0;
+	ac->replay = 0;
+	memset(ac->peb, 0, ac->peb_count * sizeof(ac->peb[0]));
+	ubi->ac = ac;
+
+	return 0;
+}
+
+/**
+ * ubi_ac_scanned - note that scanning has finished.
+ * @ubi: UBI device description object
+ * @err: zero if scanning succeeded, a negative error code otherwise
+ *
+ * The scan results become valid if every PEB has been scanned.
+ */
+void ubi_ac_scanned(struct ubi_device *ubi, int err)
+{
+	struct ubi_attach_cache *ac = ubi->ac;
+	int pnum;
+
+	if (!ac)
+		return;
+
+	ac->replay = 0;
+	ac->valid = 0;
+	if (err)
+		return;
+
+	for (pnum = 0; pnum < ac->peb_count; pnum++)
+		if (!ac->peb[pnum].known)
+			return;
+
+	ac->valid = 1;
+	ac->write_gen = mtd_write_gen(ubi->mtd);
+}
+
+/**
+ * ubi_ac_detach - keep the scan results when detaching an MTD device.
+ * @ubi: UBI device description object
+ */
+void ubi_ac_detach(struct ubi_device *ubi)
+{
+	struct ubi_attach_cache *ac = ubi->ac;
+
+	if (ac && ac->valid)
+		ac->write_gen = mtd_write_gen(ubi->mtd);
+	ubi->ac = NULL;
+}
+
+/**
+ * changed_peb - get the scan results of a PEB UBI has changed.
+ * @ubi: UBI device description object
+ * @pnum: the physical eraseblock number
+ * @err: zero if the change succeeded, a negative error code otherwise
+ *
+ * This function returns %NULL if there are no valid results to update. If the
+ * change failed, what the flash holds is unknown, so the results are dropped.
+ */
+static struct ubi_ac_peb *changed_peb(const struct ubi_device *ubi, int pnum,
+				      int err)
+{
+	struct ubi_attach_cache *ac = ubi->ac;
+
+	if (!ac || !ac->valid)
+		return NULL;
+	if (err) {
+		ac->valid = 0;
+		return NULL;
+	}
+
+	return &ac->peb[pnum];
+}
+
+void ubi_ac_write_ec_hdr(const struct ubi_device *ubi, int pnum,
+			 const struct ubi_ec_hdr *ec_hdr, int err)
+{
+	struct ubi_ac_peb *acp = changed_peb(ubi, pnum, err);
+
+	if (!acp)
+		return;
+
+	acp->ec_err = 0;
+	acp->version = ec_hdr->version;
+	acp->image_seq = ec_hdr->image_seq;
+	acp->ec = ec_hdr->ec;
+	acp->corrupt = -1;
+}
+
+void ubi_ac_write_vid_hdr(const struct ubi_device *ubi, int pnum,
+			  const struct ubi_vid_hdr *vid_hdr, int err)
+{
+	struct ubi_ac_peb *acp = changed_peb(ubi, pnum, err);
+
+	if (!acp)
+		return;
+
+	acp->vid_err = 0;
+	memcpy(&acp->vid_hdr, vid_hdr, UBI_VID_HDR_SIZE);
+	acp->corrupt = -1;
+}
+
+void ubi_ac_erase(const struct ubi_device *ubi, int pnum, int err)
+{
+	struct ubi_ac_peb *acp = changed_peb(ubi, pnum, err);
+
+	if (!acp)
+		return;
+
+	acp->ec_err = UBI_IO_FF;
+	acp->vid_err = UBI_IO_FF;
+	acp->corrupt = -1;
+}
+
+void ubi_ac_mark_bad(const struct ubi_device *ubi, int pnum, int err)
+{
+	struct ubi_ac_peb *acp = changed_peb(ubi, pnum, err);
+
+	if (acp)
+		acp->bad = 1;
+}
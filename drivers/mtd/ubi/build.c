@@ -33,6 +33,7 @@
 #include <linux/log2.h>
 #endif
 #include <linux/err.h>
+#include <bootstage.h>
 #include <ubi_uboot.h>
 #include <linux/mtd/partitions.h>
 
@@ -1002,7 +1003,9 @@ int ubi_attach_mtd_dev(struct mtd_info *mtd, int ubi_num,
 	if (!ubi->fm_buf)
 		goto out_free;
 #endif
+	bootstage_start(BOOTSTAGE_ID_ACCUM_UBI, "ubi_attach");
 	err = ubi_attach(ubi, 0);
+	bootstage_accum(BOOTSTAGE_ID_ACCUM_UBI);
 	if (err) {
 		ubi_err(ubi, "failed to attach mtd%d, error %d",
 			mtd->index, err);
@@ -1157,6 +1160,7 @@ int ubi_detach_mtd_dev(int ubi_num, int anyway)
 	ubi_wl_close(ubi);
 	ubi_free_internal_volumes(ubi);
 	vfree(ubi->vtbl);
+	ubi_ac_detach(ubi);
 	put_mtd_device(ubi->mtd);
 	vfree(ubi->peb_buf);
 	vfree(ubi->fm_buf);
@@ -94,6 +94,11 @@ static int self_check_vid_hdr(const struct ubi_device *ubi, int pnum,
 			      const struct ubi_vid_hdr *vid_hdr);
 static int self_check_write(struct ubi_device *ubi, const void *buf, int pnum,
 			    int offset, int len);
+static int check_ec_hdr(struct ubi_device *ubi, int pnum,
+			struct ubi_ec_hdr *ec_hdr, int read_err, int verbose);
+static int check_vid_hdr(struct ubi_device *ubi, int pnum,
+			 struct ubi_vid_hdr *vid_hdr, int read_err,
+			 int verbose);
 
 /**
  * ubi_io_read - read data from a physical eraseblock.
@@ -577,16 +582,21 @@ int ubi_io_sync_erase(struct ubi_device *ubi, int pnum, int torture)
 	if (ubi->nor_flash) {
 		err = nor_erase_prepare(ubi, pnum);
 		if (err)
-			return err;
+			goto out;
 	}
 
 	if (torture) {
 		ret = torture_peb(ubi, pnum);
-		if (ret < 0)
-			return ret;
+		if (ret < 0) {
+			err = ret;
+			goto out;
+		}
 	}
 
 	err = do_sync_erase(ubi, pnum);
+
+out:
+	ubi_ac_erase(ubi, pnum, err);
 	if (err)
 		return err;
 
@@ -646,6 +656,7 @@ int ubi_io_mark_bad(const struct ubi_device *ubi, int pnum)
 		return 0;
 
 	err = mtd_block_markbad(mtd, (loff_t)pnum * ubi->peb_size);
+	ubi_ac_mark_bad(ubi, pnum, err);
 	if (err)
 		ubi_err(ubi, "cannot mark PEB %d bad, error %d", pnum, err);
 	return err;
@@ -726,13 +737,31 @@ bad:
 int ubi_io_read_ec_hdr(struct ubi_device *ubi, int pnum,
 		       struct ubi_ec_hdr *ec_hdr, int verbose)
 {
-	int err, read_err;
-	uint32_t crc, magic, hdr_crc;
+	int read_err;
 
 	dbg_io("read EC header from PEB %d", pnum);
 	ubi_assert(pnum >= 0 && pnum < ubi->peb_count);
 
 	read_err = ubi_io_read(ubi, ec_hdr, pnum, 0, UBI_EC_HDR_SIZE);
+	return check_ec_hdr(ubi, pnum, ec_hdr, read_err, verbose);
+}
+
+/**
+ * check_ec_hdr - check an erase counter header which has been read.
+ * @ubi: UBI device description object
+ * @pnum: physical eraseblock the header was read from
+ * @ec_hdr: the erase counter header
+ * @read_err: what 'ubi_io_read()' returned when reading the header
+ * @verbose: be verbose if the header is corrupted or was not found
+ *
+ * This function returns the same codes as 'ubi_io_read_ec_hdr()'.
+ */
+static int check_ec_hdr(struct ubi_device *ubi, int pnum,
+			struct ubi_ec_hdr *ec_hdr, int read_err, int verbose)
+{
+	int err;
+	uint32_t crc, magic, hdr_crc;
+
 	if (read_err) {
 		if (read_err != UBI_IO_BITFLIPS && !mtd_is_eccerr(read_err))
 			return read_err;
@@ -857,6 +886,7 @@ int ubi_io_write_ec_hdr(struct ubi_device *ubi, int pnum,
 		return -EROFS;
 
 	err = ubi_io_write(ubi, ec_hdr, pnum, 0, ubi->ec_hdr_alsize);
+	ubi_ac_write_ec_hdr(ubi, pnum, ec_hdr, err);
 	return err;
 }
 
@@ -999,8 +1029,7 @@ bad:
 int ubi_io_read_vid_hdr(struct ubi_device *ubi, int pnum,
 			struct ubi_vid_hdr *vid_hdr, int verbose)
 {
-	int err, read_err;
-	uint32_t crc, magic, hdr_crc;
+	int read_err;
 	void *p;
 
 	dbg_io("read VID header from PEB %d", pnum);
@@ -1009,6 +1038,26 @@ int ubi_io_read_vid_hdr(struct ubi_device *ubi, int pnum,
 	p = (char *)vid_hdr - ubi->vid_hdr_shift;
 	read_err = ubi_io_read(ubi, p, pnum, ubi->vid_hdr_aloffset,
 			  ubi->vid_hdr_alsize);
+	return check_vid_hdr(ubi, pnum, vid_hdr, read_err, verbose);
+}
+
+/**
+ * check_vid_hdr - check a volume identifier header which has been read.
+ * @ubi: UBI device description object
+ * @pnum: physical eraseblock the header was read from
+ * @vid_hdr: the volume identifier header
+ * @read_err: what 'ubi_io_read()' returned when reading the header
+ * @verbose: be verbose if the header is corrupted or wasn't found
+ *
+ * This function returns the same codes as 'ubi_io_read_vid_hdr()'.
+ */
+static int check_vid_hdr(struct ubi_device *ubi, int pnum,
+			 struct ubi_vid_hdr *vid_hdr, int read_err,
+			 int verbose)
+{
+	int err;
+	uint32_t crc, magic, hdr_crc;
+
 	if (read_err && read_err != UBI_IO_BITFLIPS && !mtd_is_eccerr(read_err))
 		return read_err;
 
@@ -1065,6 +1114,58 @@ int ubi_io_read_vid_hdr(struct ubi_device *ubi, int pnum,
 	return read_err ? UBI_IO_BITFLIPS : 0;
 }
 
+/**
+ * ubi_io_read_hdrs - read and check both headers of a physical eraseblock.
+ * @ubi: UBI device description object
+ * @pnum: physical eraseblock number to read from
+ * @ec_hdr: &struct ubi_ec_hdr object where to store the erase counter header
+ * @vid_hdr: &struct ubi_vid_hdr object where to store the volume identifier
+ * header
+ * @vid_err: where to store the result of checking the VID header
+ *
+ * This function does the same as 'ubi_io_read_ec_hdr()' followed by
+ * 'ubi_io_read_vid_hdr()', but it reads both headers with a single MTD
+ * request, which lets the flash driver stream the pages holding them. It
+ * returns what 'ubi_io_read_ec_hdr()' would and stores what
+ * 'ubi_io_read_vid_hdr()' would in @vid_err. If the request reports
+ * bit-flips or an error, the headers are read again one at a time to find
+ * out which of them is affected.
+ */
+int ubi_io_read_hdrs(struct ubi_device *ubi, int pnum,
+		     struct ubi_ec_hdr *ec_hdr, struct ubi_vid_hdr *vid_hdr,
+		     int *vid_err)
+{
+	int len = ubi->vid_hdr_aloffset + ubi->vid_hdr_alsize;
+	int err;
+
+	dbg_io("read EC and VID headers from PEB %d", pnum);
+	ubi_assert(pnum >= 0 && pnum < ubi->peb_count);
+
+	mutex_lock(&ubi->buf_mutex);
+	err = ubi_io_read(ubi, ubi->peb_buf, pnum, 0, len);
+	if (!err) {
+		memcpy(ec_hdr, ubi->peb_buf, UBI_EC_HDR_SIZE);
+		memcpy((char *)vid_hdr - ubi->vid_hdr_shift,
+		       ubi->peb_buf + ubi->vid_hdr_aloffset,
+		       ubi->vid_hdr_alsize);
+	}
+	mutex_unlock(&ubi->buf_mutex);
+
+	if (!err) {
+		err = check_ec_hdr(ubi, pnum, ec_hdr, 0, 0);
+		*vid_err = check_vid_hdr(ubi, pnum, vid_hdr, 0, 0);
+		return err;
+	}
+
+	/* An empty PEB has no VID header worth another read */
+	err = ubi_io_read_ec_hdr(ubi, pnum, ec_hdr, 0);
+	*vid_err = UBI_IO_FF;
+	if (err >= 0 && err != UBI_IO_FF && err != UBI_IO_FF_BITFLIPS)
+		*vid_err = ubi_io_read_vid_hdr(ubi, pnum, vid_hdr, 0);
+
+	return err;
+}
+
 /**
  * ubi_io_write_vid_hdr - write a volume identifier header.
  * @ubi: UBI device description object
@@ -1109,6 +1210,7 @@ int ubi_io_write_vid_hdr(struct ubi_device *ubi, int pnum,
 	p = (char *)vid_hdr - ubi->vid_hdr_shift;
 	err = ubi_io_write(ubi, p, pnum, ubi->vid_hdr_aloffset,
 			   ubi->vid_hdr_alsize);
+	ubi_ac_write_vid_hdr(ubi, pnum, vid_hdr, err);
 	return err;
 }
 
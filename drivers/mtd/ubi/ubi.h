@@ -523,6 +523,7 @@ struct ubi_debug_info {
  * @max_write_size: maximum amount of bytes the underlying flash can write at a
  *                  time (MTD write buffer size)
  * @mtd: MTD device descriptor
+ * @ac: scan results kept for the MTD device, %NULL if there are none
  *
  * @peb_buf: a buffer of PEB size used for different purposes
  * @buf_mutex: protects @peb_buf
@@ -622,6 +623,7 @@ struct ubi_device {
 	unsigned int nor_flash:1;
 	int max_write_size;
 	struct mtd_info *mtd;
+	struct ubi_attach_cache *ac;
 
 	void *peb_buf;
 	struct mutex buf_mutex;
@@ -748,6 +750,64 @@ struct ubi_attach_info {
 	struct kmem_cache *aeb_slab_cache;
 };
 
+/**
+ * struct ubi_ac_peb - what scanning found in a physical eraseblock.
+ * @known: non-zero once the PEB has been scanned
+ * @bad: non-zero if the PEB is bad
+ * @ec_err: what 'ubi_io_read_ec_hdr()' returned
+ * @vid_err: what 'ubi_io_read_vid_hdr()' returned
+ * @corrupt: what 'check_corruption()' returned, %-1 if it was not called
+ * @version: UBI version from the EC header
+ * @image_seq: image sequence number from the EC header
+ * @ec: erase counter from the EC header
+ * @vid_hdr: the VID header
+ */
+struct ubi_ac_peb {
+	u8 known;
+	u8 bad;
+	s8 ec_err;
+	s8 vid_err;
+	s8 corrupt;
+	u8 version;
+	__be32 image_seq;
+	__be64 ec;
+	struct ubi_vid_hdr vid_hdr;
+};
+
+/**
+ * struct ubi_attach_cache - scan results kept for an MTD device.
+ * @list: link in the list of all caches
+ * @master: real MTD device the scanned MTD device is on
+ * @offset: offset of the scanned MTD device on @master
+ * @size: size of the scanned MTD device
+ * @vid_hdr_offset: VID header offset the PEBs were scanned with
+ * @peb_size: physical eraseblock size
+ * @peb_count: count of physical eraseblocks
+ * @write_gen: 'mtd_write_gen()' of @master when @peb last matched the flash
+ * @valid: non-zero if @peb matches the flash
+ * @replay: non-zero if the attach in progress takes @peb instead of reading
+ *          the flash
+ * @peb: scan results, one per physical eraseblock
+ *
+ * The results are kept after the UBI device is detached, so that attaching
+ * the same MTD device again does not have to read all the headers again.
+ * While the device is attached, every header UBI writes, every erasure and
+ * every bad block marking is applied to @peb.
+ */
+struct ubi_attach_cache {
+	struct list_head list;
+	struct mtd_info *master;
+	u64 offset;
+	u64 size;
+	int vid_hdr_offset;
+	int peb_size;
+	int peb_count;
+	unsigned int write_gen;
+	int valid;
+	int replay;
+	struct ubi_ac_peb peb[];
+};
+
 /**
  * struct ubi_work - UBI work description data structure.
  * @list: a link in the list of pending works
@@ -898,6 +958,9 @@ int ubi_io_read_vid_hdr(struct ubi_device *ubi, int pnum,
 			struct ubi_vid_hdr *vid_hdr, int verbose);
 int ubi_io_write_vid_hdr(struct ubi_device *ubi, int pnum,
 			 struct ubi_vid_hdr *vid_hdr);
+int ubi_io_read_hdrs(struct ubi_device *ubi, int pnum,
+		     struct ubi_ec_hdr *ec_hdr, struct ubi_vid_hdr *vid_hdr,
+		     int *vid_err);
 
 /* build.c */
 int ubi_attach_mtd_dev(struct mtd_info *mtd, int ubi_num,
@@ -932,6 +995,47 @@ int ubi_scan_fastmap(struct ubi_device *ubi, struct ubi_attach_info *ai,
 static inline int ubi_update_fastmap(struct ubi_device *ubi) { return 0; }
 #endif
 
+/* attach_cache.c */
+#ifdef CONFIG_MTD_UBI_ATTACH_CACHE
+int ubi_ac_attach(struct ubi_device *ubi);
+void ubi_ac_scanned(struct ubi_device *ubi, int err);
+void ubi_ac_detach(struct ubi_device *ubi);
+void ubi_ac_write_ec_hdr(const struct ubi_device *ubi, int pnum,
+			 const struct ubi_ec_hdr *ec_hdr, int err);
+void ubi_ac_write_vid_hdr(const struct ubi_device *ubi, int pnum,
+			  const struct ubi_vid_hdr *vid_hdr, int err);
+void ubi_ac_erase(const struct ubi_device *ubi, int pnum, int err);
+void ubi_ac_mark_bad(const struct ubi_device *ubi, int pnum, int err);
+#else
+static inline int ubi_ac_attach(struct ubi_device *ubi) { return 0; }
+static inline void ubi_ac_scanned(struct ubi_device *ubi, int err) {}
+static inline void ubi_ac_detach(struct ubi_device *ubi) {}
+static inline void ubi_ac_write_ec_hdr(const struct ubi_device *ubi, int pnum,
+				       const struct ubi_ec_hdr *ec_hdr,
+				       int err) {}
+static inline void ubi_ac_write_vid_hdr(const struct ubi_device *ubi,
+					int pnum,
+					const struct ubi_vid_hdr *vid_hdr,
+					int err) {}
+static inline void ubi_ac_erase(const struct ubi_device *ubi, int pnum,
+				int err) {}
+static inline void ubi_ac_mark_bad(const struct ubi_device *ubi, int pnum,
+				   int err) {}
+#endif
+
+/**
+ * ubi_ac_peb - get the scan results of a physical eraseblock.
+ * @ubi: UBI device description object
+ * @pnum: physical eraseblock number
+ *
+ * Returns %NULL if the MTD device has no attach cache.
+ */
+static inline struct ubi_ac_peb *ubi_ac_peb(const struct ubi_device *ubi,
+					    int pnum)
+{
+	return ubi->ac ? &ubi->ac->peb[pnum] : NULL;
+}
+
 /* block.c */
 #ifdef CONFIG_MTD_UBI_BLOCK
 int ubiblock_init(void);
@@ -639,6 +639,71 @@ int designware_eth_free_pkt(struct udevice *dev, uchar *packet, int length)
 	return _dw_free_pkt(priv);
 }
 
+int designware_eth_recv_batch(struct udevice *dev, int flags, uchar **packets,
+			      int *lengths, int max)
+{
+	struct dw_eth_dev *priv = dev_get_priv(dev);
+	u32 desc_num = priv->rx_currdescnum;
+	struct dmamacdescr *desc_p;
+	ulong data_start;
+	u32 status;
+	int count;
+
+	/* Invalidate the whole descriptor ring once rather than per packet */
+	invalidate_dcache_range((ulong)priv->rx_mac_descrtable,
+				(ulong)priv->rx_mac_descrtable +
+				sizeof(priv->rx_mac_descrtable));
+
+	for (count = 0; count < min(max, CONFIG_RX_DESCR_NUM); count++) {
+		desc_p = &priv->rx_mac_descrtable[desc_num];
+		status = desc_p->txrx_status;
+
+		/* Stop at the first descriptor still owned by the DMA */
+		if (status & DESC_RXSTS_OWNBYDMA)
+			break;
+
+		lengths[count] = (status & DESC_RXSTS_FRMLENMSK) >>
+				 DESC_RXSTS_FRMLENSHFT;
+		data_start = desc_p->dmamac_addr;
+		invalidate_dcache_range(data_start, data_start +
+					roundup(lengths[count],
+						ARCH_DMA_MINALIGN));
+		packets[count] = (uchar *)data_start;
+
+		if (++desc_num >= CONFIG_RX_DESCR_NUM)
+			desc_num = 0;
+	}
+
+	return count;
+}
+
+int designware_eth_free_batch(struct udevice *dev, uchar **packets,
+			      int *lengths, int count)
+{
+	struct dw_eth_dev *priv = dev_get_priv(dev);
+	struct eth_dma_regs *dma_p = priv->dma_regs_p;
+	u32 desc_num = priv->rx_currdescnum;
+	int i;
+
+	for (i = 0; i < count; i++) {
+		priv->rx_mac_descrtable[desc_num].txrx_status |=
+			DESC_RXSTS_OWNBYDMA;
+		if (++desc_num >= CONFIG_RX_DESCR_NUM)
+			desc_num = 0;
+	}
+	priv->rx_currdescnum = desc_num;
+
+	/* Flush all the status fields in one go */
+	flush_dcache_range((ulong)priv->rx_mac_descrtable,
+			   (ulong)priv->rx_mac_descrtable +
+			   sizeof(priv->rx_mac_descrtable));
+
+	/* Restart reception in case the DMA ran out of descriptors */
+	writel(POLL_DATA, &dma_p->rxpolldemand);
+
+	return 0;
+}
+
 void designware_eth_stop(struct udevice *dev)
 {
 	struct dw_eth_dev *priv = dev_get_priv(dev);
@@ -800,6 +865,8 @@ const struct eth_ops designware_eth_ops = {
 	.send			= designware_eth_send,
 	.recv			= designware_eth_recv,
 	.free_pkt		= designware_eth_free_pkt,
+	.recv_batch		= designware_eth_recv_batch,
+	.free_batch		= designware_eth_free_batch,
 	.stop			= designware_eth_stop,
 	.write_hwaddr		= designware_eth_write_hwaddr,
 };
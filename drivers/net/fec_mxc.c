@@ -834,14 +834,14 @@ out:
 }
 
 /**
- * Pull one frame from the card
+ * Handle any critical events reported by the controller
  * @param[in] dev Our ethernet device to handle
- * @return Length of packet read
+ * @return 1 if the controller had to be restarted, else 0
  */
 #ifdef CONFIG_DM_ETH
-static int fecmxc_recv(struct udevice *dev, int flags, uchar **packetp)
+static int fec_check_events(struct udevice *dev)
 #else
-static int fec_recv(struct eth_device *dev)
+static int fec_check_events(struct eth_device *dev)
 #endif
 {
 #ifdef CONFIG_DM_ETH
@@ -849,24 +849,8 @@ static int fec_recv(struct eth_device *dev)
 #else
 	struct fec_priv *fec = (struct fec_priv *)dev->priv;
 #endif
-	struct fec_bd *rbd = &fec->rbd_base[fec->rbd_index];
 	unsigned long ievent;
-	int frame_length, len = 0;
-	uint16_t bd_status;
-	ulong addr, size, end;
-	int i;
-
-#ifdef CONFIG_DM_ETH
-	*packetp = memalign(ARCH_DMA_MINALIGN, FEC_MAX_PKT_SIZE);
-	if (*packetp == 0) {
-		printf("%s: error allocating packetp\n", __func__);
-		return -ENOMEM;
-	}
-#else
-	ALLOC_CACHE_ALIGN_BUFFER(uchar, buff, FEC_MAX_PKT_SIZE);
-#endif
 
-	/* Check if any critical events have happened */
 	ievent = readl(&fec->eth->ievent);
 	writel(ievent, &fec->eth->ievent);
 	debug("fec_recv: ievent 0x%lx\n", ievent);
@@ -879,7 +863,7 @@ static int fec_recv(struct eth_device *dev)
 		fec_init(dev, fec->bd);
 #endif
 		printf("some error: 0x%08lx\n", ievent);
-		return 0;
+		return 1;
 	}
 	if (ievent & FEC_IEVENT_HBERR) {
 		/* Heartbeat error */
@@ -904,6 +888,45 @@ static int fec_recv(struct eth_device *dev)
 		}
 	}
 
+	return 0;
+}
+
+/**
+ * Pull one frame from the card
+ * @param[in] dev Our ethernet device to handle
+ * @return Length of packet read
+ */
+#ifdef CONFIG_DM_ETH
+static int fecmxc_recv(struct udevice *dev, int flags, uchar **packetp)
+#else
+static int fec_recv(struct eth_device *dev)
+#endif
+{
+#ifdef CONFIG_DM_ETH
+	struct fec_priv *fec = dev_get_priv(dev);
+#else
+	struct fec_priv *fec = (struct fec_priv *)dev->priv;
+#endif
+	struct fec_bd *rbd = &fec->rbd_base[fec->rbd_index];
+	int frame_length, len = 0;
+	uint16_t bd_status;
+	ulong addr, size, end;
+	int i;
+
+#ifdef CONFIG_DM_ETH
+	*packetp = memalign(ARCH_DMA_MINALIGN, FEC_MAX_PKT_SIZE);
+	if (*packetp == 0) {
+		printf("%s: error allocating packetp\n", __func__);
+		return -ENOMEM;
+	}
+#else
+	ALLOC_CACHE_ALIGN_BUFFER(uchar, buff, FEC_MAX_PKT_SIZE);
+#endif
+
+	/* Check if any critical events have happened */
+	if (fec_check_events(dev))
+		return 0;
+
 	/*
 	 * Read the buffer status. Before the status can be read, the data cache
 	 * must be invalidated, because the data in RAM might have been changed
@@ -1263,11 +1286,105 @@ static int fecmxc_free_pkt(struct udevice *dev, uchar *packet, int length)
 	return 0;
 }
 
+/*
+ * Return the frames that are ready straight from their DMA buffers. The
+ * descriptors are only marked free again in fecmxc_free_batch().
+ */
+static int fecmxc_recv_batch(struct udevice *dev, int flags, uchar **packets,
+			     int *lengths, int max)
+{
+	struct fec_priv *fec = dev_get_priv(dev);
+	int index = fec->rbd_index;
+	struct fec_bd *rbd;
+	uint16_t bd_status;
+	ulong addr, end;
+	int count, len;
+
+	if (fec_check_events(dev))
+		return 0;
+
+	/*
+	 * Invalidate all the descriptors at once. This is safe since the
+	 * CPU only writes to them when it frees a whole cache line of them,
+	 * see fec_recv()
+	 */
+	addr = (ulong)fec->rbd_base;
+	invalidate_dcache_range(addr, addr +
+				roundup(FEC_RBD_NUM * sizeof(struct fec_bd),
+					ARCH_DMA_MINALIGN));
+
+	for (count = 0; count < min(max, FEC_RBD_NUM); count++) {
+		rbd = &fec->rbd_base[index];
+		bd_status = readw(&rbd->status);
+		if (bd_status & FEC_RBD_EMPTY)
+			break;
+
+		addr = readl(&rbd->data_pointer);
+		len = readw(&rbd->data_length) - 4;
+		if ((bd_status & FEC_RBD_LAST) && !(bd_status & FEC_RBD_ERR) &&
+		    len > 14) {
+			end = roundup(addr + len, ARCH_DMA_MINALIGN);
+			invalidate_dcache_range(addr & ~(ARCH_DMA_MINALIGN - 1),
+						end);
+#ifdef CONFIG_FEC_MXC_SWAP_PACKET
+			swap_packet((uint32_t *)addr, len);
+#endif
+		} else {
+			if (bd_status & FEC_RBD_ERR)
+				debug("error frame: 0x%08lx 0x%08x\n",
+				      addr, bd_status);
+			len = 0;
+		}
+		packets[count] = (uchar *)addr;
+		lengths[count] = len;
+		index = (index + 1) % FEC_RBD_NUM;
+	}
+
+	return count;
+}
+
+static int fecmxc_free_batch(struct udevice *dev, uchar **packets,
+			     int *lengths, int count)
+{
+	struct fec_priv *fec = dev_get_priv(dev);
+	int size = RXDESC_PER_CACHELINE - 1;
+	ulong addr;
+	int i, j;
+
+	for (i = 0; i < count; i++) {
+		/* Drop anything the stack wrote to the buffer */
+		if (lengths[i] > 0) {
+			addr = (ulong)packets[i] & ~(ARCH_DMA_MINALIGN - 1);
+			invalidate_dcache_range(addr,
+				roundup((ulong)packets[i] + lengths[i],
+					ARCH_DMA_MINALIGN));
+		}
+
+		/* As in fec_recv(), free whole cache lines of descriptors */
+		if ((fec->rbd_index & size) == size) {
+			j = fec->rbd_index - size;
+			addr = (ulong)&fec->rbd_base[j];
+			for (; j <= fec->rbd_index; j++)
+				fec_rbd_clean(j == (FEC_RBD_NUM - 1),
+					      &fec->rbd_base[j]);
+			flush_dcache_range(addr, addr + ARCH_DMA_MINALIGN);
+		}
+		fec->rbd_index = (fec->rbd_index + 1) % FEC_RBD_NUM;
+	}
+
+	/* Restart the engine once for the whole batch */
+	fec_rx_task_enable(fec);
+
+	return 0;
+}
+
 static const struct eth_ops fecmxc_ops = {
 	.start			= fecmxc_init,
 	.send			= fecmxc_send,
 	.recv			= fecmxc_recv,
 	.free_pkt		= fecmxc_free_pkt,
+	.recv_batch		= fecmxc_recv_batch,
+	.free_batch		= fecmxc_free_batch,
 	.stop			= fecmxc_halt,
 	.write_hwaddr		= fecmxc_set_hwaddr,
 	.read_rom_hwaddr	= fecmxc_read_rom_hwaddr,
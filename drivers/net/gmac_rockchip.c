@@ -685,6 +685,8 @@ const struct eth_ops gmac_rockchip_eth_ops = {
 	.send			= designware_eth_send,
 	.recv			= designware_eth_recv,
 	.free_pkt		= designware_eth_free_pkt,
+	.recv_batch		= designware_eth_recv_batch,
+	.free_batch		= designware_eth_free_batch,
 	.stop			= designware_eth_stop,
 	.write_hwaddr		= designware_eth_write_hwaddr,
 };
@@ -72,8 +72,10 @@ int sandbox_eth_arp_req_to_reply(struct udevice *dev, void *packet,
 		return -EAGAIN;
 
 	/* Don't allow the buffer to overrun */
-	if (priv->recv_packets >= PKTBUFSRX)
+	if (priv->recv_packets >= PKTBUFSRX) {
+		priv->rx_dropped++;
 		return 0;
+	}
 
 	/* store this as the assumed IP of the fake host */
 	priv->fake_host_ipaddr = net_read_ip(&arp->ar_tpa);
@@ -134,8 +136,10 @@ int sandbox_eth_ping_req_to_reply(struct udevice *dev, void *packet,
 		return -EAGAIN;
 
 	/* Don't allow the buffer to overrun */
-	if (priv->recv_packets >= PKTBUFSRX)
+	if (priv->recv_packets >= PKTBUFSRX) {
+		priv->rx_dropped++;
 		return 0;
+	}
 
 	/* reply to the ping */
 	eth_recv = (void *)priv->recv_packet_buffer[priv->recv_packets];
@@ -174,8 +178,10 @@ int sandbox_eth_recv_arp_req(struct udevice *dev)
 	struct arp_hdr *arp_recv;
 
 	/* Don't allow the buffer to overrun */
-	if (priv->recv_packets >= PKTBUFSRX)
+	if (priv->recv_packets >= PKTBUFSRX) {
+		priv->rx_dropped++;
 		return -EOVERFLOW;
+	}
 
 	/* Formulate a fake request */
 	eth_recv = (void *)priv->recv_packet_buffer[priv->recv_packets];
@@ -216,8 +222,10 @@ int sandbox_eth_recv_ping_req(struct udevice *dev)
 	struct icmp_hdr *icmpr;
 
 	/* Don't allow the buffer to overrun */
-	if (priv->recv_packets >= PKTBUFSRX)
+	if (priv->recv_packets >= PKTBUFSRX) {
+		priv->rx_dropped++;
 		return -EOVERFLOW;
+	}
 
 	/* Formulate a fake ping */
 	eth_recv = (void *)priv->recv_packet_buffer[priv->recv_packets];
@@ -325,6 +333,7 @@ static int sb_eth_start(struct udevice *dev)
 	debug("eth_sandbox: Start\n");
 
 	priv->recv_packets = 0;
+	priv->rx_dropped = 0;
 	for (int i = 0; i < PKTBUFSRX; i++) {
 		priv->recv_packet_buffer[i] = net_rx_packets[i];
 		priv->recv_packet_length[i] = 0;
@@ -385,9 +394,51 @@ static int sb_eth_free_pkt(struct udevice *dev, uchar *packet, int length)
 	return 0;
 }
 
+static int sb_eth_recv_batch(struct udevice *dev, int flags, uchar **packets,
+			     int *lengths, int max)
+{
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+	int count;
+
+	if (skip_timeout) {
+		timer_test_add_offset(11000UL);
+		skip_timeout = false;
+	}
+
+	count = min(priv->recv_packets, max);
+	memcpy(packets, priv->recv_packet_buffer, count * sizeof(*packets));
+	memcpy(lengths, priv->recv_packet_length, count * sizeof(*lengths));
+	debug("eth_sandbox: received %d packets\n", count);
+
+	return count;
+}
+
+static int sb_eth_free_batch(struct udevice *dev, uchar **packets,
+			     int *lengths, int count)
+{
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+	int i;
+
+	/* Keep any packets injected while the batch was being processed */
+	count = min(count, priv->recv_packets);
+	priv->recv_packets -= count;
+	for (i = 0; i < priv->recv_packets; i++) {
+		priv->recv_packet_length[i] = priv->recv_packet_length[i + count];
+		memcpy(priv->recv_packet_buffer[i],
+		       priv->recv_packet_buffer[i + count],
+		       priv->recv_packet_length[i]);
+	}
+	for (; i < priv->recv_packets + count; i++)
+		priv->recv_packet_length[i] = 0;
+
+	return 0;
+}
+
 static void sb_eth_stop(struct udevice *dev)
 {
-	debug("eth_sandbox: Stop\n");
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+
+	debug("eth_sandbox: Stop, %d packets dropped\n", priv->rx_dropped);
 }
 
 static int sb_eth_write_hwaddr(struct udevice *dev)
@@ -404,6 +455,8 @@ static const struct eth_ops sb_eth_ops = {
 	.send			= sb_eth_send,
 	.recv			= sb_eth_recv,
 	.free_pkt		= sb_eth_free_pkt,
+	.recv_batch		= sb_eth_recv_batch,
+	.free_batch		= sb_eth_free_batch,
 	.stop			= sb_eth_stop,
 	.write_hwaddr		= sb_eth_write_hwaddr,
 };
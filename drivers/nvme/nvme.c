@@ -14,13 +14,14 @@
 #include <dm/device-internal.h>
 #include "nvme.h"
 
-#define NVME_Q_DEPTH		2
+#define NVME_Q_DEPTH		CONFIG_NVME_IO_QUEUE_DEPTH
 #define NVME_AQ_DEPTH		2
 #define NVME_SQ_SIZE(depth)	(depth * sizeof(struct nvme_command))
 #define NVME_CQ_SIZE(depth)	(depth * sizeof(struct nvme_completion))
 #define ADMIN_TIMEOUT		60
 #define IO_TIMEOUT		30
-#define MAX_PRP_POOL		512
+/* Largest transfer of a single read/write command, 1MB */
+#define NVME_MAX_XFER_SHIFT	20
 
 enum nvme_queue_id {
 	NVME_ADMIN_Q,
@@ -46,7 +47,18 @@ struct nvme_queue {
 	u16 qid;
 	u8 cq_phase;
 	u8 cqe_seen;
-	unsigned long cmdid_data[];
+	u16 sq_db_tail;		/* tail last written to the SQ doorbell */
+	struct nvme_slots slots;	/* command ids in flight or free */
+	u64 *prp_lists;		/* one PRP list per command id */
+	u32 prp_list_len;	/* number of entries in each PRP list */
+	/* Read started by nvme_blk_read_start(), until read_wait() */
+	struct udevice *rd_dev;	/* namespace being read, NULL if none */
+	void *rd_buf;		/* destination buffer */
+	lbaint_t rd_cnt;	/* number of blocks */
+	unsigned long rd_failed;	/* first failed block, or blocks read */
+	int rd_ret;		/* error while queueing the commands */
+	bool rd_done;		/* all commands are complete */
+	unsigned long cmdid_data[];	/* per command id: first block offset */
 };
 
 static int nvme_wait_ready(struct nvme_dev *dev, bool enabled)
@@ -67,68 +79,59 @@ static int nvme_wait_ready(struct nvme_dev *dev, bool enabled)
 	return -ETIME;
 }
 
-static int nvme_setup_prps(struct nvme_dev *dev, u64 *prp2,
-			   int total_len, u64 dma_addr)
+/**
+ * nvme_setup_prps() - describe a buffer with PRP entries
+ *
+ * The first page of the buffer always goes in PRP1. If the rest fits in a
+ * single page it goes in PRP2, otherwise PRP2 points to @prp_list which is
+ * filled in, chaining to the next page of the list when one page of
+ * entries is not enough.
+ *
+ * @dev:	NVMe device
+ * @prp_list:	Memory for the PRP list, large enough for @total_len
+ * @prp2:	Returns the value for PRP2
+ * @total_len:	Length of the buffer in bytes
+ * @dma_addr:	Address of the buffer
+ */
+static void nvme_setup_prps(struct nvme_dev *dev, u64 *prp_list, u64 *prp2,
+			    int total_len, u64 dma_addr)
 {
 	u32 page_size = dev->page_size;
 	int offset = dma_addr & (page_size - 1);
-	u64 *prp_pool;
+	u32 prps_per_page = page_size >> 3;
 	int length = total_len;
-	int i, nprps;
-	u32 prps_per_page = (page_size >> 3) - 1;
-	u32 num_pages;
+	u64 *prp = prp_list;
+	int i;
 
 	length -= (page_size - offset);
 
 	if (length <= 0) {
 		*prp2 = 0;
-		return 0;
+		return;
 	}
 
-	if (length)
-		dma_addr += (page_size - offset);
+	dma_addr += (page_size - offset);
 
 	if (length <= page_size) {
 		*prp2 = dma_addr;
-		return 0;
+		return;
 	}
 
-	nprps = DIV_ROUND_UP(length, page_size);
-	num_pages = DIV_ROUND_UP(nprps, prps_per_page);
-
-	if (nprps > dev->prp_entry_num) {
-		free(dev->prp_pool);
-		/*
-		 * Always increase in increments of pages.  It doesn't waste
-		 * much memory and reduces the number of allocations.
-		 */
-		dev->prp_pool = memalign(page_size, num_pages * page_size);
-		if (!dev->prp_pool) {
-			printf("Error: malloc prp_pool fail\n");
-			return -ENOMEM;
-		}
-		dev->prp_entry_num = prps_per_page * num_pages;
-	}
-
-	prp_pool = dev->prp_pool;
 	i = 0;
-	while (nprps) {
-		if (i == ((page_size >> 3) - 1)) {
-			*(prp_pool + i) = cpu_to_le64((ulong)prp_pool +
-					page_size);
+	while (length > 0) {
+		if (i == prps_per_page - 1 && length > page_size) {
+			prp[i] = cpu_to_le64((ulong)(prp + prps_per_page));
+			prp += prps_per_page;
 			i = 0;
-			prp_pool += page_size;
 		}
-		*(prp_pool + i++) = cpu_to_le64(dma_addr);
+		prp[i++] = cpu_to_le64(dma_addr);
 		dma_addr += page_size;
-		nprps--;
+		length -= page_size;
 	}
-	*prp2 = (ulong)dev->prp_pool;
+	*prp2 = (ulong)prp_list;
 
-	flush_dcache_range((ulong)dev->prp_pool, (ulong)dev->prp_pool +
-			   dev->prp_entry_num * sizeof(u64));
-
-	return 0;
+	flush_dcache_range((ulong)prp_list, ALIGN((ulong)(prp + i),
+						  ARCH_DMA_MINALIGN));
 }
 
 static __le16 nvme_get_cmd_id(void)
@@ -149,12 +152,12 @@ static u16 nvme_read_completion_status(struct nvme_queue *nvmeq, u16 index)
 }
 
 /**
- * nvme_submit_cmd() - copy a command into a queue and ring the doorbell
+ * nvme_queue_cmd() - copy a command into a queue without ringing the doorbell
  *
  * @nvmeq:	The queue to use
  * @cmd:	The command to send
  */
-static void nvme_submit_cmd(struct nvme_queue *nvmeq, struct nvme_command *cmd)
+static void nvme_queue_cmd(struct nvme_queue *nvmeq, struct nvme_command *cmd)
 {
 	u16 tail = nvmeq->sq_tail;
 
@@ -164,10 +167,34 @@ static void nvme_submit_cmd(struct nvme_queue *nvmeq, struct nvme_command *cmd)
 
 	if (++tail == nvmeq->q_depth)
 		tail = 0;
-	writel(tail, nvmeq->q_db);
 	nvmeq->sq_tail = tail;
 }
 
+/**
+ * nvme_ring_sq() - tell the controller about all queued commands
+ *
+ * @nvmeq:	The queue to use
+ */
+static void nvme_ring_sq(struct nvme_queue *nvmeq)
+{
+	if (nvmeq->sq_db_tail == nvmeq->sq_tail)
+		return;
+	writel(nvmeq->sq_tail, nvmeq->q_db);
+	nvmeq->sq_db_tail = nvmeq->sq_tail;
+}
+
+/**
+ * nvme_submit_cmd() - copy a command into a queue and ring the doorbell
+ *
+ * @nvmeq:	The queue to use
+ * @cmd:	The command to send
+ */
+static void nvme_submit_cmd(struct nvme_queue *nvmeq, struct nvme_command *cmd)
+{
+	nvme_queue_cmd(nvmeq, cmd);
+	nvme_ring_sq(nvmeq);
+}
+
 static int nvme_submit_sync_cmd(struct nvme_queue *nvmeq,
 				struct nvme_command *cmd,
 				u32 *result, unsigned timeout)
@@ -232,10 +259,11 @@ static int nvme_submit_admin_cmd(struct nvme_dev *dev, struct nvme_command *cmd,
 static struct nvme_queue *nvme_alloc_queue(struct nvme_dev *dev,
 					   int qid, int depth)
 {
-	struct nvme_queue *nvmeq = malloc(sizeof(*nvmeq));
+	size_t size = sizeof(struct nvme_queue) + depth * sizeof(unsigned long);
+	struct nvme_queue *nvmeq = malloc(size);
 	if (!nvmeq)
 		return NULL;
-	memset(nvmeq, 0, sizeof(*nvmeq));
+	memset(nvmeq, 0, size);
 
 	nvmeq->cqes = (void *)memalign(4096, NVME_CQ_SIZE(depth));
 	if (!nvmeq->cqes)
@@ -310,6 +338,8 @@ static void nvme_free_queue(struct nvme_queue *nvmeq)
 {
 	free((void *)nvmeq->cqes);
 	free(nvmeq->sq_cmds);
+	nvme_slots_uninit(&nvmeq->slots);
+	free(nvmeq->prp_lists);
 	free(nvmeq);
 }
 
@@ -330,6 +360,7 @@ static void nvme_init_queue(struct nvme_queue *nvmeq, u16 qid)
 	struct nvme_dev *dev = nvmeq->dev;
 
 	nvmeq->sq_tail = 0;
+	nvmeq->sq_db_tail = 0;
 	nvmeq->cq_head = 0;
 	nvmeq->cq_phase = 1;
 	nvmeq->q_db = &dev->dbs[qid * 2 * dev->db_stride];
@@ -583,6 +614,94 @@ static int nvme_setup_io_queues(struct nvme_dev *dev)
 	return 0;
 }
 
+int nvme_slots_init(struct nvme_slots *slots, uint count)
+{
+	slots->free_ids = malloc(count * (sizeof(*slots->free_ids) +
+					  sizeof(*slots->busy)));
+	if (!slots->free_ids)
+		return -ENOMEM;
+	slots->busy = (bool *)(slots->free_ids + count);
+	slots->count = count;
+	nvme_slots_reset(slots);
+
+	return 0;
+}
+
+void nvme_slots_uninit(struct nvme_slots *slots)
+{
+	free(slots->free_ids);
+	slots->free_ids = NULL;
+	slots->busy = NULL;
+	slots->count = 0;
+	slots->nr_free = 0;
+}
+
+void nvme_slots_reset(struct nvme_slots *slots)
+{
+	uint i;
+
+	/* Hand out the lowest ids first */
+	for (i = 0; i < slots->count; i++)
+		slots->free_ids[i] = slots->count - 1 - i;
+	memset(slots->busy, '\0', slots->count * sizeof(*slots->busy));
+	slots->nr_free = slots->count;
+}
+
+int nvme_slot_get(struct nvme_slots *slots)
+{
+	u16 id;
+
+	if (!slots->nr_free)
+		return -EBUSY;
+	id = slots->free_ids[--slots->nr_free];
+	slots->busy[id] = true;
+
+	return id;
+}
+
+int nvme_slot_put(struct nvme_slots *slots, uint id)
+{
+	if (id >= slots->count || !slots->busy[id])
+		return -EINVAL;
+	slots->busy[id] = false;
+	slots->free_ids[slots->nr_free++] = id;
+
+	return 0;
+}
+
+/**
+ * nvme_alloc_io_slots() - set up the I/O queue to have commands in flight
+ *
+ * Each of the q_depth - 1 commands which can be outstanding on the I/O
+ * queue gets its own command id and PRP list, sized for the largest
+ * transfer of a single command.
+ *
+ * @dev:	NVMe device, with the transfer size and page size known
+ * @return 0 if OK, -ENOMEM if out of memory
+ */
+static int nvme_alloc_io_slots(struct nvme_dev *dev)
+{
+	struct nvme_queue *nvmeq = dev->queues[NVME_IO_Q];
+	u32 prps_per_page = dev->page_size >> 3;
+	u32 shift = min_t(u32, dev->max_transfer_shift, NVME_MAX_XFER_SHIFT);
+	u32 nprps = (1 << shift) / dev->page_size;
+	u32 pages = max_t(u32, DIV_ROUND_UP(nprps, prps_per_page - 1), 1);
+	u16 slots = nvmeq->q_depth - 1;
+
+	if (nvme_slots_init(&nvmeq->slots, slots))
+		return -ENOMEM;
+
+	nvmeq->prp_list_len = pages * prps_per_page;
+	nvmeq->prp_lists = memalign(dev->page_size,
+				    slots * pages * dev->page_size);
+	if (!nvmeq->prp_lists) {
+		nvme_slots_uninit(&nvmeq->slots);
+		return -ENOMEM;
+	}
+
+	return 0;
+}
+
 static int nvme_get_info_from_identify(struct nvme_dev *dev)
 {
 	struct nvme_id_ctrl *ctrl;
@@ -706,64 +825,213 @@ static int nvme_blk_probe(struct udevice *udev)
 	return 0;
 }
 
-static ulong nvme_blk_rw(struct udevice *udev, lbaint_t blknr,
-			 lbaint_t blkcnt, void *buffer, bool read)
+/**
+ * nvme_reap_io() - wait for I/O commands to complete
+ *
+ * Any queued command is first passed to the controller. This then waits
+ * for at least one completion and reaps every completion which is already
+ * posted, updating the completion queue doorbell once for the batch.
+ *
+ * @nvmeq:	The I/O queue
+ * @failed:	Updated with the lowest block offset of any failed command
+ * @return 0 if OK, -ETIMEDOUT if nothing completed in time
+ */
+static int nvme_reap_io(struct nvme_queue *nvmeq, unsigned long *failed)
+{
+	u16 head = nvmeq->cq_head;
+	u16 phase = nvmeq->cq_phase;
+	ulong timeout_us = IO_TIMEOUT * 1000000;
+	ulong start_time;
+	int reaped = 0;
+	u16 status, id;
+
+	nvme_ring_sq(nvmeq);
+	start_time = timer_get_us();
+
+	for (;;) {
+		status = nvme_read_completion_status(nvmeq, head);
+		if ((status & 0x01) != phase) {
+			if (reaped)
+				break;
+			if ((timer_get_us() - start_time) >= timeout_us)
+				return -ETIMEDOUT;
+			continue;
+		}
+
+		id = le16_to_cpu(readw(&nvmeq->cqes[head].command_id));
+		status >>= 1;
+		if (nvme_slot_put(&nvmeq->slots, id)) {
+			printf("ERROR: unexpected command id %d\n", id);
+		} else if (status) {
+			printf("ERROR: status = %x, command id = %d\n",
+			       status, id);
+			if (nvmeq->cmdid_data[id] < *failed)
+				*failed = nvmeq->cmdid_data[id];
+		}
+
+		if (++head == nvmeq->q_depth) {
+			head = 0;
+			phase = !phase;
+		}
+		reaped++;
+	}
+
+	writel(head, nvmeq->q_db + nvmeq->dev->db_stride);
+	nvmeq->cq_head = head;
+	nvmeq->cq_phase = phase;
+
+	return 0;
+}
+
+/**
+ * nvme_reset_io_queue() - recover the I/O queue after a timeout
+ *
+ * Deleting the submission queue makes the controller abort every command
+ * still on it, so none of them can do DMA afterwards. Both queues are then
+ * created again, empty, with all command ids free. If the controller does
+ * not manage that, it is disabled, which also stops any DMA.
+ *
+ * @dev:	NVMe device
+ * @return 0 if OK, other -ve value on error
+ */
+static int nvme_reset_io_queue(struct nvme_dev *dev)
+{
+	struct nvme_queue *nvmeq = dev->queues[NVME_IO_Q];
+	int ret;
+
+	ret = nvme_delete_sq(dev, NVME_IO_Q);
+	if (!ret)
+		ret = nvme_delete_cq(dev, NVME_IO_Q);
+	if (!ret) {
+		dev->online_queues--;
+		ret = nvme_create_queue(nvmeq, NVME_IO_Q);
+	}
+	if (ret) {
+		printf("ERROR: cannot reset I/O queue, disabling controller\n");
+		nvme_disable_ctrl(dev);
+		ret = -EIO;
+	}
+	nvme_slots_reset(&nvmeq->slots);
+
+	return ret;
+}
+
+/*
+ * Reads and writes are split into commands of at most the maximum transfer
+ * size, each with its own PRP list. As many as the I/O queue can hold are
+ * kept in flight: commands are queued until no command id is free, then
+ * the doorbell is rung once and completions are reaped in batches, freeing
+ * ids for the next commands. The doorbell is rung for the last commands
+ * before returning, so a read can be left to complete in the background.
+ */
+static int nvme_rw_queue(struct udevice *udev, lbaint_t blknr,
+			 lbaint_t blkcnt, void *buffer, bool read,
+			 unsigned long *failed)
 {
 	struct nvme_ns *ns = dev_get_priv(udev);
 	struct nvme_dev *dev = ns->dev;
+	struct nvme_queue *nvmeq = dev->queues[NVME_IO_Q];
 	struct nvme_command c;
 	struct blk_desc *desc = dev_get_uclass_platdata(udev);
-	int status;
-	u64 prp2;
 	u64 total_len = blkcnt << desc->log2blksz;
-	u64 temp_len = total_len;
-
-	u64 slba = blknr;
-	u16 lbas = 1 << (dev->max_transfer_shift - ns->lba_shift);
-	u64 total_lbas = blkcnt;
+	u32 shift = min_t(u32, dev->max_transfer_shift, NVME_MAX_XFER_SHIFT);
+	u32 lbas = 1 << (shift - ns->lba_shift);
+	lbaint_t pos = 0;
+	int ret = 0;
 
 	flush_dcache_range((unsigned long)buffer,
 			   (unsigned long)buffer + total_len);
 
+	memset(&c, 0, sizeof(c));
 	c.rw.opcode = read ? nvme_cmd_read : nvme_cmd_write;
-	c.rw.flags = 0;
 	c.rw.nsid = cpu_to_le32(ns->ns_id);
-	c.rw.control = 0;
-	c.rw.dsmgmt = 0;
-	c.rw.reftag = 0;
-	c.rw.apptag = 0;
-	c.rw.appmask = 0;
-	c.rw.metadata = 0;
-
-	while (total_lbas) {
-		if (total_lbas < lbas) {
-			lbas = (u16)total_lbas;
-			total_lbas = 0;
-		} else {
-			total_lbas -= lbas;
+
+	while (pos < blkcnt && *failed == blkcnt) {
+		lbaint_t count = min_t(lbaint_t, lbas, blkcnt - pos);
+		void *buf = buffer + (pos << ns->lba_shift);
+		u64 *prp_list;
+		u64 prp2;
+		int id;
+
+		id = nvme_slot_get(&nvmeq->slots);
+		if (id < 0) {
+			ret = nvme_reap_io(nvmeq, failed);
+			if (ret)
+				break;
+			continue;
 		}
 
-		if (nvme_setup_prps(dev, &prp2,
-				    lbas << ns->lba_shift, (ulong)buffer))
-			return -EIO;
-		c.rw.slba = cpu_to_le64(slba);
-		slba += lbas;
-		c.rw.length = cpu_to_le16(lbas - 1);
-		c.rw.prp1 = cpu_to_le64((ulong)buffer);
+		prp_list = nvmeq->prp_lists + id * nvmeq->prp_list_len;
+		nvme_setup_prps(dev, prp_list, &prp2,
+				count << ns->lba_shift, (ulong)buf);
+		nvmeq->cmdid_data[id] = pos;
+
+		c.rw.command_id = cpu_to_le16(id);
+		c.rw.slba = cpu_to_le64(blknr + pos);
+		c.rw.length = cpu_to_le16(count - 1);
+		c.rw.prp1 = cpu_to_le64((ulong)buf);
 		c.rw.prp2 = cpu_to_le64(prp2);
-		status = nvme_submit_sync_cmd(dev->queues[NVME_IO_Q],
-				&c, NULL, IO_TIMEOUT);
-		if (status)
-			break;
-		temp_len -= (u32)lbas << ns->lba_shift;
-		buffer += lbas << ns->lba_shift;
+		nvme_queue_cmd(nvmeq, &c);
+		pos += count;
+	}
+	nvme_ring_sq(nvmeq);
+
+	return ret;
+}
+
+/* Wait for the commands queued by nvme_rw_queue() and finish the transfer */
+static ulong nvme_rw_finish(struct udevice *udev, lbaint_t blkcnt,
+			    void *buffer, bool read, int ret,
+			    unsigned long failed)
+{
+	struct nvme_ns *ns = dev_get_priv(udev);
+	struct nvme_dev *dev = ns->dev;
+	struct nvme_queue *nvmeq = dev->queues[NVME_IO_Q];
+	struct blk_desc *desc = dev_get_uclass_platdata(udev);
+	u64 total_len = blkcnt << desc->log2blksz;
+
+	/* Wait for everything still in flight */
+	while (!ret && !nvme_slots_idle(&nvmeq->slots))
+		ret = nvme_reap_io(nvmeq, &failed);
+
+	/* Don't leave commands behind which may still do DMA */
+	if (ret == -ETIMEDOUT) {
+		printf("ERROR: I/O timed out, resetting the queue\n");
+		nvme_reset_io_queue(dev);
 	}
 
 	if (read)
 		invalidate_dcache_range((unsigned long)buffer,
 					(unsigned long)buffer + total_len);
 
-	return (total_len - temp_len) >> desc->log2blksz;
+	return ret ? 0 : failed;
+}
+
+/* Complete a read started by nvme_blk_read_start(), keeping its result */
+static void nvme_rd_complete(struct nvme_queue *nvmeq)
+{
+	if (!nvmeq->rd_dev || nvmeq->rd_done)
+		return;
+	nvmeq->rd_failed = nvme_rw_finish(nvmeq->rd_dev, nvmeq->rd_cnt,
+					  nvmeq->rd_buf, true, nvmeq->rd_ret,
+					  nvmeq->rd_failed);
+	nvmeq->rd_done = true;
+}
+
+static ulong nvme_blk_rw(struct udevice *udev, lbaint_t blknr,
+			 lbaint_t blkcnt, void *buffer, bool read)
+{
+	struct nvme_ns *ns = dev_get_priv(udev);
+	struct nvme_queue *nvmeq = ns->dev->queues[NVME_IO_Q];
+	unsigned long failed = blkcnt;
+	int ret;
+
+	/* The queue is shared by all namespaces */
+	nvme_rd_complete(nvmeq);
+
+	ret = nvme_rw_queue(udev, blknr, blkcnt, buffer, read, &failed);
+
+	return nvme_rw_finish(udev, blkcnt, buffer, read, ret, failed);
 }
 
 static ulong nvme_blk_read(struct udevice *udev, lbaint_t blknr,
@@ -778,9 +1046,46 @@ static ulong nvme_blk_write(struct udevice *udev, lbaint_t blknr,
 	return nvme_blk_rw(udev, blknr, blkcnt, (void *)buffer, false);
 }
 
+static int nvme_blk_read_start(struct udevice *udev, lbaint_t blknr,
+			       lbaint_t blkcnt, void *buffer)
+{
+	struct nvme_ns *ns = dev_get_priv(udev);
+	struct nvme_queue *nvmeq = ns->dev->queues[NVME_IO_Q];
+
+	/* Another namespace has not collected its read yet */
+	if (nvmeq->rd_dev)
+		return -EBUSY;
+
+	nvmeq->rd_dev = udev;
+	nvmeq->rd_buf = buffer;
+	nvmeq->rd_cnt = blkcnt;
+	nvmeq->rd_failed = blkcnt;
+	nvmeq->rd_done = false;
+	nvmeq->rd_ret = nvme_rw_queue(udev, blknr, blkcnt, buffer, true,
+				      &nvmeq->rd_failed);
+
+	return 0;
+}
+
+static ulong nvme_blk_read_wait(struct udevice *udev)
+{
+	struct nvme_ns *ns = dev_get_priv(udev);
+	struct nvme_queue *nvmeq = ns->dev->queues[NVME_IO_Q];
+
+	if (nvmeq->rd_dev != udev)
+		return -EINVAL;
+
+	nvme_rd_complete(nvmeq);
+	nvmeq->rd_dev = NULL;
+
+	return nvmeq->rd_failed;
+}
+
 static const struct blk_ops nvme_blk_ops = {
-	.read	= nvme_blk_read,
-	.write	= nvme_blk_write,
+	.read		= nvme_blk_read,
+	.write		= nvme_blk_write,
+	.read_start	= nvme_blk_read_start,
+	.read_wait	= nvme_blk_read_wait,
 };
 
 U_BOOT_DRIVER(nvme_blk) = {
@@ -834,21 +1139,19 @@ static int nvme_probe(struct udevice *udev)
 	if (ret)
 		goto free_queue;
 
-	/* Allocate after the page size is known */
-	ndev->prp_pool = memalign(ndev->page_size, MAX_PRP_POOL);
-	if (!ndev->prp_pool) {
-		ret = -ENOMEM;
-		printf("Error: %s: Out of memory!\n", udev->name);
-		goto free_nvme;
-	}
-	ndev->prp_entry_num = MAX_PRP_POOL >> 3;
-
 	ret = nvme_setup_io_queues(ndev);
 	if (ret)
 		goto free_queue;
 
 	nvme_get_info_from_identify(ndev);
 
+	/* Allocate after the page size and transfer size are known */
+	ret = nvme_alloc_io_slots(ndev);
+	if (ret) {
+		printf("Error: %s: Out of memory!\n", udev->name);
+		goto free_queue;
+	}
+
 	return 0;
 
 free_queue:
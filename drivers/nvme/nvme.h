@@ -624,8 +624,6 @@ struct nvme_dev {
 	u32 stripe_size;
 	u32 page_size;
 	u8 vwc;
-	u64 *prp_pool;
-	u32 prp_entry_num;
 	u32 nn;
 };
 
@@ -645,4 +643,76 @@ struct nvme_ns {
 	u32 mode_select_block_len;
 };
 
+/**
+ * struct nvme_slots - command ids which can be in flight on an I/O queue
+ *
+ * Free ids are kept on a stack. @busy records which ids are in flight, so
+ * that a stray or repeated completion cannot free an id twice.
+ *
+ * @count:	Number of command ids, from 0 to @count - 1
+ * @nr_free:	Number of entries in @free_ids
+ * @free_ids:	Command ids which are not in flight
+ * @busy:	For each command id, true if it is in flight
+ */
+struct nvme_slots {
+	u16 count;
+	u16 nr_free;
+	u16 *free_ids;
+	bool *busy;
+};
+
+/**
+ * nvme_slots_init() - allocate command ids, all free
+ *
+ * @slots:	Slots to set up
+ * @count:	Number of command ids
+ * @return 0 if OK, -ENOMEM if out of memory
+ */
+int nvme_slots_init(struct nvme_slots *slots, uint count);
+
+/**
+ * nvme_slots_uninit() - free the memory used by command ids
+ *
+ * @slots:	Slots to free
+ */
+void nvme_slots_uninit(struct nvme_slots *slots);
+
+/**
+ * nvme_slots_reset() - mark every command id free
+ *
+ * This is only safe once the controller can no longer complete any
+ * command which was in flight, e.g. after its queue was deleted.
+ *
+ * @slots:	Slots to reset
+ */
+void nvme_slots_reset(struct nvme_slots *slots);
+
+/**
+ * nvme_slot_get() - take a free command id
+ *
+ * @slots:	Slots to take from
+ * @return command id, or -EBUSY if all are in flight
+ */
+int nvme_slot_get(struct nvme_slots *slots);
+
+/**
+ * nvme_slot_put() - free a command id when its command completes
+ *
+ * @slots:	Slots to return the id to
+ * @id:		Command id from the completion
+ * @return 0 if OK, -EINVAL if @id is out of range or not in flight
+ */
+int nvme_slot_put(struct nvme_slots *slots, uint id);
+
+/**
+ * nvme_slots_idle() - check whether no command is in flight
+ *
+ * @slots:	Slots to check
+ * @return true if every command id is free
+ */
+static inline bool nvme_slots_idle(const struct nvme_slots *slots)
+{
+	return slots->nr_free == slots->count;
+}
+
 #endif /* __DRIVER_NVME_H__ */
@@ -12,46 +12,137 @@
 #include <virtio_ring.h>
 #include "virtio_blk.h"
 
+/*
+ * Maximum number of requests in flight, and size of each request when the
+ * device does not limit the segment size
+ */
+#define VIRTIO_BLK_MAX_REQS	32
+#define VIRTIO_BLK_REQ_SECTORS	1024
+
+struct virtio_blk_req {
+	struct virtio_blk_outhdr out_hdr;
+	lbaint_t pos;		/* offset of the request in the transfer */
+	u8 status;
+};
+
 struct virtio_blk_priv {
 	struct virtqueue *vq;
+	lbaint_t req_sectors;	/* sectors per request */
+	u32 busy;		/* bitmap of @reqs in flight */
+	struct virtio_blk_req reqs[VIRTIO_BLK_MAX_REQS];
+};
+
+/*
+ * Only one data segment is used per request, so the segment size limit
+ * is all that matters here
+ */
+static const u32 feature[] = {
+	VIRTIO_BLK_F_SIZE_MAX,
 };
 
+/* Reap all completed requests, noting the offset of the first failure */
+static int virtio_blk_reap(struct udevice *dev, lbaint_t *failed)
+{
+	struct virtio_blk_priv *priv = dev_get_priv(dev);
+	struct virtio_blk_req *req;
+	int reaped = 0;
+
+	while ((req = virtqueue_get_buf(priv->vq, NULL))) {
+		int i = req - priv->reqs;
+
+		if (i < 0 || i >= VIRTIO_BLK_MAX_REQS) {
+			printf("%s: unexpected buffer %p\n", __func__, req);
+			continue;
+		}
+		if (req->status != VIRTIO_BLK_S_OK && req->pos < *failed)
+			*failed = req->pos;
+		priv->busy &= ~BIT(i);
+		reaped++;
+	}
+
+	return reaped;
+}
+
+/*
+ * Split the transfer into requests of req_sectors and keep as many in
+ * flight as the virtqueue and the request table allow. Requests are
+ * added without notifying the device; it is kicked once per batch, which
+ * with VIRTIO_RING_F_EVENT_IDX only traps to the host if it is not
+ * already processing the queue. Every completion posted by then is
+ * collected at once, and the freed slots are used for the next batch.
+ */
 static ulong virtio_blk_do_req(struct udevice *dev, u64 sector,
 			       lbaint_t blkcnt, void *buffer, u32 type)
 {
 	struct virtio_blk_priv *priv = dev_get_priv(dev);
-	unsigned int num_out = 0, num_in = 0;
-	struct virtio_sg *sgs[3];
-	u8 status;
+	lbaint_t failed = blkcnt;
+	lbaint_t pos = 0;
 	int ret;
 
-	struct virtio_blk_outhdr out_hdr = {
-		.type = cpu_to_virtio32(dev, type),
-		.sector = cpu_to_virtio64(dev, sector),
-	};
-	struct virtio_sg hdr_sg = { &out_hdr, sizeof(out_hdr) };
-	struct virtio_sg data_sg = { buffer, blkcnt * 512 };
-	struct virtio_sg status_sg = { &status, sizeof(status) };
-
-	sgs[num_out++] = &hdr_sg;
-
-	if (type & VIRTIO_BLK_T_OUT)
-		sgs[num_out++] = &data_sg;
-	else
-		sgs[num_out + num_in++] = &data_sg;
-
-	sgs[num_out + num_in++] = &status_sg;
-
-	ret = virtqueue_add(priv->vq, sgs, num_out, num_in);
-	if (ret)
-		return ret;
-
-	virtqueue_kick(priv->vq);
-
-	while (!virtqueue_get_buf(priv->vq, NULL))
-		;
-
-	return status == VIRTIO_BLK_S_OK ? blkcnt : -EIO;
+	while (pos < blkcnt || priv->busy) {
+		unsigned int num_out = 0, num_in = 0;
+		struct virtio_sg *sgs[3];
+		struct virtio_sg hdr_sg, data_sg, status_sg;
+		struct virtio_blk_req *req;
+		lbaint_t count;
+		int i;
+
+		i = ffs(~priv->busy) - 1;
+		if (pos >= blkcnt || failed != blkcnt || i < 0 ||
+		    i >= VIRTIO_BLK_MAX_REQS) {
+			/* Nothing more to queue now, wait for completions */
+			virtqueue_kick(priv->vq);
+			while (!virtio_blk_reap(dev, &failed))
+				;
+			if (failed != blkcnt)
+				pos = blkcnt;
+			continue;
+		}
+
+		count = min(blkcnt - pos, priv->req_sectors);
+		req = &priv->reqs[i];
+		req->out_hdr.type = cpu_to_virtio32(dev, type);
+		req->out_hdr.ioprio = 0;
+		req->out_hdr.sector = cpu_to_virtio64(dev, sector + pos);
+		req->pos = pos;
+		req->status = 0xff;
+
+		hdr_sg.addr = &req->out_hdr;
+		hdr_sg.length = sizeof(req->out_hdr);
+		data_sg.addr = buffer + pos * 512;
+		data_sg.length = count * 512;
+		status_sg.addr = &req->status;
+		status_sg.length = sizeof(req->status);
+
+		sgs[num_out++] = &hdr_sg;
+		if (type & VIRTIO_BLK_T_OUT)
+			sgs[num_out++] = &data_sg;
+		else
+			sgs[num_out + num_in++] = &data_sg;
+		sgs[num_out + num_in++] = &status_sg;
+
+		ret = virtqueue_add(priv->vq, sgs, num_out, num_in);
+		if (ret == -ENOSPC && priv->busy) {
+			/* The ring is full, wait for some requests to finish */
+			virtqueue_kick(priv->vq);
+			while (!virtio_blk_reap(dev, &failed))
+				;
+			continue;
+		}
+		if (ret) {
+			failed = min(failed, pos);
+			pos = blkcnt;
+			continue;
+		}
+
+		priv->busy |= BIT(i);
+		pos += count;
+	}
+
+	if (failed != blkcnt)
+		return failed ? failed : -EIO;
+
+	return blkcnt;
 }
 
 static ulong virtio_blk_read(struct udevice *dev, lbaint_t start,
@@ -97,7 +188,8 @@ static int virtio_blk_bind(struct udevice *dev)
 	desc->bdev = dev;
 
 	/* Indicate what driver features we support */
-	virtio_driver_features_init(uc_priv, NULL, 0, NULL, 0);
+	virtio_driver_features_init(uc_priv, feature, ARRAY_SIZE(feature),
+				    NULL, 0);
 
 	return 0;
 }
@@ -106,6 +198,7 @@ static int virtio_blk_probe(struct udevice *dev)
 {
 	struct virtio_blk_priv *priv = dev_get_priv(dev);
 	struct blk_desc *desc = dev_get_uclass_platdata(dev);
+	u32 size_max;
 	u64 cap;
 	int ret;
 
@@ -117,6 +210,15 @@ static int virtio_blk_probe(struct udevice *dev)
 	virtio_cread(dev, struct virtio_blk_config, capacity, &cap);
 	desc->lba = cap;
 
+	priv->req_sectors = VIRTIO_BLK_REQ_SECTORS;
+	if (virtio_has_feature(dev, VIRTIO_BLK_F_SIZE_MAX)) {
+		virtio_cread(dev, struct virtio_blk_config, size_max,
+			     &size_max);
+		if (size_max >= 512)
+			priv->req_sectors = min_t(lbaint_t, priv->req_sectors,
+						  size_max / 512);
+	}
+
 	return 0;
 }
 
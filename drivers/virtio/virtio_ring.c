@@ -13,12 +13,45 @@
 #include <virtio.h>
 #include <virtio_ring.h>
 
+/*
+ * Fill the indirect table of ring descriptor @head and point @head at it.
+ * The table entries are chained by index, so their next fields are set
+ * once when the virtqueue is created.
+ */
+static void virtqueue_add_indirect(struct virtqueue *vq, unsigned int head,
+				   struct virtio_sg *sgs[],
+				   unsigned int out_sgs, unsigned int in_sgs)
+{
+	struct vring_desc *desc = &vq->indirect[head * VIRTQUEUE_MAX_INDIRECT];
+	unsigned int total_sg = out_sgs + in_sgs;
+	unsigned int n;
+	u16 flags;
+
+	for (n = 0; n < total_sg; n++) {
+		flags = n < out_sgs ? 0 : VRING_DESC_F_WRITE;
+		if (n + 1 < total_sg)
+			flags |= VRING_DESC_F_NEXT;
+		desc[n].flags = cpu_to_virtio16(vq->vdev, flags);
+		desc[n].addr = cpu_to_virtio64(vq->vdev,
+					       (u64)(uintptr_t)sgs[n]->addr);
+		desc[n].len = cpu_to_virtio32(vq->vdev, sgs[n]->length);
+	}
+
+	desc = &vq->vring.desc[head];
+	desc->flags = cpu_to_virtio16(vq->vdev, VRING_DESC_F_INDIRECT);
+	desc->addr = cpu_to_virtio64(vq->vdev,
+		(u64)(uintptr_t)&vq->indirect[head * VIRTQUEUE_MAX_INDIRECT]);
+	desc->len = cpu_to_virtio32(vq->vdev,
+				    total_sg * sizeof(struct vring_desc));
+}
+
 int virtqueue_add(struct virtqueue *vq, struct virtio_sg *sgs[],
 		  unsigned int out_sgs, unsigned int in_sgs)
 {
 	struct vring_desc *desc;
 	unsigned int total_sg = out_sgs + in_sgs;
 	unsigned int i, n, avail, descs_used, uninitialized_var(prev);
+	bool indirect;
 	int head;
 
 	WARN_ON(total_sg == 0);
@@ -27,7 +60,9 @@ int virtqueue_add(struct virtqueue *vq, struct virtio_sg *sgs[],
 
 	desc = vq->vring.desc;
 	i = head;
-	descs_used = total_sg;
+	indirect = vq->indirect && total_sg > 1 &&
+		   total_sg <= VIRTQUEUE_MAX_INDIRECT;
+	descs_used = indirect ? 1 : total_sg;
 
 	if (vq->num_free < descs_used) {
 		debug("Can't add buf len %i - avail = %i\n",
@@ -42,6 +77,12 @@ int virtqueue_add(struct virtqueue *vq, struct virtio_sg *sgs[],
 		return -ENOSPC;
 	}
 
+	if (indirect) {
+		virtqueue_add_indirect(vq, head, sgs, out_sgs, in_sgs);
+		i = virtio16_to_cpu(vq->vdev, desc[head].next);
+		goto added;
+	}
+
 	for (n = 0; n < out_sgs; n++) {
 		struct virtio_sg *sg = sgs[n];
 
@@ -67,6 +108,7 @@ int virtqueue_add(struct virtqueue *vq, struct virtio_sg *sgs[],
 	/* Last one doesn't continue */
 	desc[prev].flags &= cpu_to_virtio16(vq->vdev, ~VRING_DESC_F_NEXT);
 
+added:
 	/* We're using some buffers from the free list. */
 	vq->num_free -= descs_used;
 
@@ -161,6 +203,7 @@ void *virtqueue_get_buf(struct virtqueue *vq, unsigned int *len)
 {
 	unsigned int i;
 	u16 last_used;
+	struct vring_desc *desc;
 
 	if (!more_used(vq)) {
 		debug("(%s.%d): No more buffers in queue\n",
@@ -197,8 +240,12 @@ void *virtqueue_get_buf(struct virtqueue *vq, unsigned int *len)
 		virtio_store_mb(&vring_used_event(&vq->vring),
 				cpu_to_virtio16(vq->vdev, vq->last_used_idx));
 
-	return (void *)(uintptr_t)virtio64_to_cpu(vq->vdev,
-						  vq->vring.desc[i].addr);
+	/* Hand back the first buffer, not the indirect table */
+	desc = &vq->vring.desc[i];
+	if (desc->flags & cpu_to_virtio16(vq->vdev, VRING_DESC_F_INDIRECT))
+		desc = &vq->indirect[i * VIRTQUEUE_MAX_INDIRECT];
+
+	return (void *)(uintptr_t)virtio64_to_cpu(vq->vdev, desc->addr);
 }
 
 static struct virtqueue *__vring_new_virtqueue(unsigned int index,
@@ -226,6 +273,21 @@ static struct virtqueue *__vring_new_virtqueue(unsigned int index,
 
 	vq->event = virtio_has_feature(vdev, VIRTIO_RING_F_EVENT_IDX);
 
+	vq->indirect = NULL;
+	if (virtio_has_feature(vdev, VIRTIO_RING_F_INDIRECT_DESC)) {
+		size_t size = vring.num * VIRTQUEUE_MAX_INDIRECT *
+			      sizeof(struct vring_desc);
+
+		/* Fall back to direct descriptors if this fails */
+		vq->indirect = memalign(VRING_DESC_ALIGN_SIZE, size);
+		if (vq->indirect) {
+			memset(vq->indirect, 0, size);
+			for (i = 0; i < vring.num * VIRTQUEUE_MAX_INDIRECT; i++)
+				vq->indirect[i].next = cpu_to_virtio16(vdev,
+					(i + 1) % VIRTQUEUE_MAX_INDIRECT);
+		}
+	}
+
 	/* Tell other side not to bother us */
 	vq->avail_flags_shadow |= VRING_AVAIL_F_NO_INTERRUPT;
 	if (!vq->event)
@@ -287,6 +349,7 @@ struct virtqueue *vring_create_virtqueue(unsigned int index, unsigned int num,
 
 void vring_del_virtqueue(struct virtqueue *vq)
 {
+	free(vq->indirect);
 	free(vq->vring.desc);
 	list_del(&vq->list);
 	free(vq);
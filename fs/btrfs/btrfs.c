@@ -6,6 +6,7 @@
  */
 
 #include "btrfs.h"
+#include <btrfs.h>
 #include <config.h>
 #include <malloc.h>
 #include <linux/time.h>
@@ -97,12 +98,14 @@ int btrfs_probe(struct blk_desc *fs_dev_desc, disk_partition_t *fs_partition)
 
 	if (btrfs_read_chunk_tree()) {
 		printf("%s: failed to read chunk tree\n", __func__);
+		btrfs_close();
 		return -1;
 	}
 
 	if (btrfs_find_root(btrfs_get_default_subvol_objectid(),
 			    &btrfs_info.fs_root, NULL)) {
 		printf("%s: failed to find default subvolume\n", __func__);
+		btrfs_close();
 		return -1;
 	}
 
@@ -210,6 +213,9 @@ int btrfs_read(const char *file, void *buf, loff_t offset, loff_t len,
 void btrfs_close(void)
 {
 	btrfs_chunk_map_exit();
+	btrfs_node_cache_exit();
+	btrfs_read_ahead_exit();
+	btrfs_decompress_exit();
 }
 
 int btrfs_uuid(char *uuid_str)
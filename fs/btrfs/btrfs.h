@@ -11,6 +11,15 @@
 #include <linux/rbtree.h>
 #include "conv-funcs.h"
 
+/* Tree blocks kept in memory while the filesystem is mounted */
+#define BTRFS_NODE_CACHE_SIZE	16
+
+struct btrfs_cached_node {
+	u64 physical;
+	unsigned long used;	/* LRU stamp, 0 if the entry is free */
+	union btrfs_tree_node *node;
+};
+
 struct btrfs_info {
 	struct btrfs_super_block sb;
 
@@ -19,6 +28,14 @@ struct btrfs_info {
 	struct btrfs_root chunk_root;
 
 	struct rb_root chunks_root;
+
+	struct btrfs_cached_node node_cache[BTRFS_NODE_CACHE_SIZE];
+	unsigned long node_cache_stamp;
+
+	/* Compressed file data read ahead of the extent being decompressed */
+	char *ra_buf;
+	u64 ra_physical;
+	u64 ra_len;
 };
 
 extern struct btrfs_info btrfs_info;
@@ -42,12 +59,14 @@ int btrfs_devread(u64, int, void *);
 
 /* chunk-map.c */
 u64 btrfs_map_logical_to_physical(u64);
+u64 btrfs_map_logical_to_physical_len(u64, u64 *);
 int btrfs_chunk_map_init(void);
 void btrfs_chunk_map_exit(void);
 int btrfs_read_chunk_tree(void);
 
 /* compression.c */
 u32 btrfs_decompress(u8 type, const char *, u32, char *, u32);
+void btrfs_decompress_exit(void);
 
 /* super.c */
 int btrfs_read_superblock(void);
@@ -78,10 +97,23 @@ u64 btrfs_file_read(const struct btrfs_root *, u64, u64, u64, char *);
 u64 btrfs_get_default_subvol_objectid(void);
 
 /* extent-io.c */
+
+/*
+ * Uncompressed file data waiting to be read, which is extended while the
+ * following extents are contiguous on the device
+ */
+struct btrfs_read_batch {
+	u64 physical;
+	u64 len;
+	char *out;
+};
+
 u64 btrfs_read_extent_inline(struct btrfs_path *,
 			      struct btrfs_file_extent_item *, u64, u64,
 			      char *);
 u64 btrfs_read_extent_reg(struct btrfs_path *, struct btrfs_file_extent_item *,
-			   u64, u64, char *);
+			   u64, u64, char *, struct btrfs_read_batch *);
+int btrfs_read_batch_flush(struct btrfs_read_batch *);
+void btrfs_read_ahead_exit(void);
 
 #endif /* !__BTRFS_BTRFS_H__ */
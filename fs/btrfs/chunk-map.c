@@ -67,7 +67,11 @@ static int add_chunk_mapping(struct btrfs_key *key, struct btrfs_chunk *chunk)
 	return 0;
 }
 
-u64 btrfs_map_logical_to_physical(u64 logical)
+/*
+ * Also returns in *len the number of bytes from logical to the end of its
+ * chunk, which are contiguous on the device
+ */
+u64 btrfs_map_logical_to_physical_len(u64 logical, u64 *len)
 {
 	struct rb_node *node = btrfs_info.chunks_root.rb_node;
 
@@ -76,12 +80,14 @@ u64 btrfs_map_logical_to_physical(u64 logical)
 
 		item = rb_entry(node, struct chunk_map_item, node);
 
-		if (item->logical > logical)
+		if (item->logical > logical) {
 			node = node->rb_left;
-		else if (logical >= item->logical + item->length)
+		} else if (logical >= item->logical + item->length) {
 			node = node->rb_right;
-		else
+		} else {
+			*len = item->logical + item->length - logical;
 			return item->physical + logical - item->logical;
+		}
 	}
 
 	printf("%s: Cannot map logical address %llu to physical\n", __func__,
@@ -90,6 +96,13 @@ u64 btrfs_map_logical_to_physical(u64 logical)
 	return -1ULL;
 }
 
+u64 btrfs_map_logical_to_physical(u64 logical)
+{
+	u64 len;
+
+	return btrfs_map_logical_to_physical_len(logical, &len);
+}
+
 void btrfs_chunk_map_exit(void)
 {
 	struct rb_node *now, *next;
@@ -12,6 +12,14 @@
 #include <u-boot/zlib.h>
 #include <asm/unaligned.h>
 
+/*
+ * Decompression state is set up for the first compressed extent and then
+ * reused for the others, until btrfs_close()
+ */
+static z_stream zlib_stream;	/* Raw deflate, without the zlib header */
+static ZSTD_DStream *zstd_dstream;
+static void *zstd_workspace;
+
 static u32 decompress_lzo(const u8 *cbuf, u32 clen, u8 *dbuf, u32 dlen)
 {
 	u32 tot_len, in_len, res;
@@ -64,45 +72,53 @@ static u32 decompress_lzo(const u8 *cbuf, u32 clen, u8 *dbuf, u32 dlen)
 
 static u32 decompress_zlib(const u8 *_cbuf, u32 clen, u8 *dbuf, u32 dlen)
 {
-	int wbits = MAX_WBITS, ret = -1;
-	z_stream stream;
+	int ret = -1;
+	z_stream one_off, *stream;
 	u8 *cbuf;
 	u32 res;
 
-	memset(&stream, 0, sizeof(stream));
-
 	cbuf = (u8 *) _cbuf;
 
-	stream.total_in = 0;
-
-	stream.next_out = dbuf;
-	stream.avail_out = dlen;
-	stream.total_out = 0;
-
 	/* skip adler32 check if deflate and no dictionary */
 	if (clen > 2 && !(cbuf[1] & PRESET_DICT) &&
 	    ((cbuf[0] & 0x0f) == Z_DEFLATED) &&
 	    !(((cbuf[0] << 8) + cbuf[1]) % 31)) {
-		wbits = -((cbuf[0] >> 4) + 8);
 		cbuf += 2;
 		clen -= 2;
-	}
 
-	if (Z_OK != inflateInit2(&stream, wbits))
+		/* A raw stream decoder handles all smaller windows too */
+		stream = &zlib_stream;
+		if (stream->state)
+			ret = inflateReset(stream);
+		else
+			ret = inflateInit2(stream, -MAX_WBITS);
+	} else {
+		stream = &one_off;
+		memset(stream, 0, sizeof(*stream));
+		ret = inflateInit2(stream, MAX_WBITS);
+	}
+	if (ret != Z_OK)
 		return -1;
 
-	while (stream.total_in < clen) {
-		stream.next_in = cbuf + stream.total_in;
-		stream.avail_in = min((u32) (clen - stream.total_in),
-				      (u32) btrfs_info.sb.sectorsize);
+	stream->total_in = 0;
+
+	stream->next_out = dbuf;
+	stream->avail_out = dlen;
+	stream->total_out = 0;
 
-		ret = inflate(&stream, Z_NO_FLUSH);
+	while (stream->total_in < clen) {
+		stream->next_in = cbuf + stream->total_in;
+		stream->avail_in = min((u32) (clen - stream->total_in),
+				       (u32) btrfs_info.sb.sectorsize);
+
+		ret = inflate(stream, Z_NO_FLUSH);
 		if (ret != Z_OK)
 			break;
 	}
 
-	res = stream.total_out;
-	inflateEnd(&stream);
+	res = stream->total_out;
+	if (stream == &one_off)
+		inflateEnd(stream);
 
 	if (ret != Z_STREAM_END)
 		return -1;
@@ -113,28 +129,43 @@ static u32 decompress_zlib(const u8 *_cbuf, u32 clen, u8 *dbuf, u32 dlen)
 #define ZSTD_BTRFS_MAX_WINDOWLOG 17
 #define ZSTD_BTRFS_MAX_INPUT (1 << ZSTD_BTRFS_MAX_WINDOWLOG)
 
-static u32 decompress_zstd(const u8 *cbuf, u32 clen, u8 *dbuf, u32 dlen)
+static int init_zstd(void)
 {
-	ZSTD_DStream *dstream;
-	ZSTD_inBuffer in_buf;
-	ZSTD_outBuffer out_buf;
-	void *workspace;
 	size_t wsize;
-	u32 res = -1;
 
 	wsize = ZSTD_DStreamWorkspaceBound(ZSTD_BTRFS_MAX_INPUT);
-	workspace = malloc(wsize);
-	if (!workspace) {
+	zstd_workspace = malloc(wsize);
+	if (!zstd_workspace) {
 		debug("%s: cannot allocate workspace of size %zu\n", __func__,
 		      wsize);
 		return -1;
 	}
 
-	dstream = ZSTD_initDStream(ZSTD_BTRFS_MAX_INPUT, workspace, wsize);
-	if (!dstream) {
+	zstd_dstream = ZSTD_initDStream(ZSTD_BTRFS_MAX_INPUT, zstd_workspace,
+					wsize);
+	if (!zstd_dstream) {
 		printf("%s: ZSTD_initDStream failed\n", __func__);
-		goto err_free;
+		free(zstd_workspace);
+		zstd_workspace = NULL;
+		return -1;
+	}
+
+	return 0;
+}
+
+static u32 decompress_zstd(const u8 *cbuf, u32 clen, u8 *dbuf, u32 dlen)
+{
+	ZSTD_DStream *dstream;
+	ZSTD_inBuffer in_buf;
+	ZSTD_outBuffer out_buf;
+
+	if (!zstd_dstream) {
+		if (init_zstd())
+			return -1;
+	} else if (ZSTD_isError(ZSTD_resetDStream(zstd_dstream))) {
+		return -1;
 	}
+	dstream = zstd_dstream;
 
 	in_buf.src = cbuf;
 	in_buf.pos = 0;
@@ -151,18 +182,14 @@ static u32 decompress_zstd(const u8 *cbuf, u32 clen, u8 *dbuf, u32 dlen)
 		if (ZSTD_isError(ret)) {
 			printf("%s: ZSTD_decompressStream error %d\n", __func__,
 			       ZSTD_getErrorCode(ret));
-			goto err_free;
+			return -1;
 		}
 
 		if (in_buf.pos >= clen || !ret)
 			break;
 	}
 
-	res = out_buf.pos;
-
-err_free:
-	free(workspace);
-	return res;
+	return out_buf.pos;
 }
 
 u32 btrfs_decompress(u8 type, const char *c, u32 clen, char *d, u32 dlen)
@@ -191,3 +218,14 @@ u32 btrfs_decompress(u8 type, const char *c, u32 clen, char *d, u32 dlen)
 		return -1;
 	}
 }
+
+void btrfs_decompress_exit(void)
+{
+	if (zlib_stream.state)
+		inflateEnd(&zlib_stream);
+	memset(&zlib_stream, 0, sizeof(zlib_stream));
+
+	free(zstd_workspace);
+	zstd_workspace = NULL;
+	zstd_dstream = NULL;
+}
@@ -104,38 +104,107 @@ void btrfs_free_path(struct btrfs_path *p)
 	clear_path(p);
 }
 
+/*
+ * Tree blocks are copied from the cache rather than shared, since their
+ * users convert items to CPU order in place and free them with the path
+ */
+static union btrfs_tree_node *node_cache_get(u64 physical)
+{
+	struct btrfs_cached_node *c;
+	union btrfs_tree_node *res;
+	int i;
+
+	for (i = 0; i < BTRFS_NODE_CACHE_SIZE; ++i) {
+		c = &btrfs_info.node_cache[i];
+		if (!c->used || c->physical != physical)
+			continue;
+
+		res = malloc_cache_aligned(btrfs_info.sb.nodesize);
+		if (!res)
+			return NULL;
+
+		memcpy(res, c->node, btrfs_info.sb.nodesize);
+		c->used = ++btrfs_info.node_cache_stamp;
+		return res;
+	}
+
+	return NULL;
+}
+
+static void node_cache_put(u64 physical, union btrfs_tree_node *node)
+{
+	struct btrfs_cached_node *c, *victim = NULL;
+	int i;
+
+	for (i = 0; i < BTRFS_NODE_CACHE_SIZE; ++i) {
+		c = &btrfs_info.node_cache[i];
+		if (!victim || c->used < victim->used)
+			victim = c;
+	}
+
+	if (!victim->node) {
+		victim->node = malloc_cache_aligned(btrfs_info.sb.nodesize);
+		if (!victim->node)
+			return;
+	}
+
+	memcpy(victim->node, node, btrfs_info.sb.nodesize);
+	victim->physical = physical;
+	victim->used = ++btrfs_info.node_cache_stamp;
+}
+
+void btrfs_node_cache_exit(void)
+{
+	int i;
+
+	for (i = 0; i < BTRFS_NODE_CACHE_SIZE; ++i) {
+		free(btrfs_info.node_cache[i].node);
+		btrfs_info.node_cache[i].node = NULL;
+		btrfs_info.node_cache[i].used = 0;
+	}
+}
+
 static int read_tree_node(u64 physical, union btrfs_tree_node **buf)
 {
-	ALLOC_CACHE_ALIGN_BUFFER(struct btrfs_header, hdr,
-				 sizeof(struct btrfs_header));
-	unsigned long size, offset = sizeof(*hdr);
 	union btrfs_tree_node *res;
+	struct btrfs_header *hdr;
+	unsigned long size;
 	u32 i;
 
-	if (!btrfs_devread(physical, sizeof(*hdr), hdr))
+	res = node_cache_get(physical);
+	if (res) {
+		*buf = res;
+		return 0;
+	}
+
+	res = malloc_cache_aligned(btrfs_info.sb.nodesize);
+	if (!res) {
+		debug("%s: malloc failed\n", __func__);
 		return -1;
+	}
 
+	/* Read the whole block with one request, even for nodes */
+	if (!btrfs_devread(physical, btrfs_info.sb.nodesize, res)) {
+		free(res);
+		return -1;
+	}
+
+	hdr = &res->header;
 	btrfs_header_to_cpu(hdr);
 
 	if (hdr->level)
 		size = sizeof(struct btrfs_node)
 		       + hdr->nritems * sizeof(struct btrfs_key_ptr);
 	else
-		size = btrfs_info.sb.nodesize;
-
-	res = malloc_cache_aligned(size);
-	if (!res) {
-		debug("%s: malloc failed\n", __func__);
-		return -1;
-	}
-
-	if (!btrfs_devread(physical + offset, size - offset,
-			   ((u8 *) res) + offset)) {
+		size = sizeof(struct btrfs_leaf)
+		       + hdr->nritems * sizeof(struct btrfs_item);
+	if (size > btrfs_info.sb.nodesize) {
+		printf("%s: invalid number of items at %llu\n", __func__,
+		       physical);
 		free(res);
 		return -1;
 	}
 
-	memcpy(&res->header, hdr, sizeof(*hdr));
 	if (hdr->level)
 		for (i = 0; i < hdr->nritems; ++i)
 			btrfs_key_ptr_to_cpu(&res->node.ptrs[i]);
@@ -143,6 +212,7 @@ static int read_tree_node(u64 physical, union btrfs_tree_node **buf)
 		for (i = 0; i < hdr->nritems; ++i)
 			btrfs_item_to_cpu(&res->leaf.items[i]);
 
+	node_cache_put(physical, res);
 	*buf = res;
 
 	return 0;
@@ -281,6 +281,7 @@ int btrfs_search_tree(const struct btrfs_root *, struct btrfs_key *,
 		      struct btrfs_path *);
 int btrfs_prev_slot(struct btrfs_path *);
 int btrfs_next_slot(struct btrfs_path *);
+void btrfs_node_cache_exit(void);
 
 static inline struct btrfs_key *btrfs_path_leaf_key(struct btrfs_path *p) {
 	return &p->nodes[0]->leaf.items[p->slots[0]].key;
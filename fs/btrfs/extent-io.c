@@ -8,6 +8,12 @@
 #include "btrfs.h"
 #include <malloc.h>
 #include <memalign.h>
+#include <linux/sizes.h>
+
+/* Largest device request for uncompressed file data */
+#define BTRFS_READ_BATCH_MAX	SZ_1G
+/* Largest device request for compressed file data */
+#define BTRFS_READ_AHEAD_MAX	SZ_1M
 
 u64 btrfs_read_extent_inline(struct btrfs_path *path,
 			     struct btrfs_file_extent_item *extent, u64 offset,
@@ -61,11 +67,88 @@ err:
 	return -1ULL;
 }
 
+int btrfs_read_batch_flush(struct btrfs_read_batch *batch)
+{
+	u64 len = batch->len;
+
+	batch->len = 0;
+	if (len && !btrfs_devread(batch->physical, len, batch->out))
+		return -1;
+
+	return 0;
+}
+
+/* Read uncompressed data, along with the batch if it is contiguous */
+static int read_batched(struct btrfs_read_batch *batch, u64 physical,
+			u64 len, char *out)
+{
+	if (batch->len && batch->physical + batch->len == physical &&
+	    batch->out + batch->len == out &&
+	    batch->len + len <= BTRFS_READ_BATCH_MAX) {
+		batch->len += len;
+		return 0;
+	}
+
+	if (btrfs_read_batch_flush(batch))
+		return -1;
+
+	batch->physical = physical;
+	batch->len = len;
+	batch->out = out;
+
+	return 0;
+}
+
+/*
+ * Get the len bytes of compressed data at physical. If they are not already
+ * buffered, up to ahead bytes from there are read with one request, so that
+ * the data of the extents that follow is read along with them.
+ */
+static char *read_compressed(u64 physical, u64 len, u64 ahead)
+{
+	if (btrfs_info.ra_len && physical >= btrfs_info.ra_physical &&
+	    physical + len <= btrfs_info.ra_physical + btrfs_info.ra_len)
+		return btrfs_info.ra_buf + physical - btrfs_info.ra_physical;
+
+	if (len > BTRFS_READ_AHEAD_MAX) {
+		printf("%s: compressed extent too large (%llu)\n", __func__,
+		       len);
+		return NULL;
+	}
+
+	if (!btrfs_info.ra_buf) {
+		btrfs_info.ra_buf = malloc_cache_aligned(BTRFS_READ_AHEAD_MAX);
+		if (!btrfs_info.ra_buf)
+			return NULL;
+	}
+
+	ahead = clamp(ahead, len, (u64) BTRFS_READ_AHEAD_MAX);
+	btrfs_info.ra_len = 0;
+	if (!btrfs_devread(physical, ahead, btrfs_info.ra_buf))
+		return NULL;
+
+	btrfs_info.ra_physical = physical;
+	btrfs_info.ra_len = ahead;
+
+	return btrfs_info.ra_buf;
+}
+
+void btrfs_read_ahead_exit(void)
+{
+	free(btrfs_info.ra_buf);
+	btrfs_info.ra_buf = NULL;
+	btrfs_info.ra_len = 0;
+}
+
+/*
+ * Uncompressed data is only queued in batch, to be read along with that of
+ * the following extents; btrfs_read_batch_flush() reads it.
+ */
 u64 btrfs_read_extent_reg(struct btrfs_path *path,
 			  struct btrfs_file_extent_item *extent, u64 offset,
-			  u64 size, char *out)
+			  u64 size, char *out, struct btrfs_read_batch *batch)
 {
-	u64 physical, clen, dlen, orig_size = size;
+	u64 physical, chunk_len, clen, dlen, orig_size = size;
 	u32 res;
 	char *cbuf, *dbuf;
 
@@ -78,43 +161,57 @@ u64 btrfs_read_extent_reg(struct btrfs_path *path,
 	if (size > dlen - offset)
 		size = dlen - offset;
 
-	physical = btrfs_map_logical_to_physical(extent->disk_bytenr);
+	physical = btrfs_map_logical_to_physical_len(extent->disk_bytenr,
+						     &chunk_len);
 	if (physical == -1ULL)
 		return -1ULL;
 
 	if (extent->compression == BTRFS_COMPRESS_NONE) {
 		physical += extent->offset + offset;
-		if (!btrfs_devread(physical, size, out))
+		if (read_batched(batch, physical, size, out))
 			return -1ULL;
 
 		return size;
 	}
 
-	cbuf = malloc_cache_aligned(dlen > size ? clen + dlen : clen);
+	/*
+	 * The extent may only use part of the compressed data, which
+	 * decompresses to ram_bytes. The rest of the request is most likely
+	 * in the compressed extents that follow.
+	 */
+	offset += extent->offset;
+	dlen = extent->ram_bytes;
+	if (offset + size > dlen)
+		return -1ULL;
+
+	cbuf = read_compressed(physical, clen,
+			       min(max(clen, orig_size), chunk_len));
 	if (!cbuf)
 		return -1ULL;
 
-	if (dlen > orig_size)
-		dbuf = cbuf + clen;
-	else
+	if (dlen > orig_size) {
+		dbuf = malloc(dlen);
+		if (!dbuf)
+			return -1ULL;
+	} else {
 		dbuf = out;
-
-	if (!btrfs_devread(physical, clen, cbuf))
-		goto err;
+	}
 
 	res = btrfs_decompress(extent->compression, cbuf, clen, dbuf, dlen);
-	if (res == -1)
+	if (res == -1 || res < offset + size)
 		goto err;
 
-	if (dlen > orig_size)
+	if (dlen > orig_size) {
 		memcpy(out, dbuf + offset, size);
-	else
+		free(dbuf);
+	} else if (offset) {
 		memmove(out, dbuf + offset, size);
+	}
 
-	free(cbuf);
-	return res;
+	return size;
 
 err:
-	free(cbuf);
+	if (dlen > orig_size)
+		free(dbuf);
 	return -1ULL;
 }
@@ -322,6 +322,7 @@ u64 btrfs_file_read(const struct btrfs_root *root, u64 inr, u64 offset,
 	struct btrfs_path path;
 	struct btrfs_key key;
 	struct btrfs_file_extent_item *extent;
+	struct btrfs_read_batch batch = { 0 };
 	int res = 0;
 	u64 rd, rd_all = -1ULL;
 
@@ -356,7 +357,7 @@ u64 btrfs_file_read(const struct btrfs_root *root, u64 inr, u64 offset,
 		} else {
 			btrfs_file_extent_item_to_cpu(extent);
 			rd = btrfs_read_extent_reg(&path, extent, offset, size,
-						   buf);
+						   buf, &batch);
 		}
 
 		if (rd == -1ULL) {
@@ -377,6 +378,11 @@ u64 btrfs_file_read(const struct btrfs_root *root, u64 inr, u64 offset,
 	if (res)
 		return -1ULL;
 
+	if (btrfs_read_batch_flush(&batch)) {
+		printf("%s: Error reading extent\n", __func__);
+		rd_all = -1ULL;
+	}
+
 out:
 	btrfs_free_path(&path);
 	return rd_all;
@@ -0,0 +1,1062 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * EROFS read-only filesystem
+ *
+ * Inodes, inline file tails, directories and the cluster indexes of
+ * compressed files are read through a small cache of metadata blocks.
+ *
+ * Uncompressed file data is read straight into the destination. Compressed
+ * files are made of extents, each stored as LZ4 in one physical block. An
+ * extent that lies wholly inside the range being read is decompressed
+ * straight into the destination; only extents cut by the start or end of
+ * the range go through a bounce buffer. The physical blocks of consecutive
+ * extents are read ahead with one device request.
+ */
+
+#include <common.h>
+#include <blk.h>
+#include <errno.h>
+#include <erofs.h>
+#include <fs.h>
+#include <fs_internal.h>
+#include <lz4.h>
+#include <malloc.h>
+#include <memalign.h>
+#include <uuid.h>
+#include <asm/unaligned.h>
+#include <linux/kernel.h>
+#include <linux/sizes.h>
+#include <linux/stat.h>
+
+#include "erofs_fs.h"
+
+#define EROFS_META_CACHE	8	/* Metadata blocks kept */
+#define EROFS_RUN_BLOCKS	32	/* Most compressed blocks read ahead */
+#define EROFS_MAX_SYMLINKS	8	/* Most symlinks followed for a path */
+#define EROFS_NAME_MAX		255
+
+struct erofs_meta {
+	u64 blk;		/* Block number, valid if @used is non-zero */
+	ulong used;		/* When last used, for LRU eviction */
+	u8 *data;
+};
+
+struct erofs_inode {
+	u64 nid;
+	u64 size;
+	u64 inline_pos;		/* Position of the data after the inode */
+	u16 mode;
+	u8 datalayout;
+	u32 blkaddr;		/* First data block of uncompressed inodes */
+	/* Compressed inodes */
+	u64 z_index;		/* Position of the cluster index */
+	u16 z_advise;
+	u8 z_lclusterbits;
+};
+
+/* A logical cluster, as described by the cluster index */
+struct z_erofs_lcluster {
+	u32 lcn;
+	u8 type;
+	u32 clusterofs;
+	u32 pblk;		/* HEAD and PLAIN clusters */
+	u32 delta;		/* NONHEAD clusters: distance to the HEAD */
+};
+
+/* A whole extent: the file data in [la, lend) is stored in block pblk */
+struct z_erofs_extent {
+	u64 la;
+	u64 lend;
+	u32 pblk;
+	bool zipped;
+};
+
+/*
+ * Directory entries are all read when the directory is opened, since the
+ * filesystem is closed, and its caches emptied, between fs_readdir() calls.
+ * Each entry is the size (8 bytes), the FS_DT_... type (1 byte) and the
+ * name, terminated with a nul.
+ */
+struct erofs_dir_stream {
+	struct fs_dir_stream fs_dirs;
+	struct fs_dirent dirent;
+	u8 *ents;
+	u32 len;
+	u32 pos;
+};
+
+struct erofs_info {
+	struct blk_desc *desc;
+	disk_partition_t part;
+
+	u32 blksz;
+	u8 blkszbits;
+	u32 blocks;
+	u64 meta_base;
+	u64 root_nid;
+	u32 feature_incompat;
+	u8 uuid[16];
+
+	struct erofs_meta meta[EROFS_META_CACHE];
+	ulong stamp;
+	u8 *dirbuf;		/* A directory block */
+
+	/* Compressed blocks read ahead */
+	u8 *run;
+	u32 run_blk;
+	u32 run_len;
+	/* Extents that are only partly wanted */
+	u8 *bounce;
+	u32 bounce_size;
+};
+
+static struct erofs_info *erofs;
+
+/* Number of blocks of 1 << @bits bytes needed for @size bytes */
+static u32 erofs_blocks(u64 size, u32 bits)
+{
+	return (size + (1 << bits) - 1) >> bits;
+}
+
+static int erofs_disk_read(struct erofs_info *ei, u64 pos, u64 len, void *buf)
+{
+	struct blk_desc *desc = ei->desc;
+	u32 n;
+
+	while (len) {
+		n = min_t(u64, len, SZ_1G);
+		if (!fs_devread(desc, &ei->part, pos >> desc->log2blksz,
+				pos & (desc->blksz - 1), n, buf))
+			return -EIO;
+		pos += n;
+		buf += n;
+		len -= n;
+	}
+
+	return 0;
+}
+
+static u8 *erofs_meta_get(struct erofs_info *ei, u64 blk)
+{
+	struct erofs_meta *m, *victim = NULL;
+	int i;
+
+	for (i = 0; i < EROFS_META_CACHE; i++) {
+		m = &ei->meta[i];
+		if (m->used && m->blk == blk) {
+			m->used = ++ei->stamp;
+			return m->data;
+		}
+		if (!victim || m->used < victim->used)
+			victim = m;
+	}
+
+	m = victim;
+	m->used = 0;
+	if (blk >= ei->blocks ||
+	    erofs_disk_read(ei, blk << ei->blkszbits, ei->blksz, m->data))
+		return NULL;
+	m->blk = blk;
+	m->used = ++ei->stamp;
+
+	return m->data;
+}
+
+static int erofs_meta_read(struct erofs_info *ei, u64 pos, void *buf,
+			   u32 len)
+{
+	u32 off, n;
+	u8 *data;
+
+	while (len) {
+		data = erofs_meta_get(ei, pos >> ei->blkszbits);
+		if (!data)
+			return -EIO;
+		off = pos & (ei->blksz - 1);
+		n = min(len, ei->blksz - off);
+		memcpy(buf, data + off, n);
+		pos += n;
+		buf += n;
+		len -= n;
+	}
+
+	return 0;
+}
+
+static int erofs_read_inode(struct erofs_info *ei, u64 nid,
+			    struct erofs_inode *ino)
+{
+	union {
+		struct erofs_inode_compact c;
+		struct erofs_inode_extended e;
+	} i;
+	struct z_erofs_map_header h;
+	u64 pos = ei->meta_base + (nid << EROFS_ISLOTBITS);
+	u32 isize;
+	u16 fmt;
+	int ret;
+
+	ret = erofs_meta_read(ei, pos, &i.c, sizeof(i.c));
+	if (ret)
+		return ret;
+
+	memset(ino, 0, sizeof(*ino));
+	ino->nid = nid;
+	fmt = le16_to_cpu(i.c.i_format);
+	ino->datalayout = EROFS_I_DATALAYOUT(fmt);
+	switch (EROFS_I_VERSION(fmt)) {
+	case EROFS_INODE_LAYOUT_COMPACT:
+		isize = sizeof(i.c);
+		ino->size = le32_to_cpu(i.c.i_size);
+		break;
+	default:
+		isize = sizeof(i.e);
+		ret = erofs_meta_read(ei, pos + sizeof(i.c),
+				      (u8 *)&i + sizeof(i.c),
+				      sizeof(i.e) - sizeof(i.c));
+		if (ret)
+			return ret;
+		ino->size = le64_to_cpu(i.e.i_size);
+		break;
+	}
+	/* i_format, i_xattr_icount, i_mode and i_u are common to both */
+	ino->mode = le16_to_cpu(i.c.i_mode);
+	ino->blkaddr = le32_to_cpu(i.c.i_u);
+	ino->inline_pos = pos + isize +
+		EROFS_XATTR_ISIZE(le16_to_cpu(i.c.i_xattr_icount));
+
+	switch (ino->datalayout) {
+	case EROFS_INODE_FLAT_PLAIN:
+	case EROFS_INODE_FLAT_INLINE:
+		return 0;
+	case EROFS_INODE_COMPRESSED_FULL:
+	case EROFS_INODE_COMPRESSED_COMPACT:
+		break;
+	default:
+		printf("** erofs: unsupported data layout %d **\n",
+		       ino->datalayout);
+		return -EOPNOTSUPP;
+	}
+
+	pos = round_up(ino->inline_pos, 8);
+	ret = erofs_meta_read(ei, pos, &h, sizeof(h));
+	if (ret)
+		return ret;
+	ino->z_advise = le16_to_cpu(h.h_advise);
+	ino->z_lclusterbits = ei->blkszbits + (h.h_clusterbits & 7);
+	ino->z_index = pos + sizeof(h);
+	if (ino->datalayout == EROFS_INODE_COMPRESSED_FULL)
+		ino->z_index += Z_EROFS_FULL_INDEX_PADDING;
+
+	/* Big or tail-packed clusters, fragments and other algorithms */
+	if ((h.h_algorithmtype & 0xf) != Z_EROFS_COMPRESSION_LZ4 ||
+	    h.h_clusterbits >> 3 ||
+	    ino->z_advise & ~Z_EROFS_ADVISE_COMPACTED_2B ||
+	    (ino->datalayout == EROFS_INODE_COMPRESSED_COMPACT &&
+	     ino->z_lclusterbits != ei->blkszbits)) {
+		printf("** erofs: unsupported compressed inode %llu **\n",
+		       nid);
+		return -EOPNOTSUPP;
+	}
+	if (!IS_ENABLED(CONFIG_LZ4)) {
+		printf("** erofs: LZ4 support is not enabled **\n");
+		return -EOPNOTSUPP;
+	}
+
+	return 0;
+}
+
+/* Read from an uncompressed inode, through the metadata cache if @meta */
+static int erofs_read_flat(struct erofs_info *ei, struct erofs_inode *ino,
+			   void *buf, u64 off, u64 len, bool meta)
+{
+	u64 end = off + len;
+	u64 pos = (u64)ino->blkaddr << ei->blkszbits;
+	u64 tail, n;
+	int ret;
+
+	/* The last block of an inline inode is stored after the inode */
+	tail = erofs_blocks(ino->size, ei->blkszbits);
+	if (ino->datalayout == EROFS_INODE_FLAT_INLINE && tail)
+		tail--;
+	tail <<= ei->blkszbits;
+
+	if (off < tail) {
+		n = min(end, tail) - off;
+		if (meta)
+			ret = erofs_meta_read(ei, pos + off, buf, n);
+		else
+			ret = erofs_disk_read(ei, pos + off, n, buf);
+		if (ret)
+			return ret;
+		buf += n;
+		off += n;
+	}
+	if (off < end) {
+		if (end - tail > ei->blksz)
+			return -EIO;
+		ret = erofs_meta_read(ei, ino->inline_pos + off - tail, buf,
+				      end - off);
+		if (ret)
+			return ret;
+	}
+
+	return 0;
+}
+
+static u32 z_erofs_decode_bits(const u8 *in, u32 pos, u32 lobits, u8 *type)
+{
+	u32 v = get_unaligned_le32(in + pos / 8) >> (pos & 7);
+
+	*type = (v >> lobits) & 3;
+
+	return v & ((1 << lobits) - 1);
+}
+
+/*
+ * Compact indexes pack 2 clusters into 8 bytes or 16 into 32 bytes: a value
+ * of lclusterbits + 2 type bits for each, then the block of the first HEAD
+ * in the pack less one. Later HEADs in the pack use the following blocks.
+ * The value is clusterofs for HEAD and PLAIN clusters and the distance back
+ * to the HEAD for NONHEAD ones, except that the last cluster in a pack
+ * holds the distance forward instead.
+ */
+static int z_erofs_load_compact(struct erofs_info *ei, struct erofs_inode *ino,
+				u32 lcn, struct z_erofs_lcluster *lc)
+{
+	const u32 lobits = ino->z_lclusterbits;
+	u32 initial_4b, compacted_2b, totalidx, shift;
+	u32 vcnt, packsize, encodebits, lo, nblk;
+	u8 in[32 + 4];
+	u64 pos;
+	u8 type;
+	int i, ret;
+
+	totalidx = erofs_blocks(ino->size, lobits);
+	initial_4b = (32 - ino->z_index % 32) / 4;
+	if (initial_4b == 32 / 4)
+		initial_4b = 0;
+	compacted_2b = 0;
+	if (ino->z_advise & Z_EROFS_ADVISE_COMPACTED_2B &&
+	    totalidx > initial_4b)
+		compacted_2b = rounddown(totalidx - initial_4b, 16);
+
+	pos = ino->z_index;
+	shift = 2;
+	if (lcn >= initial_4b) {
+		pos += initial_4b * 4;
+		if (lcn - initial_4b < compacted_2b) {
+			shift = 1;
+			lcn -= initial_4b;
+		} else {
+			pos += compacted_2b * 2;
+			lcn -= initial_4b + compacted_2b;
+		}
+	}
+	pos += lcn << shift;
+
+	if (shift == 2)
+		vcnt = 2;
+	else if (lobits == 12)
+		vcnt = 16;
+	else
+		return -EOPNOTSUPP;
+	packsize = vcnt << shift;
+	encodebits = (packsize - sizeof(__le32)) * 8 / vcnt;
+	i = (pos & (packsize - 1)) >> shift;
+	ret = erofs_meta_read(ei, pos & ~(u64)(packsize - 1), in, packsize);
+	if (ret)
+		return ret;
+
+	lo = z_erofs_decode_bits(in, encodebits * i, lobits, &type);
+	lc->type = type;
+	if (type == Z_EROFS_LCLUSTER_TYPE_NONHEAD) {
+		lc->clusterofs = 1 << lobits;
+		if (i + 1 != vcnt) {
+			lc->delta = lo;
+			return 0;
+		}
+		/* Get the distance back from the cluster before */
+		lo = z_erofs_decode_bits(in, encodebits * (i - 1), lobits,
+					 &type);
+		if (type != Z_EROFS_LCLUSTER_TYPE_NONHEAD)
+			lo = 0;
+		lc->delta = lo + 1;
+		return 0;
+	}
+
+	lc->clusterofs = lo;
+	lc->delta = 0;
+	/* Count the HEADs before this one in the pack */
+	nblk = 1;
+	while (i > 0) {
+		--i;
+		lo = z_erofs_decode_bits(in, encodebits * i, lobits, &type);
+		if (type == Z_EROFS_LCLUSTER_TYPE_NONHEAD)
+			i -= lo;
+		if (i >= 0)
+			++nblk;
+	}
+	lc->pblk = get_unaligned_le32(in + packsize - sizeof(__le32)) + nblk;
+
+	return 0;
+}
+
+static int z_erofs_load(struct erofs_info *ei, struct erofs_inode *ino,
+			u32 lcn, struct z_erofs_lcluster *lc)
+{
+	struct z_erofs_lcluster_index di;
+	int ret;
+
+	if (lcn >= erofs_blocks(ino->size, ino->z_lclusterbits))
+		return -EIO;
+	lc->lcn = lcn;
+	if (ino->datalayout == EROFS_INODE_COMPRESSED_COMPACT)
+		return z_erofs_load_compact(ei, ino, lcn, lc);
+
+	ret = erofs_meta_read(ei, ino->z_index + (u64)lcn * sizeof(di), &di,
+			      sizeof(di));
+	if (ret)
+		return ret;
+	lc->type = le16_to_cpu(di.di_advise) & 3;
+	if (lc->type == Z_EROFS_LCLUSTER_TYPE_NONHEAD) {
+		lc->clusterofs = 1 << ino->z_lclusterbits;
+		lc->delta = le16_to_cpu(di.di_u.delta[0]);
+	} else {
+		lc->clusterofs = le16_to_cpu(di.di_clusterofs);
+		lc->pblk = le32_to_cpu(di.di_u.blkaddr);
+	}
+
+	return 0;
+}
+
+/* Find the whole extent holding the byte at @pos */
+static int z_erofs_map(struct erofs_info *ei, struct erofs_inode *ino,
+		       u64 pos, struct z_erofs_extent *ext)
+{
+	const u32 bits = ino->z_lclusterbits;
+	struct z_erofs_lcluster lc;
+	u32 lcn = pos >> bits;
+	u32 endoff = pos & ((1 << bits) - 1);
+	u32 totalidx;
+	int ret;
+
+	ret = z_erofs_load(ei, ino, lcn, &lc);
+	if (ret)
+		return ret;
+
+	/* Data before clusterofs belongs to the extent before */
+	if (lc.type != Z_EROFS_LCLUSTER_TYPE_NONHEAD &&
+	    endoff < lc.clusterofs) {
+		if (!lcn)
+			return -EIO;
+		ret = z_erofs_load(ei, ino, lcn - 1, &lc);
+		if (ret)
+			return ret;
+	}
+	while (lc.type == Z_EROFS_LCLUSTER_TYPE_NONHEAD) {
+		if (!lc.delta || lc.delta > lc.lcn)
+			return -EIO;
+		ret = z_erofs_load(ei, ino, lc.lcn - lc.delta, &lc);
+		if (ret)
+			return ret;
+	}
+	ext->la = ((u64)lc.lcn << bits) + lc.clusterofs;
+	ext->pblk = lc.pblk;
+	ext->zipped = lc.type == Z_EROFS_LCLUSTER_TYPE_HEAD;
+
+	/* The extent ends where the next one starts */
+	totalidx = erofs_blocks(ino->size, bits);
+	ext->lend = ino->size;
+	for (lcn = lc.lcn + 1; lcn < totalidx; lcn++) {
+		ret = z_erofs_load(ei, ino, lcn, &lc);
+		if (ret)
+			return ret;
+		if (lc.type != Z_EROFS_LCLUSTER_TYPE_NONHEAD) {
+			ext->lend = ((u64)lcn << bits) + lc.clusterofs;
+			break;
+		}
+	}
+	if (ext->la > pos || ext->lend <= pos ||
+	    (!ext->zipped && ext->lend - ext->la > ei->blksz))
+		return -EIO;
+
+	return 0;
+}
+
+/*
+ * Get compressed block @blk, reading up to @ahead blocks from there with
+ * one request if it is not already in the run buffer
+ */
+static u8 *z_erofs_get_block(struct erofs_info *ei, u32 blk, u32 ahead)
+{
+	u32 n;
+
+	if (ei->run_len && blk >= ei->run_blk &&
+	    blk - ei->run_blk < ei->run_len)
+		return ei->run + ((blk - ei->run_blk) << ei->blkszbits);
+
+	if (blk >= ei->blocks)
+		return NULL;
+	n = clamp_t(u32, ahead, 1, EROFS_RUN_BLOCKS);
+	n = min(n, ei->blocks - blk);
+	ei->run_len = 0;
+	if (erofs_disk_read(ei, (u64)blk << ei->blkszbits,
+			    n << ei->blkszbits, ei->run))
+		return NULL;
+	ei->run_blk = blk;
+	ei->run_len = n;
+
+	return ei->run;
+}
+
+/* Decompress at least the first @want bytes of @ext into @dst */
+static int z_erofs_decompress(struct erofs_info *ei,
+			      struct z_erofs_extent *ext, u8 *dst, u32 want,
+			      u32 ahead)
+{
+	u32 len = ext->lend - ext->la;
+	size_t outn = want;
+	u32 margin = 0;
+	u8 *src;
+
+	src = z_erofs_get_block(ei, ext->pblk, ahead);
+	if (!src)
+		return -EIO;
+
+	/* With zero padding the data is at the end of the block */
+	if (ei->feature_incompat & EROFS_FEATURE_INCOMPAT_ZERO_PADDING) {
+		while (margin < ei->blksz && !src[margin])
+			margin++;
+		if (margin == ei->blksz)
+			return -EIO;
+	}
+
+	if (ulz4_block_partial(src + margin, ei->blksz - margin, dst, len,
+			       &outn))
+		return -EIO;
+
+	return 0;
+}
+
+static int erofs_read_z(struct erofs_info *ei, struct erofs_inode *ino,
+			u8 *buf, u64 off, u64 len)
+{
+	struct z_erofs_extent ext;
+	u64 end = off + len;
+	u64 pos = off;
+	u32 elen, n, ahead;
+	u8 *bounce;
+	int ret;
+
+	while (pos < end) {
+		ret = z_erofs_map(ei, ino, pos, &ext);
+		if (ret)
+			return ret;
+		elen = ext.lend - ext.la;
+		n = min(ext.lend, end) - pos;
+		ahead = erofs_blocks(end - pos, ei->blkszbits) + 1;
+
+		if (!ext.zipped) {
+			/* Plain data starts at the start of the block */
+			u64 at = (u64)ext.pblk << ei->blkszbits;
+
+			ret = erofs_disk_read(ei, at + pos - ext.la, n,
+					      buf + pos - off);
+		} else if (ext.la >= off && ext.lend <= end) {
+			ret = z_erofs_decompress(ei, &ext, buf + ext.la - off,
+						 elen, ahead);
+		} else {
+			/* Decompression needs room for the whole extent */
+			if (elen > ei->bounce_size) {
+				bounce = realloc(ei->bounce, elen);
+				if (!bounce)
+					return -ENOMEM;
+				ei->bounce = bounce;
+				ei->bounce_size = elen;
+			}
+			ret = z_erofs_decompress(ei, &ext, ei->bounce,
+						 pos - ext.la + n, ahead);
+			if (!ret)
+				memcpy(buf + pos - off,
+				       ei->bounce + pos - ext.la, n);
+		}
+		if (ret)
+			return ret;
+		pos += n;
+	}
+
+	return 0;
+}
+
+static int erofs_read_data(struct erofs_info *ei, struct erofs_inode *ino,
+			   void *buf, u64 off, u64 len, bool meta)
+{
+	switch (ino->datalayout) {
+	case EROFS_INODE_FLAT_PLAIN:
+	case EROFS_INODE_FLAT_INLINE:
+		return erofs_read_flat(ei, ino, buf, off, len, meta);
+	default:
+		return erofs_read_z(ei, ino, buf, off, len);
+	}
+}
+
+/* Read block @blk of directory @dir into ei->dirbuf */
+static int erofs_dir_block(struct erofs_info *ei, struct erofs_inode *dir,
+			   u32 blk, u32 *lenp, u32 *countp)
+{
+	u64 off = (u64)blk << ei->blkszbits;
+	u32 len = min_t(u64, ei->blksz, dir->size - off);
+	struct erofs_dirent *de = (struct erofs_dirent *)ei->dirbuf;
+	u32 nameoff;
+	int ret;
+
+	ret = erofs_read_data(ei, dir, ei->dirbuf, off, len, true);
+	if (ret)
+		return ret;
+	nameoff = le16_to_cpu(de->nameoff);
+	if (nameoff < sizeof(*de) || nameoff % sizeof(*de) || nameoff > len)
+		return -EIO;
+	*lenp = len;
+	*countp = nameoff / sizeof(*de);
+
+	return 0;
+}
+
+/* Get the name of entry @i of the block in ei->dirbuf */
+static int erofs_dir_name(struct erofs_info *ei, u32 len, u32 count, u32 i,
+			  const char **namep)
+{
+	struct erofs_dirent *de = (struct erofs_dirent *)ei->dirbuf;
+	u32 off, end;
+
+	off = le16_to_cpu(de[i].nameoff);
+	end = i + 1 < count ? le16_to_cpu(de[i + 1].nameoff) : len;
+	if (off < count * sizeof(*de) || off > end || end > len)
+		return -EIO;
+	*namep = (char *)ei->dirbuf + off;
+
+	/* The last name in a block may be padded with nuls */
+	return strnlen(*namep, end - off);
+}
+
+static int erofs_namecmp(const char *a, int alen, const char *b, int blen)
+{
+	int ret = memcmp(a, b, min(alen, blen));
+
+	return ret ? ret : alen - blen;
+}
+
+static int erofs_dir_find(struct erofs_info *ei, u64 dir_nid,
+			  const char *name, int namelen, u64 *nidp)
+{
+	struct erofs_dirent *de = (struct erofs_dirent *)ei->dirbuf;
+	struct erofs_inode dir;
+	u32 len, count, lo, hi, mid, first, last;
+	const char *dname;
+	int dlen, cmp, ret;
+
+	ret = erofs_read_inode(ei, dir_nid, &dir);
+	if (ret)
+		return ret;
+	if (!S_ISDIR(dir.mode))
+		return -ENOTDIR;
+
+	/* Names are sorted, so bisect the blocks and then the block found */
+	first = 0;
+	last = erofs_blocks(dir.size, ei->blkszbits);
+	while (first < last) {
+		mid = first + (last - first) / 2;
+		ret = erofs_dir_block(ei, &dir, mid, &len, &count);
+		if (ret)
+			return ret;
+
+		lo = 0;
+		hi = count;
+		while (lo < hi) {
+			u32 i = lo + (hi - lo) / 2;
+
+			dlen = erofs_dir_name(ei, len, count, i, &dname);
+			if (dlen < 0)
+				return dlen;
+			cmp = erofs_namecmp(name, namelen, dname, dlen);
+			if (!cmp) {
+				*nidp = le64_to_cpu(de[i].nid);
+				return 0;
+			}
+			if (cmp < 0)
+				hi = i;
+			else
+				lo = i + 1;
+		}
+		if (!lo)
+			last = mid;
+		else if (lo == count)
+			first = mid + 1;
+		else
+			break;
+	}
+
+	return -ENOENT;
+}
+
+/* Follow @path from directory *@nidp, leaving the inode found in *@nidp */
+static int erofs_walk(struct erofs_info *ei, u64 *nidp, const char *path,
+		      int *links, bool follow)
+{
+	struct erofs_inode ino;
+	const char *name;
+	char *target;
+	u64 nid, start;
+	int len, ret;
+
+	while (*path) {
+		while (*path == '/')
+			path++;
+		name = path;
+		while (*path && *path != '/')
+			path++;
+		len = path - name;
+		if (!len || (len == 1 && name[0] == '.'))
+			continue;
+
+		ret = erofs_dir_find(ei, *nidp, name, len, &nid);
+		if (ret)
+			return ret;
+		ret = erofs_read_inode(ei, nid, &ino);
+		if (ret)
+			return ret;
+
+		while (*path == '/')
+			path++;
+		if (S_ISLNK(ino.mode) && (*path || follow)) {
+			if (++*links > EROFS_MAX_SYMLINKS)
+				return -ELOOP;
+			if (ino.size > SZ_4K)
+				return -ENAMETOOLONG;
+			target = malloc(ino.size + 1);
+			if (!target)
+				return -ENOMEM;
+			ret = erofs_read_data(ei, &ino, target, 0, ino.size,
+					      true);
+			target[ino.size] = '\0';
+			start = target[0] == '/' ? ei->root_nid : *nidp;
+			if (!ret)
+				ret = erofs_walk(ei, &start, target, links,
+						 true);
+			free(target);
+			if (ret)
+				return ret;
+			*nidp = start;
+			continue;
+		}
+		*nidp = nid;
+	}
+
+	return 0;
+}
+
+static int erofs_lookup(struct erofs_info *ei, const char *path,
+			struct erofs_inode *ino)
+{
+	u64 nid = ei->root_nid;
+	int links = 0;
+	int ret;
+
+	ret = erofs_walk(ei, &nid, path, &links, true);
+	if (ret)
+		return ret;
+
+	return erofs_read_inode(ei, nid, ino);
+}
+
+int erofs_probe(struct blk_desc *fs_dev_desc, disk_partition_t *fs_partition)
+{
+	struct erofs_super_block *sb;
+	struct erofs_info *ei;
+	int i, ret;
+
+	erofs_close();
+
+	ei = calloc(1, sizeof(*ei));
+	if (!ei)
+		return -ENOMEM;
+	ei->desc = fs_dev_desc;
+	ei->part = *fs_partition;
+
+	sb = malloc_cache_aligned(sizeof(*sb));
+	if (!sb) {
+		ret = -ENOMEM;
+		goto err;
+	}
+	ret = erofs_disk_read(ei, EROFS_SUPER_OFFSET, sizeof(*sb), sb);
+	if (ret)
+		goto err;
+	if (le32_to_cpu(sb->magic) != EROFS_SUPER_MAGIC) {
+		ret = -EINVAL;
+		goto err;
+	}
+
+	ei->blkszbits = sb->blkszbits;
+	ei->blksz = 1 << ei->blkszbits;
+	ei->blocks = le32_to_cpu(sb->blocks);
+	ei->meta_base = (u64)le32_to_cpu(sb->meta_blkaddr) << ei->blkszbits;
+	ei->root_nid = le16_to_cpu(sb->root_nid);
+	ei->feature_incompat = le32_to_cpu(sb->feature_incompat);
+	memcpy(ei->uuid, sb->uuid, sizeof(ei->uuid));
+	if (ei->blkszbits < fs_dev_desc->log2blksz || ei->blkszbits > 16 ||
+	    ei->feature_incompat & ~EROFS_FEATURE_INCOMPAT_SUPP) {
+		printf("** Unsupported erofs block size or features %#x **\n",
+		       ei->feature_incompat);
+		ret = -EINVAL;
+		goto err;
+	}
+
+	for (i = 0; i < EROFS_META_CACHE; i++) {
+		ei->meta[i].data = malloc_cache_aligned(ei->blksz);
+		if (!ei->meta[i].data) {
+			ret = -ENOMEM;
+			goto err;
+		}
+	}
+	ei->dirbuf = malloc(ei->blksz);
+	ei->run = malloc_cache_aligned(EROFS_RUN_BLOCKS << ei->blkszbits);
+	if (!ei->dirbuf || !ei->run) {
+		ret = -ENOMEM;
+		goto err;
+	}
+
+	free(sb);
+	erofs = ei;
+
+	return 0;
+
+err:
+	free(sb);
+	erofs = ei;
+	erofs_close();
+
+	return ret;
+}
+
+void erofs_close(void)
+{
+	struct erofs_info *ei = erofs;
+	int i;
+
+	if (!ei)
+		return;
+
+	for (i = 0; i < EROFS_META_CACHE; i++)
+		free(ei->meta[i].data);
+	free(ei->dirbuf);
+	free(ei->run);
+	free(ei->bounce);
+	free(ei);
+	erofs = NULL;
+}
+
+static int erofs_dirent_type(u8 file_type)
+{
+	switch (file_type) {
+	case EROFS_FT_DIR:
+		return FS_DT_DIR;
+	case EROFS_FT_SYMLINK:
+		return FS_DT_LNK;
+	default:
+		return FS_DT_REG;
+	}
+}
+
+/* Add the entries of the block in ei->dirbuf to @dirs */
+static int erofs_opendir_block(struct erofs_info *ei,
+			       struct erofs_dir_stream *dirs, u32 len,
+			       u32 count, u32 *sizep)
+{
+	struct erofs_dirent *de = (struct erofs_dirent *)ei->dirbuf;
+	struct erofs_inode ino;
+	char name[EROFS_NAME_MAX + 1];
+	const char *dname;
+	u32 i, n, type;
+	u8 *ents;
+	u64 size;
+	int dlen, ret;
+
+	for (i = 0; i < count; i++) {
+		dlen = erofs_dir_name(ei, len, count, i, &dname);
+		if (dlen < 0)
+			return dlen;
+		if (dlen > EROFS_NAME_MAX)
+			return -EIO;
+		memcpy(name, dname, dlen);
+		name[dlen] = '\0';
+		type = erofs_dirent_type(de[i].file_type);
+		size = 0;
+		if (type != FS_DT_DIR) {
+			ret = erofs_read_inode(ei, le64_to_cpu(de[i].nid),
+					       &ino);
+			if (ret)
+				return ret;
+			size = ino.size;
+		}
+
+		n = sizeof(u64) + 1 + dlen + 1;
+		if (dirs->len + n > *sizep) {
+			*sizep = max(*sizep * 2, dirs->len + n + 256);
+			ents = realloc(dirs->ents, *sizep);
+			if (!ents)
+				return -ENOMEM;
+			dirs->ents = ents;
+		}
+		ents = dirs->ents + dirs->len;
+		put_unaligned(size, (u64 *)ents);
+		ents[sizeof(u64)] = type;
+		strcpy((char *)ents + sizeof(u64) + 1, name);
+		dirs->len += n;
+	}
+
+	return 0;
+}
+
+int erofs_opendir(const char *filename, struct fs_dir_stream **dirsp)
+{
+	struct erofs_info *ei = erofs;
+	struct erofs_dir_stream *dirs;
+	struct erofs_inode dir;
+	u32 blk, nblks, len, count, size = 0;
+	int ret;
+
+	if (!ei)
+		return -ENODEV;
+	ret = erofs_lookup(ei, filename, &dir);
+	if (ret)
+		return ret;
+	if (!S_ISDIR(dir.mode))
+		return -ENOTDIR;
+
+	dirs = calloc(1, sizeof(*dirs));
+	if (!dirs)
+		return -ENOMEM;
+
+	nblks = erofs_blocks(dir.size, ei->blkszbits);
+	for (blk = 0; blk < nblks; blk++) {
+		ret = erofs_dir_block(ei, &dir, blk, &len, &count);
+		if (!ret)
+			ret = erofs_opendir_block(ei, dirs, len, count, &size);
+		if (ret) {
+			free(dirs->ents);
+			free(dirs);
+			return ret;
+		}
+	}
+
+	*dirsp = &dirs->fs_dirs;
+
+	return 0;
+}
+
+int erofs_readdir(struct fs_dir_stream *fs_dirs, struct fs_dirent **dentp)
+{
+	struct erofs_dir_stream *dirs;
+	struct fs_dirent *dent;
+	u8 *ent;
+
+	dirs = container_of(fs_dirs, struct erofs_dir_stream, fs_dirs);
+	if (dirs->pos >= dirs->len)
+		return -ENOENT;
+
+	ent = dirs->ents + dirs->pos;
+	dent = &dirs->dirent;
+	memset(dent, 0, sizeof(*dent));
+	dent->size = get_unaligned((u64 *)ent);
+	dent->type = ent[sizeof(u64)];
+	strlcpy(dent->name, (char *)ent + sizeof(u64) + 1, sizeof(dent->name));
+	dirs->pos += sizeof(u64) + 1 + strlen(dent->name) + 1;
+	*dentp = dent;
+
+	return 0;
+}
+
+void erofs_closedir(struct fs_dir_stream *fs_dirs)
+{
+	struct erofs_dir_stream *dirs;
+
+	dirs = container_of(fs_dirs, struct erofs_dir_stream, fs_dirs);
+	free(dirs->ents);
+	free(dirs);
+}
+
+int erofs_exists(const char *filename)
+{
+	struct erofs_inode ino;
+
+	if (!erofs)
+		return 0;
+
+	return !erofs_lookup(erofs, filename, &ino);
+}
+
+int erofs_size(const char *filename, loff_t *size)
+{
+	struct erofs_inode ino;
+	int ret;
+
+	if (!erofs)
+		return -ENODEV;
+	ret = erofs_lookup(erofs, filename, &ino);
+	if (ret)
+		return ret;
+	if (!S_ISREG(ino.mode))
+		return -EISDIR;
+	*size = ino.size;
+
+	return 0;
+}
+
+int erofs_read(const char *filename, void *buf, loff_t offset, loff_t len,
+	       loff_t *actread)
+{
+	struct erofs_inode ino;
+	int ret;
+
+	*actread = 0;
+	if (!erofs)
+		return -ENODEV;
+	ret = erofs_lookup(erofs, filename, &ino);
+	if (ret) {
+		printf("** File not found %s **\n", filename);
+		return ret;
+	}
+	if (!S_ISREG(ino.mode)) {
+		printf("** %s is not a regular file **\n", filename);
+		return -EISDIR;
+	}
+
+	if (offset >= ino.size)
+		return offset == ino.size ? 0 : -EINVAL;
+	if (!len || len > ino.size - offset)
+		len = ino.size - offset;
+
+	ret = erofs_read_data(erofs, &ino, buf, offset, len, false);
+	if (ret) {
+		printf("** Error reading %s: %d **\n", filename, ret);
+		return ret;
+	}
+	*actread = len;
+
+	return 0;
+}
+
+int erofs_uuid(char *uuid_str)
+{
+	if (!erofs)
+		return -ENODEV;
+
+#ifdef CONFIG_LIB_UUID
+	uuid_bin_to_str(erofs->uuid, uuid_str, UUID_STR_FORMAT_STD);
+
+	return 0;
+#else
+	return -ENOSYS;
+#endif
+}
@@ -0,0 +1,154 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * EROFS on-disk format, as written by mkfs.erofs
+ *
+ * All values are little-endian. Inodes live in the metadata area and are
+ * found by their nid, which counts 32-byte slots from its start.
+ */
+
+#ifndef __EROFS_FS_H
+#define __EROFS_FS_H
+
+#include <linux/types.h>
+
+#define EROFS_SUPER_OFFSET		1024
+#define EROFS_SUPER_MAGIC		0xe0f5e1e2
+#define EROFS_ISLOTBITS			5
+
+/* Incompatible features that this driver handles */
+#define EROFS_FEATURE_INCOMPAT_ZERO_PADDING	0x00000001
+#define EROFS_FEATURE_INCOMPAT_COMPR_CFGS	0x00000002
+#define EROFS_FEATURE_INCOMPAT_SUPP	(EROFS_FEATURE_INCOMPAT_ZERO_PADDING | \
+					 EROFS_FEATURE_INCOMPAT_COMPR_CFGS)
+
+struct erofs_super_block {
+	__le32 magic;
+	__le32 checksum;
+	__le32 feature_compat;
+	__u8 blkszbits;
+	__u8 sb_extslots;
+	__le16 root_nid;
+	__le64 inos;
+	__le64 build_time;
+	__le32 build_time_nsec;
+	__le32 blocks;
+	__le32 meta_blkaddr;
+	__le32 xattr_blkaddr;
+	__u8 uuid[16];
+	__u8 volume_name[16];
+	__le32 feature_incompat;
+	__le16 available_compr_algs;
+	__le16 extra_devices;
+	__le16 devt_slotoff;
+	__u8 reserved[38];
+} __packed;
+
+/* i_format: bit 0 is the inode version, bits 1-3 the data layout */
+#define EROFS_I_VERSION(fmt)		((fmt) & 1)
+#define EROFS_I_DATALAYOUT(fmt)		(((fmt) >> 1) & 7)
+
+#define EROFS_INODE_LAYOUT_COMPACT	0
+#define EROFS_INODE_LAYOUT_EXTENDED	1
+
+enum erofs_datalayout {
+	EROFS_INODE_FLAT_PLAIN = 0,
+	EROFS_INODE_COMPRESSED_FULL = 1,
+	EROFS_INODE_FLAT_INLINE = 2,
+	EROFS_INODE_COMPRESSED_COMPACT = 3,
+	EROFS_INODE_CHUNK_BASED = 4,
+};
+
+/* 32-byte inode */
+struct erofs_inode_compact {
+	__le16 i_format;
+	__le16 i_xattr_icount;
+	__le16 i_mode;
+	__le16 i_nlink;
+	__le32 i_size;
+	__le32 i_reserved;
+	__le32 i_u;		/* raw_blkaddr, compressed_blocks or rdev */
+	__le32 i_ino;
+	__le16 i_uid;
+	__le16 i_gid;
+	__le32 i_reserved2;
+} __packed;
+
+/* 64-byte inode */
+struct erofs_inode_extended {
+	__le16 i_format;
+	__le16 i_xattr_icount;
+	__le16 i_mode;
+	__le16 i_reserved;
+	__le64 i_size;
+	__le32 i_u;
+	__le32 i_ino;
+	__le32 i_uid;
+	__le32 i_gid;
+	__le64 i_mtime;
+	__le32 i_mtime_nsec;
+	__le32 i_nlink;
+	__u8 i_reserved2[16];
+} __packed;
+
+/* The in-inode xattrs are this header and i_xattr_icount - 1 more words */
+#define EROFS_XATTR_IBODY_HEADER_SIZE	12
+#define EROFS_XATTR_ISIZE(icount)	((icount) ? \
+					 EROFS_XATTR_IBODY_HEADER_SIZE + \
+					 ((icount) - 1) * 4 : 0)
+
+/*
+ * Directory blocks start with an array of these, the first of which gives
+ * the size of the array through its nameoff. Names follow, without
+ * terminators, sorted in strcmp() order within and across blocks.
+ */
+struct erofs_dirent {
+	__le64 nid;
+	__le16 nameoff;
+	__u8 file_type;
+	__u8 reserved;
+} __packed;
+
+enum erofs_file_type {
+	EROFS_FT_UNKNOWN,
+	EROFS_FT_REG_FILE,
+	EROFS_FT_DIR,
+	EROFS_FT_CHRDEV,
+	EROFS_FT_BLKDEV,
+	EROFS_FT_FIFO,
+	EROFS_FT_SOCK,
+	EROFS_FT_SYMLINK,
+};
+
+/*
+ * Compressed inodes are followed, at the next 8-byte boundary, by a map
+ * header and then the index of logical clusters.
+ */
+struct z_erofs_map_header {
+	__le32 h_reserved1;
+	__le16 h_advise;
+	__u8 h_algorithmtype;	/* Low 4 bits: algorithm of HEAD clusters */
+	__u8 h_clusterbits;	/* Low 3 bits: logical cluster bits - blkszbits */
+} __packed;
+
+#define Z_EROFS_ADVISE_COMPACTED_2B	0x0001
+#define Z_EROFS_COMPRESSION_LZ4		0
+
+/* Full (legacy) index entries start 8 bytes after the map header */
+#define Z_EROFS_FULL_INDEX_PADDING	8
+
+struct z_erofs_lcluster_index {
+	__le16 di_advise;	/* Low 2 bits: Z_EROFS_LCLUSTER_TYPE_... */
+	__le16 di_clusterofs;
+	union {
+		__le32 blkaddr;	/* HEAD and PLAIN clusters */
+		__le16 delta[2];	/* NONHEAD clusters */
+	} di_u;
+} __packed;
+
+enum {
+	Z_EROFS_LCLUSTER_TYPE_PLAIN = 0,
+	Z_EROFS_LCLUSTER_TYPE_HEAD = 1,
+	Z_EROFS_LCLUSTER_TYPE_NONHEAD = 2,
+};
+
+#endif /* __EROFS_FS_H */
@@ -206,6 +206,9 @@ void put_ext4(uint64_t off, const void *buf, uint32_t size)
 	if (fs->dev_desc == NULL)
 		return;
 
+	/* Cached metadata may be overwritten */
+	ext4fs_cache_invalidate();
+
 	if ((startblock + (size >> log2blksz)) >
 	    (part_offset + fs->total_sect)) {
 		printf("part_offset is " LBAFU "\n", part_offset);
@@ -1584,9 +1587,10 @@ static int ext4fs_blockgroup
 	debug("ext4fs read %d group descriptor (blkno %ld blkoff %u)\n",
 	      group, blkno, blkoff);
 
-	return ext4fs_devread((lbaint_t)blkno <<
-			      (LOG2_BLOCK_SIZE(data) - log2blksz),
-			      blkoff, desc_size, (char *)blkgrp);
+	return ext4fs_cache_read((lbaint_t)blkno <<
+				 (LOG2_BLOCK_SIZE(data) - log2blksz),
+				 EXT2_BLOCK_SIZE(data), blkoff, desc_size,
+				 (char *)blkgrp);
 }
 
 int ext4fs_read_inode(struct ext2_data *data, int ino, struct ext2_inode *inode)
@@ -1630,9 +1634,9 @@ int ext4fs_read_inode(struct ext2_data *data, int ino, struct ext2_inode *inode)
 	free(blkgrp);
 
 	/* Read the inode. */
-	status = ext4fs_devread((lbaint_t)blkno << (LOG2_BLOCK_SIZE(data) -
-				log2blksz), blkoff,
-				sizeof(struct ext2_inode), (char *)inode);
+	status = ext4fs_cache_read((lbaint_t)blkno << (LOG2_BLOCK_SIZE(data) -
+				   log2blksz), EXT2_BLOCK_SIZE(data), blkoff,
+				   sizeof(struct ext2_inode), (char *)inode);
 	if (status == 0)
 		return 0;
 
@@ -2037,6 +2041,42 @@ void ext4fs_close(void)
 	}
 
 	ext4fs_reinit_global();
+	ext4fs_cache_invalidate();
+}
+
+/*
+ * Read part of a directory. Unlike file contents, directory blocks go
+ * through the metadata cache.
+ */
+static int ext4fs_read_dir(struct ext2fs_node *diro, unsigned int pos,
+			   int len, char *buf)
+{
+	int log2_fs_blksz = LOG2_BLOCK_SIZE(diro->data);
+	int log2blksz = get_fs()->dev_desc->log2blksz;
+	int blksz = EXT2_BLOCK_SIZE(diro->data);
+	long int blknr;
+	int off, n;
+
+	while (len > 0) {
+		off = pos & (blksz - 1);
+		n = min(len, blksz - off);
+		blknr = read_allocated_block(&diro->inode,
+					     pos >> log2_fs_blksz, NULL);
+		if (blknr < 0)
+			return -1;
+
+		if (!blknr)
+			memset(buf, 0, n);
+		else if (!ext4fs_cache_read((lbaint_t)blknr <<
+					    (log2_fs_blksz - log2blksz),
+					    blksz, off, n, buf))
+			return -1;
+		pos += n;
+		buf += n;
+		len -= n;
+	}
+
+	return 0;
 }
 
 int ext4fs_iterate_dir(struct ext2fs_node *dir, char *name,
@@ -2044,7 +2084,6 @@ int ext4fs_iterate_dir(struct ext2fs_node *dir, char *name,
 {
 	unsigned int fpos = 0;
 	int status;
-	loff_t actread;
 	struct ext2fs_node *diro = (struct ext2fs_node *) dir;
 
 #ifdef DEBUG
@@ -2060,9 +2099,9 @@ int ext4fs_iterate_dir(struct ext2fs_node *dir, char *name,
 	while (fpos < le32_to_cpu(diro->inode.size)) {
 		struct ext2_dirent dirent;
 
-		status = ext4fs_read_file(diro, fpos,
-					   sizeof(struct ext2_dirent),
-					   (char *)&dirent, &actread);
+		status = ext4fs_read_dir(diro, fpos,
+					 sizeof(struct ext2_dirent),
+					 (char *)&dirent);
 		if (status < 0)
 			return 0;
 
@@ -2076,11 +2115,10 @@ int ext4fs_iterate_dir(struct ext2fs_node *dir, char *name,
 			struct ext2fs_node *fdiro;
 			int type = FILETYPE_UNKNOWN;
 
-			status = ext4fs_read_file(diro,
-						  fpos +
-						  sizeof(struct ext2_dirent),
-						  dirent.namelen, filename,
-						  &actread);
+			status = ext4fs_read_dir(diro,
+						 fpos +
+						 sizeof(struct ext2_dirent),
+						 dirent.namelen, filename);
 			if (status < 0)
 				return 0;
 
@@ -2365,6 +2403,8 @@ int ext4fs_mount(unsigned part_length)
 	struct ext2_data *data;
 	int status;
 	struct ext_filesystem *fs = get_fs();
+
+	ext4fs_cache_invalidate();
 	data = zalloc(SUPERBLOCK_SIZE);
 	if (!data)
 		return 0;
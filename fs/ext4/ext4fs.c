@@ -26,6 +26,12 @@
 #include "ext4_common.h"
 #include <div64.h>
 
+#if defined(CONFIG_EXT4_CACHE_BLOCKS) && !defined(CONFIG_SPL_BUILD)
+#define EXT4_CACHE_BLOCKS	CONFIG_EXT4_CACHE_BLOCKS
+#else
+#define EXT4_CACHE_BLOCKS	0
+#endif
+
 int ext4fs_symlinknest;
 struct ext_filesystem ext_fs;
 
@@ -290,7 +296,7 @@ int ext_cache_read(struct ext_block_cache *cache, lbaint_t block, int size)
 	cache->buf = malloc(size);
 	if (!cache->buf)
 		return 0;
-	if (!ext4fs_devread(block, 0, size, cache->buf)) {
+	if (!ext4fs_cache_read(block, size, 0, size, cache->buf)) {
 		ext_cache_fini(cache);
 		return 0;
 	}
@@ -298,3 +304,94 @@ int ext_cache_read(struct ext_block_cache *cache, lbaint_t block, int size)
 	cache->size = size;
 	return 1;
 }
+
+/*
+ * Metadata cache
+ *
+ * Blocks holding group descriptors, inodes, extent-tree nodes and
+ * directories are kept from mount until the filesystem is closed or written
+ * to, so that looking up several files or listing a directory reads each of
+ * them only once. When the cache is full, the least recently used block is
+ * replaced.
+ */
+struct ext_meta_block {
+	char *buf;		/* Block contents, NULL if the slot is free */
+	lbaint_t sector;	/* First sector of the block */
+	int size;		/* Size of the block in bytes */
+	ulong used;		/* Time of the last use, for replacement */
+};
+
+static struct ext_meta_block ext_meta[EXT4_CACHE_BLOCKS];
+static ulong ext_meta_clock;
+static struct ext4fs_cache_stats ext_meta_stats;
+
+void ext4fs_cache_invalidate(void)
+{
+	bool cached = false;
+	int i;
+
+	for (i = 0; i < EXT4_CACHE_BLOCKS; i++) {
+		if (ext_meta[i].buf) {
+			free(ext_meta[i].buf);
+			ext_meta[i].buf = NULL;
+			cached = true;
+		}
+	}
+	if (cached)
+		ext_meta_stats.invalidations++;
+}
+
+int ext4fs_cache_read(lbaint_t sector, int size, int byte_offset, int byte_len,
+		      char *buf)
+{
+	struct ext_meta_block *m, *victim = NULL;
+	int i;
+
+	for (i = 0; i < EXT4_CACHE_BLOCKS; i++) {
+		m = &ext_meta[i];
+		if (!m->buf) {
+			if (!victim || victim->buf)
+				victim = m;
+			continue;
+		}
+		if (m->sector == sector && m->size == size) {
+			m->used = ++ext_meta_clock;
+			ext_meta_stats.hits++;
+			memcpy(buf, m->buf + byte_offset, byte_len);
+			return 1;
+		}
+		if (!victim || (victim->buf && m->used < victim->used))
+			victim = m;
+	}
+
+	ext_meta_stats.misses++;
+	if (victim && victim->buf) {
+		ext_meta_stats.evictions++;
+		if (victim->size != size) {
+			free(victim->buf);
+			victim->buf = NULL;
+		}
+	}
+	if (victim && !victim->buf)
+		victim->buf = malloc(size);
+	if (!victim || !victim->buf)
+		return ext4fs_devread(sector, byte_offset, byte_len, buf);
+
+	if (!ext4fs_devread(sector, 0, size, victim->buf)) {
+		free(victim->buf);
+		victim->buf = NULL;
+		return 0;
+	}
+	victim->sector = sector;
+	victim->size = size;
+	victim->used = ++ext_meta_clock;
+	memcpy(buf, victim->buf + byte_offset, byte_len);
+
+	return 1;
+}
+
+void ext4fs_cache_stats(struct ext4fs_cache_stats *stats)
+{
+	memcpy(stats, &ext_meta_stats, sizeof(*stats));
+	memset(&ext_meta_stats, 0, sizeof(ext_meta_stats));
+}
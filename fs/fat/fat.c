@@ -14,12 +14,14 @@
 #include <exports.h>
 #include <fat.h>
 #include <fs.h>
+#include <fs_internal.h>
 #include <asm/byteorder.h>
 #include <part.h>
 #include <malloc.h>
 #include <memalign.h>
 #include <linux/compiler.h>
 #include <linux/ctype.h>
+#include <linux/sizes.h>
 
 /*
  * Convert a string to lowercase.  Converts at most 'len' characters,
@@ -37,6 +39,36 @@ static void downcase(char *str, size_t len)
 static struct blk_desc *cur_dev;
 static disk_partition_t cur_part_info;
 
+/*
+ * Cluster map of the last file read
+ *
+ * The cluster chain of a file is kept as runs of contiguous clusters, so
+ * that each run can be read with a single request and reading the file
+ * again at another offset does not walk its chain from the start. The map
+ * only covers the clusters read so far and is extended as needed. It is
+ * dropped whenever the device changes or the FAT is written.
+ */
+struct fat_extent {
+	__u32	file_clust;	/* Index of the first cluster in the file */
+	__u32	start;		/* First cluster of the run */
+	__u32	len;		/* Number of clusters in the run */
+};
+
+static struct {
+	__u32	start;		/* First cluster of the file, 0 if none */
+	__u32	nclust;		/* Number of clusters mapped */
+	int	count;		/* Number of runs in ext */
+	int	size;		/* Number of runs allocated */
+	struct fat_extent *ext;
+} fat_map;
+
+static void fat_map_invalidate(void)
+{
+	fat_map.start = 0;
+	fat_map.nclust = 0;
+	fat_map.count = 0;
+}
+
 #define DOS_BOOT_MAGIC_OFFSET	0x1fe
 #define DOS_FS_TYPE_OFFSET	0x36
 #define DOS_FS32_TYPE_OFFSET	0x52
@@ -62,6 +94,7 @@ int fat_set_blk_dev(struct blk_desc *dev_desc, disk_partition_t *info)
 
 	cur_dev = dev_desc;
 	cur_part_info = *info;
+	fat_map_invalidate();
 
 	/* Make sure it has a valid FAT header */
 	if (disk_read(0, 1, buffer) != 1) {
@@ -240,15 +273,15 @@ static __u32 get_fatent(fsdata *mydata, __u32 entry)
 }
 
 /*
- * Read at most 'size' bytes from the specified cluster into 'buffer'.
+ * Read at most 'size' bytes from 'offset' in the specified cluster, and in
+ * the clusters that follow it on the disk, into 'buffer'.
  * Return 0 on success, -1 otherwise.
  */
-static int
-get_cluster(fsdata *mydata, __u32 clustnum, __u8 *buffer, unsigned long size)
+static int get_cluster(fsdata *mydata, __u32 clustnum, __u32 offset,
+		       __u8 *buffer, unsigned long size)
 {
-	__u32 idx = 0;
 	__u32 startsect;
-	int ret;
+	int len;
 
 	if (clustnum > 0) {
 		startsect = clust_to_sect(mydata, clustnum);
@@ -256,51 +289,97 @@ get_cluster(fsdata *mydata, __u32 clustnum, __u8 *buffer, unsigned long size)
 		startsect = mydata->rootdir_sect;
 	}
 
-	debug("gc - clustnum: %d, startsect: %d\n", clustnum, startsect);
+	debug("gc - clustnum: %d, startsect: %d, offset: %u\n", clustnum,
+	      startsect, offset);
 
-	if ((unsigned long)buffer & (ARCH_DMA_MINALIGN - 1)) {
-		ALLOC_CACHE_ALIGN_BUFFER(__u8, tmpbuf, mydata->sect_size);
+	/*
+	 * fs_devread() reads whole sectors straight into the buffer and only
+	 * bounces partial sectors, or everything if the buffer is misaligned.
+	 * It takes an int length, so split huge reads.
+	 */
+	while (size) {
+		len = min_t(unsigned long, size, SZ_1G);
+		if (!fs_devread(cur_dev, &cur_part_info, startsect, offset,
+				len, (char *)buffer)) {
+			debug("Error reading data\n");
+			return -1;
+		}
+		startsect += len / mydata->sect_size;
+		buffer += len;
+		size -= len;
+	}
 
-		debug("FAT: Misaligned buffer address (%p)\n", buffer);
+	return 0;
+}
 
-		while (size >= mydata->sect_size) {
-			ret = disk_read(startsect++, 1, tmpbuf);
-			if (ret != 1) {
-				debug("Error reading data (got %d)\n", ret);
-				return -1;
-			}
+/*
+ * Map at least the first 'nclust' clusters of the file starting at cluster
+ * 'start'. Return 0 on success, -1 otherwise.
+ */
+static int fat_map_extend(fsdata *mydata, __u32 start, __u32 nclust)
+{
+	struct fat_extent *ext = NULL;
+	__u32 clust = 0, next;
 
-			memcpy(buffer, tmpbuf, mydata->sect_size);
-			buffer += mydata->sect_size;
-			size -= mydata->sect_size;
-		}
-	} else {
-		idx = size / mydata->sect_size;
-		ret = disk_read(startsect, idx, buffer);
-		if (ret != idx) {
-			debug("Error reading data (got %d)\n", ret);
-			return -1;
-		}
-		startsect += idx;
-		idx *= mydata->sect_size;
-		buffer += idx;
-		size -= idx;
+	if (fat_map.start != start) {
+		fat_map_invalidate();
+		fat_map.start = start;
+	}
+	if (fat_map.count) {
+		ext = &fat_map.ext[fat_map.count - 1];
+		clust = ext->start + ext->len - 1;
 	}
-	if (size) {
-		ALLOC_CACHE_ALIGN_BUFFER(__u8, tmpbuf, mydata->sect_size);
 
-		ret = disk_read(startsect, 1, tmpbuf);
-		if (ret != 1) {
-			debug("Error reading data (got %d)\n", ret);
+	while (fat_map.nclust < nclust) {
+		next = fat_map.count ? get_fatent(mydata, clust) : start;
+		if (CHECK_CLUST(next, mydata->fatsize)) {
+			debug("curclust: 0x%x\n", next);
+			printf("Invalid FAT entry\n");
 			return -1;
 		}
 
-		memcpy(buffer, tmpbuf, size);
+		if (ext && next == clust + 1) {
+			ext->len++;
+		} else {
+			if (fat_map.count == fat_map.size) {
+				int size = fat_map.size ? fat_map.size * 2 : 16;
+
+				ext = realloc(fat_map.ext, size * sizeof(*ext));
+				if (!ext) {
+					debug("Error: allocating memory\n");
+					return -1;
+				}
+				fat_map.ext = ext;
+				fat_map.size = size;
+			}
+			ext = &fat_map.ext[fat_map.count++];
+			ext->file_clust = fat_map.nclust;
+			ext->start = next;
+			ext->len = 1;
+		}
+		clust = next;
+		fat_map.nclust++;
 	}
 
 	return 0;
 }
 
+/* Find the run holding cluster 'idx' of the file, which must be mapped */
+static struct fat_extent *fat_map_find(__u32 idx)
+{
+	int lo = 0, hi = fat_map.count - 1, mid;
+
+	while (lo < hi) {
+		mid = (lo + hi + 1) / 2;
+		if (fat_map.ext[mid].file_clust <= idx)
+			lo = mid;
+		else
+			hi = mid - 1;
+	}
+
+	return &fat_map.ext[lo];
+}
+
 /**
  * get_contents() - read from file
  *
@@ -321,8 +400,8 @@ static int get_contents(fsdata *mydata, dir_entry *dentptr, loff_t pos,
 {
 	loff_t filesize = FAT2CPU32(dentptr->size);
 	unsigned int bytesperclust = mydata->clust_size * mydata->sect_size;
-	__u32 curclust = START(dentptr);
-	__u32 endclust, newclust;
+	struct fat_extent *ext;
+	__u32 idx, curclust;
 	loff_t actsize;
 
 	*gotsize = 0;
@@ -338,101 +417,65 @@ static int get_contents(fsdata *mydata, dir_entry *dentptr, loff_t pos,
 
 	debug("%llu bytes\n", filesize);
 
-	actsize = bytesperclust;
+	/* FAT files are below 4 GiB, so 32-bit arithmetic is enough here */
+	if (fat_map_extend(mydata, START(dentptr),
+			   ((__u32)filesize - 1) / bytesperclust + 1))
+		return -1;
 
 	/* go to cluster at pos */
-	while (actsize <= pos) {
-		curclust = get_fatent(mydata, curclust);
-		if (CHECK_CLUST(curclust, mydata->fatsize)) {
-			debug("curclust: 0x%x\n", curclust);
-			printf("Invalid FAT entry\n");
-			return -1;
-		}
-		actsize += bytesperclust;
-	}
+	idx = (__u32)pos / bytesperclust;
+	ext = fat_map_find(idx);
+	curclust = ext->start + idx - ext->file_clust;
 
-	/* actsize > pos */
-	actsize -= bytesperclust;
+	actsize = (loff_t)idx * bytesperclust;
 	filesize -= actsize;
 	pos -= actsize;
 
 	/* align to beginning of next cluster if any */
 	if (pos) {
-		__u8 *tmp_buffer;
-
 		actsize = min(filesize, (loff_t)bytesperclust);
-		tmp_buffer = malloc_cache_aligned(actsize);
-		if (!tmp_buffer) {
-			debug("Error: allocating buffer\n");
-			return -1;
-		}
-
-		if (get_cluster(mydata, curclust, tmp_buffer, actsize) != 0) {
+		filesize -= actsize;
+		actsize -= pos;
+		if (get_cluster(mydata, curclust, pos, buffer, actsize) != 0) {
 			printf("Error reading cluster\n");
-			free(tmp_buffer);
 			return -1;
 		}
-		filesize -= actsize;
-		actsize -= pos;
-		memcpy(buffer, tmp_buffer + pos, actsize);
-		free(tmp_buffer);
 		*gotsize += actsize;
 		if (!filesize)
 			return 0;
 		buffer += actsize;
 
-		curclust = get_fatent(mydata, curclust);
-		if (CHECK_CLUST(curclust, mydata->fatsize)) {
-			debug("curclust: 0x%x\n", curclust);
-			printf("Invalid FAT entry\n");
-			return -1;
+		idx++;
+		curclust++;
+		if (idx == ext->file_clust + ext->len) {
+			ext++;
+			curclust = ext->start;
 		}
 	}
 
-	actsize = bytesperclust;
-	endclust = curclust;
-
+	/* read each run of consecutive clusters at once */
 	do {
-		/* search for consecutive clusters */
-		while (actsize < filesize) {
-			newclust = get_fatent(mydata, endclust);
-			if ((newclust - 1) != endclust)
-				goto getit;
-			if (CHECK_CLUST(newclust, mydata->fatsize)) {
-				debug("curclust: 0x%x\n", newclust);
-				printf("Invalid FAT entry\n");
-				return -1;
-			}
-			endclust = newclust;
-			actsize += bytesperclust;
-		}
+		actsize = (loff_t)(ext->file_clust + ext->len - idx) *
+			  bytesperclust;
+		if (actsize > filesize)
+			actsize = filesize;
 
-		/* get remaining bytes */
-		actsize = filesize;
-		if (get_cluster(mydata, curclust, buffer, (int)actsize) != 0) {
+		if (get_cluster(mydata, curclust, 0, buffer, actsize) != 0) {
 			printf("Error reading cluster\n");
 			return -1;
 		}
 		*gotsize += actsize;
-		return 0;
-getit:
-		if (get_cluster(mydata, curclust, buffer, (int)actsize) != 0) {
-			printf("Error reading cluster\n");
-			return -1;
-		}
-		*gotsize += (int)actsize;
 		filesize -= actsize;
 		buffer += actsize;
 
-		curclust = get_fatent(mydata, endclust);
-		if (CHECK_CLUST(curclust, mydata->fatsize)) {
-			debug("curclust: 0x%x\n", curclust);
-			printf("Invalid FAT entry\n");
-			return -1;
+		if (filesize) {
+			ext++;
+			idx = ext->file_clust;
+			curclust = ext->start;
 		}
-		actsize = bytesperclust;
-		endclust = curclust;
-	} while (1);
+	} while (filesize);
+
+	return 0;
 }
 
 /*
@@ -556,6 +599,7 @@ static int get_fs_info(fsdata *mydata)
 {
 	boot_sector bs;
 	volume_info volinfo;
+	__u32 blocks;
 	int ret;
 
 	ret = read_bootsectandvi(&bs, &volinfo, &mydata->fatsize);
@@ -623,7 +667,22 @@ static int get_fs_info(fsdata *mydata)
 
 	mydata->fatbufnum = -1;
 	mydata->fat_dirty = 0;
+
+	/*
+	 * Cache as much of the FAT as allowed, so that following a long
+	 * cluster chain does not re-read it over and over
+	 */
+	blocks = CONFIG_FS_FAT_FATBUF_SIZE / mydata->sect_size;
+	blocks = min_t(__u32, blocks,
+		       roundup(mydata->fatlength, FATBUFBLOCKS_MIN));
+	blocks = max_t(__u32, rounddown(blocks, FATBUFBLOCKS_MIN),
+		       FATBUFBLOCKS_MIN);
+	mydata->fatbufblocks = blocks;
 	mydata->fatbuf = malloc_cache_aligned(FATBUFSIZE);
+	if (!mydata->fatbuf && blocks > FATBUFBLOCKS_MIN) {
+		mydata->fatbufblocks = FATBUFBLOCKS_MIN;
+		mydata->fatbuf = malloc_cache_aligned(FATBUFSIZE);
+	}
 	if (mydata->fatbuf == NULL) {
 		debug("Error: allocating memory\n");
 		return -1;
@@ -636,8 +695,8 @@ static int get_fs_info(fsdata *mydata)
 	       mydata->root_cluster,
 	       mydata->rootdir_sect,
 	       mydata->rootdir_sect * mydata->sect_size, mydata->data_begin);
-	debug("Sector size: %d, cluster size: %d\n", mydata->sect_size,
-	      mydata->clust_size);
+	debug("Sector size: %d, cluster size: %d, FAT cache: %d sectors\n",
+	      mydata->sect_size, mydata->clust_size, mydata->fatbufblocks);
 
 	return 0;
 }
@@ -6,7 +6,12 @@
 #include <config.h>
 #include <errno.h>
 #include <common.h>
+#include <console.h>
 #include <env.h>
+#include <gzip.h>
+#include <lmb.h>
+#include <malloc.h>
+#include <memalign.h>
 #include <mapmem.h>
 #include <part.h>
 #include <ext4fs.h>
@@ -15,9 +20,12 @@
 #include <sandboxfs.h>
 #include <ubifs_uboot.h>
 #include <btrfs.h>
+#include <erofs.h>
+#include <squashfs.h>
 #include <asm/io.h>
 #include <div64.h>
 #include <linux/math64.h>
+#include <linux/sizes.h>
 #include <efi_loader.h>
 
 DECLARE_GLOBAL_DATA_PTR;
@@ -273,6 +281,48 @@ static struct fstype_info fstypes[] = {
 		.mkdir = fs_mkdir_unsupported,
 		.ln = fs_ln_unsupported,
 	},
+#endif
+#ifdef CONFIG_FS_SQUASHFS
+	{
+		.fstype = FS_TYPE_SQUASHFS,
+		.name = "squashfs",
+		.null_dev_desc_ok = false,
+		.probe = sqfs_probe,
+		.close = sqfs_close,
+		.ls = fs_ls_generic,
+		.exists = sqfs_exists,
+		.size = sqfs_size,
+		.read = sqfs_read,
+		.write = fs_write_unsupported,
+		.uuid = fs_uuid_unsupported,
+		.opendir = sqfs_opendir,
+		.readdir = sqfs_readdir,
+		.closedir = sqfs_closedir,
+		.unlink = fs_unlink_unsupported,
+		.mkdir = fs_mkdir_unsupported,
+		.ln = fs_ln_unsupported,
+	},
+#endif
+#ifdef CONFIG_FS_EROFS
+	{
+		.fstype = FS_TYPE_EROFS,
+		.name = "erofs",
+		.null_dev_desc_ok = false,
+		.probe = erofs_probe,
+		.close = erofs_close,
+		.ls = fs_ls_generic,
+		.exists = erofs_exists,
+		.size = erofs_size,
+		.read = erofs_read,
+		.write = fs_write_unsupported,
+		.uuid = erofs_uuid,
+		.opendir = erofs_opendir,
+		.readdir = erofs_readdir,
+		.closedir = erofs_closedir,
+		.unlink = fs_unlink_unsupported,
+		.mkdir = fs_mkdir_unsupported,
+		.ln = fs_ln_unsupported,
+	},
 #endif
 	{
 		.fstype = FS_TYPE_ANY,
@@ -484,11 +534,13 @@ static int fs_read_lmb_check(const char *filename, ulong addr, loff_t offset,
 	lmb_init_and_reserve(&lmb, gd->bd, (void *)gd->fdt_blob);
 	lmb_dump_all(&lmb);
 
-	if (lmb_alloc_addr(&lmb, addr, read_len) == addr)
-		return 0;
+	if (lmb_alloc_addr(&lmb, addr, read_len) != addr) {
+		printf("** Reading file would overwrite reserved memory **\n");
+		ret = -ENOSPC;
+	}
+	lmb_uninit(&lmb);
 
-	printf("** Reading file would overwrite reserved memory **\n");
-	return -ENOSPC;
+	return ret;
 }
 #endif
 
@@ -529,6 +581,41 @@ int fs_read(const char *filename, ulong addr, loff_t offset, loff_t len,
 	return _fs_read(filename, addr, offset, len, 0, actread);
 }
 
+int fs_read_stream(const char *filename, void *buf, loff_t size,
+		   int (*fn)(void *priv, const void *buf, loff_t len),
+		   void *priv, loff_t *actread)
+{
+	struct fstype_info *info = fs_get_info(fs_type);
+	loff_t file_size, pos, len;
+	int ret;
+
+	*actread = 0;
+	ret = info->size(filename, &file_size);
+	for (pos = 0; !ret && pos < file_size; pos += len) {
+		ret = info->read(filename, buf, pos,
+				 min(size, file_size - pos), &len);
+		if (ret)
+			break;
+		if (!len) {
+			ret = -EIO;
+			break;
+		}
+		*actread += len;
+		ret = fn(priv, buf, len);
+		if (ret > 0) {
+			ret = 0;
+			break;
+		}
+		if (ctrlc()) {
+			ret = -EINTR;
+			break;
+		}
+	}
+	fs_close();
+
+	return ret;
+}
+
 int fs_write(const char *filename, ulong addr, loff_t offset, loff_t len,
 	     loff_t *actwrite)
 {
@@ -736,6 +823,129 @@ int do_load(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[],
 	return 0;
 }
 
+#ifdef CONFIG_CMD_LOADZ
+/* Size of each piece read from the file before it is decompressed */
+#define LOADZ_CHUNK_SIZE	SZ_256K
+
+#ifndef CONFIG_SYS_BOOTM_LEN
+/* use 8MByte as default max gunzip size, as bootm does */
+#define CONFIG_SYS_BOOTM_LEN	0x800000
+#endif
+
+static int loadz_feed(void *priv, const void *buf, loff_t len)
+{
+	return gunzip_stream_feed(priv, buf, len);
+}
+
+int do_loadz(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[],
+	     int fstype)
+{
+	struct gunzip_stream *gz;
+#ifdef CONFIG_LMB
+	struct lmb lmb;
+#endif
+	unsigned long addr, max_size, len;
+	const char *addr_str;
+	const char *filename;
+	loff_t len_read;
+	unsigned long time;
+	void *buf, *chunk;
+	char *ep;
+	int ret;
+
+	if (argc < 2 || argc > 6)
+		return CMD_RET_USAGE;
+
+	if (fs_set_blk_dev(argv[1], (argc >= 3) ? argv[2] : NULL, fstype))
+		return 1;
+
+	if (argc >= 4) {
+		addr = simple_strtoul(argv[3], &ep, 16);
+		if (ep == argv[3] || *ep != '\0')
+			return CMD_RET_USAGE;
+	} else {
+		addr_str = env_get("loadaddr");
+		if (addr_str != NULL)
+			addr = simple_strtoul(addr_str, NULL, 16);
+		else
+			addr = CONFIG_SYS_LOAD_ADDR;
+	}
+	if (argc >= 5) {
+		filename = argv[4];
+	} else {
+		filename = env_get("bootfile");
+		if (!filename) {
+			puts("** No boot file defined **\n");
+			return 1;
+		}
+	}
+
+	/* Don't let the output run over anything reserved */
+#ifdef CONFIG_LMB
+	lmb_init_and_reserve(&lmb, gd->bd, (void *)gd->fdt_blob);
+	max_size = lmb_get_free_size(&lmb, addr);
+	lmb_uninit(&lmb);
+	if (argc >= 6)
+		max_size = min(max_size, simple_strtoul(argv[5], NULL, 16));
+#else
+	if (argc >= 6)
+		max_size = simple_strtoul(argv[5], NULL, 16);
+	else
+		max_size = CONFIG_SYS_BOOTM_LEN;
+#endif
+	if (!max_size) {
+		printf("** Loading to 0x%lx would overwrite reserved memory **\n",
+		       addr);
+		return 1;
+	}
+
+	chunk = malloc_cache_aligned(LOADZ_CHUNK_SIZE);
+	buf = map_sysmem(addr, max_size);
+	gz = chunk ? gunzip_stream_start(buf, max_size) : NULL;
+	if (!gz) {
+		free(chunk);
+		unmap_sysmem(buf);
+		fs_close();
+		return CMD_RET_FAILURE;
+	}
+
+	/*
+	 * Each piece is decompressed straight after it is read, while it is
+	 * still in the cache, so the compressed file is never held in memory
+	 */
+	time = get_timer(0);
+	ret = fs_read_stream(filename, chunk, LOADZ_CHUNK_SIZE, loadz_feed, gz,
+			     &len_read);
+	if (!ret)
+		ret = gunzip_stream_finish(gz, &len);
+	else
+		gunzip_stream_finish(gz, &len);
+	time = get_timer(time);
+	unmap_sysmem(buf);
+	free(chunk);
+
+	if (ret == -ENOSPC)
+		printf("** Uncompressed data is larger than 0x%lx bytes **\n",
+		       max_size);
+	if (ret < 0)
+		return 1;
+
+	printf("%llu bytes read, %lu bytes uncompressed in %lu ms", len_read,
+	       len, time);
+	if (time > 0) {
+		puts(" (");
+		print_size(div_u64(len, time) * 1000, "/s");
+		puts(")");
+	}
+	puts("\n");
+
+	env_set_hex("fileaddr", addr);
+	env_set_hex("filesize", len);
+
+	return 0;
+}
+#endif
+
 int do_ls(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[],
 	int fstype)
 {
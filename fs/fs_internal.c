@@ -7,8 +7,64 @@
 
 #include <common.h>
 #include <compiler.h>
+#include <fs_internal.h>
+#include <malloc.h>
 #include <part.h>
 #include <memalign.h>
+#include <linux/sizes.h>
+
+/* Largest bounce buffer for reads into buffers not aligned for DMA */
+#define FS_BOUNCE_SIZE	SZ_64K
+
+static struct fs_devread_stats devread_stats;
+
+/*
+ * Read whole sectors into buf. DMA needs a cache-aligned buffer, so if buf
+ * is not aligned the sectors are read through an aligned bounce buffer, as
+ * many at a time as fit in it. sec_buf holds a single sector and is used if
+ * no larger buffer can be had.
+ */
+static int fs_read_sectors(struct blk_desc *blk, disk_partition_t *partition,
+			   lbaint_t sector, lbaint_t count, char *buf,
+			   char *sec_buf)
+{
+	int log2blksz = blk->log2blksz;
+	lbaint_t n, max = 1;
+	char *bounce = NULL;
+
+	if (IS_ALIGNED((ulong)buf, ARCH_DMA_MINALIGN)) {
+		if (blk_dread(blk, partition->start + sector, count, buf) !=
+		    count)
+			return 0;
+		devread_stats.direct += (u64)count << log2blksz;
+		return 1;
+	}
+
+	/* The simple malloc() never frees, so use it sparingly */
+	if (!CONFIG_IS_ENABLED(SYS_MALLOC_SIMPLE) && count > 1) {
+		max = min_t(lbaint_t, count, FS_BOUNCE_SIZE >> log2blksz);
+		bounce = malloc_cache_aligned(max << log2blksz);
+	}
+	if (!bounce)
+		max = 1;
+
+	while (count) {
+		n = min(count, max);
+		if (blk_dread(blk, partition->start + sector, n,
+			      bounce ? bounce : sec_buf) != n) {
+			free(bounce);
+			return 0;
+		}
+		memcpy(buf, bounce ? bounce : sec_buf, n << log2blksz);
+		devread_stats.copied += (u64)n << log2blksz;
+		buf += n << log2blksz;
+		sector += n;
+		count -= n;
+	}
+	free(bounce);
+
+	return 1;
+}
 
 int fs_devread(struct blk_desc *blk, disk_partition_t *partition,
 	       lbaint_t sector, int byte_offset, int byte_len, char *buf)
@@ -47,6 +103,7 @@ int fs_devread(struct blk_desc *blk, disk_partition_t *partition,
 		readlen = min((int)blk->blksz - byte_offset,
 			      byte_len);
 		memcpy(buf, sec_buf + byte_offset, readlen);
+		devread_stats.copied += readlen;
 		buf += readlen;
 		byte_len -= readlen;
 		sector++;
@@ -55,29 +112,18 @@ int fs_devread(struct blk_desc *blk, disk_partition_t *partition,
 	if (byte_len == 0)
 		return 1;
 
-	/* read sector aligned part */
+	/* read sector aligned part straight into the buffer if possible */
 	block_len = byte_len & ~(blk->blksz - 1);
-
-	if (block_len == 0) {
-		ALLOC_CACHE_ALIGN_BUFFER(u8, p, blk->blksz);
-
-		block_len = blk->blksz;
-		blk_dread(blk, partition->start + sector, 1,
-			  (void *)p);
-		memcpy(buf, p, byte_len);
-		return 1;
-	}
-
-	if (blk_dread(blk, partition->start + sector,
-		      block_len >> log2blksz, (void *)buf) !=
-			block_len >> log2blksz) {
-		printf(" ** %s read error - block\n", __func__);
-		return 0;
+	if (block_len) {
+		if (!fs_read_sectors(blk, partition, sector,
+				     block_len >> log2blksz, buf, sec_buf)) {
+			printf(" ** %s read error - block\n", __func__);
+			return 0;
+		}
+		buf += block_len;
+		byte_len -= block_len;
+		sector += block_len >> log2blksz;
 	}
-	block_len = byte_len & ~(blk->blksz - 1);
-	buf += block_len;
-	byte_len -= block_len;
-	sector += block_len / blk->blksz;
 
 	if (byte_len != 0) {
 		/* read rest of data which are not in whole sector */
@@ -87,6 +133,13 @@ int fs_devread(struct blk_desc *blk, disk_partition_t *partition,
 			return 0;
 		}
 		memcpy(buf, sec_buf, byte_len);
+		devread_stats.copied += byte_len;
 	}
 	return 1;
 }
+
+void fs_devread_stats(struct fs_devread_stats *stats)
+{
+	memcpy(stats, &devread_stats, sizeof(*stats));
+	memset(&devread_stats, 0, sizeof(devread_stats));
+}
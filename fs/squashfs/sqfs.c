@@ -0,0 +1,1080 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * SquashFS read-only filesystem
+ *
+ * Inodes, directories and the fragment table are kept in metadata blocks of
+ * up to 8 KiB, each compressed on its own. The last few metadata blocks used
+ * are kept decompressed, as are the last few fragment blocks, which hold the
+ * tails of small files.
+ *
+ * File data is stored in blocks of block_size bytes, one after the other.
+ * A run of compressed blocks is read from the device with one request and
+ * each block that is wanted whole is decompressed by a worker job straight
+ * into the destination, while the next run is read into a second buffer.
+ * Blocks that are only partly wanted are decompressed on the boot CPU into a
+ * bounce buffer, and uncompressed blocks are read directly.
+ */
+
+#include <common.h>
+#include <blk.h>
+#include <errno.h>
+#include <fs.h>
+#include <fs_internal.h>
+#include <malloc.h>
+#include <memalign.h>
+#include <squashfs.h>
+#include <worker.h>
+#include <asm/unaligned.h>
+#include <linux/kernel.h>
+#include <linux/sizes.h>
+
+#include "sqfs_decompressor.h"
+#include "sqfs_filesystem.h"
+
+#define SQFS_META_CACHE		8	/* Metadata blocks kept decompressed */
+#define SQFS_FRAG_CACHE		2	/* Fragment blocks kept decompressed */
+#define SQFS_RUN_SIZE		SZ_512K	/* Most data read in one request */
+#define SQFS_RUN_BLOCKS		64	/* Most blocks read in one request */
+#define SQFS_MAX_JOBS		8	/* Most blocks decompressed at once */
+#define SQFS_MAX_SYMLINKS	8	/* Most symlinks followed for a path */
+#define SQFS_MAX_DEPTH		64	/* Most directories in a path */
+#define SQFS_NAME_MAX		255
+
+struct sqfs_meta {
+	u64 pos;		/* Position on disk, 0 if unused */
+	u64 next;		/* Position of the following block */
+	u32 len;		/* Length of @data */
+	ulong used;		/* When last used, for LRU eviction */
+	u8 data[SQFS_METADATA_SIZE];
+};
+
+struct sqfs_frag {
+	u64 pos;		/* Position on disk, 0 if unused */
+	u32 len;		/* Length of @data */
+	ulong used;		/* When last used, for LRU eviction */
+	u8 *data;		/* block_size bytes, allocated on first use */
+};
+
+/* A position in the metadata: a block and an offset into its data */
+struct sqfs_cursor {
+	u64 block;
+	u32 offset;
+};
+
+/* A data block to decompress, with its own decompression context */
+struct sqfs_job {
+	struct worker_job wj;
+	struct sqfs_decomp dec;
+	bool busy;		/* Started and not yet waited for */
+	int buf;		/* Run buffer holding @src */
+	const void *src;
+	u32 srclen;
+	void *dst;
+	u32 dstlen;
+};
+
+/* A data block waiting in the current run */
+struct sqfs_pending {
+	u32 off;		/* Offset of the block in the run */
+	u32 len;		/* Length on disk */
+	u32 blen;		/* Length once decompressed */
+	u32 skip;		/* Bytes not wanted at the start */
+	u32 n;			/* Bytes wanted */
+	void *out;
+};
+
+/* Reading data blocks into a file buffer */
+struct sqfs_reader {
+	u64 start;		/* Position of the current run, 0 if none */
+	u32 len;		/* Length of the current run */
+	int count;		/* Blocks in the current run */
+	int buf;		/* Run buffer to read the current run into */
+	uint next_job;
+	int ret;		/* First error seen */
+	struct sqfs_pending pending[SQFS_RUN_BLOCKS];
+};
+
+struct sqfs_inode {
+	u16 type;
+	u64 size;
+	/* Regular files */
+	u64 start;
+	u32 frag;
+	u32 frag_off;
+	struct sqfs_cursor blocks;
+	/* Directories */
+	u32 dir_block;
+	u16 dir_offset;
+	/* Symlinks */
+	struct sqfs_cursor target;
+};
+
+struct sqfs_dir_iter {
+	struct sqfs_cursor cur;
+	u32 left;		/* Bytes left in the directory listing */
+	u32 count;		/* Entries left under the current header */
+	u32 start_block;	/* Inode block of the current header */
+	u64 ref;
+	char name[SQFS_NAME_MAX + 1];
+};
+
+/*
+ * Directory entries are all read when the directory is opened, since the
+ * filesystem is closed, and its caches emptied, between fs_readdir() calls.
+ * Each entry is the size (8 bytes), the FS_DT_... type (1 byte) and the
+ * name, terminated with a nul.
+ */
+struct sqfs_dir_stream {
+	struct fs_dir_stream fs_dirs;
+	struct fs_dirent dirent;
+	u8 *ents;
+	u32 len;
+	u32 pos;
+};
+
+struct sqfs_info {
+	struct blk_desc *desc;
+	disk_partition_t part;
+
+	u32 block_size;
+	u16 block_log;
+	u16 comp;
+	u32 fragments;
+	u64 bytes_used;
+	u64 root_inode;
+	u64 inode_table;
+	u64 dir_table;
+	u64 frag_table;
+
+	struct sqfs_decomp dec;		/* Used on the boot CPU */
+	struct sqfs_meta *meta;
+	struct sqfs_frag frag[SQFS_FRAG_CACHE];
+	u64 *frag_index;		/* Read on first use */
+	ulong stamp;
+	u8 *cbuf;			/* Compressed metadata or fragment */
+	u8 *block;			/* A decompressed data block */
+
+	/* Set up on the first file read */
+	u8 *run_buf[2];
+	u32 run_size;
+	struct sqfs_job *jobs;
+	int njobs;
+};
+
+static struct sqfs_info *sqfs;
+
+static int sqfs_disk_read(struct sqfs_info *sq, u64 pos, u32 len, void *buf)
+{
+	struct blk_desc *desc = sq->desc;
+
+	if (pos + len > sq->bytes_used)
+		return -EIO;
+	if (!fs_devread(desc, &sq->part, pos >> desc->log2blksz,
+			pos & (desc->blksz - 1), len, buf))
+		return -EIO;
+
+	return 0;
+}
+
+static struct sqfs_meta *sqfs_meta_get(struct sqfs_info *sq, u64 pos)
+{
+	struct sqfs_meta *m, *victim = NULL;
+	u32 hdr, len;
+	int i;
+
+	for (i = 0; i < SQFS_META_CACHE; i++) {
+		m = &sq->meta[i];
+		if (m->pos == pos) {
+			m->used = ++sq->stamp;
+			return m;
+		}
+		if (!victim || m->used < victim->used)
+			victim = m;
+	}
+
+	/* Read the header and the longest possible block in one go */
+	m = victim;
+	m->pos = 0;
+	if (pos + 2 > sq->bytes_used)
+		return NULL;
+	len = min_t(u64, 2 + SQFS_METADATA_SIZE, sq->bytes_used - pos);
+	if (sqfs_disk_read(sq, pos, len, sq->cbuf))
+		return NULL;
+	hdr = get_unaligned_le16(sq->cbuf);
+	len = SQFS_METADATA_LEN(hdr);
+	if (!len || len > SQFS_METADATA_SIZE || pos + 2 + len > sq->bytes_used)
+		return NULL;
+
+	if (hdr & SQFS_METADATA_UNCOMPRESSED) {
+		memcpy(m->data, sq->cbuf + 2, len);
+		m->len = len;
+	} else {
+		m->len = SQFS_METADATA_SIZE;
+		if (sqfs_decompress(&sq->dec, m->data, &m->len, sq->cbuf + 2,
+				    len))
+			return NULL;
+	}
+	m->pos = pos;
+	m->next = pos + 2 + len;
+	m->used = ++sq->stamp;
+
+	return m;
+}
+
+/* Copy @len bytes of metadata from @cur and move @cur past them */
+static int sqfs_meta_read(struct sqfs_info *sq, struct sqfs_cursor *cur,
+			  void *buf, u32 len)
+{
+	struct sqfs_meta *m;
+	u32 n;
+
+	while (len) {
+		m = sqfs_meta_get(sq, cur->block);
+		if (!m)
+			return -EIO;
+		if (cur->offset >= m->len) {
+			if (cur->offset > m->len)
+				return -EIO;
+			cur->block = m->next;
+			cur->offset = 0;
+			continue;
+		}
+		n = min(len, m->len - cur->offset);
+		memcpy(buf, m->data + cur->offset, n);
+		cur->offset += n;
+		buf += n;
+		len -= n;
+	}
+
+	return 0;
+}
+
+static int sqfs_read_inode(struct sqfs_info *sq, u64 ref,
+			   struct sqfs_inode *ino)
+{
+	union {
+		struct sqfs_base_inode base;
+		struct sqfs_dir_inode dir;
+		struct sqfs_ldir_inode ldir;
+		struct sqfs_reg_inode reg;
+		struct sqfs_lreg_inode lreg;
+		struct sqfs_symlink_inode symlink;
+	} i;
+	struct sqfs_cursor cur;
+	u32 len;
+	int ret;
+
+	cur.block = sq->inode_table + SQFS_INODE_BLOCK(ref);
+	cur.offset = SQFS_INODE_OFFSET(ref);
+	ret = sqfs_meta_read(sq, &cur, &i.base, sizeof(i.base));
+	if (ret)
+		return ret;
+
+	memset(ino, 0, sizeof(*ino));
+	ino->type = le16_to_cpu(i.base.inode_type);
+	switch (ino->type) {
+	case SQFS_DIR_TYPE:
+		len = sizeof(i.dir);
+		break;
+	case SQFS_LDIR_TYPE:
+		len = sizeof(i.ldir);
+		break;
+	case SQFS_REG_TYPE:
+		len = sizeof(i.reg);
+		break;
+	case SQFS_LREG_TYPE:
+		len = sizeof(i.lreg);
+		break;
+	case SQFS_SYMLINK_TYPE:
+	case SQFS_LSYMLINK_TYPE:
+		len = sizeof(i.symlink);
+		break;
+	case SQFS_BLKDEV_TYPE ... SQFS_SOCKET_TYPE:
+	case SQFS_LBLKDEV_TYPE ... SQFS_LSOCKET_TYPE:
+		return 0;
+	default:
+		return -EIO;
+	}
+	ret = sqfs_meta_read(sq, &cur, (u8 *)&i + sizeof(i.base),
+			     len - sizeof(i.base));
+	if (ret)
+		return ret;
+
+	switch (ino->type) {
+	case SQFS_DIR_TYPE:
+		ino->size = le16_to_cpu(i.dir.file_size);
+		ino->dir_block = le32_to_cpu(i.dir.start_block);
+		ino->dir_offset = le16_to_cpu(i.dir.offset);
+		break;
+	case SQFS_LDIR_TYPE:
+		ino->size = le32_to_cpu(i.ldir.file_size);
+		ino->dir_block = le32_to_cpu(i.ldir.start_block);
+		ino->dir_offset = le16_to_cpu(i.ldir.offset);
+		break;
+	case SQFS_REG_TYPE:
+		ino->size = le32_to_cpu(i.reg.file_size);
+		ino->start = le32_to_cpu(i.reg.start_block);
+		ino->frag = le32_to_cpu(i.reg.fragment);
+		ino->frag_off = le32_to_cpu(i.reg.offset);
+		ino->blocks = cur;
+		break;
+	case SQFS_LREG_TYPE:
+		ino->size = le64_to_cpu(i.lreg.file_size);
+		ino->start = le64_to_cpu(i.lreg.start_block);
+		ino->frag = le32_to_cpu(i.lreg.fragment);
+		ino->frag_off = le32_to_cpu(i.lreg.offset);
+		ino->blocks = cur;
+		break;
+	default:
+		ino->size = le32_to_cpu(i.symlink.symlink_size);
+		ino->target = cur;
+		break;
+	}
+
+	return 0;
+}
+
+static bool sqfs_is_dir(struct sqfs_inode *ino)
+{
+	return ino->type == SQFS_DIR_TYPE || ino->type == SQFS_LDIR_TYPE;
+}
+
+static bool sqfs_is_reg(struct sqfs_inode *ino)
+{
+	return ino->type == SQFS_REG_TYPE || ino->type == SQFS_LREG_TYPE;
+}
+
+static bool sqfs_is_symlink(struct sqfs_inode *ino)
+{
+	return ino->type == SQFS_SYMLINK_TYPE ||
+	       ino->type == SQFS_LSYMLINK_TYPE;
+}
+
+static void sqfs_dir_start(struct sqfs_info *sq, struct sqfs_inode *dir,
+			   struct sqfs_dir_iter *it)
+{
+	it->cur.block = sq->dir_table + dir->dir_block;
+	it->cur.offset = dir->dir_offset;
+	/* The size includes 3 bytes for the "." and ".." entries */
+	it->left = dir->size > 3 ? dir->size - 3 : 0;
+	it->count = 0;
+}
+
+/* Return 1 with the next entry in @it, 0 at the end or -ve on error */
+static int sqfs_dir_next(struct sqfs_info *sq, struct sqfs_dir_iter *it)
+{
+	struct sqfs_dir_header hdr;
+	struct sqfs_dir_entry ent;
+	u32 len;
+	int ret;
+
+	if (!it->count) {
+		if (it->left < sizeof(hdr))
+			return 0;
+		ret = sqfs_meta_read(sq, &it->cur, &hdr, sizeof(hdr));
+		if (ret)
+			return ret;
+		it->left -= sizeof(hdr);
+		it->count = le32_to_cpu(hdr.count) + 1;
+		it->start_block = le32_to_cpu(hdr.start_block);
+	}
+
+	if (it->left < sizeof(ent))
+		return -EIO;
+	ret = sqfs_meta_read(sq, &it->cur, &ent, sizeof(ent));
+	if (ret)
+		return ret;
+	it->left -= sizeof(ent);
+	len = le16_to_cpu(ent.size) + 1;
+	if (len > it->left || len > SQFS_NAME_MAX)
+		return -EIO;
+	ret = sqfs_meta_read(sq, &it->cur, it->name, len);
+	if (ret)
+		return ret;
+	it->left -= len;
+	it->name[len] = '\0';
+	it->ref = ((u64)it->start_block << 16) | le16_to_cpu(ent.offset);
+	it->count--;
+
+	return 1;
+}
+
+static int sqfs_dir_find(struct sqfs_info *sq, u64 dir_ref, const char *name,
+			 int len, u64 *refp)
+{
+	struct sqfs_dir_iter it;
+	struct sqfs_inode dir;
+	int ret;
+
+	ret = sqfs_read_inode(sq, dir_ref, &dir);
+	if (ret)
+		return ret;
+	if (!sqfs_is_dir(&dir))
+		return -ENOTDIR;
+
+	sqfs_dir_start(sq, &dir, &it);
+	while ((ret = sqfs_dir_next(sq, &it)) > 0) {
+		if (!strncmp(it.name, name, len) && !it.name[len]) {
+			*refp = it.ref;
+			return 0;
+		}
+	}
+
+	return ret ? ret : -ENOENT;
+}
+
+/*
+ * Follow @path from the directory on top of @stack, pushing each directory
+ * and the final inode onto it. ".." pops a directory, which is why the
+ * whole stack is kept.
+ */
+static int sqfs_walk(struct sqfs_info *sq, u64 *stack, int *depth,
+		     const char *path, int *links, bool follow)
+{
+	struct sqfs_inode ino;
+	const char *name;
+	char *target;
+	u64 ref;
+	int len, ret;
+
+	while (*path) {
+		while (*path == '/')
+			path++;
+		name = path;
+		while (*path && *path != '/')
+			path++;
+		len = path - name;
+		if (!len || (len == 1 && name[0] == '.'))
+			continue;
+		if (len == 2 && name[0] == '.' && name[1] == '.') {
+			if (*depth > 1)
+				(*depth)--;
+			continue;
+		}
+
+		ret = sqfs_dir_find(sq, stack[*depth - 1], name, len, &ref);
+		if (ret)
+			return ret;
+		ret = sqfs_read_inode(sq, ref, &ino);
+		if (ret)
+			return ret;
+
+		while (*path == '/')
+			path++;
+		if (sqfs_is_symlink(&ino) && (*path || follow)) {
+			if (++*links > SQFS_MAX_SYMLINKS)
+				return -ELOOP;
+			target = malloc(ino.size + 1);
+			if (!target)
+				return -ENOMEM;
+			ret = sqfs_meta_read(sq, &ino.target, target, ino.size);
+			target[ino.size] = '\0';
+			if (!ret) {
+				if (target[0] == '/')
+					*depth = 1;
+				ret = sqfs_walk(sq, stack, depth, target, links,
+						true);
+			}
+			free(target);
+			if (ret)
+				return ret;
+			continue;
+		}
+
+		if (*depth == SQFS_MAX_DEPTH)
+			return -ENAMETOOLONG;
+		stack[(*depth)++] = ref;
+	}
+
+	return 0;
+}
+
+static int sqfs_lookup(struct sqfs_info *sq, const char *path, bool follow,
+		       struct sqfs_inode *ino)
+{
+	u64 stack[SQFS_MAX_DEPTH];
+	int depth = 1, links = 0;
+	int ret;
+
+	stack[0] = sq->root_inode;
+	ret = sqfs_walk(sq, stack, &depth, path, &links, follow);
+	if (ret)
+		return ret;
+
+	return sqfs_read_inode(sq, stack[depth - 1], ino);
+}
+
+/* Get fragment block @idx, decompressed */
+static int sqfs_frag_get(struct sqfs_info *sq, u32 idx, struct sqfs_frag **fp)
+{
+	struct sqfs_fragment_entry ent;
+	struct sqfs_frag *f, *victim = NULL;
+	struct sqfs_cursor cur;
+	u32 size, len;
+	u64 pos;
+	int i, ret;
+
+	if (idx >= sq->fragments)
+		return -EIO;
+	if (!sq->frag_index) {
+		len = DIV_ROUND_UP(sq->fragments, SQFS_FRAGMENTS_PER_BLOCK);
+		sq->frag_index = malloc(len * sizeof(u64));
+		if (!sq->frag_index)
+			return -ENOMEM;
+		ret = sqfs_disk_read(sq, sq->frag_table, len * sizeof(u64),
+				     sq->frag_index);
+		if (ret) {
+			free(sq->frag_index);
+			sq->frag_index = NULL;
+			return ret;
+		}
+		for (i = 0; i < len; i++)
+			sq->frag_index[i] = le64_to_cpu(sq->frag_index[i]);
+	}
+
+	cur.block = sq->frag_index[idx / SQFS_FRAGMENTS_PER_BLOCK];
+	cur.offset = idx % SQFS_FRAGMENTS_PER_BLOCK * sizeof(ent);
+	ret = sqfs_meta_read(sq, &cur, &ent, sizeof(ent));
+	if (ret)
+		return ret;
+	pos = le64_to_cpu(ent.start_block);
+	size = le32_to_cpu(ent.size);
+
+	for (i = 0; i < SQFS_FRAG_CACHE; i++) {
+		f = &sq->frag[i];
+		if (f->pos == pos) {
+			f->used = ++sq->stamp;
+			*fp = f;
+			return 0;
+		}
+		if (!victim || f->used < victim->used)
+			victim = f;
+	}
+
+	f = victim;
+	f->pos = 0;
+	if (!f->data) {
+		f->data = malloc_cache_aligned(sq->block_size);
+		if (!f->data)
+			return -ENOMEM;
+	}
+	len = SQFS_BLOCK_LEN(size);
+	if (!len || len > sq->block_size)
+		return -EIO;
+	if (size & SQFS_BLOCK_UNCOMPRESSED) {
+		ret = sqfs_disk_read(sq, pos, len, f->data);
+		f->len = len;
+	} else {
+		ret = sqfs_disk_read(sq, pos, len, sq->cbuf);
+		f->len = sq->block_size;
+		if (!ret)
+			ret = sqfs_decompress(&sq->dec, f->data, &f->len,
+					      sq->cbuf, len);
+	}
+	if (ret)
+		return ret;
+	f->pos = pos;
+	f->used = ++sq->stamp;
+	*fp = f;
+
+	return 0;
+}
+
+static int sqfs_job_run(void *arg)
+{
+	struct sqfs_job *job = arg;
+	u32 len = job->dstlen;
+	int ret;
+
+	ret = sqfs_decompress(&job->dec, job->dst, &len, job->src,
+			      job->srclen);
+	if (!ret && len != job->dstlen)
+		ret = -EIO;
+
+	return ret;
+}
+
+static void sqfs_job_wait(struct sqfs_reader *rd, struct sqfs_job *job)
+{
+	int ret;
+
+	if (!job->busy)
+		return;
+	ret = worker_wait(&job->wj);
+	if (ret && !rd->ret)
+		rd->ret = ret;
+	job->busy = false;
+}
+
+/* Set up the buffers and jobs for reading file data */
+static int sqfs_reader_init(struct sqfs_info *sq)
+{
+	int i, njobs, ret;
+
+	if (sq->jobs)
+		return 0;
+
+	/* Room for a sector before the run, to read it from a sector start */
+	sq->run_size = max_t(u32, SQFS_RUN_SIZE, sq->block_size);
+	for (i = 0; i < 2; i++) {
+		if (!sq->run_buf[i])
+			sq->run_buf[i] = malloc_cache_aligned(sq->run_size +
+							      sq->desc->blksz);
+		if (!sq->run_buf[i])
+			return -ENOMEM;
+	}
+
+	/* Jobs the workers cannot take run on this CPU, so allow one more */
+	njobs = 1;
+	if (sqfs_decomp_parallel(sq->comp)) {
+		ret = worker_init();
+		if (ret > 0)
+			njobs = min(ret + 1, SQFS_MAX_JOBS);
+	}
+	sq->jobs = calloc(njobs, sizeof(*sq->jobs));
+	if (!sq->jobs)
+		return -ENOMEM;
+	for (i = 0; i < njobs; i++) {
+		ret = sqfs_decomp_init(&sq->jobs[i].dec, sq->comp);
+		if (ret)
+			break;
+	}
+	sq->njobs = i;
+	if (!sq->njobs)
+		return ret;
+
+	return 0;
+}
+
+/* Read the current run and decompress its blocks */
+static void sqfs_reader_flush(struct sqfs_info *sq, struct sqfs_reader *rd)
+{
+	struct sqfs_pending *p;
+	struct sqfs_job *job;
+	u64 start;
+	u8 *buf;
+	u32 len;
+	int i, ret;
+
+	if (!rd->count)
+		return;
+
+	/* Jobs for the run before last may still be using this buffer */
+	for (i = 0; i < sq->njobs; i++) {
+		if (sq->jobs[i].buf == rd->buf)
+			sqfs_job_wait(rd, &sq->jobs[i]);
+	}
+
+	/* Start at a sector boundary so that whole sectors are read directly */
+	start = rd->start & ~(u64)(sq->desc->blksz - 1);
+	buf = sq->run_buf[rd->buf];
+	ret = sqfs_disk_read(sq, start, rd->start - start + rd->len, buf);
+	if (ret) {
+		rd->ret = ret;
+		goto out;
+	}
+	buf += rd->start - start;
+
+	for (i = 0; i < rd->count && !rd->ret; i++) {
+		p = &rd->pending[i];
+		if (p->skip || p->n != p->blen) {
+			len = sq->block_size;
+			ret = sqfs_decompress(&sq->dec, sq->block, &len,
+					      buf + p->off, p->len);
+			if (!ret && len != p->blen)
+				ret = -EIO;
+			if (ret)
+				rd->ret = ret;
+			else
+				memcpy(p->out, sq->block + p->skip, p->n);
+			continue;
+		}
+
+		job = &sq->jobs[rd->next_job++ % sq->njobs];
+		sqfs_job_wait(rd, job);
+		job->buf = rd->buf;
+		job->src = buf + p->off;
+		job->srclen = p->len;
+		job->dst = p->out;
+		job->dstlen = p->blen;
+		job->busy = true;
+		if (sqfs_decomp_parallel(sq->comp)) {
+			worker_submit(&job->wj, sqfs_job_run, job);
+		} else {
+			job->wj.ret = sqfs_job_run(job);
+			job->wj.done = 1;
+		}
+	}
+
+out:
+	rd->buf ^= 1;
+	rd->start = 0;
+	rd->len = 0;
+	rd->count = 0;
+}
+
+static int sqfs_read_data(struct sqfs_info *sq, struct sqfs_inode *ino,
+			  u8 *buf, u64 offset, u64 len)
+{
+	struct sqfs_reader *rd;
+	struct sqfs_pending *p;
+	struct sqfs_frag *frag;
+	u64 end = offset + len;
+	u64 pos, boff, tail;
+	u32 *sizes = NULL;
+	u8 *out;
+	u32 nblocks, first, last, i;
+	u32 size, clen, blen, skip, n;
+	int ret;
+
+	nblocks = ino->size >> sq->block_log;
+	if (ino->frag == SQFS_FRAGMENT_NONE &&
+	    ino->size & (sq->block_size - 1))
+		nblocks++;
+	tail = (u64)nblocks << sq->block_log;
+
+	first = offset >> sq->block_log;
+	last = min_t(u64, (end + sq->block_size - 1) >> sq->block_log, nblocks);
+	if (first < last) {
+		ret = sqfs_reader_init(sq);
+		if (ret)
+			return ret;
+		rd = calloc(1, sizeof(*rd));
+		sizes = malloc(last * sizeof(u32));
+		if (!rd || !sizes) {
+			free(rd);
+			free(sizes);
+			return -ENOMEM;
+		}
+		ret = sqfs_meta_read(sq, &ino->blocks, sizes,
+				     last * sizeof(u32));
+		if (ret)
+			goto out;
+
+		pos = ino->start;
+		for (i = 0; i < first; i++)
+			pos += SQFS_BLOCK_LEN(le32_to_cpu(sizes[i]));
+
+		for (i = first; i < last && !rd->ret; i++) {
+			size = le32_to_cpu(sizes[i]);
+			clen = SQFS_BLOCK_LEN(size);
+			boff = (u64)i << sq->block_log;
+			blen = min_t(u64, sq->block_size, ino->size - boff);
+			skip = offset > boff ? offset - boff : 0;
+			n = min_t(u64, blen, end - boff) - skip;
+			out = buf + boff + skip - offset;
+
+			if (!clen) {
+				/* Sparse block */
+				memset(out, 0, n);
+			} else if (size & SQFS_BLOCK_UNCOMPRESSED) {
+				ret = sqfs_disk_read(sq, pos + skip, n, out);
+				if (ret)
+					rd->ret = ret;
+			} else {
+				if (clen > sq->block_size) {
+					rd->ret = -EIO;
+					break;
+				}
+				if (rd->count &&
+				    (pos != rd->start + rd->len ||
+				     rd->len + clen > sq->run_size ||
+				     rd->count == SQFS_RUN_BLOCKS))
+					sqfs_reader_flush(sq, rd);
+				if (!rd->count)
+					rd->start = pos;
+				p = &rd->pending[rd->count++];
+				p->off = pos - rd->start;
+				p->len = clen;
+				p->blen = blen;
+				p->skip = skip;
+				p->n = n;
+				p->out = out;
+				rd->len += clen;
+			}
+			pos += clen;
+		}
+		sqfs_reader_flush(sq, rd);
+		for (i = 0; i < sq->njobs; i++)
+			sqfs_job_wait(rd, &sq->jobs[i]);
+		ret = rd->ret;
+out:
+		free(sizes);
+		free(rd);
+		if (ret)
+			return ret;
+	}
+
+	/* The tail of the file is in a fragment block */
+	if (end > tail) {
+		ret = sqfs_frag_get(sq, ino->frag, &frag);
+		if (ret)
+			return ret;
+		skip = offset > tail ? offset - tail : 0;
+		n = end - tail - skip;
+		if ((u64)ino->frag_off + skip + n > frag->len)
+			return -EIO;
+		memcpy(buf + tail + skip - offset,
+		       frag->data + ino->frag_off + skip, n);
+	}
+
+	return 0;
+}
+
+int sqfs_probe(struct blk_desc *fs_dev_desc, disk_partition_t *fs_partition)
+{
+	struct sqfs_super_block *sb;
+	struct sqfs_info *sq;
+	int ret;
+
+	sqfs_close();
+
+	sq = calloc(1, sizeof(*sq));
+	if (!sq)
+		return -ENOMEM;
+	sq->desc = fs_dev_desc;
+	sq->part = *fs_partition;
+	sq->bytes_used = sizeof(*sb);
+
+	sb = malloc_cache_aligned(fs_dev_desc->blksz);
+	if (!sb) {
+		ret = -ENOMEM;
+		goto err;
+	}
+	ret = sqfs_disk_read(sq, 0, sizeof(*sb), sb);
+	if (ret)
+		goto err;
+	if (le32_to_cpu(sb->s_magic) != SQFS_MAGIC) {
+		ret = -EINVAL;
+		goto err;
+	}
+
+	sq->block_size = le32_to_cpu(sb->block_size);
+	sq->block_log = le16_to_cpu(sb->block_log);
+	sq->comp = le16_to_cpu(sb->compression);
+	sq->fragments = le32_to_cpu(sb->fragments);
+	sq->bytes_used = le64_to_cpu(sb->bytes_used);
+	sq->root_inode = le64_to_cpu(sb->root_inode);
+	sq->inode_table = le64_to_cpu(sb->inode_table_start);
+	sq->dir_table = le64_to_cpu(sb->directory_table_start);
+	sq->frag_table = le64_to_cpu(sb->fragment_table_start);
+
+	if (le16_to_cpu(sb->s_major) != SQFS_MAJOR ||
+	    sq->block_log < 12 || sq->block_size > SQFS_MAX_BLOCK_SIZE ||
+	    sq->block_size != 1 << sq->block_log) {
+		printf("** Unsupported squashfs version or block size **\n");
+		ret = -EINVAL;
+		goto err;
+	}
+
+	ret = sqfs_decomp_init(&sq->dec, sq->comp);
+	if (ret) {
+		printf("** squashfs: %s compression is not supported **\n",
+		       sqfs_decomp_name(sq->comp));
+		goto err;
+	}
+
+	sq->meta = calloc(SQFS_META_CACHE, sizeof(*sq->meta));
+	sq->cbuf = malloc_cache_aligned(max_t(u32, sq->block_size,
+					      2 + SQFS_METADATA_SIZE));
+	sq->block = malloc_cache_aligned(sq->block_size);
+	if (!sq->meta || !sq->cbuf || !sq->block) {
+		ret = -ENOMEM;
+		goto err;
+	}
+
+	free(sb);
+	sqfs = sq;
+
+	return 0;
+
+err:
+	free(sb);
+	sqfs = sq;
+	sqfs_close();
+
+	return ret;
+}
+
+void sqfs_close(void)
+{
+	struct sqfs_info *sq = sqfs;
+	int i;
+
+	if (!sq)
+		return;
+
+	for (i = 0; i < sq->njobs; i++)
+		sqfs_decomp_free(&sq->jobs[i].dec);
+	free(sq->jobs);
+	free(sq->run_buf[0]);
+	free(sq->run_buf[1]);
+	for (i = 0; i < SQFS_FRAG_CACHE; i++)
+		free(sq->frag[i].data);
+	free(sq->frag_index);
+	free(sq->block);
+	free(sq->cbuf);
+	free(sq->meta);
+	sqfs_decomp_free(&sq->dec);
+	free(sq);
+	sqfs = NULL;
+}
+
+static int sqfs_dirent_type(struct sqfs_inode *ino)
+{
+	if (sqfs_is_dir(ino))
+		return FS_DT_DIR;
+	if (sqfs_is_symlink(ino))
+		return FS_DT_LNK;
+
+	return FS_DT_REG;
+}
+
+int sqfs_opendir(const char *filename, struct fs_dir_stream **dirsp)
+{
+	struct sqfs_info *sq = sqfs;
+	struct sqfs_dir_stream *dirs;
+	struct sqfs_inode dir, ino;
+	struct sqfs_dir_iter it;
+	u32 size = 0, len;
+	u64 fsize;
+	u8 *ents;
+	int ret;
+
+	if (!sq)
+		return -ENODEV;
+	ret = sqfs_lookup(sq, filename, true, &dir);
+	if (ret)
+		return ret;
+	if (!sqfs_is_dir(&dir))
+		return -ENOTDIR;
+
+	dirs = calloc(1, sizeof(*dirs));
+	if (!dirs)
+		return -ENOMEM;
+
+	sqfs_dir_start(sq, &dir, &it);
+	while ((ret = sqfs_dir_next(sq, &it)) > 0) {
+		ret = sqfs_read_inode(sq, it.ref, &ino);
+		if (ret)
+			break;
+
+		len = sizeof(u64) + 1 + strlen(it.name) + 1;
+		if (dirs->len + len > size) {
+			size = max(size * 2, dirs->len + len + 256);
+			ents = realloc(dirs->ents, size);
+			if (!ents) {
+				ret = -ENOMEM;
+				break;
+			}
+			dirs->ents = ents;
+		}
+		ents = dirs->ents + dirs->len;
+		fsize = sqfs_is_dir(&ino) ? 0 : ino.size;
+		put_unaligned(fsize, (u64 *)ents);
+		ents[sizeof(u64)] = sqfs_dirent_type(&ino);
+		strcpy((char *)ents + sizeof(u64) + 1, it.name);
+		dirs->len += len;
+	}
+	if (ret) {
+		free(dirs->ents);
+		free(dirs);
+		return ret;
+	}
+
+	*dirsp = &dirs->fs_dirs;
+
+	return 0;
+}
+
+int sqfs_readdir(struct fs_dir_stream *fs_dirs, struct fs_dirent **dentp)
+{
+	struct sqfs_dir_stream *dirs;
+	struct fs_dirent *dent;
+	u8 *ent;
+
+	dirs = container_of(fs_dirs, struct sqfs_dir_stream, fs_dirs);
+	if (dirs->pos >= dirs->len)
+		return -ENOENT;
+
+	ent = dirs->ents + dirs->pos;
+	dent = &dirs->dirent;
+	memset(dent, 0, sizeof(*dent));
+	dent->size = get_unaligned((u64 *)ent);
+	dent->type = ent[sizeof(u64)];
+	strlcpy(dent->name, (char *)ent + sizeof(u64) + 1, sizeof(dent->name));
+	dirs->pos += sizeof(u64) + 1 + strlen(dent->name) + 1;
+	*dentp = dent;
+
+	return 0;
+}
+
+void sqfs_closedir(struct fs_dir_stream *fs_dirs)
+{
+	struct sqfs_dir_stream *dirs;
+
+	dirs = container_of(fs_dirs, struct sqfs_dir_stream, fs_dirs);
+	free(dirs->ents);
+	free(dirs);
+}
+
+int sqfs_exists(const char *filename)
+{
+	struct sqfs_inode ino;
+
+	if (!sqfs)
+		return 0;
+
+	return !sqfs_lookup(sqfs, filename, true, &ino);
+}
+
+int sqfs_size(const char *filename, loff_t *size)
+{
+	struct sqfs_inode ino;
+	int ret;
+
+	if (!sqfs)
+		return -ENODEV;
+	ret = sqfs_lookup(sqfs, filename, true, &ino);
+	if (ret)
+		return ret;
+	if (!sqfs_is_reg(&ino))
+		return -EISDIR;
+	*size = ino.size;
+
+	return 0;
+}
+
+int sqfs_read(const char *filename, void *buf, loff_t offset, loff_t len,
+	      loff_t *actread)
+{
+	struct sqfs_inode ino;
+	int ret;
+
+	*actread = 0;
+	if (!sqfs)
+		return -ENODEV;
+	ret = sqfs_lookup(sqfs, filename, true, &ino);
+	if (ret) {
+		printf("** File not found %s **\n", filename);
+		return ret;
+	}
+	if (!sqfs_is_reg(&ino)) {
+		printf("** %s is not a regular file **\n", filename);
+		return -EISDIR;
+	}
+
+	if (offset >= ino.size)
+		return offset == ino.size ? 0 : -EINVAL;
+	if (!len || len > ino.size - offset)
+		len = ino.size - offset;
+
+	ret = sqfs_read_data(sqfs, &ino, buf, offset, len);
+	if (ret) {
+		printf("** Error reading %s: %d **\n", filename, ret);
+		return ret;
+	}
+	*actread = len;
+
+	return 0;
+}
@@ -0,0 +1,175 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * SquashFS block decompression
+ *
+ * Each block is compressed on its own, so any block can be decompressed
+ * without the ones before it.
+ */
+
+#include <common.h>
+#include <errno.h>
+#include <lz4.h>
+#include <malloc.h>
+#include <lzma/LzmaTypes.h>
+#include <lzma/LzmaTools.h>
+#include <linux/lzo.h>
+#include <linux/zstd.h>
+#include <u-boot/zlib.h>
+
+#include "sqfs_decompressor.h"
+#include "sqfs_filesystem.h"
+
+const char *sqfs_decomp_name(u16 comp)
+{
+	switch (comp) {
+	case SQFS_COMP_ZLIB:
+		return "zlib";
+	case SQFS_COMP_LZMA:
+		return "lzma";
+	case SQFS_COMP_LZO:
+		return "lzo";
+	case SQFS_COMP_XZ:
+		return "xz";
+	case SQFS_COMP_LZ4:
+		return "lz4";
+	case SQFS_COMP_ZSTD:
+		return "zstd";
+	default:
+		return "unknown";
+	}
+}
+
+bool sqfs_decomp_parallel(u16 comp)
+{
+	return comp == SQFS_COMP_LZO || comp == SQFS_COMP_LZ4 ||
+	       comp == SQFS_COMP_ZSTD;
+}
+
+int sqfs_decomp_init(struct sqfs_decomp *d, u16 comp)
+{
+	memset(d, 0, sizeof(*d));
+	d->comp = comp;
+
+	switch (comp) {
+	case SQFS_COMP_ZLIB:
+		if (!CONFIG_IS_ENABLED(ZLIB))
+			return -EPROTONOSUPPORT;
+		return 0;
+	case SQFS_COMP_LZMA:
+		if (!IS_ENABLED(CONFIG_LZMA))
+			return -EPROTONOSUPPORT;
+		return 0;
+	case SQFS_COMP_LZO:
+		if (!CONFIG_IS_ENABLED(LZO))
+			return -EPROTONOSUPPORT;
+		return 0;
+	case SQFS_COMP_LZ4:
+		if (!CONFIG_IS_ENABLED(LZ4))
+			return -EPROTONOSUPPORT;
+		return 0;
+#if CONFIG_IS_ENABLED(ZSTD)
+	case SQFS_COMP_ZSTD: {
+		size_t wsize = ZSTD_DCtxWorkspaceBound();
+
+		d->workspace = malloc(wsize);
+		if (!d->workspace)
+			return -ENOMEM;
+		d->zstd = ZSTD_initDCtx(d->workspace, wsize);
+		if (!d->zstd) {
+			free(d->workspace);
+			d->workspace = NULL;
+			return -EINVAL;
+		}
+		return 0;
+	}
+#endif
+	default:
+		return -EPROTONOSUPPORT;
+	}
+}
+
+void sqfs_decomp_free(struct sqfs_decomp *d)
+{
+	free(d->workspace);
+	d->workspace = NULL;
+	d->zstd = NULL;
+}
+
+#if CONFIG_IS_ENABLED(ZLIB)
+static int sqfs_zlib(void *dst, u32 *dstlen, const void *src, u32 srclen)
+{
+	z_stream stream;
+	int ret;
+
+	memset(&stream, 0, sizeof(stream));
+	stream.next_in = (u8 *)src;
+	stream.avail_in = srclen;
+	stream.next_out = dst;
+	stream.avail_out = *dstlen;
+
+	if (inflateInit(&stream) != Z_OK)
+		return -EIO;
+	ret = inflate(&stream, Z_FINISH);
+	inflateEnd(&stream);
+	if (ret != Z_STREAM_END)
+		return -EIO;
+	*dstlen = stream.total_out;
+
+	return 0;
+}
+#endif
+
+int sqfs_decompress(struct sqfs_decomp *d, void *dst, u32 *dstlen,
+		    const void *src, u32 srclen)
+{
+	switch (d->comp) {
+#if CONFIG_IS_ENABLED(ZLIB)
+	case SQFS_COMP_ZLIB:
+		return sqfs_zlib(dst, dstlen, src, srclen);
+#endif
+#ifdef CONFIG_LZMA
+	case SQFS_COMP_LZMA: {
+		SizeT len = *dstlen;
+
+		/* Blocks have the 13-byte header of the lzma-alone format */
+		if (lzmaBuffToBuffDecompress(dst, &len, (u8 *)src, srclen))
+			return -EIO;
+		*dstlen = len;
+		return 0;
+	}
+#endif
+#if CONFIG_IS_ENABLED(LZO)
+	case SQFS_COMP_LZO: {
+		size_t len = *dstlen;
+
+		if (lzo1x_decompress_safe(src, srclen, dst, &len) != LZO_E_OK)
+			return -EIO;
+		*dstlen = len;
+		return 0;
+	}
+#endif
+#if CONFIG_IS_ENABLED(LZ4)
+	case SQFS_COMP_LZ4: {
+		size_t len = *dstlen;
+
+		if (ulz4_block(src, srclen, dst, &len))
+			return -EIO;
+		*dstlen = len;
+		return 0;
+	}
+#endif
+#if CONFIG_IS_ENABLED(ZSTD)
+	case SQFS_COMP_ZSTD: {
+		size_t len;
+
+		len = ZSTD_decompressDCtx(d->zstd, dst, *dstlen, src, srclen);
+		if (ZSTD_isError(len))
+			return -EIO;
+		*dstlen = len;
+		return 0;
+	}
+#endif
+	default:
+		return -EPROTONOSUPPORT;
+	}
+}
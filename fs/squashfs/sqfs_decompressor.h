@@ -0,0 +1,76 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * SquashFS block decompression
+ */
+
+#ifndef __SQFS_DECOMPRESSOR_H
+#define __SQFS_DECOMPRESSOR_H
+
+#include <linux/types.h>
+
+/**
+ * struct sqfs_decomp - state needed to decompress one block at a time
+ *
+ * Several blocks can be decompressed at once, on different CPUs, as long as
+ * each uses its own struct sqfs_decomp.
+ *
+ * @comp: compression id from the superblock (enum sqfs_compression)
+ * @workspace: memory used by the decompressor, or NULL if it needs none
+ * @zstd: zstd decompression context in @workspace
+ */
+struct sqfs_decomp {
+	u16 comp;
+	void *workspace;
+	void *zstd;
+};
+
+/**
+ * sqfs_decomp_name() - get the name of a compression id
+ *
+ * @comp: compression id from the superblock
+ * @return name of the compressor, or "unknown"
+ */
+const char *sqfs_decomp_name(u16 comp);
+
+/**
+ * sqfs_decomp_parallel() - check whether blocks can be decompressed on workers
+ *
+ * Some decompressors allocate memory or reset the watchdog as they go, so
+ * must only run on the boot CPU.
+ *
+ * @comp: compression id from the superblock
+ * @return true if the decompressor is safe to run in a worker job
+ */
+bool sqfs_decomp_parallel(u16 comp);
+
+/**
+ * sqfs_decomp_init() - set up a decompression context
+ *
+ * @d: context to set up
+ * @comp: compression id from the superblock
+ * @return 0 if OK, -EPROTONOSUPPORT if @comp is not supported by this build,
+ *	-ENOMEM if out of memory
+ */
+int sqfs_decomp_init(struct sqfs_decomp *d, u16 comp);
+
+/**
+ * sqfs_decomp_free() - free a decompression context
+ *
+ * @d: context set up by sqfs_decomp_init()
+ */
+void sqfs_decomp_free(struct sqfs_decomp *d);
+
+/**
+ * sqfs_decompress() - decompress one metadata or data block
+ *
+ * @d: decompression context
+ * @dst: buffer for the decompressed data
+ * @dstlen: size of @dst; returns the number of bytes decompressed
+ * @src: compressed block
+ * @srclen: size of @src
+ * @return 0 if OK, -EIO if the block is corrupt or does not fit in @dst
+ */
+int sqfs_decompress(struct sqfs_decomp *d, void *dst, u32 *dstlen,
+		    const void *src, u32 srclen);
+
+#endif /* __SQFS_DECOMPRESSOR_H */
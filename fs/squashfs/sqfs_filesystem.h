@@ -0,0 +1,168 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * SquashFS on-disk format, as written by mksquashfs 4.x
+ *
+ * All values are little-endian. Positions are byte offsets from the start
+ * of the filesystem.
+ */
+
+#ifndef __SQFS_FILESYSTEM_H
+#define __SQFS_FILESYSTEM_H
+
+#include <linux/types.h>
+
+#define SQFS_MAGIC			0x73717368
+#define SQFS_MAJOR			4
+
+/* Largest size of a metadata block once decompressed */
+#define SQFS_METADATA_SIZE		8192
+/* Metadata block header: bit set if the block is stored uncompressed */
+#define SQFS_METADATA_UNCOMPRESSED	0x8000
+#define SQFS_METADATA_LEN(h)		((h) & 0x7fff)
+
+/* Data block and fragment sizes: bit set if stored uncompressed */
+#define SQFS_BLOCK_UNCOMPRESSED		(1 << 24)
+#define SQFS_BLOCK_LEN(s)		((s) & ~SQFS_BLOCK_UNCOMPRESSED)
+#define SQFS_MAX_BLOCK_SIZE		(1 << 20)
+
+/* Superblock flags */
+#define SQFS_FLAG_COMP_OPT		0x0400
+
+/* Fragment number of files that have no tail in a fragment */
+#define SQFS_FRAGMENT_NONE		0xffffffff
+/* Fragment entries per metadata block */
+#define SQFS_FRAGMENTS_PER_BLOCK	(SQFS_METADATA_SIZE / \
+					 sizeof(struct sqfs_fragment_entry))
+
+/* An inode reference is the metadata block position and an offset in it */
+#define SQFS_INODE_BLOCK(ref)		((u32)((ref) >> 16))
+#define SQFS_INODE_OFFSET(ref)		((u32)((ref) & 0xffff))
+
+enum sqfs_compression {
+	SQFS_COMP_ZLIB = 1,
+	SQFS_COMP_LZMA = 2,
+	SQFS_COMP_LZO = 3,
+	SQFS_COMP_XZ = 4,
+	SQFS_COMP_LZ4 = 5,
+	SQFS_COMP_ZSTD = 6,
+};
+
+enum sqfs_inode_type {
+	SQFS_DIR_TYPE = 1,
+	SQFS_REG_TYPE,
+	SQFS_SYMLINK_TYPE,
+	SQFS_BLKDEV_TYPE,
+	SQFS_CHRDEV_TYPE,
+	SQFS_FIFO_TYPE,
+	SQFS_SOCKET_TYPE,
+	SQFS_LDIR_TYPE,
+	SQFS_LREG_TYPE,
+	SQFS_LSYMLINK_TYPE,
+	SQFS_LBLKDEV_TYPE,
+	SQFS_LCHRDEV_TYPE,
+	SQFS_LFIFO_TYPE,
+	SQFS_LSOCKET_TYPE,
+};
+
+struct sqfs_super_block {
+	__le32 s_magic;
+	__le32 inodes;
+	__le32 mkfs_time;
+	__le32 block_size;
+	__le32 fragments;
+	__le16 compression;
+	__le16 block_log;
+	__le16 flags;
+	__le16 no_ids;
+	__le16 s_major;
+	__le16 s_minor;
+	__le64 root_inode;
+	__le64 bytes_used;
+	__le64 id_table_start;
+	__le64 xattr_id_table_start;
+	__le64 inode_table_start;
+	__le64 directory_table_start;
+	__le64 fragment_table_start;
+	__le64 export_table_start;
+} __packed;
+
+struct sqfs_base_inode {
+	__le16 inode_type;
+	__le16 mode;
+	__le16 uid;
+	__le16 guid;
+	__le32 mtime;
+	__le32 inode_number;
+} __packed;
+
+struct sqfs_dir_inode {
+	struct sqfs_base_inode base;
+	__le32 start_block;
+	__le32 nlink;
+	__le16 file_size;
+	__le16 offset;
+	__le32 parent_inode;
+} __packed;
+
+/* Followed by i_count directory index entries */
+struct sqfs_ldir_inode {
+	struct sqfs_base_inode base;
+	__le32 nlink;
+	__le32 file_size;
+	__le32 start_block;
+	__le32 parent_inode;
+	__le16 i_count;
+	__le16 offset;
+	__le32 xattr;
+} __packed;
+
+/* Followed by the size of each data block, as __le32 */
+struct sqfs_reg_inode {
+	struct sqfs_base_inode base;
+	__le32 start_block;
+	__le32 fragment;
+	__le32 offset;
+	__le32 file_size;
+} __packed;
+
+/* Followed by the size of each data block, as __le32 */
+struct sqfs_lreg_inode {
+	struct sqfs_base_inode base;
+	__le64 start_block;
+	__le64 file_size;
+	__le64 sparse;
+	__le32 nlink;
+	__le32 fragment;
+	__le32 offset;
+	__le32 xattr;
+} __packed;
+
+/* Followed by symlink_size bytes of target, without a terminator */
+struct sqfs_symlink_inode {
+	struct sqfs_base_inode base;
+	__le32 nlink;
+	__le32 symlink_size;
+} __packed;
+
+/* Followed by count + 1 entries */
+struct sqfs_dir_header {
+	__le32 count;
+	__le32 start_block;
+	__le32 inode_number;
+} __packed;
+
+/* Followed by size + 1 bytes of name, without a terminator */
+struct sqfs_dir_entry {
+	__le16 offset;
+	__le16 inode_number;
+	__le16 type;
+	__le16 size;
+} __packed;
+
+struct sqfs_fragment_entry {
+	__le64 start_block;
+	__le32 size;
+	__le32 unused;
+} __packed;
+
+#endif /* __SQFS_FILESYSTEM_H */
@@ -116,6 +116,10 @@ struct blk_desc {
 /**
  * blkcache_read() - attempt to read a set of blocks from cache
  *
+ * Blocks are copied from the cache starting at @start until the first
+ * block which is not cached, so the return value may be anything
+ * between 0 and @blkcnt.
+ *
  * @param iftype - IF_TYPE_x for type of device
  * @param dev - device index of particular type
  * @param start - starting block number
@@ -123,11 +127,26 @@ struct blk_desc {
  * @param blksz - size in bytes of each block
  * @param buf - buffer to contain cached data
  *
- * @return - '1' if block returned from cache, '0' otherwise.
+ * @return - number of leading blocks returned from cache
  */
-int blkcache_read(int iftype, int dev,
-		  lbaint_t start, lbaint_t blkcnt,
-		  unsigned long blksz, void *buffer);
+lbaint_t blkcache_read(int iftype, int dev,
+		       lbaint_t start, lbaint_t blkcnt,
+		       unsigned long blksz, void *buffer);
+
+/**
+ * blkcache_uncached() - count the blocks that must be read from a device
+ *
+ * @param iftype - IF_TYPE_x for type of device
+ * @param dev - device index of particular type
+ * @param start - starting block number
+ * @param blkcnt - number of blocks wanted
+ * @param blksz - size in bytes of each block
+ *
+ * @return - number of leading blocks, from @start, which are not cached
+ */
+lbaint_t blkcache_uncached(int iftype, int dev,
+			   lbaint_t start, lbaint_t blkcnt,
+			   unsigned long blksz);
 
 /**
  * blkcache_fill() - make data read from a block device available
@@ -157,20 +176,22 @@ void blkcache_invalidate(int iftype, int dev);
 /**
  * blkcache_configure() - configure block cache
  *
- * @param blocks - maximum blocks per entry
- * @param entries - maximum entries in cache
+ * @param blocks - largest read, in blocks, which goes through the cache
+ * @param bytes - maximum size of the cache in bytes, 0 to disable it
  */
-void blkcache_configure(unsigned blocks, unsigned entries);
+void blkcache_configure(unsigned blocks, unsigned bytes);
 
 /*
  * statistics of the block cache
  */
 struct block_cache_stats {
-	unsigned hits;
-	unsigned misses;
-	unsigned entries; /* current entry count */
-	unsigned max_blocks_per_entry;
-	unsigned max_entries;
+	unsigned hits;		/* blocks read from the cache */
+	unsigned misses;	/* blocks read from the device */
+	unsigned evictions;	/* pages dropped to stay within max_bytes */
+	unsigned entries;	/* current page count */
+	unsigned bytes;		/* current size of the cached pages */
+	unsigned max_blocks_per_read;
+	unsigned max_bytes;
 };
 
 /**
@@ -182,13 +203,20 @@ void blkcache_stats(struct block_cache_stats *stats);
 
 #else
 
-static inline int blkcache_read(int iftype, int dev,
-				lbaint_t start, lbaint_t blkcnt,
-				unsigned long blksz, void *buffer)
+static inline lbaint_t blkcache_read(int iftype, int dev,
+				     lbaint_t start, lbaint_t blkcnt,
+				     unsigned long blksz, void *buffer)
 {
 	return 0;
 }
 
+static inline lbaint_t blkcache_uncached(int iftype, int dev,
+					 lbaint_t start, lbaint_t blkcnt,
+					 unsigned long blksz)
+{
+	return blkcnt;
+}
+
 static inline void blkcache_fill(int iftype, int dev,
 				 lbaint_t start, lbaint_t blkcnt,
 				 unsigned long blksz, void const *buffer) {}
@@ -197,9 +225,92 @@ static inline void blkcache_invalidate(int iftype, int dev) {}
 
 #endif
 
-#if CONFIG_IS_ENABLED(BLK)
 struct udevice;
 
+#if CONFIG_IS_ENABLED(BLK_READAHEAD)
+/*
+ * Per-device readahead state, held as uclass-private data of the block
+ * device
+ */
+struct blk_readahead {
+	lbaint_t next;		/* block following the previous read */
+	lbaint_t start;		/* first block held in @buf */
+	lbaint_t count;		/* number of valid blocks in @buf */
+	lbaint_t size;		/* size of each buffer in blocks */
+	lbaint_t ahead_start;	/* first block read into @ahead_buf */
+	lbaint_t ahead_count;	/* number of blocks read into @ahead_buf */
+	bool busy;		/* the read into @ahead_buf is in flight */
+	void *buf;		/* window which reads are served from */
+	void *ahead_buf;	/* window read ahead of @buf */
+	void *mem;		/* allocation holding both buffers */
+};
+
+/*
+ * statistics of the readahead layer
+ */
+struct blk_readahead_stats {
+	unsigned hits;		/* blocks served from a readahead window */
+	unsigned misses;	/* blocks read from the device on demand */
+	unsigned fetched;	/* blocks read ahead of the request */
+	unsigned windows;	/* number of readahead transfers */
+	unsigned max_blocks;	/* readahead window size in blocks */
+};
+
+/**
+ * blk_readahead_read() - read blocks from a device, reading ahead when the
+ * access pattern is sequential
+ *
+ * @dev:	Block device to read from
+ * @start:	Start block number to read (0=first)
+ * @blkcnt:	Number of blocks to read
+ * @buffer:	Destination buffer for data read
+ * @return number of blocks read, or -ve error number
+ */
+ulong blk_readahead_read(struct udevice *dev, lbaint_t start,
+			 lbaint_t blkcnt, void *buffer);
+
+/**
+ * blk_readahead_invalidate() - discard the readahead window of a device
+ * because of a write or device (re)initialization.
+ *
+ * A readahead still in flight is waited for first, so the device is idle
+ * on return.
+ *
+ * @desc:	Block device descriptor
+ */
+void blk_readahead_invalidate(struct blk_desc *desc);
+
+/**
+ * blk_readahead_remove() - free the readahead buffer of a device
+ *
+ * @dev:	Block device which is being removed
+ */
+void blk_readahead_remove(struct udevice *dev);
+
+/**
+ * blk_readahead_configure() - set the readahead window size
+ *
+ * The windows of all devices are dropped, so the new size applies to the
+ * next read.
+ *
+ * @blocks:	Number of blocks read ahead of a sequential read, 0 to disable
+ */
+void blk_readahead_configure(unsigned blocks);
+
+/**
+ * blk_readahead_stats() - return statistics and reset
+ *
+ * @stats:	Statistics are copied here
+ */
+void blk_readahead_stats(struct blk_readahead_stats *stats);
+
+#else
+
+static inline void blk_readahead_invalidate(struct blk_desc *desc) {}
+
+#endif
+
+#if CONFIG_IS_ENABLED(BLK)
 /* Operations on block devices */
 struct blk_ops {
 	/**
@@ -240,6 +351,32 @@ struct blk_ops {
 	unsigned long (*erase)(struct udevice *dev, lbaint_t start,
 			       lbaint_t blkcnt);
 
+	/**
+	 * read_start() - start reading from a block device
+	 *
+	 * This is optional and used for readahead. The read is queued on
+	 * the device and the call returns without waiting for the data.
+	 * Only one read can be in flight: read_wait() is called before any
+	 * other operation on the device.
+	 *
+	 * @dev:	Device to read from
+	 * @start:	Start block number to read (0=first)
+	 * @blkcnt:	Number of blocks to read
+	 * @buffer:	Destination buffer for data read
+	 * @return 0 if the read was started, -ve error number otherwise
+	 */
+	int (*read_start)(struct udevice *dev, lbaint_t start,
+			  lbaint_t blkcnt, void *buffer);
+
+	/**
+	 * read_wait() - wait for the read started by read_start()
+	 *
+	 * @dev:	Device which is reading
+	 * @return number of blocks read, or -ve error number (see the
+	 * IS_ERR_VALUE() macro
+	 */
+	unsigned long (*read_wait)(struct udevice *dev);
+
 	/**
 	 * select_hwpart() - select a particular hardware partition
 	 *
@@ -430,7 +567,7 @@ static inline ulong blk_dread(struct blk_desc *block_dev, lbaint_t start,
 {
 	ulong blks_read;
 	if (blkcache_read(block_dev->if_type, block_dev->devnum,
-			  start, blkcnt, block_dev->blksz, buffer))
+			  start, blkcnt, block_dev->blksz, buffer) == blkcnt)
 		return blkcnt;
 
 	/*
@@ -0,0 +1,175 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * eMMC Command Queue Host Controller Interface (CQHCI), as defined by
+ * JEDEC JESD84-B51
+ */
+
+#ifndef __CQHCI_H
+#define __CQHCI_H
+
+#include <asm/io.h>
+#include <linux/bitops.h>
+#include <linux/sizes.h>
+#include <linux/types.h>
+
+/*
+ * Controller registers
+ */
+
+#define CQHCI_VER		0x00
+#define CQHCI_CAP		0x04
+
+#define CQHCI_CFG		0x08
+#define  CQHCI_DCMD		BIT(12)
+#define  CQHCI_TASK_DESC_SZ	BIT(8)	/* 128-bit task descriptors */
+#define  CQHCI_ENABLE		BIT(0)
+
+#define CQHCI_CTL		0x0C
+#define  CQHCI_CLEAR_ALL_TASKS	BIT(8)
+#define  CQHCI_HALT		BIT(0)
+
+#define CQHCI_IS		0x10
+#define CQHCI_ISTE		0x14
+#define CQHCI_ISGE		0x18
+#define  CQHCI_IS_HAC		BIT(0)	/* halt complete */
+#define  CQHCI_IS_TCC		BIT(1)	/* task complete */
+#define  CQHCI_IS_RED		BIT(2)	/* response error detected */
+#define  CQHCI_IS_TCL		BIT(3)	/* task cleared */
+#define  CQHCI_IS_MASK		(CQHCI_IS_HAC | CQHCI_IS_TCC | \
+				 CQHCI_IS_RED | CQHCI_IS_TCL)
+
+#define CQHCI_IC		0x1C
+#define CQHCI_TDLBA		0x20
+#define CQHCI_TDLBAU		0x24
+#define CQHCI_TDBR		0x28	/* doorbell */
+#define CQHCI_TCN		0x2C	/* task completion notification */
+#define CQHCI_DQS		0x30
+#define CQHCI_DPT		0x34
+#define CQHCI_TCLR		0x38
+#define CQHCI_SSC1		0x40
+#define CQHCI_SSC2		0x44	/* RCA used for CMD13 polling */
+#define CQHCI_CRDCT		0x48
+#define CQHCI_RMEM		0x50
+#define CQHCI_TERRI		0x54
+#define CQHCI_CRI		0x58
+#define CQHCI_CRA		0x5C
+
+/*
+ * Descriptor fields, common to task, link and transfer descriptors
+ */
+#define CQHCI_VALID(x)		(((x) & 1) << 0)
+#define CQHCI_END(x)		(((x) & 1) << 1)
+#define CQHCI_INT(x)		(((x) & 1) << 2)
+#define CQHCI_ACT(x)		(((x) & 0x7) << 3)
+#define  CQHCI_ACT_TRAN		0x4
+#define  CQHCI_ACT_TASK		0x5
+#define  CQHCI_ACT_LINK		0x6
+
+/* Task descriptor, always 64 bits here */
+#define CQHCI_TASK_DESC_LEN	8
+#define CQHCI_DATA_DIR(x)	(((x) & 1) << 12)	/* 1 for reads */
+#define CQHCI_BLK_COUNT(x)	(((x) & 0xFFFF) << 16)
+#define CQHCI_BLK_ADDR(x)	(((u64)(x) & 0xFFFFFFFF) << 32)
+
+/* Transfer descriptor */
+#define CQHCI_DAT_LENGTH(x)	(((x) & 0xFFFF) << 16)
+
+#define CQHCI_NUM_SLOTS		32
+/* Largest task queued, as a count of 512-byte blocks */
+#define CQHCI_MAX_TASK_BLOCKS	1024
+/* Largest transfer descriptor; a task uses as many as it needs */
+#define CQHCI_MAX_SEG_SIZE	SZ_32K
+#define CQHCI_SEGS_PER_TASK	(CQHCI_MAX_TASK_BLOCKS * 512 / \
+				 CQHCI_MAX_SEG_SIZE)
+
+struct cqhci_host;
+struct mmc;
+struct mmc_data;
+
+/**
+ * struct cqhci_host_ops - Hooks into the host controller owning the engine
+ */
+struct cqhci_host_ops {
+	/**
+	 * enable() - Set the host up for command queueing
+	 *
+	 * Selects ADMA2, 512-byte blocks and lets the engine's interrupt
+	 * through to the host status register.
+	 */
+	void (*enable)(struct cqhci_host *cq);
+	/**
+	 * disable() - Return the host to normal operation
+	 *
+	 * @recovery:	true if the engine stopped on an error, in which case
+	 *		the command and data lines should be reset
+	 */
+	void (*disable)(struct cqhci_host *cq, bool recovery);
+	/**
+	 * error() - Check the host for bus errors raised while queueing
+	 *
+	 * @return 0 if none, -ve on error
+	 */
+	int (*error)(struct cqhci_host *cq);
+};
+
+/**
+ * struct cqhci_host - Command queue engine of an eMMC host
+ *
+ * @ioaddr:	Engine registers, set by the host driver before cqhci_init()
+ * @mmc:	MMC device the engine belongs to
+ * @ops:	Host controller hooks
+ * @dma64:	true to use 64-bit descriptor addresses
+ * @trans_desc_len: Length of a transfer or link descriptor in bytes
+ * @slot_sz:	Length of a task list slot: task plus link descriptor
+ * @desc:	Task descriptor list, one slot per tag
+ * @trans:	Transfer descriptors, CQHCI_SEGS_PER_TASK per tag
+ */
+struct cqhci_host {
+	void *ioaddr;
+	struct mmc *mmc;
+	const struct cqhci_host_ops *ops;
+	bool dma64;
+	uint trans_desc_len;
+	uint slot_sz;
+	u8 *desc;
+	u8 *trans;
+};
+
+static inline void cqhci_writel(struct cqhci_host *cq, u32 val, int reg)
+{
+	writel(val, cq->ioaddr + reg);
+}
+
+static inline u32 cqhci_readl(struct cqhci_host *cq, int reg)
+{
+	return readl(cq->ioaddr + reg);
+}
+
+/**
+ * cqhci_init() - Set up the engine of a host
+ *
+ * Allocates the descriptor lists. The engine stays disabled until a request
+ * is made.
+ *
+ * @cq:		Engine, with ioaddr and ops filled in
+ * @mmc:	MMC device of the host
+ * @dma64:	true if the host uses 64-bit DMA addresses
+ * @return 0 if OK, -ve on error
+ */
+int cqhci_init(struct cqhci_host *cq, struct mmc *mmc, bool dma64);
+
+/**
+ * cqhci_request() - Transfer data through the engine
+ *
+ * The card must already be in command queue mode. The transfer is split
+ * into tasks of up to CQHCI_MAX_TASK_BLOCKS blocks which are kept queued,
+ * up to the queue depth of the card, until all of them have completed.
+ *
+ * @cq:		Engine to use
+ * @data:	Data to transfer; the buffer must be cache-line aligned
+ * @blkaddr:	First block on the card
+ * @return 0 if OK, -ve on error
+ */
+int cqhci_request(struct cqhci_host *cq, struct mmc_data *data, uint blkaddr);
+
+#endif /* __CQHCI_H */
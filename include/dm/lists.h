@@ -32,6 +32,40 @@ struct driver *lists_driver_lookup_name(const char *name);
  */
 struct uclass_driver *lists_uclass_lookup(enum uclass_id id);
 
+/**
+ * lists_driver_lookup_compatible() - Find the driver for a compatible string
+ *
+ * This returns the first driver, in linker-list order, which has @compat in
+ * its of_match table. The compatible index is used if it has been built.
+ * The time taken is added to the 'dm_lookup' bootstage accumulator.
+ *
+ * @compat: Compatible string to look up
+ * @drvp: Returns the driver found
+ * @idp: Returns the of_match entry of the driver which matched
+ * @return 0 if found, -ENOENT if no driver matches
+ */
+int lists_driver_lookup_compatible(const char *compat, struct driver **drvp,
+				   const struct udevice_id **idp);
+
+/**
+ * lists_compat_index_init() - Build the compatible string index
+ *
+ * This creates a hash table mapping each compatible string in the drivers'
+ * of_match tables to the first driver that has it, and stores it in global
+ * data. Before the full malloc() pool is ready, nothing is done if the table
+ * would take more than a quarter of what is left of the pool, which binding
+ * needs. It is built again after relocation.
+ *
+ * @return 0 if OK, -ENOMEM if out of memory, in which case lookups fall
+ * back to scanning the drivers
+ */
+int lists_compat_index_init(void);
+
+/**
+ * lists_compat_index_free() - Free the compatible string index
+ */
+void lists_compat_index_free(void);
+
 /**
  * lists_bind_drivers() - search for and bind all drivers to parent
  *
@@ -123,6 +123,14 @@ struct ext_block_cache {
 	int size;
 };
 
+/* Statistics of the metadata cache */
+struct ext4fs_cache_stats {
+	unsigned hits;		/* blocks read from the cache */
+	unsigned misses;	/* blocks read from the device */
+	unsigned evictions;	/* blocks dropped to make room for others */
+	unsigned invalidations;	/* times the cache was emptied */
+};
+
 extern struct ext2_data *ext4fs_root;
 extern struct ext2fs_node *ext4fs_file;
 
@@ -164,4 +172,34 @@ int ext4fs_uuid(char *uuid_str);
 void ext_cache_init(struct ext_block_cache *cache);
 void ext_cache_fini(struct ext_block_cache *cache);
 int ext_cache_read(struct ext_block_cache *cache, lbaint_t block, int size);
+
+/**
+ * ext4fs_cache_read() - read part of a metadata block through the cache
+ *
+ * The whole block is read and kept until the filesystem is closed or
+ * written to. If the cache is disabled or there is no memory for it, only
+ * the requested part is read from the device.
+ *
+ * @sector: first sector of the block
+ * @size: size of the block in bytes
+ * @byte_offset: offset of the part to read in the block
+ * @byte_len: number of bytes to read
+ * @buf: buffer to hold the data
+ * @return 1 if OK, 0 on error
+ */
+int ext4fs_cache_read(lbaint_t sector, int size, int byte_offset, int byte_len,
+		      char *buf);
+
+/**
+ * ext4fs_cache_invalidate() - drop all blocks from the metadata cache
+ */
+void ext4fs_cache_invalidate(void);
+
+/**
+ * ext4fs_cache_stats() - return statistics of the metadata cache and reset
+ *
+ * @stats: statistics are copied here
+ */
+void ext4fs_cache_stats(struct ext4fs_cache_stats *stats);
+
 #endif
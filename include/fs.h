@@ -13,6 +13,8 @@
 #define FS_TYPE_SANDBOX	3
 #define FS_TYPE_UBIFS	4
 #define FS_TYPE_BTRFS	5
+#define FS_TYPE_SQUASHFS	6
+#define FS_TYPE_EROFS	7
 
 /**
  * do_fat_fsload - Run the fatload command
@@ -131,6 +133,28 @@ int fs_size(const char *filename, loff_t *size);
 int fs_read(const char *filename, ulong addr, loff_t offset, loff_t len,
 	    loff_t *actread);
 
+/**
+ * fs_read_stream() - read a file in pieces, handing each one to a function
+ *
+ * This reads a file from the partition previously set by fs_set_blk_dev()
+ * into @buf, @size bytes at a time, and calls @fn on each piece before
+ * reading the next. This lets the data be consumed (e.g. decompressed) while
+ * it is still in the cache and without room for the whole file in memory.
+ * The filesystem must support reading at an offset.
+ *
+ * @filename:	full path of the file to read from
+ * @buf:	buffer for each piece
+ * @size:	size of @buf in bytes
+ * @fn:		called with each piece; returns 0 to continue, 1 to stop
+ *		reading, or -ve on error
+ * @priv:	private data for @fn
+ * @actread:	returns the number of bytes read
+ * Return:	0 if OK, -ve on error from the filesystem or @fn
+ */
+int fs_read_stream(const char *filename, void *buf, loff_t size,
+		   int (*fn)(void *priv, const void *buf, loff_t len),
+		   void *priv, loff_t *actread);
+
 /**
  * fs_write() - write file to the partition previously set by fs_set_blk_dev()
  *
@@ -228,6 +252,8 @@ int do_size(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[],
 		int fstype);
 int do_load(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[],
 		int fstype);
+int do_loadz(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[],
+	     int fstype);
 int do_ls(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[],
 		int fstype);
 int file_exists(const char *dev_type, const char *dev_part, const char *file,
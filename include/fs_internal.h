@@ -10,7 +10,41 @@
 
 #include <part.h>
 
-int fs_devread(struct blk_desc *, disk_partition_t *, lbaint_t, int, int,
-	       char *);
+/**
+ * struct fs_devread_stats - how fs_devread() delivered the data it read
+ *
+ * @direct: bytes read from the device straight into the caller's buffer
+ * @copied: bytes read into a bounce buffer and copied, because they did not
+ *	fill whole sectors or the caller's buffer was not aligned for DMA
+ */
+struct fs_devread_stats {
+	u64 direct;
+	u64 copied;
+};
+
+/**
+ * fs_devread() - read bytes from a partition
+ *
+ * Whole sectors are read straight into @buf if it is aligned for DMA. Only
+ * the partial sectors at either end, and the whole read if @buf is not
+ * aligned, go through a bounce buffer.
+ *
+ * @blk: block device
+ * @partition: partition on @blk
+ * @sector: sector in the partition to read from
+ * @byte_offset: offset from @sector of the first byte to read
+ * @byte_len: number of bytes to read
+ * @buf: buffer to hold the data
+ * @return 1 if OK, 0 on error
+ */
+int fs_devread(struct blk_desc *blk, disk_partition_t *partition,
+	       lbaint_t sector, int byte_offset, int byte_len, char *buf);
+
+/**
+ * fs_devread_stats() - return statistics of fs_devread() and reset them
+ *
+ * @stats: statistics are copied here
+ */
+void fs_devread_stats(struct fs_devread_stats *stats);
 
 #endif /* __U_BOOT_FS_INTERNAL_H__ */
@@ -29,6 +29,43 @@ int gzip_parse_header(const unsigned char *src, unsigned long len);
  */
 int gunzip(void *dst, int dstlen, unsigned char *src, unsigned long *lenp);
 
+struct gunzip_stream;
+
+/**
+ * gunzip_stream_start() - Start decompressing gzipped data in pieces
+ *
+ * This allows a gzip file to be decompressed as it is read, without holding
+ * all of the compressed data in memory. Feed the pieces in order with
+ * gunzip_stream_feed() and then call gunzip_stream_finish(). Unlike gunzip(),
+ * the CRC and length in the gzip trailer are checked.
+ *
+ * @dst: Destination for uncompressed data
+ * @dstlen: Size of destination buffer
+ * @return stream, or NULL if out of memory
+ */
+struct gunzip_stream *gunzip_stream_start(void *dst, ulong dstlen);
+
+/**
+ * gunzip_stream_feed() - Decompress the next piece of a gzip file
+ *
+ * @gz: Stream from gunzip_stream_start()
+ * @src: Next piece of the gzip file
+ * @len: Length of @src in bytes
+ * @return 0 if more data is needed, 1 if the end of the gzip data has been
+ *	reached, -ENOSPC if the destination buffer is full, -EINVAL if the data
+ *	is corrupt
+ */
+int gunzip_stream_feed(struct gunzip_stream *gz, const void *src, ulong len);
+
+/**
+ * gunzip_stream_finish() - Finish decompressing and free the stream
+ *
+ * @gz: Stream from gunzip_stream_start()
+ * @lenp: Returns length of uncompressed data
+ * @return 0 if OK, -EINVAL if the gzip data was incomplete
+ */
+int gunzip_stream_finish(struct gunzip_stream *gz, ulong *lenp);
+
 /**
  * zunzip() - Uncompress blocks compressed with zlib without headers
  *
@@ -329,6 +329,13 @@ struct mtd_info {
 	 * MTD device can itself be a partition).
 	 */
 	struct list_head partitions;
+
+	/*
+	 * Count of writes, erases and bad block markings done through the
+	 * MTD API. Only kept up to date for real MTD devices, see
+	 * mtd_write_gen().
+	 */
+	unsigned int write_gen;
 };
 
 #if IS_ENABLED(CONFIG_DM)
@@ -361,6 +368,19 @@ static inline bool mtd_is_partition(const struct mtd_info *mtd)
 	return mtd->parent;
 }
 
+/*
+ * Get the change count of the real MTD device @mtd is on. It goes up whenever
+ * the device, or any partition on it, is written or erased, so it tells
+ * whether data read from it earlier may be stale.
+ */
+static inline unsigned int mtd_write_gen(const struct mtd_info *mtd)
+{
+	while (mtd->parent)
+		mtd = mtd->parent;
+
+	return mtd->write_gen;
+}
+
 static inline bool mtd_has_partitions(const struct mtd_info *mtd)
 {
 	return !list_empty(&mtd->partitions);
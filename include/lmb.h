@@ -12,6 +12,7 @@
  * Copyright (C) 2001 Peter Bergner, IBM Corp.
  */
 
+/* Number of regions held in struct lmb_region before it uses malloc() */
 #define MAX_LMB_REGIONS 8
 
 struct lmb_property {
@@ -19,10 +20,24 @@ struct lmb_property {
 	phys_size_t size;
 };
 
+/**
+ * struct lmb_region - Sorted table of non-overlapping regions
+ *
+ * Adjacent regions are merged. The table starts in @initial and is moved to
+ * a larger allocated one when it is full, so it has no fixed limit.
+ *
+ * @cnt: Number of regions
+ * @max: Number of regions that fit in @region
+ * @size: Unused
+ * @region: Regions, sorted by base address
+ * @initial: Storage for the first MAX_LMB_REGIONS regions
+ */
 struct lmb_region {
 	unsigned long cnt;
+	unsigned long max;
 	phys_size_t size;
-	struct lmb_property region[MAX_LMB_REGIONS+1];
+	struct lmb_property *region;
+	struct lmb_property initial[MAX_LMB_REGIONS];
 };
 
 struct lmb {
@@ -31,6 +46,7 @@ struct lmb {
 };
 
 extern void lmb_init(struct lmb *lmb);
+extern void lmb_uninit(struct lmb *lmb);
 extern void lmb_init_and_reserve(struct lmb *lmb, bd_t *bd, void *fdt_blob);
 extern void lmb_init_and_reserve_range(struct lmb *lmb, phys_addr_t base,
 				       phys_size_t size, void *fdt_blob);
@@ -21,4 +21,34 @@
  */
 int ulz4fn(const void *src, size_t srcn, void *dst, size_t *dstn);
 
+/**
+ * ulz4_block() - Decompress a single raw LZ4 block
+ *
+ * This is for users such as filesystems that store LZ4 blocks without the
+ * frame header around them.
+ *
+ * @src: Source block to decompress
+ * @srcn: Length of source block
+ * @dst: Destination for uncompressed data
+ * @dstn: Size of @dst; returns length of uncompressed data
+ * @return 0 if OK, -EPROTO if the block is corrupt or does not fit in @dst
+ */
+int ulz4_block(const void *src, size_t srcn, void *dst, size_t *dstn);
+
+/**
+ * ulz4_block_partial() - Decompress the start of a single raw LZ4 block
+ *
+ * Decompression stops once at least the wanted number of bytes have been
+ * produced, so any data after that in @src, such as padding, is ignored.
+ *
+ * @src: Source block to decompress
+ * @srcn: Length of source block
+ * @dst: Destination for uncompressed data
+ * @dstn: Size of @dst, which must be large enough for the whole block
+ * @outn: Number of bytes wanted; returns the number of bytes decompressed
+ * @return 0 if OK, -EPROTO if the block is corrupt or does not fit in @dst
+ */
+int ulz4_block_partial(const void *src, size_t srcn, void *dst, size_t dstn,
+		       size_t *outn);
+
 #endif
@@ -70,6 +70,8 @@
 #define MMC_CAP_NONREMOVABLE	BIT(14)
 #define MMC_CAP_NEEDS_POLL	BIT(15)
 #define MMC_CAP_CD_ACTIVE_HIGH  BIT(16)
+#define MMC_CAP_CMD23		BIT(17)	/* host can send CMD23 before data */
+#define MMC_CAP_CQE		BIT(18)	/* host has a command queue engine */
 
 #define MMC_MODE_8BIT		BIT(30)
 #define MMC_MODE_4BIT		BIT(29)
@@ -78,6 +80,7 @@
 
 
 #define SD_DATA_4BIT	0x00040000
+#define SD_SCR_CMD23_SUPPORT	BIT(1)
 
 #define IS_SD(x)	((x)->version & SD_VERSION_SD)
 #define IS_MMC(x)	((x)->version & MMC_VERSION_MMC)
@@ -108,6 +111,7 @@
 #define MMC_CMD_ERASE_GROUP_START	35
 #define MMC_CMD_ERASE_GROUP_END		36
 #define MMC_CMD_ERASE			38
+#define MMC_CMD_CMDQ_TASK_MGMT		48
 #define MMC_CMD_APP_CMD			55
 #define MMC_CMD_SPI_READ_OCR		58
 #define MMC_CMD_SPI_CRC_ON_OFF		59
@@ -208,6 +212,7 @@ static inline bool mmc_is_tuning_cmd(uint cmdidx)
 /*
  * EXT_CSD fields
  */
+#define EXT_CSD_CMDQ_MODE_EN		15	/* R/W */
 #define EXT_CSD_ENH_START_ADDR		136	/* R/W */
 #define EXT_CSD_ENH_SIZE_MULT		140	/* R/W */
 #define EXT_CSD_GP_SIZE_MULT		143	/* R/W */
@@ -234,6 +239,8 @@ static inline bool mmc_is_tuning_cmd(uint cmdidx)
 #define EXT_CSD_HC_ERASE_GRP_SIZE	224	/* RO */
 #define EXT_CSD_BOOT_MULT		226	/* RO */
 #define EXT_CSD_GENERIC_CMD6_TIME       248     /* RO */
+#define EXT_CSD_CMDQ_DEPTH		307	/* RO */
+#define EXT_CSD_CMDQ_SUPPORT		308	/* RO */
 #define EXT_CSD_BKOPS_SUPPORT		502	/* RO */
 
 /*
@@ -303,6 +310,11 @@ static inline bool mmc_is_tuning_cmd(uint cmdidx)
 #define EXT_CSD_WR_DATA_REL_USR		(1 << 0)	/* user data area WR_REL */
 #define EXT_CSD_WR_DATA_REL_GP(x)	(1 << ((x)+1))	/* GP part (x+1) WR_REL */
 
+#define EXT_CSD_CMDQ_DEPTH_MASK		0x1f	/* depth is this field + 1 */
+#define EXT_CSD_CMDQ_SUPPORTED		BIT(0)
+
+#define MMC_CMDQ_DISCARD_QUEUE		1	/* CMD48 TM op-code */
+
 #define R1_ILLEGAL_COMMAND		(1 << 22)
 #define R1_APP_CMD			(1 << 5)
 
@@ -477,6 +489,23 @@ struct dm_mmc_ops {
 	 * @return 0 if not present, 1 if present, -ve on error
 	 */
 	int (*host_power_cycle)(struct udevice *dev);
+
+#if CONFIG_IS_ENABLED(MMC_CQHCI)
+	/**
+	 * cqe_request() - Transfer data through the command queue engine
+	 *
+	 * The card has already been switched to command queue mode. The host
+	 * splits the transfer into as many tasks as it likes and returns once
+	 * all of them have completed.
+	 *
+	 * @dev:	Device to transfer with
+	 * @data:	Data to transfer, in 512-byte blocks
+	 * @blkaddr:	First block on the card
+	 * @return 0 if OK, -ENOSYS if there is no engine, other -ve on error
+	 */
+	int (*cqe_request)(struct udevice *dev, struct mmc_data *data,
+			   uint blkaddr);
+#endif
 };
 
 #define mmc_get_ops(dev)        ((struct dm_mmc_ops *)(dev)->driver->ops)
@@ -489,6 +518,8 @@ int dm_mmc_get_wp(struct udevice *dev);
 int dm_mmc_execute_tuning(struct udevice *dev, uint opcode);
 int dm_mmc_wait_dat0(struct udevice *dev, int state, int timeout_us);
 int dm_mmc_host_power_cycle(struct udevice *dev);
+int dm_mmc_cqe_request(struct udevice *dev, struct mmc_data *data,
+		       uint blkaddr);
 
 /* Transition functions for compatibility */
 int mmc_set_ios(struct mmc *mmc);
@@ -498,6 +529,7 @@ int mmc_execute_tuning(struct mmc *mmc, uint opcode);
 int mmc_wait_dat0(struct mmc *mmc, int state, int timeout_us);
 int mmc_set_enhanced_strobe(struct mmc *mmc);
 int mmc_host_power_cycle(struct mmc *mmc);
+int mmc_cqe_request(struct mmc *mmc, struct mmc_data *data, uint blkaddr);
 
 #else
 struct mmc_ops {
@@ -618,6 +650,8 @@ struct mmc {
 	u8 part_config;
 	u8 gen_cmd6_time;	/* units: 10 ms */
 	u8 part_switch_time;	/* units: 10 ms */
+	u8 cmdq_depth;		/* eMMC command queue depth, 0 if none */
+	bool cmd23;		/* card accepts SET_BLOCK_COUNT before data */
 	uint tran_speed;
 	uint legacy_speed; /* speed for the legacy mode provided by the card */
 	uint read_bl_len;
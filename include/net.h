@@ -136,6 +136,15 @@ enum eth_recv_flags {
  * free_pkt: Give the driver an opportunity to manage its packet buffer memory
  *	     when the network stack is finished processing it. This will only be
  *	     called when no error was returned from recv - optional
+ * recv_batch: Like recv, but return up to "max" packets that are ready at
+ *	       once, setting their buffers in "packets" and their lengths in
+ *	       "lengths". A length of 0 marks a bad frame, which is skipped.
+ *	       Returns the number of packets, 0 if there are none, or an error.
+ *	       The buffers must stay valid until free_batch is called. When
+ *	       supplied, this is used instead of recv and free_pkt - optional
+ * free_batch: Hand back the buffers of the "count" packets returned by the
+ *	       last call to recv_batch, so that the hardware can use them
+ *	       again - required with recv_batch
  * stop: Stop the hardware from looking for packets - may be called even if
  *	 state == PASSIVE
  * mcast: Join or leave a multicast group (for TFTP) - optional
@@ -154,6 +163,10 @@ struct eth_ops {
 	int (*send)(struct udevice *dev, void *packet, int length);
 	int (*recv)(struct udevice *dev, int flags, uchar **packetp);
 	int (*free_pkt)(struct udevice *dev, uchar *packet, int length);
+	int (*recv_batch)(struct udevice *dev, int flags, uchar **packets,
+			  int *lengths, int max);
+	int (*free_batch)(struct udevice *dev, uchar **packets, int *lengths,
+			  int count);
 	void (*stop)(struct udevice *dev);
 	int (*mcast)(struct udevice *dev, const u8 *enetaddr, int join);
 	int (*write_hwaddr)(struct udevice *dev);
@@ -358,6 +371,7 @@ struct vlan_ethernet_hdr {
 #define PROT_PPP_SES	0x8864		/* PPPoE session messages	*/
 
 #define IPPROTO_ICMP	 1	/* Internet Control Message Protocol	*/
+#define IPPROTO_TCP	 6	/* Transmission Control Protocol	*/
 #define IPPROTO_UDP	17	/* User Datagram Protocol		*/
 
 /*
@@ -490,6 +504,11 @@ struct icmp_hdr {
 #define PKTSIZE			1522
 #define PKTSIZE_ALIGN		1536
 
+/* Largest IP datagram that can be reassembled from fragments */
+#ifndef CONFIG_NET_MAXDEFRAG
+#define CONFIG_NET_MAXDEFRAG	16384
+#endif
+
 /*
  * Maximum receive ring size; that is, the number of packets
  * we can buffer before overflow happens. Basically, this just
@@ -543,7 +562,7 @@ extern int		net_restart_wrap;	/* Tried all network devices */
 
 enum proto_t {
 	BOOTP, RARP, ARP, TFTPGET, DHCP, PING, DNS, NFS, CDP, NETCONS, SNTP,
-	TFTPSRV, TFTPPUT, LINKLOCAL, FASTBOOT, WOL
+	TFTPSRV, TFTPPUT, LINKLOCAL, FASTBOOT, WOL, WGET
 };
 
 extern char	net_boot_file_name[1024];/* Boot File name */
@@ -0,0 +1,158 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * Minimal TCP client for downloading files
+ *
+ * There is a single connection at a time, driven by net_loop() like the UDP
+ * protocols. Received data is handed to the caller together with its offset
+ * in the stream, so that it can be stored straight into its final place even
+ * when segments arrive out of order.
+ */
+
+#ifndef __NET_TCP_H__
+#define __NET_TCP_H__
+
+/* TCP header flags */
+#define TCP_FIN		0x01
+#define TCP_SYN		0x02
+#define TCP_RST		0x04
+#define TCP_PSH		0x08
+#define TCP_ACK		0x10
+#define TCP_URG		0x20
+
+/*
+ *	Internet Protocol (IP) + TCP header, without TCP options.
+ */
+struct ip_tcp_hdr {
+	u8		ip_hl_v;	/* header length and version	*/
+	u8		ip_tos;		/* type of service		*/
+	u16		ip_len;		/* total length			*/
+	u16		ip_id;		/* identification		*/
+	u16		ip_off;		/* fragment offset field	*/
+	u8		ip_ttl;		/* time to live			*/
+	u8		ip_p;		/* protocol			*/
+	u16		ip_sum;		/* checksum			*/
+	struct in_addr	ip_src;		/* Source IP address		*/
+	struct in_addr	ip_dst;		/* Destination IP address	*/
+	u16		tcp_src;	/* TCP source port		*/
+	u16		tcp_dst;	/* TCP destination port		*/
+	u32		tcp_seq;	/* Sequence number		*/
+	u32		tcp_ack;	/* Acknowledgment number	*/
+	u8		tcp_hlen;	/* Header length in words << 4	*/
+	u8		tcp_flags;	/* TCP_... flags		*/
+	u16		tcp_win;	/* Receive window		*/
+	u16		tcp_xsum;	/* Checksum			*/
+	u16		tcp_urg;	/* Urgent pointer		*/
+} __attribute__((packed));
+
+#define IP_TCP_HDR_SIZE		(sizeof(struct ip_tcp_hdr))
+#define TCP_HDR_SIZE		(IP_TCP_HDR_SIZE - IP_HDR_SIZE)
+
+/* Largest segment we accept: an Ethernet frame without IP/TCP headers */
+#define TCP_MSS			(1500 - IP_TCP_HDR_SIZE)
+
+/**
+ * enum tcp_event - Things that happen to a connection
+ *
+ * @TCP_EV_CONNECTED: The connection is open and data can be sent
+ * @TCP_EV_CLOSED: The peer has sent all its data and closed its side
+ * @TCP_EV_RESET: The connection was reset or timed out; it is closed
+ */
+enum tcp_event {
+	TCP_EV_CONNECTED,
+	TCP_EV_CLOSED,
+	TCP_EV_RESET,
+};
+
+/**
+ * tcp_rxhand_f() - Handle data received on a connection
+ *
+ * This is called for each piece of data received, which may arrive out of
+ * order if a segment was lost. Data that arrived out of order may be passed
+ * again if the peer resends it, always with the same offset.
+ *
+ * @offset: Offset of @data from the start of the received stream
+ * @data: Received data
+ * @len: Number of bytes in @data
+ * @return 0 if the data was accepted, -ve to drop it (the peer sends it
+ *	again later)
+ */
+typedef int tcp_rxhand_f(ulong offset, const uchar *data, uint len);
+
+/**
+ * tcp_evhand_f() - Handle a change in the connection state
+ *
+ * @event: What happened
+ */
+typedef void tcp_evhand_f(enum tcp_event event);
+
+/**
+ * tcp_connect() - Open a connection
+ *
+ * This sends a SYN and returns; @event is called with TCP_EV_CONNECTED once
+ * the connection is open. Any earlier connection is forgotten. This must be
+ * called from within net_loop(), since TCP uses the net_loop() timeout
+ * handler for retransmissions.
+ *
+ * @dest: Peer IP address
+ * @dport: Peer port
+ * @rx: Called with received data
+ * @event: Called when the connection state changes
+ * @return 0 if OK, -ve on error
+ */
+int tcp_connect(struct in_addr dest, int dport, tcp_rxhand_f *rx,
+		tcp_evhand_f *event);
+
+/**
+ * tcp_send() - Send data on the open connection
+ *
+ * The data is copied, so the caller need not keep it.
+ *
+ * @data: Data to send
+ * @len: Number of bytes to send
+ * @return 0 if OK, -ENOSPC if there is not enough buffer space, -ENOTCONN if
+ *	the connection is not open
+ */
+int tcp_send(const void *data, uint len);
+
+/**
+ * tcp_close() - Close our side of the connection
+ *
+ * A FIN is sent once all data has been sent. Data may still be received
+ * until the peer closes its side.
+ */
+void tcp_close(void);
+
+/**
+ * tcp_abort() - Reset the connection and forget it
+ */
+void tcp_abort(void);
+
+/**
+ * tcp_set_tcp_header() - Set up the IP and TCP headers of a segment
+ *
+ * A SYN carries the MSS and window-scale options. Other segments have no
+ * options, so their data starts IP_TCP_HDR_SIZE bytes into @pkt.
+ *
+ * @pkt: Start of the IP header
+ * @dest: Destination IP address
+ * @dport: Destination port
+ * @sport: Source port
+ * @payload_len: Number of bytes of data after the headers
+ * @action: TCP_... flags
+ * @tcp_seq_num: Sequence number
+ * @tcp_ack_num: Acknowledgment number
+ * @return size of the IP and TCP headers in bytes
+ */
+int tcp_set_tcp_header(uchar *pkt, struct in_addr dest, int dport, int sport,
+		       int payload_len, u8 action, u32 tcp_seq_num,
+		       u32 tcp_ack_num);
+
+/**
+ * tcp_receive() - Process a received TCP segment
+ *
+ * @ip: IP packet holding the segment
+ * @len: Length of the IP packet
+ */
+void tcp_receive(struct ip_tcp_hdr *ip, int len);
+
+#endif /* __NET_TCP_H__ */
@@ -0,0 +1,17 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * HTTP download over TCP
+ */
+
+#ifndef __NET_WGET_H__
+#define __NET_WGET_H__
+
+/**
+ * wget_start() - Start downloading net_boot_file_name to image_load_addr
+ *
+ * The file name may be a URL (http://host[:port]/path), host:path or just a
+ * path on the server given by serverip. Hosts must be IP addresses.
+ */
+void wget_start(void);
+
+#endif /* __NET_WGET_H__ */
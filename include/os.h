@@ -154,6 +154,28 @@ void *os_realloc(void *ptr, size_t length);
  */
 void os_usleep(unsigned long usec);
 
+/**
+ * os_cpu_count() - Get the number of host CPUs that are online
+ *
+ * @return number of CPUs, at least 1
+ */
+int os_cpu_count(void);
+
+/**
+ * os_thread_create() - Run a function in a new host thread
+ *
+ * The thread is detached and ends when @entry returns. Very little of
+ * U-Boot is thread-safe, so the thread must stick to its own data.
+ *
+ * @entry:	Function to run
+ * @arg:	Argument for @entry
+ * @stack:	Stack for the thread, or NULL to let the host allocate one
+ * @stack_size:	Size of @stack in bytes
+ * @return 0 if OK, -ve on error
+ */
+int os_thread_create(void (*entry)(void *arg), void *arg, void *stack,
+		     size_t stack_size);
+
 /**
  * Gets a monotonic increasing number of nano seconds from the OS
  *
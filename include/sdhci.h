@@ -12,6 +12,9 @@
 #include <asm/io.h>
 #include <mmc.h>
 #include <asm/gpio.h>
+#if CONFIG_IS_ENABLED(MMC_CQHCI)
+#include <cqhci.h>
+#endif
 
 /*
  * Controller registers
@@ -119,6 +122,7 @@
 #define  SDHCI_INT_CARD_INSERT	BIT(6)
 #define  SDHCI_INT_CARD_REMOVE	BIT(7)
 #define  SDHCI_INT_CARD_INT	BIT(8)
+#define  SDHCI_INT_CQE		BIT(14)
 #define  SDHCI_INT_ERROR	BIT(15)
 #define  SDHCI_INT_TIMEOUT	BIT(16)
 #define  SDHCI_INT_CRC		BIT(17)
@@ -142,6 +146,11 @@
 		SDHCI_INT_DATA_END_BIT | SDHCI_INT_ADMA_ERROR)
 #define SDHCI_INT_ALL_MASK	((unsigned int)-1)
 
+#define  SDHCI_CQE_INT_ERR_MASK	(SDHCI_INT_ADMA_ERROR | SDHCI_INT_BUS_POWER | \
+		SDHCI_INT_DATA_END_BIT | SDHCI_INT_DATA_CRC | \
+		SDHCI_INT_DATA_TIMEOUT | SDHCI_INT_INDEX | \
+		SDHCI_INT_END_BIT | SDHCI_INT_CRC | SDHCI_INT_TIMEOUT)
+
 #define SDHCI_ACMD12_ERR	0x3C
 
 #define SDHCI_HOST_CONTROL2	0x3E
@@ -332,6 +341,9 @@ struct sdhci_host {
 	struct sdhci_adma_desc *adma_desc_table;
 	uint desc_slot;
 #endif
+#if CONFIG_IS_ENABLED(MMC_CQHCI)
+	struct cqhci_host cqe;	/* set cqe.ioaddr to use the engine */
+#endif
 };
 
 #ifdef CONFIG_MMC_SDHCI_IO_ACCESSORS
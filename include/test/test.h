@@ -37,6 +37,11 @@ struct unit_test {
 	int flags;
 };
 
+/* Flags for tests run by cmd_ut_category() */
+enum {
+	UT_TESTF_MANUAL	= 1 << 0,	/* only run when given by name */
+};
+
 /* Declare a new unit test */
 #define UNIT_TEST(_name, _flags, _suite)				\
 	ll_entry_declare(struct unit_test, _name, _suite) = {		\
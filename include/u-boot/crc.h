@@ -93,6 +93,68 @@ uint32_t crc32_no_comp(uint32_t crc, const unsigned char *buf, uint len);
 void crc32_wd_buf(const uint8_t *input, uint ilen, uint8_t *output,
 		  uint chunk_sz);
 
+#ifndef USE_HOSTCC
+/**
+ * enum crc32_impl - Ways of computing CRC32, slowest first
+ *
+ * @CRC32_IMPL_BYTE: One byte at a time with a 256-entry table
+ * @CRC32_IMPL_SLICE8: Eight bytes at a time with eight tables
+ * @CRC32_IMPL_ARM64: ARMv8 CRC32 instructions
+ * @CRC32_IMPL_PCLMUL: x86 carry-less multiplication (sandbox only)
+ */
+enum crc32_impl {
+	CRC32_IMPL_BYTE,
+	CRC32_IMPL_SLICE8,
+	CRC32_IMPL_ARM64,
+	CRC32_IMPL_PCLMUL,
+
+	CRC32_IMPL_COUNT,
+};
+
+/**
+ * crc32_impl_available() - Check whether a CRC32 implementation can be used
+ *
+ * This depends both on the build configuration and on the CPU.
+ *
+ * @impl: Implementation to check
+ * @return true if crc32_impl_calc() would accept @impl
+ */
+bool crc32_impl_available(enum crc32_impl impl);
+
+/**
+ * crc32_impl_name() - Get the name of a CRC32 implementation
+ *
+ * @impl: Implementation
+ * @return its name, or "unknown"
+ */
+const char *crc32_impl_name(enum crc32_impl impl);
+
+/**
+ * crc32_impl_default() - Get the implementation used by crc32()
+ *
+ * This is the fastest one available on this CPU.
+ *
+ * @return implementation crc32() uses
+ */
+enum crc32_impl crc32_impl_default(void);
+
+/**
+ * crc32_impl_calc() - Compute a CRC32 with a given implementation
+ *
+ * This works like crc32(), and is mostly useful for testing and
+ * benchmarking.
+ *
+ * @impl: Implementation to use
+ * @crc: CRC so far, as for crc32()
+ * @buf: Data to add to the CRC
+ * @len: Number of bytes at @buf
+ * @result: Place to put the new CRC
+ * @return 0 if OK, -ENOENT if @impl is not available
+ */
+int crc32_impl_calc(enum crc32_impl impl, uint32_t crc,
+		    const unsigned char *buf, uint len, uint32_t *result);
+#endif
+
 /* lib/crc32c.c */
 
 /**
@@ -94,6 +94,22 @@ void sha1_hmac(const unsigned char *key, int keylen,
 		const unsigned char *input, unsigned int ilen,
 		unsigned char *output);
 
+#ifndef USE_HOSTCC
+/**
+ * \brief	   Hash whole blocks with CPU-specific instructions
+ *
+ * Architectures may provide this to speed up sha1_update(). It must check
+ * at run time that the CPU has the instructions it needs.
+ *
+ * \param state    hash state, updated in place
+ * \param data     input data
+ * \param blocks   number of 64-byte blocks in data, at least 1
+ * \return	   true if the blocks were hashed, false to use the generic code
+ */
+bool sha1_blocks_arch(unsigned long state[5], const unsigned char *data,
+		      unsigned int blocks);
+#endif
+
 /**
  * \brief	   Checkup routine
  *
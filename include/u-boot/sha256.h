@@ -22,4 +22,21 @@ void sha256_finish(sha256_context * ctx, uint8_t digest[SHA256_SUM_LEN]);
 void sha256_csum_wd(const unsigned char *input, unsigned int ilen,
 		unsigned char *output, unsigned int chunk_sz);
 
+#ifndef USE_HOSTCC
+/**
+ * sha256_blocks_arch() - Hash whole blocks with CPU-specific instructions
+ *
+ * Architectures may provide this to speed up sha256_update(), and so every
+ * user of SHA-256 including the 'hash' command and FIT verification. It
+ * must check at run time that the CPU has the instructions it needs.
+ *
+ * @state:	Hash state, updated in place
+ * @data:	Input data
+ * @blocks:	Number of 64-byte blocks in @data, at least 1
+ * @return true if the blocks were hashed, false to use the generic code
+ */
+bool sha256_blocks_arch(uint32_t state[8], const uint8_t *data,
+			unsigned int blocks);
+#endif
+
 #endif /* _SHA256_H */
@@ -0,0 +1,147 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * Running independent jobs on secondary CPUs
+ */
+
+#ifndef __WORKER_H
+#define __WORKER_H
+
+/**
+ * struct worker_job - A job for a worker CPU
+ *
+ * A job must only touch memory that no other code uses until the job has
+ * finished: it must not call the console, malloc(), drivers or anything
+ * else that keeps global state. Hashing, decompressing and clearing memory
+ * are typical jobs.
+ *
+ * @fn: Function to run
+ * @arg: Argument for @fn
+ * @ret: Return value from @fn, valid once the job is done
+ * @done: Non-zero once the job is done
+ */
+struct worker_job {
+	int (*fn)(void *arg);
+	void *arg;
+	int ret;
+	int done;
+};
+
+#if CONFIG_IS_ENABLED(WORKER)
+/**
+ * worker_init() - Start a worker on each secondary CPU
+ *
+ * This is called by worker_submit() if needed, so it is only necessary to
+ * call it to find out how many workers there are. It does nothing if the
+ * workers are already running.
+ *
+ * @return number of workers (0 if there are no secondary CPUs), or -ve on
+ *	error
+ */
+int worker_init(void);
+
+/**
+ * worker_uninit() - Stop all workers and hand the CPUs back to the arch
+ *
+ * Jobs already submitted are finished first, so worker_wait() still works
+ * for them afterwards. This must be called before booting an OS, so that
+ * the OS can start the secondary CPUs itself.
+ */
+void worker_uninit(void);
+
+/**
+ * worker_count() - Get the number of running workers
+ *
+ * @return number of workers, 0 if none are running
+ */
+int worker_count(void);
+
+/**
+ * worker_submit() - Start a job
+ *
+ * The job is handed to an idle worker. If there are none, it is run on the
+ * calling CPU before this function returns, so callers need not care how
+ * many workers there are.
+ *
+ * @job: Job to start; must stay valid until worker_wait() returns
+ * @fn: Function to run
+ * @arg: Argument for @fn
+ */
+void worker_submit(struct worker_job *job, int (*fn)(void *arg), void *arg);
+
+/**
+ * worker_wait() - Wait for a job to finish
+ *
+ * @job: Job started with worker_submit()
+ * @return value returned by the job's function
+ */
+int worker_wait(struct worker_job *job);
+#else
+static inline int worker_init(void)
+{
+	return 0;
+}
+
+static inline void worker_uninit(void)
+{
+}
+
+static inline int worker_count(void)
+{
+	return 0;
+}
+
+static inline void worker_submit(struct worker_job *job,
+				 int (*fn)(void *arg), void *arg)
+{
+	job->fn = fn;
+	job->arg = arg;
+	job->ret = fn(arg);
+	job->done = 1;
+}
+
+static inline int worker_wait(struct worker_job *job)
+{
+	return job->ret;
+}
+#endif
+
+/**
+ * worker_arch_cpus() - Get the number of secondary CPUs that can run jobs
+ *
+ * @return number of CPUs, which are numbered from 0
+ */
+int worker_arch_cpus(void);
+
+/**
+ * worker_arch_start() - Start running a function on a secondary CPU
+ *
+ * The arch must set up the CPU so that it can run U-Boot code (with the
+ * same memory map and caches as the boot CPU, and with gd pointing to the
+ * same global data), switch to @stack and call @entry(@arg). When @entry
+ * returns the CPU must be parked again.
+ *
+ * @cpu: CPU to start
+ * @entry: Function to run
+ * @arg: Argument for @entry
+ * @stack: Bottom of the stack for the CPU
+ * @stack_size: Size of @stack in bytes
+ * @return 0 if OK, -ve on error
+ */
+int worker_arch_start(int cpu, void (*entry)(void *arg), void *arg,
+		      void *stack, ulong stack_size);
+
+/**
+ * worker_arch_idle() - Wait a little while for something to change
+ *
+ * This is called by workers waiting for a job and by worker_wait(). It may
+ * return at any time, but should save power until worker_arch_wake() is
+ * called, e.g. with WFE.
+ */
+void worker_arch_idle(void);
+
+/**
+ * worker_arch_wake() - Wake CPUs waiting in worker_arch_idle()
+ */
+void worker_arch_wake(void);
+
+#endif /* __WORKER_H */
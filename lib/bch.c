@@ -33,6 +33,10 @@
  * Encoding is performed by processing 32 input bits in parallel, using 4
  * remainder lookup tables.
  *
+ * Syndromes are computed from the ecc remainder, which is short compared with
+ * the data, with the same approach: 32 bits at a time using Horner's rule, and
+ * 4 lookup tables per syndrome.
+ *
  * The final stage of decoding involves the following internal steps:
  * a. Syndrome computation
  * b. Error locator polynomial computation using Berlekamp-Massey algorithm
@@ -341,20 +345,20 @@ static inline int parity(unsigned int x)
 static inline unsigned int gf_mul(struct bch_control *bch, unsigned int a,
 				  unsigned int b)
 {
-	return (a && b) ? bch->a_pow_tab[mod_s(bch, bch->a_log_tab[a]+
-					       bch->a_log_tab[b])] : 0;
+	return (a && b) ? bch->a_pow_tab[bch->a_log_tab[a]+
+					 bch->a_log_tab[b]] : 0;
 }
 
 static inline unsigned int gf_sqr(struct bch_control *bch, unsigned int a)
 {
-	return a ? bch->a_pow_tab[mod_s(bch, 2*bch->a_log_tab[a])] : 0;
+	return a ? bch->a_pow_tab[2*bch->a_log_tab[a]] : 0;
 }
 
 static inline unsigned int gf_div(struct bch_control *bch, unsigned int a,
 				  unsigned int b)
 {
-	return a ? bch->a_pow_tab[mod_s(bch, bch->a_log_tab[a]+
-					GF_N(bch)-bch->a_log_tab[b])] : 0;
+	return a ? bch->a_pow_tab[bch->a_log_tab[a]+
+				  GF_N(bch)-bch->a_log_tab[b]] : 0;
 }
 
 static inline unsigned int gf_inv(struct bch_control *bch, unsigned int a)
@@ -383,31 +387,47 @@ static inline int a_ilog(struct bch_control *bch, unsigned int x)
 static void compute_syndromes(struct bch_control *bch, uint32_t *ecc,
 			      unsigned int *syn)
 {
-	int i, j, s;
-	unsigned int m;
-	uint32_t poly;
+	int i, j;
+	unsigned int m, s, l;
+	uint32_t w;
 	const int t = GF_T(bch);
-
-	s = bch->ecc_bits;
+	const unsigned int l1 = modulo(bch, 32), l2 = modulo(bch, 64);
+	const int nwords = DIV_ROUND_UP(bch->ecc_bits, 32);
+	const uint16_t *tab;
 
 	/* make sure extra bits in last ecc word are cleared */
-	m = ((unsigned int)s) & 31;
+	m = bch->ecc_bits & 31;
 	if (m)
-		ecc[s/32] &= ~((1u << (32-m))-1);
+		ecc[bch->ecc_bits/32] &= ~((1u << (32-m))-1);
 	memset(syn, 0, 2*t*sizeof(*syn));
 
-	/* compute v(a^j) for j=1 .. 2t-1 */
-	do {
-		poly = *ecc++;
-		s -= 32;
-		while (poly) {
-			i = deg(poly);
-			for (j = 0; j < 2*t; j += 2)
-				syn[j] ^= a_pow(bch, (j+1)*(i+s));
-
-			poly ^= (1 << i);
+	/*
+	 * compute v(a^j) for j=1 .. 2t-1 using Horner's rule on 32-bit ecc
+	 * words: v(a^j) = (..(w0(a^j).a^32j+w1(a^j)).a^32j+..), each wi(a^j)
+	 * being the sum of 4 precomputed values, one per byte of wi
+	 */
+	for (i = 0; i < nwords; i++) {
+		w = ecc[i];
+		tab = bch->syn_tab;
+		/* l = log(a^32j) */
+		for (j = 0, l = l1; j < t;
+		     j++, tab += 1024, l = mod_s(bch, l+l2)) {
+			s = syn[2*j];
+			if (s)
+				s = bch->a_pow_tab[a_log(bch, s)+l];
+			syn[2*j] = s^tab[(w >> 0) & 0xff]^
+				tab[256+((w >> 8) & 0xff)]^
+				tab[512+((w >> 16) & 0xff)]^
+				tab[768+((w >> 24) & 0xff)];
 		}
-	} while (s > 0);
+	}
+
+	/* last ecc word was padded with zero bits, remove them */
+	m = 32*nwords-bch->ecc_bits;
+	for (j = 0; m && (j < t); j++)
+		if (syn[2*j])
+			syn[2*j] = a_pow(bch, a_log(bch, syn[2*j])+GF_N(bch)-
+					 modulo(bch, (2*j+1)*m));
 
 	/* v(a^(2j)) = v(a^j)^2 */
 	for (j = 0; j < t; j++)
@@ -778,8 +798,7 @@ static void gf_poly_mod(struct bch_control *bch, struct gf_poly *a,
 			for (i = 0; i < d; i++, p++) {
 				m = rep[i];
 				if (m >= 0)
-					c[p] ^= bch->a_pow_tab[mod_s(bch,
-								     m+la)];
+					c[p] ^= bch->a_pow_tab[m+la];
 			}
 		}
 	}
@@ -1112,7 +1131,9 @@ static int build_gf_tables(struct bch_control *bch, unsigned int poly)
 		if (x & k)
 			x ^= poly;
 	}
-	bch->a_pow_tab[GF_N(bch)] = 1;
+	/* a_pow_tab is doubled, so that sums of two logs need no reduction */
+	for (i = GF_N(bch); i <= 2*GF_N(bch); i++)
+		bch->a_pow_tab[i] = bch->a_pow_tab[i-GF_N(bch)];
 	bch->a_log_tab[0] = 0;
 
 	return 0;
@@ -1152,6 +1173,33 @@ static void build_mod8_tables(struct bch_control *bch, const uint32_t *g)
 	}
 }
 
+/*
+ * compute syndrome lookup tables: for each odd syndrome a^j, 4 tables give
+ * the value at a^j of p(X).X^(8*b), where p(X) is the polynomial of degree < 8
+ * whose coefficients are the bits of a byte, and b = 0..3 the byte position
+ * in a 32-bit ecc word
+ */
+static void build_syn_tables(struct bch_control *bch)
+{
+	unsigned int i, j, b, d, x;
+	uint16_t *tab = bch->syn_tab;
+
+	for (i = 0; i < GF_T(bch); i++, tab += 1024) {
+		tab[0] = 0;
+		for (x = 1; x < 256; x++) {
+			d = deg(x);
+			tab[x] = tab[x^(1u << d)]^a_pow(bch, (2*i+1)*d);
+		}
+		for (b = 1; b < 4; b++) {
+			for (x = 0; x < 256; x++) {
+				j = tab[x];
+				tab[256*b+x] = j ? a_pow(bch, a_log(bch, j)+
+							 (2*i+1)*8*b) : 0;
+			}
+		}
+	}
+}
+
 /*
  * build a base for factoring degree 2 polynomials
  */
@@ -1341,9 +1389,10 @@ struct bch_control *init_bch(int m, int t, unsigned int prim_poly)
 	bch->n = (1 << m)-1;
 	words  = DIV_ROUND_UP(m*t, 32);
 	bch->ecc_bytes = DIV_ROUND_UP(m*t, 8);
-	bch->a_pow_tab = bch_alloc((1+bch->n)*sizeof(*bch->a_pow_tab), &err);
+	bch->a_pow_tab = bch_alloc((1+2*bch->n)*sizeof(*bch->a_pow_tab), &err);
 	bch->a_log_tab = bch_alloc((1+bch->n)*sizeof(*bch->a_log_tab), &err);
 	bch->mod8_tab  = bch_alloc(words*1024*sizeof(*bch->mod8_tab), &err);
+	bch->syn_tab   = bch_alloc(t*1024*sizeof(*bch->syn_tab), &err);
 	bch->ecc_buf   = bch_alloc(words*sizeof(*bch->ecc_buf), &err);
 	bch->ecc_buf2  = bch_alloc(words*sizeof(*bch->ecc_buf2), &err);
 	bch->xi_tab    = bch_alloc(m*sizeof(*bch->xi_tab), &err);
@@ -1369,6 +1418,8 @@ struct bch_control *init_bch(int m, int t, unsigned int prim_poly)
 	build_mod8_tables(bch, genpoly);
 	kfree(genpoly);
 
+	build_syn_tables(bch);
+
 	err = build_deg2_base(bch);
 	if (err)
 		goto fail;
@@ -1392,6 +1443,7 @@ void free_bch(struct bch_control *bch)
 		kfree(bch->a_pow_tab);
 		kfree(bch->a_log_tab);
 		kfree(bch->mod8_tab);
+		kfree(bch->syn_tab);
 		kfree(bch->ecc_buf);
 		kfree(bch->ecc_buf2);
 		kfree(bch->xi_tab);
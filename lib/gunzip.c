@@ -81,6 +81,72 @@ int gunzip(void *dst, int dstlen, unsigned char *src, unsigned long *lenp)
 	return zunzip(dst, dstlen, src, lenp, 1, offset);
 }
 
+struct gunzip_stream {
+	z_stream s;
+	bool done;
+};
+
+struct gunzip_stream *gunzip_stream_start(void *dst, ulong dstlen)
+{
+	struct gunzip_stream *gz;
+	int r;
+
+	gz = calloc(1, sizeof(*gz));
+	if (!gz)
+		return NULL;
+
+	gz->s.zalloc = gzalloc;
+	gz->s.zfree = gzfree;
+	/* Let zlib parse the header and check the CRC and length trailer */
+	r = inflateInit2(&gz->s, 16 + MAX_WBITS);
+	if (r != Z_OK) {
+		printf("Error: inflateInit2() returned %d\n", r);
+		free(gz);
+		return NULL;
+	}
+	gz->s.next_out = dst;
+	gz->s.avail_out = min_t(ulong, dstlen, UINT_MAX);
+
+	return gz;
+}
+
+int gunzip_stream_feed(struct gunzip_stream *gz, const void *src, ulong len)
+{
+	int r;
+
+	/* Anything after the end of the stream is ignored, as with gunzip() */
+	if (gz->done)
+		return 1;
+
+	gz->s.next_in = (unsigned char *)src;
+	gz->s.avail_in = len;
+	r = inflate(&gz->s, Z_NO_FLUSH);
+	if (r == Z_STREAM_END) {
+		gz->done = true;
+		return 1;
+	}
+	if (r != Z_OK && r != Z_BUF_ERROR) {
+		printf("Error: inflate() returned %d\n", r);
+		return -EINVAL;
+	}
+	/* inflate() only stops early when the output buffer is full */
+	if (gz->s.avail_in)
+		return -ENOSPC;
+
+	return 0;
+}
+
+int gunzip_stream_finish(struct gunzip_stream *gz, ulong *lenp)
+{
+	int ret = gz->done ? 0 : -EINVAL;
+
+	*lenp = gz->s.total_out;
+	inflateEnd(&gz->s);
+	free(gz);
+
+	return ret;
+}
+
 #ifdef CONFIG_CMD_UNZIP
 __weak
 void gzwrite_progress_init(u64 expectedsize)
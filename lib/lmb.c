@@ -8,6 +8,7 @@
 
 #include <common.h>
 #include <lmb.h>
+#include <malloc.h>
 
 #define LMB_ALLOC_ANYWHERE	0
 
@@ -73,12 +74,8 @@ static long lmb_regions_adjacent(struct lmb_region *rgn, unsigned long r1,
 
 static void lmb_remove_region(struct lmb_region *rgn, unsigned long r)
 {
-	unsigned long i;
-
-	for (i = r; i < rgn->cnt - 1; i++) {
-		rgn->region[i].base = rgn->region[i + 1].base;
-		rgn->region[i].size = rgn->region[i + 1].size;
-	}
+	memmove(&rgn->region[r], &rgn->region[r + 1],
+		(rgn->cnt - r - 1) * sizeof(rgn->region[0]));
 	rgn->cnt--;
 }
 
@@ -90,12 +87,86 @@ static void lmb_coalesce_regions(struct lmb_region *rgn, unsigned long r1,
 	lmb_remove_region(rgn, r2);
 }
 
+/* Double the size of the region table, moving it to the heap */
+static int lmb_grow_region(struct lmb_region *rgn)
+{
+	struct lmb_property *region;
+	unsigned long max = rgn->max * 2;
+
+	region = malloc(max * sizeof(*region));
+	if (!region)
+		return -ENOMEM;
+	memcpy(region, rgn->region, rgn->cnt * sizeof(*region));
+	if (rgn->region != rgn->initial)
+		free(rgn->region);
+	rgn->region = region;
+	rgn->max = max;
+
+	return 0;
+}
+
+static long lmb_insert_region(struct lmb_region *rgn, unsigned long r,
+			      phys_addr_t base, phys_size_t size)
+{
+	if (rgn->cnt == rgn->max && lmb_grow_region(rgn))
+		return -1;
+
+	memmove(&rgn->region[r + 1], &rgn->region[r],
+		(rgn->cnt - r) * sizeof(rgn->region[0]));
+	rgn->region[r].base = base;
+	rgn->region[r].size = size;
+	rgn->cnt++;
+
+	return 0;
+}
+
+/* Return the index of the last region starting at or below addr, or -1 */
+static long lmb_search(struct lmb_region *rgn, phys_addr_t addr)
+{
+	unsigned long lo = 0, hi = rgn->cnt, mid;
+
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (rgn->region[mid].base <= addr)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return (long)lo - 1;
+}
+
+static phys_addr_t lmb_region_end(struct lmb_region *rgn, unsigned long r)
+{
+	return rgn->region[r].base + rgn->region[r].size - 1;
+}
+
+static void lmb_init_region(struct lmb_region *rgn)
+{
+	rgn->cnt = 0;
+	rgn->max = MAX_LMB_REGIONS;
+	rgn->size = 0;
+	rgn->region = rgn->initial;
+}
+
 void lmb_init(struct lmb *lmb)
 {
-	lmb->memory.cnt = 0;
-	lmb->memory.size = 0;
-	lmb->reserved.cnt = 0;
-	lmb->reserved.size = 0;
+	lmb_init_region(&lmb->memory);
+	lmb_init_region(&lmb->reserved);
+}
+
+static void lmb_uninit_region(struct lmb_region *rgn)
+{
+	if (rgn->region && rgn->region != rgn->initial)
+		free(rgn->region);
+	lmb_init_region(rgn);
+}
+
+/* Free any tables allocated since lmb_init(); the struct may be reused */
+void lmb_uninit(struct lmb *lmb)
+{
+	lmb_uninit_region(&lmb->memory);
+	lmb_uninit_region(&lmb->reserved);
 }
 
 static void lmb_reserve_common(struct lmb *lmb, void *fdt_blob)
@@ -142,70 +213,46 @@ void lmb_init_and_reserve_range(struct lmb *lmb, phys_addr_t base,
 static long lmb_add_region(struct lmb_region *rgn, phys_addr_t base, phys_size_t size)
 {
 	unsigned long coalesced = 0;
-	long adjacent, i;
+	long i;
 
-	if (rgn->cnt == 0) {
-		rgn->region[0].base = base;
-		rgn->region[0].size = size;
-		rgn->cnt = 1;
-		return 0;
-	}
-
-	/* First try and coalesce this LMB with another. */
-	for (i = 0; i < rgn->cnt; i++) {
+	/* Only the regions either side of base can overlap or be adjacent */
+	i = lmb_search(rgn, base);
+	if (i >= 0) {
 		phys_addr_t rgnbase = rgn->region[i].base;
 		phys_size_t rgnsize = rgn->region[i].size;
 
 		if ((rgnbase == base) && (rgnsize == size))
 			/* Already have this region, so we're done */
 			return 0;
-
-		adjacent = lmb_addrs_adjacent(base, size, rgnbase, rgnsize);
-		if (adjacent > 0) {
-			rgn->region[i].base -= size;
-			rgn->region[i].size += size;
-			coalesced++;
-			break;
-		} else if (adjacent < 0) {
-			rgn->region[i].size += size;
-			coalesced++;
-			break;
-		} else if (lmb_addrs_overlap(base, size, rgnbase, rgnsize)) {
-			/* regions overlap */
+		if (lmb_addrs_overlap(base, size, rgnbase, rgnsize))
 			return -1;
-		}
-	}
-
-	if ((i < rgn->cnt - 1) && lmb_regions_adjacent(rgn, i, i + 1)) {
-		lmb_coalesce_regions(rgn, i, i + 1);
-		coalesced++;
 	}
-
-	if (coalesced)
-		return coalesced;
-	if (rgn->cnt >= MAX_LMB_REGIONS)
+	if (i + 1 < rgn->cnt &&
+	    lmb_addrs_overlap(base, size, rgn->region[i + 1].base,
+			      rgn->region[i + 1].size))
 		return -1;
 
-	/* Couldn't coalesce the LMB, so add it to the sorted table. */
-	for (i = rgn->cnt-1; i >= 0; i--) {
-		if (base < rgn->region[i].base) {
-			rgn->region[i + 1].base = rgn->region[i].base;
-			rgn->region[i + 1].size = rgn->region[i].size;
-		} else {
-			rgn->region[i + 1].base = base;
-			rgn->region[i + 1].size = size;
-			break;
+	/* Try and coalesce this LMB with its neighbours */
+	if (i >= 0 && lmb_addrs_adjacent(rgn->region[i].base,
+					 rgn->region[i].size, base, size) > 0) {
+		rgn->region[i].size += size;
+		coalesced++;
+		if (i + 1 < rgn->cnt && lmb_regions_adjacent(rgn, i, i + 1)) {
+			lmb_coalesce_regions(rgn, i, i + 1);
+			coalesced++;
 		}
+		return coalesced;
 	}
-
-	if (base < rgn->region[0].base) {
-		rgn->region[0].base = base;
-		rgn->region[0].size = size;
+	if (i + 1 < rgn->cnt &&
+	    lmb_addrs_adjacent(base, size, rgn->region[i + 1].base,
+			       rgn->region[i + 1].size) > 0) {
+		rgn->region[i + 1].base = base;
+		rgn->region[i + 1].size += size;
+		return 1;
 	}
 
-	rgn->cnt++;
-
-	return 0;
+	/* Couldn't coalesce the LMB, so add it to the sorted table. */
+	return lmb_insert_region(rgn, i + 1, base, size);
 }
 
 /* This routine may be called with relocation disabled. */
@@ -221,21 +268,17 @@ long lmb_free(struct lmb *lmb, phys_addr_t base, phys_size_t size)
 	struct lmb_region *rgn = &(lmb->reserved);
 	phys_addr_t rgnbegin, rgnend;
 	phys_addr_t end = base + size - 1;
-	int i;
-
-	rgnbegin = rgnend = 0; /* supress gcc warnings */
+	long i;
 
 	/* Find the region where (base, size) belongs to */
-	for (i = 0; i < rgn->cnt; i++) {
-		rgnbegin = rgn->region[i].base;
-		rgnend = rgnbegin + rgn->region[i].size - 1;
-
-		if ((rgnbegin <= base) && (end <= rgnend))
-			break;
-	}
+	i = lmb_search(rgn, base);
+	if (i < 0)
+		return -1;
+	rgnbegin = rgn->region[i].base;
+	rgnend = lmb_region_end(rgn, i);
 
 	/* Didn't find the region */
-	if (i == rgn->cnt)
+	if (end > rgnend)
 		return -1;
 
 	/* Check to see if we are removing entire region */
@@ -258,11 +301,15 @@ long lmb_free(struct lmb *lmb, phys_addr_t base, phys_size_t size)
 	}
 
 	/*
-	 * We need to split the entry -  adjust the current one to the
-	 * beginging of the hole and add the region after hole.
+	 * We need to split the entry - add the region after the hole, then
+	 * adjust the current one to the beginning of the hole. Doing it in
+	 * this order leaves the table untouched if the insert fails.
 	 */
-	rgn->region[i].size = base - rgn->region[i].base;
-	return lmb_add_region(rgn, end + 1, rgnend - end);
+	if (lmb_insert_region(rgn, i + 1, end + 1, rgnend - end))
+		return -1;
+	rgn->region[i].size = base - rgnbegin;
+
+	return 0;
 }
 
 long lmb_reserve(struct lmb *lmb, phys_addr_t base, phys_size_t size)
@@ -275,16 +322,15 @@ long lmb_reserve(struct lmb *lmb, phys_addr_t base, phys_size_t size)
 static long lmb_overlaps_region(struct lmb_region *rgn, phys_addr_t base,
 				phys_size_t size)
 {
-	unsigned long i;
+	long i;
 
-	for (i = 0; i < rgn->cnt; i++) {
-		phys_addr_t rgnbase = rgn->region[i].base;
-		phys_size_t rgnsize = rgn->region[i].size;
-		if (lmb_addrs_overlap(base, size, rgnbase, rgnsize))
-			break;
-	}
+	/* Only the last region starting at or below the end can overlap */
+	i = lmb_search(rgn, base + size - 1);
+	if (i >= 0 && lmb_addrs_overlap(base, size, rgn->region[i].base,
+					rgn->region[i].size))
+		return i;
 
-	return (i < rgn->cnt) ? i : -1;
+	return -1;
 }
 
 phys_addr_t lmb_alloc(struct lmb *lmb, phys_size_t size, ulong align)
@@ -310,45 +356,75 @@ static phys_addr_t lmb_align_down(phys_addr_t addr, phys_size_t size)
 	return addr & ~(size - 1);
 }
 
+/*
+ * Consider the free range [start, end] for an allocation. Each range is
+ * scored by its size so that the allocator picks the smallest range the
+ * block fits in, leaving large ranges intact. On a tie the highest address
+ * wins, as it did when the allocator was purely top-down.
+ */
+static void lmb_fit_range(phys_addr_t start, phys_addr_t end,
+			  phys_size_t size, ulong align, phys_addr_t *best,
+			  phys_size_t *best_span)
+{
+	phys_size_t span = end - start;
+	phys_addr_t base;
+
+	if (span < size - 1)
+		return;
+	base = lmb_align_down(end - (size - 1), align);
+	if (!base || base < start)
+		return;
+	if (!*best || span < *best_span ||
+	    (span == *best_span && base > *best)) {
+		*best = base;
+		*best_span = span;
+	}
+}
+
 phys_addr_t __lmb_alloc_base(struct lmb *lmb, phys_size_t size, ulong align, phys_addr_t max_addr)
 {
-	long i, rgn;
-	phys_addr_t base = 0;
-	phys_addr_t res_base;
-
-	for (i = lmb->memory.cnt - 1; i >= 0; i--) {
-		phys_addr_t lmbbase = lmb->memory.region[i].base;
-		phys_size_t lmbsize = lmb->memory.region[i].size;
-
-		if (lmbsize < size)
-			continue;
-		if (max_addr == LMB_ALLOC_ANYWHERE)
-			base = lmb_align_down(lmbbase + lmbsize - size, align);
-		else if (lmbbase < max_addr) {
-			base = lmbbase + lmbsize;
-			if (base < lmbbase)
-				base = -1;
-			base = min(base, max_addr);
-			base = lmb_align_down(base - size, align);
-		} else
-			continue;
-
-		while (base && lmbbase <= base) {
-			rgn = lmb_overlaps_region(&lmb->reserved, base, size);
-			if (rgn < 0) {
-				/* This area isn't reserved, take it */
-				if (lmb_add_region(&lmb->reserved, base,
-						   size) < 0)
-					return 0;
-				return base;
-			}
-			res_base = lmb->reserved.region[rgn].base;
-			if (res_base < size)
+	struct lmb_region *res = &lmb->reserved;
+	phys_addr_t best = 0;
+	phys_size_t best_span = 0;
+	unsigned long i;
+	long r;
+
+	if (!size)
+		return 0;
+
+	/* Walk the free ranges between reserved regions, in each memory bank */
+	for (i = 0; i < lmb->memory.cnt; i++) {
+		phys_addr_t start = lmb->memory.region[i].base;
+		phys_addr_t end = lmb_region_end(&lmb->memory, i);
+
+		if (max_addr != LMB_ALLOC_ANYWHERE) {
+			if (start >= max_addr)
+				continue;
+			end = min(end, max_addr - 1);
+		}
+
+		r = lmb_search(res, start);
+		if (r >= 0 && lmb_region_end(res, r) >= start) {
+			if (lmb_region_end(res, r) >= end)
+				continue;
+			start = lmb_region_end(res, r) + 1;
+		}
+		for (r++; r < res->cnt && res->region[r].base <= end; r++) {
+			lmb_fit_range(start, res->region[r].base - 1, size,
+				      align, &best, &best_span);
+			if (lmb_region_end(res, r) >= end)
 				break;
-			base = lmb_align_down(res_base - size, align);
+			start = lmb_region_end(res, r) + 1;
 		}
+		if (r == res->cnt || res->region[r].base > end)
+			lmb_fit_range(start, end, size, align, &best,
+				      &best_span);
 	}
-	return 0;
+
+	if (!best || lmb_add_region(res, best, size) < 0)
+		return 0;
+
+	return best;
 }
 
 /*
@@ -359,20 +435,12 @@ phys_addr_t lmb_alloc_addr(struct lmb *lmb, phys_addr_t base, phys_size_t size)
 {
 	long rgn;
 
-	/* Check if the requested address is in one of the memory regions */
-	rgn = lmb_overlaps_region(&lmb->memory, base, size);
-	if (rgn >= 0) {
-		/*
-		 * Check if the requested end address is in the same memory
-		 * region we found.
-		 */
-		if (lmb_addrs_overlap(lmb->memory.region[rgn].base,
-				      lmb->memory.region[rgn].size,
-				      base + size - 1, 1)) {
-			/* ok, reserve the memory */
-			if (lmb_reserve(lmb, base, size) >= 0)
-				return base;
-		}
+	/* Check if the requested range is within one of the memory regions */
+	rgn = lmb_search(&lmb->memory, base);
+	if (rgn >= 0 && base + size - 1 <= lmb_region_end(&lmb->memory, rgn)) {
+		/* ok, reserve the memory */
+		if (lmb_reserve(lmb, base, size) >= 0)
+			return base;
 	}
 	return 0;
 }
@@ -380,41 +448,34 @@ phys_addr_t lmb_alloc_addr(struct lmb *lmb, phys_addr_t base, phys_size_t size)
 /* Return number of bytes from a given address that are free */
 phys_size_t lmb_get_free_size(struct lmb *lmb, phys_addr_t addr)
 {
-	int i;
+	struct lmb_region *res = &lmb->reserved;
 	long rgn;
 
 	/* check if the requested address is in the memory regions */
 	rgn = lmb_overlaps_region(&lmb->memory, addr, 1);
-	if (rgn >= 0) {
-		for (i = 0; i < lmb->reserved.cnt; i++) {
-			if (addr < lmb->reserved.region[i].base) {
-				/* first reserved range > requested address */
-				return lmb->reserved.region[i].base - addr;
-			}
-			if (lmb->reserved.region[i].base +
-			    lmb->reserved.region[i].size > addr) {
-				/* requested addr is in this reserved range */
-				return 0;
-			}
-		}
-		/* if we come here: no reserved ranges above requested addr */
-		return lmb->memory.region[lmb->memory.cnt - 1].base +
-		       lmb->memory.region[lmb->memory.cnt - 1].size - addr;
+	if (rgn < 0)
+		return 0;
+
+	rgn = lmb_search(res, addr);
+	if (rgn >= 0 && addr <= lmb_region_end(res, rgn)) {
+		/* requested addr is in this reserved range */
+		return 0;
 	}
-	return 0;
+	if (rgn + 1 < res->cnt) {
+		/* first reserved range > requested address */
+		return res->region[rgn + 1].base - addr;
+	}
+	/* if we come here: no reserved ranges above requested addr */
+	return lmb_region_end(&lmb->memory, lmb->memory.cnt - 1) + 1 - addr;
 }
 
 int lmb_is_reserved(struct lmb *lmb, phys_addr_t addr)
 {
-	int i;
+	long i;
 
-	for (i = 0; i < lmb->reserved.cnt; i++) {
-		phys_addr_t upper = lmb->reserved.region[i].base +
-			lmb->reserved.region[i].size - 1;
-		if ((addr >= lmb->reserved.region[i].base) && (addr <= upper))
-			return 1;
-	}
-	return 0;
+	i = lmb_search(&lmb->reserved, addr);
+
+	return i >= 0 && addr <= lmb_region_end(&lmb->reserved, i);
 }
 
 __weak void board_lmb_reserve(struct lmb *lmb)
@@ -136,3 +136,32 @@ int ulz4fn(const void *src, size_t srcn, void *dst, size_t *dstn)
 	*dstn = out - dst;
 	return ret;
 }
+
+int ulz4_block(const void *src, size_t srcn, void *dst, size_t *dstn)
+{
+	int ret;
+
+	/* constant folding essential, do not touch params! */
+	ret = LZ4_decompress_generic(src, dst, srcn, *dstn, endOnInputSize,
+				     full, 0, noDict, dst, NULL, 0);
+	if (ret < 0)
+		return -EPROTO;
+	*dstn = ret;
+
+	return 0;
+}
+
+int ulz4_block_partial(const void *src, size_t srcn, void *dst, size_t dstn,
+		       size_t *outn)
+{
+	int ret;
+
+	/* constant folding essential, do not touch params! */
+	ret = LZ4_decompress_generic(src, dst, srcn, dstn, endOnInputSize,
+				     partial, *outn, noDict, dst, NULL, 0);
+	if (ret < 0 || ret < *outn)
+		return -EPROTO;
+	*outn = ret;
+
+	return 0;
+}
@@ -219,6 +219,25 @@ static void sha1_process(sha1_context *ctx, const unsigned char data[64])
 	ctx->state[4] += E;
 }
 
+#ifndef USE_HOSTCC
+__weak bool sha1_blocks_arch(unsigned long state[5], const unsigned char *data,
+			     unsigned int blocks)
+{
+	return false;
+}
+#endif
+
+static void sha1_blocks(sha1_context *ctx, const unsigned char *data,
+			unsigned int blocks)
+{
+#ifndef USE_HOSTCC
+	if (sha1_blocks_arch(ctx->state, data, blocks))
+		return;
+#endif
+	for (; blocks; blocks--, data += 64)
+		sha1_process(ctx, data);
+}
+
 /*
  * SHA-1 process buffer
  */
@@ -242,16 +261,16 @@ void sha1_update(sha1_context *ctx, const unsigned char *input,
 
 	if (left && ilen >= fill) {
 		memcpy ((void *) (ctx->buffer + left), (void *) input, fill);
-		sha1_process (ctx, ctx->buffer);
+		sha1_blocks(ctx, ctx->buffer, 1);
 		input += fill;
 		ilen -= fill;
 		left = 0;
 	}
 
-	while (ilen >= 64) {
-		sha1_process (ctx, input);
-		input += 64;
-		ilen -= 64;
+	if (ilen >= 64) {
+		sha1_blocks(ctx, input, ilen / 64);
+		input += ilen & ~0x3f;
+		ilen &= 0x3f;
 	}
 
 	if (ilen > 0) {
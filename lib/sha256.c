@@ -186,6 +186,25 @@ static void sha256_process(sha256_context *ctx, const uint8_t data[64])
 	ctx->state[7] += H;
 }
 
+#ifndef USE_HOSTCC
+__weak bool sha256_blocks_arch(uint32_t state[8], const uint8_t *data,
+			       unsigned int blocks)
+{
+	return false;
+}
+#endif
+
+static void sha256_blocks(sha256_context *ctx, const uint8_t *data,
+			  unsigned int blocks)
+{
+#ifndef USE_HOSTCC
+	if (sha256_blocks_arch(ctx->state, data, blocks))
+		return;
+#endif
+	for (; blocks; blocks--, data += 64)
+		sha256_process(ctx, data);
+}
+
 void sha256_update(sha256_context *ctx, const uint8_t *input, uint32_t length)
 {
 	uint32_t left, fill;
@@ -204,16 +223,16 @@ void sha256_update(sha256_context *ctx, const uint8_t *input, uint32_t length)
 
 	if (left && length >= fill) {
 		memcpy((void *) (ctx->buffer + left), (void *) input, fill);
-		sha256_process(ctx, ctx->buffer);
+		sha256_blocks(ctx, ctx->buffer, 1);
 		length -= fill;
 		input += fill;
 		left = 0;
 	}
 
-	while (length >= 64) {
-		sha256_process(ctx, input);
-		length -= 64;
-		input += 64;
+	if (length >= 64) {
+		sha256_blocks(ctx, input, length / 64);
+		input += length & ~0x3f;
+		length &= 0x3f;
 	}
 
 	if (length)
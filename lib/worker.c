@@ -0,0 +1,172 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Running independent jobs on secondary CPUs
+ *
+ * Each worker runs on its own CPU and stack and polls a mailbox holding at
+ * most one job. Jobs are handed straight to an idle worker, or run on the
+ * boot CPU when all workers are busy, so there is no queue to manage and
+ * the boot CPU never sits idle while there is work to do.
+ */
+
+#include <common.h>
+#include <malloc.h>
+#include <worker.h>
+
+enum {
+	WORKER_RUN,
+	WORKER_STOP,
+	WORKER_STOPPED,
+};
+
+struct worker {
+	struct worker_job *job;
+	int state;
+	void *stack;
+};
+
+static struct worker *workers;
+static int num_workers;
+
+static void worker_loop(void *arg)
+{
+	struct worker *w = arg;
+	struct worker_job *job;
+	bool stop;
+
+	for (;;) {
+		/*
+		 * Check the state first: a job submitted before the stop
+		 * request is then seen below and still gets run
+		 */
+		stop = __atomic_load_n(&w->state, __ATOMIC_ACQUIRE) !=
+			WORKER_RUN;
+		job = __atomic_load_n(&w->job, __ATOMIC_ACQUIRE);
+		if (!job) {
+			if (stop)
+				break;
+			worker_arch_idle();
+			continue;
+		}
+		job->ret = job->fn(job->arg);
+		__atomic_store_n(&w->job, NULL, __ATOMIC_RELEASE);
+		__atomic_store_n(&job->done, 1, __ATOMIC_RELEASE);
+		worker_arch_wake();
+	}
+	__atomic_store_n(&w->state, WORKER_STOPPED, __ATOMIC_RELEASE);
+	worker_arch_wake();
+}
+
+int worker_init(void)
+{
+	struct worker *w;
+	int cpus, ret;
+
+	if (workers)
+		return num_workers;
+
+	cpus = min(worker_arch_cpus(), CONFIG_WORKER_MAX);
+	if (cpus <= 0)
+		return 0;
+	workers = calloc(cpus, sizeof(*workers));
+	if (!workers)
+		return -ENOMEM;
+
+	for (num_workers = 0; num_workers < cpus; num_workers++) {
+		w = &workers[num_workers];
+		w->stack = memalign(16, CONFIG_WORKER_STACK_SIZE);
+		if (!w->stack)
+			break;
+		ret = worker_arch_start(num_workers, worker_loop, w, w->stack,
+					CONFIG_WORKER_STACK_SIZE);
+		if (ret) {
+			debug("%s: Cannot start CPU %d (err=%d)\n", __func__,
+			      num_workers, ret);
+			free(w->stack);
+			break;
+		}
+	}
+	debug("%s: %d workers\n", __func__, num_workers);
+
+	return num_workers;
+}
+
+void worker_uninit(void)
+{
+	int i;
+
+	if (!workers)
+		return;
+
+	for (i = 0; i < num_workers; i++)
+		__atomic_store_n(&workers[i].state, WORKER_STOP,
+				 __ATOMIC_RELEASE);
+	worker_arch_wake();
+	for (i = 0; i < num_workers; i++) {
+		while (__atomic_load_n(&workers[i].state, __ATOMIC_ACQUIRE) !=
+		       WORKER_STOPPED)
+			worker_arch_idle();
+		free(workers[i].stack);
+	}
+	free(workers);
+	workers = NULL;
+	num_workers = 0;
+}
+
+int worker_count(void)
+{
+	return num_workers;
+}
+
+void worker_submit(struct worker_job *job, int (*fn)(void *arg), void *arg)
+{
+	struct worker_job *idle;
+	int i;
+
+	job->fn = fn;
+	job->arg = arg;
+	job->ret = 0;
+	job->done = 0;
+
+	if (!workers)
+		worker_init();
+	for (i = 0; i < num_workers; i++) {
+		idle = NULL;
+		if (__atomic_compare_exchange_n(&workers[i].job, &idle, job,
+						false, __ATOMIC_RELEASE,
+						__ATOMIC_RELAXED)) {
+			worker_arch_wake();
+			return;
+		}
+	}
+
+	/* All workers are busy, so do it here */
+	job->ret = fn(arg);
+	job->done = 1;
+}
+
+int worker_wait(struct worker_job *job)
+{
+	while (!__atomic_load_n(&job->done, __ATOMIC_ACQUIRE))
+		worker_arch_idle();
+
+	return job->ret;
+}
+
+__weak int worker_arch_cpus(void)
+{
+	return 0;
+}
+
+__weak int worker_arch_start(int cpu, void (*entry)(void *arg), void *arg,
+			     void *stack, ulong stack_size)
+{
+	return -ENOSYS;
+}
+
+__weak void worker_arch_idle(void)
+{
+}
+
+__weak void worker_arch_wake(void)
+{
+}
@@ -352,6 +352,35 @@ int eth_send(void *packet, int length)
 	return ret;
 }
 
+/* Maximum number of packets processed by one call to eth_rx() */
+#define ETH_RX_BATCH	32
+
+/*
+ * Take all the packets the device has ready in one go, and hand their
+ * buffers back together once they are processed
+ */
+static int eth_rx_batch(struct udevice *current)
+{
+	uchar *packets[ETH_RX_BATCH];
+	int lengths[ETH_RX_BATCH];
+	int count;
+	int i;
+
+	count = eth_get_ops(current)->recv_batch(current, ETH_RECV_CHECK_DEVICE,
+						 packets, lengths,
+						 ETH_RX_BATCH);
+	if (count <= 0)
+		return count;
+
+	for (i = 0; i < count; i++) {
+		if (lengths[i] > 0)
+			net_process_received_packet(packets[i], lengths[i]);
+	}
+	eth_get_ops(current)->free_batch(current, packets, lengths, count);
+
+	return count;
+}
+
 int eth_rx(void)
 {
 	struct udevice *current;
@@ -367,9 +396,14 @@ int eth_rx(void)
 	if (!eth_is_active(current))
 		return -EINVAL;
 
-	/* Process up to 32 packets at one time */
+	if (eth_get_ops(current)->recv_batch) {
+		ret = eth_rx_batch(current);
+		goto out;
+	}
+
+	/* Process up to ETH_RX_BATCH packets at one time */
 	flags = ETH_RECV_CHECK_DEVICE;
-	for (i = 0; i < 32; i++) {
+	for (i = 0; i < ETH_RX_BATCH; i++) {
 		ret = eth_get_ops(current)->recv(current, flags, &packet);
 		flags = 0;
 		if (ret > 0)
@@ -379,6 +413,7 @@ int eth_rx(void)
 		if (ret <= 0)
 			break;
 	}
+out:
 	if (ret == -EAGAIN)
 		ret = 0;
 	if (ret < 0) {
@@ -504,6 +539,10 @@ static int eth_post_probe(struct udevice *dev)
 			ops->recv += gd->reloc_off;
 		if (ops->free_pkt)
 			ops->free_pkt += gd->reloc_off;
+		if (ops->recv_batch)
+			ops->recv_batch += gd->reloc_off;
+		if (ops->free_batch)
+			ops->free_batch += gd->reloc_off;
 		if (ops->stop)
 			ops->stop += gd->reloc_off;
 		if (ops->mcast)
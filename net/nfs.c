@@ -33,6 +33,7 @@
 #include <net.h>
 #include <malloc.h>
 #include <mapmem.h>
+#include <linux/log2.h>
 #include "nfs.h"
 #include "bootp.h"
 #include <time.h>
@@ -50,10 +51,25 @@
 
 static int fs_mounted;
 static unsigned long rpc_id;
-static int nfs_offset = -1;
-static int nfs_len;
+static ulong nfs_offset;	/* Offset of the next block to request */
+static int nfs_len;		/* Number of bytes asked for in each READ */
 static ulong nfs_timeout = NFS_TIMEOUT;
 
+/* A READ request waiting for its reply */
+struct nfs_read_slot {
+	unsigned long id;	/* XID of the request, 0 if the slot is free */
+	ulong offset;		/* File offset asked for */
+	int len;		/* Number of bytes asked for */
+	ulong sent;		/* get_timer() value when it was last sent */
+	int retries;		/* Number of times it was sent again */
+};
+
+static struct nfs_read_slot nfs_read_slots[CONFIG_NFS_READ_WINDOW];
+static ulong nfs_read_end;	/* File size once known, else ~0 */
+static ulong nfs_read_done;	/* Number of bytes stored so far */
+static ulong nfs_hash_next;	/* Value of nfs_read_done for the next '#' */
+static int nfs_hash_count;
+
 static char dirfh[NFS_FHSIZE];	/* NFSv2 / NFSv3 file handle of directory */
 static char filefh[NFS3_FHSIZE]; /* NFSv2 / NFSv3 file handle */
 static int filefh3_length;	/* (variable) length of filefh when NFSv3 */
@@ -72,6 +88,7 @@ static int nfs_state;
 #define STATE_LOOKUP_REQ		5
 #define STATE_READ_REQ			6
 #define STATE_READLINK_REQ		7
+#define STATE_FSINFO_REQ		8
 
 static char *nfs_filename;
 static char *nfs_path;
@@ -174,15 +191,14 @@ static uint32_t *rpc_add_credentials(uint32_t *p)
 /**************************************************************************
 RPC_LOOKUP - Lookup RPC Port numbers
 **************************************************************************/
-static void rpc_req(int rpc_prog, int rpc_proc, uint32_t *data, int datalen)
+static void rpc_send(unsigned long id, int rpc_prog, int rpc_proc,
+		     uint32_t *data, int datalen)
 {
 	struct rpc_t rpc_pkt;
-	unsigned long id;
 	uint32_t *p;
 	int pktlen;
 	int sport;
 
-	id = ++rpc_id;
 	rpc_pkt.u.call.id = htonl(id);
 	rpc_pkt.u.call.type = htonl(MSG_CALL);
 	rpc_pkt.u.call.rpcvers = htonl(2);	/* use RPC version 2 */
@@ -221,6 +237,11 @@ static void rpc_req(int rpc_prog, int rpc_proc, uint32_t *data, int datalen)
 			    nfs_our_port, pktlen);
 }
 
+static void rpc_req(int rpc_prog, int rpc_proc, uint32_t *data, int datalen)
+{
+	rpc_send(++rpc_id, rpc_prog, rpc_proc, data, datalen);
+}
+
 /**************************************************************************
 RPC_LOOKUP - Lookup RPC Port numbers
 **************************************************************************/
@@ -360,7 +381,7 @@ static void nfs_lookup_req(char *fname)
 /**************************************************************************
 NFS_READ - Read File on NFS Server
 **************************************************************************/
-static void nfs_read_req(int offset, int readlen)
+static void nfs_read_req(unsigned long id, ulong offset, int readlen)
 {
 	uint32_t data[1024];
 	uint32_t *p;
@@ -387,7 +408,91 @@ static void nfs_read_req(int offset, int readlen)
 
 	len = (uint32_t *)p - (uint32_t *)&(data[0]);
 
-	rpc_req(PROG_NFS, NFS_READ, data, len);
+	rpc_send(id, PROG_NFS, NFS_READ, data, len);
+}
+
+static void nfs_read_send(struct nfs_read_slot *slot)
+{
+	slot->sent = get_timer(0);
+	nfs_read_req(slot->id, slot->offset, slot->len);
+}
+
+/* Send READ requests for the next blocks until the window is full */
+static void nfs_read_fill(void)
+{
+	struct nfs_read_slot *slot;
+
+	for (slot = nfs_read_slots;
+	     slot < nfs_read_slots + ARRAY_SIZE(nfs_read_slots); slot++) {
+		if (slot->id)
+			continue;
+		if (nfs_offset >= nfs_read_end)
+			break;
+		slot->id = ++rpc_id;
+		slot->offset = nfs_offset;
+		slot->len = nfs_len;
+		slot->retries = 0;
+		nfs_offset += nfs_len;
+		nfs_read_send(slot);
+	}
+}
+
+static struct nfs_read_slot *nfs_read_find(unsigned long id)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(nfs_read_slots); i++) {
+		if (nfs_read_slots[i].id == id)
+			return &nfs_read_slots[i];
+	}
+
+	return NULL;
+}
+
+/* Check whether any READ request is still waiting for its reply */
+static bool nfs_read_busy(void)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(nfs_read_slots); i++) {
+		if (nfs_read_slots[i].id)
+			return true;
+	}
+
+	return false;
+}
+
+/* Forget the requests for blocks that start at or after @end */
+static void nfs_read_truncate(ulong end)
+{
+	int i;
+
+	nfs_read_end = end;
+	for (i = 0; i < ARRAY_SIZE(nfs_read_slots); i++) {
+		if (nfs_read_slots[i].offset >= end)
+			nfs_read_slots[i].id = 0;
+	}
+}
+
+/**************************************************************************
+NFS3_FSINFO - Ask the server for its preferred read size
+**************************************************************************/
+static void nfs3_fsinfo_req(void)
+{
+	uint32_t data[1024];
+	uint32_t *p;
+	int len;
+
+	p = &(data[0]);
+	p = rpc_add_credentials(p);
+
+	*p++ = htonl(filefh3_length);
+	memcpy(p, filefh, filefh3_length);
+	p += (filefh3_length / 4);
+
+	len = (uint32_t *)p - (uint32_t *)&(data[0]);
+
+	rpc_req(PROG_NFS, NFS3PROC_FSINFO, data, len);
 }
 
 /**************************************************************************
@@ -420,11 +525,14 @@ static void nfs_send(void)
 		nfs_lookup_req(nfs_filename);
 		break;
 	case STATE_READ_REQ:
-		nfs_read_req(nfs_offset, nfs_len);
+		nfs_read_fill();
 		break;
 	case STATE_READLINK_REQ:
 		nfs_readlink_req();
 		break;
+	case STATE_FSINFO_REQ:
+		nfs3_fsinfo_req();
+		break;
 	}
 }
 
@@ -663,21 +771,62 @@ static int nfs_readlink_reply(uchar *pkt, unsigned len)
 	return 0;
 }
 
-static int nfs_read_reply(uchar *pkt, unsigned len)
+static int nfs3_fsinfo_reply(uchar *pkt, unsigned len)
 {
 	struct rpc_t rpc_pkt;
-	int rlen;
-	uchar *data_ptr;
+	int nfsv3_data_offset;
+	uint size;
 
 	debug("%s\n", __func__);
 
-	memcpy(&rpc_pkt.u.data[0], pkt, sizeof(rpc_pkt.u.reply));
+	memcpy(&rpc_pkt.u.data[0], pkt, len);
 
 	if (ntohl(rpc_pkt.u.reply.id) > rpc_id)
 		return -NFS_RPC_ERR;
 	else if (ntohl(rpc_pkt.u.reply.id) < rpc_id)
 		return -NFS_RPC_DROP;
 
+	if (rpc_pkt.u.reply.rstatus  ||
+	    rpc_pkt.u.reply.verifier ||
+	    rpc_pkt.u.reply.astatus  ||
+	    rpc_pkt.u.reply.data[0])
+		return -1;
+
+	nfsv3_data_offset = nfs3_get_attributes_offset(rpc_pkt.u.reply.data);
+	if (((uchar *)&(rpc_pkt.u.reply.data[3 + nfsv3_data_offset]) -
+	     (uchar *)(&rpc_pkt)) > len)
+		return -1;
+
+	/* Use the preferred size (rtpref) unless it is above the maximum */
+	size = min(ntohl(rpc_pkt.u.reply.data[1 + nfsv3_data_offset]),
+		   ntohl(rpc_pkt.u.reply.data[2 + nfsv3_data_offset]));
+	size = min_t(uint, size, NFS3_MAX_READ_SIZE);
+	if (size > NFS_READ_SIZE)
+		nfs_len = rounddown_pow_of_two(size);
+	debug("NFS read size %d\n", nfs_len);
+
+	return 0;
+}
+
+static int nfs_read_reply(uchar *pkt, unsigned len)
+{
+	struct rpc_t rpc_pkt;
+	struct nfs_read_slot *slot;
+	unsigned long id;
+	int rlen, eof = 0;
+	uint data_offset;
+
+	debug("%s\n", __func__);
+
+	/* Only the headers are copied; the data is stored straight from pkt */
+	memcpy(&rpc_pkt.u.data[0], pkt,
+	       min_t(unsigned, len, sizeof(rpc_pkt.u.reply) - NFS_READ_SIZE));
+
+	id = ntohl(rpc_pkt.u.reply.id);
+	slot = id ? nfs_read_find(id) : NULL;
+	if (!slot)
+		return -NFS_RPC_DROP;
+
 	if (rpc_pkt.u.reply.rstatus  ||
 	    rpc_pkt.u.reply.verifier ||
 	    rpc_pkt.u.reply.astatus  ||
@@ -689,34 +838,54 @@ static int nfs_read_reply(uchar *pkt, unsigned len)
 		return -ntohl(rpc_pkt.u.reply.data[0]);
 	}
 
-	if ((nfs_offset != 0) && !((nfs_offset) %
-			(NFS_READ_SIZE / 2 * 10 * HASHES_PER_LINE)))
-		puts("\n\t ");
-	if (!(nfs_offset % ((NFS_READ_SIZE / 2) * 10)))
-		putc('#');
-
 	if (supported_nfs_versions & NFSV2_FLAG) {
 		rlen = ntohl(rpc_pkt.u.reply.data[18]);
-		data_ptr = (uchar *)&(rpc_pkt.u.reply.data[19]);
+		data_offset = (uchar *)&(rpc_pkt.u.reply.data[19]) -
+			      (uchar *)&rpc_pkt;
 	} else {  /* NFSV3_FLAG */
 		int nfsv3_data_offset =
 			nfs3_get_attributes_offset(rpc_pkt.u.reply.data);
 
 		/* count value */
 		rlen = ntohl(rpc_pkt.u.reply.data[1 + nfsv3_data_offset]);
+		eof = ntohl(rpc_pkt.u.reply.data[2 + nfsv3_data_offset]);
 		/* Skip unused values :
 			EOF:		32 bits value,
 			data_size:	32 bits value,
 		*/
-		data_ptr = (uchar *)
-			&(rpc_pkt.u.reply.data[4 + nfsv3_data_offset]);
+		data_offset = (uchar *)
+			&(rpc_pkt.u.reply.data[4 + nfsv3_data_offset]) -
+			(uchar *)&rpc_pkt;
 	}
 
-	if (((uchar *)&(rpc_pkt.u.reply.data[0]) - (uchar *)(&rpc_pkt) + rlen) > len)
-			return -9999;
+	if (rlen < 0 || rlen > slot->len || data_offset + rlen > len)
+		return -9999;
 
-	if (store_block(data_ptr, nfs_offset, rlen))
-			return -9999;
+	if (rlen && store_block(pkt + data_offset, slot->offset, rlen))
+		return -9999;
+
+	nfs_read_done += rlen;
+	while (nfs_read_done >= nfs_hash_next) {
+		putc('#');
+		if (++nfs_hash_count % HASHES_PER_LINE == 0)
+			puts("\n\t ");
+		nfs_hash_next += NFS_READ_SIZE / 2 * 10;
+	}
+
+	if (eof || !rlen) {
+		/* The file ends here; nothing after it needs to be read */
+		nfs_read_truncate(slot->offset + rlen);
+		slot->id = 0;
+	} else if (rlen < slot->len) {
+		/* Short read: ask again for the rest of the block */
+		slot->id = ++rpc_id;
+		slot->offset += rlen;
+		slot->len -= rlen;
+		slot->retries = 0;
+		nfs_read_send(slot);
+	} else {
+		slot->id = 0;
+	}
 
 	return rlen;
 }
@@ -724,8 +893,58 @@ static int nfs_read_reply(uchar *pkt, unsigned len)
 /**************************************************************************
 Interfaces of U-BOOT
 **************************************************************************/
+static void nfs_timeout_handler(void);
+
+/* Send again each READ request whose reply is overdue */
+static void nfs_read_timeout(void)
+{
+	struct nfs_read_slot *slot;
+	ulong next = nfs_timeout;
+	ulong limit, elapsed;
+
+	for (slot = nfs_read_slots;
+	     slot < nfs_read_slots + ARRAY_SIZE(nfs_read_slots); slot++) {
+		if (!slot->id)
+			continue;
+		limit = nfs_timeout + NFS_TIMEOUT * slot->retries;
+		elapsed = get_timer(slot->sent);
+		if (elapsed >= limit) {
+			if (++slot->retries > NFS_RETRY_COUNT) {
+				puts("\nRetry count exceeded; starting again\n");
+				net_start_again();
+				return;
+			}
+			puts("T ");
+			nfs_read_send(slot);
+			limit += NFS_TIMEOUT;
+			elapsed = 0;
+		}
+		next = min(next, limit - elapsed);
+	}
+	net_set_timeout_handler(max(next, 1UL), nfs_timeout_handler);
+}
+
+static void nfs_read_start(void)
+{
+	memset(nfs_read_slots, 0, sizeof(nfs_read_slots));
+	nfs_offset = 0;
+	nfs_read_end = ~0UL;
+	nfs_read_done = 0;
+	nfs_hash_next = NFS_READ_SIZE / 2 * 10;
+	nfs_hash_count = 0;
+
+	nfs_state = STATE_READ_REQ;
+	net_set_timeout_handler(nfs_timeout, nfs_timeout_handler);
+	nfs_read_fill();
+}
+
 static void nfs_timeout_handler(void)
 {
+	if (nfs_state == STATE_READ_REQ) {
+		nfs_read_timeout();
+		return;
+	}
+
 	if (++nfs_timeout_count > NFS_RETRY_COUNT) {
 		puts("\nRetry count exceeded; starting again\n");
 		net_start_again();
@@ -746,7 +965,8 @@ static void nfs_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 
 	debug("%s\n", __func__);
 
-	if (len > sizeof(struct rpc_t))
+	/* READ replies may be larger, see nfs_read_reply() */
+	if (len > sizeof(struct rpc_t) && nfs_state != STATE_READ_REQ)
 		return;
 
 	if (dest != nfs_our_port)
@@ -812,13 +1032,26 @@ static void nfs_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 			nfs_state = STATE_PRCLOOKUP_PROG_MOUNT_REQ;
 			nfs_send();
 		} else {
-			nfs_state = STATE_READ_REQ;
-			nfs_offset = 0;
 			nfs_len = NFS_READ_SIZE;
-			nfs_send();
+			if (IS_ENABLED(CONFIG_IP_DEFRAG) &&
+			    !(supported_nfs_versions & NFSV2_FLAG)) {
+				/* Find out how much can be read at once */
+				nfs_state = STATE_FSINFO_REQ;
+				nfs_send();
+			} else {
+				nfs_read_start();
+			}
 		}
 		break;
 
+	case STATE_FSINFO_REQ:
+		reply = nfs3_fsinfo_reply(pkt, len);
+		if (reply == -NFS_RPC_DROP)
+			break;
+		/* Without an answer, just use the default read size */
+		nfs_read_start();
+		break;
+
 	case STATE_READLINK_REQ:
 		reply = nfs_readlink_reply(pkt, len);
 		if (reply == -NFS_RPC_DROP) {
@@ -841,19 +1074,20 @@ static void nfs_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 		rlen = nfs_read_reply(pkt, len);
 		if (rlen == -NFS_RPC_DROP)
 			break;
-		net_set_timeout_handler(nfs_timeout, nfs_timeout_handler);
-		if (rlen > 0) {
-			nfs_offset += rlen;
+		if (rlen >= 0) {
+			/* Done once the end is known and all of it is read */
+			nfs_read_fill();
+			if (nfs_read_busy())
+				break;
+			nfs_download_state = NETLOOP_SUCCESS;
+			nfs_state = STATE_UMOUNT_REQ;
 			nfs_send();
 		} else if ((rlen == -NFSERR_ISDIR) || (rlen == -NFSERR_INVAL)) {
 			/* symbolic link */
 			nfs_state = STATE_READLINK_REQ;
 			nfs_send();
 		} else {
-			if (!rlen)
-				nfs_download_state = NETLOOP_SUCCESS;
-			if (rlen < 0)
-				debug("NFS READ error (%d)\n", rlen);
+			debug("NFS READ error (%d)\n", rlen);
 			nfs_state = STATE_UMOUNT_REQ;
 			nfs_send();
 		}
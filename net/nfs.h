@@ -25,6 +25,7 @@
 #define NFS_READ        6
 
 #define NFS3PROC_LOOKUP 3
+#define NFS3PROC_FSINFO 19
 
 #define NFS_FHSIZE      32
 #define NFS3_FHSIZE     64
@@ -44,6 +45,16 @@
 #define NFS_READ_SIZE	1024	/* biggest power of two that fits Ether frame */
 #define NFS_MAX_ATTRS	26
 
+/*
+ * Largest NFSv3 read for which the reply fits in a reassembled IP datagram:
+ * RPC reply header, status, attributes, count, EOF flag and data length.
+ * The read size is asked from the server with FSINFO and rounded down to a
+ * power of two no larger than this.
+ */
+#define NFS3_READ_OVERHEAD	((6 + 1 + 22 + 3) * sizeof(uint32_t))
+#define NFS3_MAX_READ_SIZE	(CONFIG_NET_MAXDEFRAG - IP_UDP_HDR_SIZE - \
+				 NFS3_READ_OVERHEAD)
+
 /* Values for Accept State flag on RPC answers (See: rfc1831) */
 enum rpc_accept_stat {
 	NFS_RPC_SUCCESS = 0,	/* RPC executed successfully */
@@ -0,0 +1,628 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Minimal TCP client
+ *
+ * This is just enough TCP to download a file quickly: one connection at a
+ * time, window scaling so that the peer can keep a useful amount of data in
+ * flight, and out-of-order reception so that a lost segment only costs one
+ * retransmission. Without SACK the peer learns about a lost segment from
+ * the duplicate ACKs we send for every segment past the hole, which triggers
+ * its fast retransmit. Our own (small) output is resent from the oldest
+ * unacknowledged byte after a timeout or three duplicate ACKs.
+ *
+ * Received data is passed to the caller with its offset in the stream, so
+ * it does not need to be buffered here. Only the ranges received past a
+ * hole are remembered, so that the ACK can jump forward once the hole is
+ * filled.
+ */
+
+#include <common.h>
+#include <net.h>
+#include <net/tcp.h>
+#include <asm/unaligned.h>
+
+/* Interval of the net_loop() timer that drives everything below */
+#define TCP_TICK_MS		100
+/* Initial and largest retransmission timeouts */
+#define TCP_RTO_MIN_MS		1000
+#define TCP_RTO_MAX_MS		16000
+/* Give up after sending the same data this many more times */
+#define TCP_RETRIES		8
+/* Give up if nothing is received for this long */
+#define TCP_IDLE_TIMEOUT_MS	60000
+/* Number of duplicate ACKs that make us resend */
+#define TCP_DUP_ACKS		3
+/* Number of ranges past a hole that are remembered */
+#define TCP_OOO_MAX		32
+/* Largest amount of unacknowledged data we can send */
+#define TCP_TX_BUF_SIZE		2048
+/* MSS to assume if the peer does not send one */
+#define TCP_DEFAULT_MSS		536
+/* Largest window-scale shift (RFC 7323) */
+#define TCP_MAX_WSCALE		14
+
+/* TCP options */
+#define TCPOPT_EOL		0
+#define TCPOPT_NOP		1
+#define TCPOPT_MSS		2
+#define TCPOPT_WSCALE		3
+/* MSS (4 bytes), NOP (1 byte) and window scale (3 bytes) */
+#define TCP_SYN_OPT_LEN		8
+
+enum tcp_state {
+	TCP_CLOSED,
+	TCP_SYN_SENT,
+	TCP_ESTABLISHED,	/* Also used while either side is closing */
+};
+
+/* A range of sequence numbers, @end being the first one not included */
+struct tcp_range {
+	u32 start;
+	u32 end;
+};
+
+/**
+ * struct tcp_conn - State of the connection
+ *
+ * @state: Connection state
+ * @ip: Peer IP address
+ * @ethaddr: Peer (or gateway) Ethernet address, found by ARP
+ * @dport: Peer port
+ * @sport: Our port
+ * @rx: Handler for received data
+ * @event: Handler for connection events
+ * @snd_una: First sequence number not acknowledged by the peer
+ * @snd_nxt: Next sequence number to send
+ * @snd_wnd: Peer's receive window in bytes
+ * @snd_wscale: Shift to apply to window values from the peer
+ * @mss: Largest segment the peer accepts
+ * @tx_buf: Data from @snd_una onwards (not including any FIN)
+ * @tx_len: Number of bytes in @tx_buf
+ * @fin_queued: true if tcp_close() has been called
+ * @fin_sent: true if @snd_nxt includes our FIN
+ * @fin_acked: true if the peer has acknowledged our FIN
+ * @dup_acks: Number of duplicate ACKs received in a row
+ * @rtx_start: Time (ms) at which the retransmission timer was started
+ * @rto: Current retransmission timeout (ms)
+ * @retries: Number of retransmissions of the data at @snd_una
+ * @irs: Peer's initial sequence number
+ * @rcv_nxt: Next sequence number we expect
+ * @rcv_wnd: Receive window we offer in bytes
+ * @rcv_wscale: Shift we apply to the window values we send
+ * @ooo: Ranges received past @rcv_nxt, sorted and not touching
+ * @ooo_cnt: Number of ranges in @ooo
+ * @peer_fin: true if the peer's FIN has been seen
+ * @peer_fin_seq: Sequence number of the peer's FIN
+ * @peer_closed: true if all data up to the peer's FIN has been received
+ * @unacked_segs: Number of segments received since we last sent an ACK
+ * @ack_now: true to send an ACK as soon as possible
+ * @rx_time: Time (ms) at which a segment was last received
+ */
+struct tcp_conn {
+	enum tcp_state state;
+	struct in_addr ip;
+	uchar ethaddr[ARP_HLEN];
+	int dport;
+	int sport;
+	tcp_rxhand_f *rx;
+	tcp_evhand_f *event;
+
+	u32 snd_una;
+	u32 snd_nxt;
+	u32 snd_wnd;
+	uint snd_wscale;
+	uint mss;
+	uchar tx_buf[TCP_TX_BUF_SIZE];
+	uint tx_len;
+	bool fin_queued;
+	bool fin_sent;
+	bool fin_acked;
+	int dup_acks;
+	ulong rtx_start;
+	ulong rto;
+	int retries;
+
+	u32 irs;
+	u32 rcv_nxt;
+	u32 rcv_wnd;
+	uint rcv_wscale;
+	struct tcp_range ooo[TCP_OOO_MAX];
+	int ooo_cnt;
+	bool peer_fin;
+	u32 peer_fin_seq;
+	bool peer_closed;
+	int unacked_segs;
+	bool ack_now;
+	ulong rx_time;
+};
+
+static struct tcp_conn conn;
+
+static inline bool tcp_seq_before(u32 a, u32 b)
+{
+	return (s32)(a - b) < 0;
+}
+
+static inline bool tcp_seq_after(u32 a, u32 b)
+{
+	return (s32)(b - a) < 0;
+}
+
+/* Compute the checksum of a segment, including the IP pseudo-header */
+static uint tcp_checksum(struct ip_tcp_hdr *ip, uint tcp_len)
+{
+	struct {
+		struct in_addr src;
+		struct in_addr dst;
+		u8 zero;
+		u8 proto;
+		u16 len;
+	} __packed pseudo;
+	uint sum;
+
+	net_copy_ip(&pseudo.src, &ip->ip_src);
+	net_copy_ip(&pseudo.dst, &ip->ip_dst);
+	pseudo.zero = 0;
+	pseudo.proto = IPPROTO_TCP;
+	pseudo.len = htons(tcp_len);
+	sum = compute_ip_checksum(&pseudo, sizeof(pseudo));
+
+	return add_ip_checksums(sizeof(pseudo), sum,
+				compute_ip_checksum(&ip->tcp_src, tcp_len));
+}
+
+int tcp_set_tcp_header(uchar *pkt, struct in_addr dest, int dport, int sport,
+		       int payload_len, u8 action, u32 tcp_seq_num,
+		       u32 tcp_ack_num)
+{
+	struct ip_tcp_hdr *ip = (struct ip_tcp_hdr *)pkt;
+	uchar *opt = pkt + IP_TCP_HDR_SIZE;
+	int hdr_len = IP_TCP_HDR_SIZE;
+	u32 win;
+
+	if (action & TCP_SYN) {
+		opt[0] = TCPOPT_MSS;
+		opt[1] = 4;
+		put_unaligned_be16(TCP_MSS, opt + 2);
+		opt[4] = TCPOPT_NOP;
+		opt[5] = TCPOPT_WSCALE;
+		opt[6] = 3;
+		opt[7] = conn.rcv_wscale;
+		hdr_len += TCP_SYN_OPT_LEN;
+		/* The window in a SYN is never scaled */
+		win = min_t(u32, conn.rcv_wnd, 0xffff);
+	} else {
+		win = conn.rcv_wnd >> conn.rcv_wscale;
+	}
+
+	net_set_ip_header(pkt, dest, net_ip, hdr_len + payload_len,
+			  IPPROTO_TCP);
+
+	ip->tcp_src = htons(sport);
+	ip->tcp_dst = htons(dport);
+	ip->tcp_seq = htonl(tcp_seq_num);
+	ip->tcp_ack = htonl(tcp_ack_num);
+	ip->tcp_hlen = (hdr_len - IP_HDR_SIZE) << 2;
+	ip->tcp_flags = action;
+	ip->tcp_win = htons(win);
+	ip->tcp_urg = 0;
+	ip->tcp_xsum = 0;
+	ip->tcp_xsum = tcp_checksum(ip, hdr_len - IP_HDR_SIZE + payload_len);
+
+	return hdr_len;
+}
+
+static void tcp_send_segment(u8 flags, u32 seq, const uchar *data, uint len)
+{
+	uchar *pkt = net_tx_packet + net_eth_hdr_size() + IP_TCP_HDR_SIZE;
+
+	if (len)
+		memcpy(pkt, data, len);
+	if (flags & TCP_ACK) {
+		conn.unacked_segs = 0;
+		conn.ack_now = false;
+	}
+	net_send_ip_packet(conn.ethaddr, conn.ip, conn.dport, conn.sport, len,
+			   IPPROTO_TCP, flags, seq, conn.rcv_nxt);
+}
+
+static void tcp_send_ack(void)
+{
+	tcp_send_segment(TCP_ACK, conn.snd_nxt, NULL, 0);
+}
+
+/* Send whatever the peer's window allows; returns true if anything went */
+static bool tcp_output(void)
+{
+	bool idle = conn.snd_una == conn.snd_nxt;
+	bool sent = false;
+	uint off, len;
+
+	for (;;) {
+		off = conn.snd_nxt - conn.snd_una;
+		if (conn.fin_sent || off >= conn.tx_len || off >= conn.snd_wnd)
+			break;
+		len = min(conn.tx_len - off, conn.mss);
+		len = min(len, conn.snd_wnd - off);
+		tcp_send_segment(TCP_ACK | TCP_PSH, conn.snd_nxt,
+				 conn.tx_buf + off, len);
+		conn.snd_nxt += len;
+		sent = true;
+	}
+	if (conn.fin_queued && !conn.fin_sent &&
+	    conn.snd_nxt - conn.snd_una == conn.tx_len) {
+		tcp_send_segment(TCP_ACK | TCP_FIN, conn.snd_nxt, NULL, 0);
+		conn.snd_nxt++;
+		conn.fin_sent = true;
+		sent = true;
+	}
+	if (sent && idle)
+		conn.rtx_start = get_timer(0);
+
+	return sent;
+}
+
+/* Resend everything from the oldest unacknowledged byte */
+static void tcp_retransmit(void)
+{
+	if (conn.state == TCP_SYN_SENT) {
+		tcp_send_segment(TCP_SYN, conn.snd_una, NULL, 0);
+		return;
+	}
+	conn.snd_nxt = conn.snd_una;
+	conn.fin_sent = false;
+	if (!tcp_output())
+		tcp_send_ack();
+}
+
+static void tcp_fail(void)
+{
+	conn.state = TCP_CLOSED;
+	conn.event(TCP_EV_RESET);
+}
+
+static void tcp_timeout_handler(void)
+{
+	if (conn.state == TCP_CLOSED)
+		return;
+	net_set_timeout_handler(TCP_TICK_MS, tcp_timeout_handler);
+
+	if (conn.snd_una != conn.snd_nxt &&
+	    get_timer(conn.rtx_start) > conn.rto) {
+		if (++conn.retries > TCP_RETRIES) {
+			puts("\nTCP: retransmission timeout\n");
+			tcp_fail();
+			return;
+		}
+		conn.rto = min_t(ulong, conn.rto * 2, TCP_RTO_MAX_MS);
+		conn.rtx_start = get_timer(0);
+		tcp_retransmit();
+		return;
+	}
+	if (get_timer(conn.rx_time) > TCP_IDLE_TIMEOUT_MS) {
+		puts("\nTCP: connection timed out\n");
+		tcp_fail();
+		return;
+	}
+	if (conn.unacked_segs)
+		tcp_send_ack();
+}
+
+int tcp_connect(struct in_addr dest, int dport, tcp_rxhand_f *rx,
+		tcp_evhand_f *event)
+{
+	u32 iss = get_ticks();
+
+	memset(&conn, '\0', sizeof(conn));
+	conn.ip = dest;
+	conn.dport = dport;
+	conn.sport = random_port();
+	conn.rx = rx;
+	conn.event = event;
+	conn.mss = TCP_DEFAULT_MSS;
+	conn.rcv_wnd = CONFIG_TCP_WINDOW_SIZE;
+	while (conn.rcv_wscale < TCP_MAX_WSCALE &&
+	       conn.rcv_wnd >> conn.rcv_wscale > 0xffff)
+		conn.rcv_wscale++;
+	conn.snd_una = iss;
+	conn.snd_nxt = iss + 1;
+	conn.rto = TCP_RTO_MIN_MS;
+	conn.rtx_start = get_timer(0);
+	conn.rx_time = conn.rtx_start;
+	conn.state = TCP_SYN_SENT;
+
+	debug("%s: %pI4:%d from port %d\n", __func__, &dest, dport,
+	      conn.sport);
+	net_set_timeout_handler(TCP_TICK_MS, tcp_timeout_handler);
+	tcp_send_segment(TCP_SYN, iss, NULL, 0);
+
+	return 0;
+}
+
+int tcp_send(const void *data, uint len)
+{
+	if (conn.state != TCP_ESTABLISHED || conn.fin_queued)
+		return -ENOTCONN;
+	if (conn.tx_len + len > sizeof(conn.tx_buf))
+		return -ENOSPC;
+	memcpy(conn.tx_buf + conn.tx_len, data, len);
+	conn.tx_len += len;
+	tcp_output();
+
+	return 0;
+}
+
+void tcp_close(void)
+{
+	if (conn.state != TCP_ESTABLISHED || conn.fin_queued)
+		return;
+	conn.fin_queued = true;
+	tcp_output();
+	/*
+	 * If the peer has closed already there is nothing left to wait for,
+	 * other than the ACK of our FIN. A peer that misses it times out.
+	 */
+	if (conn.peer_closed)
+		conn.state = TCP_CLOSED;
+}
+
+void tcp_abort(void)
+{
+	if (conn.state == TCP_ESTABLISHED)
+		tcp_send_segment(TCP_RST | TCP_ACK, conn.snd_nxt, NULL, 0);
+	conn.state = TCP_CLOSED;
+}
+
+static void tcp_parse_syn_options(const uchar *opt, int len)
+{
+	bool wscale = false;
+
+	while (len > 0 && *opt != TCPOPT_EOL) {
+		if (*opt == TCPOPT_NOP) {
+			opt++;
+			len--;
+			continue;
+		}
+		if (len < 2 || opt[1] < 2 || opt[1] > len)
+			break;
+		if (*opt == TCPOPT_MSS && opt[1] == 4) {
+			conn.mss = get_unaligned_be16(opt + 2);
+		} else if (*opt == TCPOPT_WSCALE && opt[1] == 3) {
+			conn.snd_wscale = min(opt[2], (uchar)TCP_MAX_WSCALE);
+			wscale = true;
+		}
+		len -= opt[1];
+		opt += opt[1];
+	}
+
+	/* Window scaling is only used if both sides ask for it */
+	if (!wscale) {
+		conn.snd_wscale = 0;
+		conn.rcv_wscale = 0;
+		conn.rcv_wnd = min_t(u32, conn.rcv_wnd, 0xffff);
+	}
+	conn.mss = clamp_t(uint, conn.mss, 64, TCP_MSS);
+}
+
+static void tcp_ack_rcvd(u32 ack, u32 wnd, bool has_data)
+{
+	u32 acked;
+
+	if (tcp_seq_after(ack, conn.snd_nxt)) {
+		/* This acknowledges something we never sent */
+		conn.ack_now = true;
+		return;
+	}
+	if (tcp_seq_after(ack, conn.snd_una)) {
+		acked = ack - conn.snd_una;
+		if (conn.fin_sent && ack == conn.snd_nxt) {
+			conn.fin_acked = true;
+			acked--;
+		}
+		conn.tx_len -= acked;
+		memmove(conn.tx_buf, conn.tx_buf + acked, conn.tx_len);
+		conn.snd_una = ack;
+		conn.dup_acks = 0;
+		conn.retries = 0;
+		conn.rto = TCP_RTO_MIN_MS;
+		conn.rtx_start = get_timer(0);
+	} else if (ack == conn.snd_una && conn.snd_una != conn.snd_nxt &&
+		   !has_data && wnd == conn.snd_wnd) {
+		if (++conn.dup_acks == TCP_DUP_ACKS) {
+			debug("%s: fast retransmit at %u\n", __func__, ack);
+			conn.snd_nxt = conn.snd_una;
+			conn.fin_sent = false;
+		}
+	}
+	conn.snd_wnd = wnd;
+}
+
+/* Note a range received past a hole, merging it with its neighbours */
+static void tcp_ooo_add(u32 start, u32 end)
+{
+	struct tcp_range *r;
+	int i, j;
+
+	for (i = 0; i < conn.ooo_cnt; i++) {
+		if (!tcp_seq_before(conn.ooo[i].end, start))
+			break;
+	}
+	if (i < conn.ooo_cnt && !tcp_seq_after(conn.ooo[i].start, end)) {
+		/* Overlaps or touches range i, and maybe the ones after it */
+		r = &conn.ooo[i];
+		if (tcp_seq_before(start, r->start))
+			r->start = start;
+		for (j = i + 1; j < conn.ooo_cnt &&
+		     !tcp_seq_after(conn.ooo[j].start, end); j++)
+			;
+		if (tcp_seq_after(conn.ooo[j - 1].end, end))
+			end = conn.ooo[j - 1].end;
+		if (tcp_seq_after(end, r->end))
+			r->end = end;
+		memmove(r + 1, &conn.ooo[j],
+			(conn.ooo_cnt - j) * sizeof(*r));
+		conn.ooo_cnt -= j - i - 1;
+		return;
+	}
+	/* If there is no room the data will just be received again */
+	if (conn.ooo_cnt == TCP_OOO_MAX)
+		return;
+	r = &conn.ooo[i];
+	memmove(r + 1, r, (conn.ooo_cnt - i) * sizeof(*r));
+	r->start = start;
+	r->end = end;
+	conn.ooo_cnt++;
+}
+
+/* Move rcv_nxt past any ranges that are now in order */
+static bool tcp_ooo_advance(void)
+{
+	bool moved = false;
+
+	while (conn.ooo_cnt &&
+	       !tcp_seq_after(conn.ooo[0].start, conn.rcv_nxt)) {
+		if (tcp_seq_after(conn.ooo[0].end, conn.rcv_nxt))
+			conn.rcv_nxt = conn.ooo[0].end;
+		conn.ooo_cnt--;
+		memmove(conn.ooo, conn.ooo + 1,
+			conn.ooo_cnt * sizeof(conn.ooo[0]));
+		moved = true;
+	}
+
+	return moved;
+}
+
+static void tcp_data_rcvd(u32 seq, const uchar *data, uint len, bool push)
+{
+	u32 end = seq + len;
+	u32 wnd_end = conn.rcv_nxt + conn.rcv_wnd;
+
+	/* Drop anything we already have or that is outside our window */
+	if (tcp_seq_before(seq, conn.rcv_nxt)) {
+		data += conn.rcv_nxt - seq;
+		seq = conn.rcv_nxt;
+	}
+	if (tcp_seq_after(end, wnd_end))
+		end = wnd_end;
+	if (!tcp_seq_after(end, seq)) {
+		conn.ack_now = true;
+		return;
+	}
+	len = end - seq;
+
+	if (conn.rx(seq - conn.irs - 1, data, len))
+		return;
+
+	if (seq == conn.rcv_nxt) {
+		conn.rcv_nxt = end;
+		/* ACK at once when a hole is filled, else every other one */
+		if (tcp_ooo_advance() || push || ++conn.unacked_segs >= 2)
+			conn.ack_now = true;
+	} else {
+		/* A duplicate ACK tells the peer that something was lost */
+		tcp_ooo_add(seq, end);
+		conn.ack_now = true;
+	}
+}
+
+static void tcp_fin_rcvd(u32 fin_seq)
+{
+	if (conn.peer_closed) {
+		/* The peer did not see our ACK of its FIN */
+		conn.ack_now = true;
+		return;
+	}
+	if (tcp_seq_before(fin_seq, conn.rcv_nxt) ||
+	    tcp_seq_after(fin_seq, conn.rcv_nxt + conn.rcv_wnd))
+		return;
+	conn.peer_fin = true;
+	conn.peer_fin_seq = fin_seq;
+}
+
+void tcp_receive(struct ip_tcp_hdr *ip, int len)
+{
+	struct in_addr src;
+	uint hlen, plen;
+	uchar *data;
+	u32 seq, ack;
+	u8 flags;
+
+	if (conn.state == TCP_CLOSED || len < IP_TCP_HDR_SIZE)
+		return;
+	hlen = (ip->tcp_hlen >> 4) * 4;
+	if (hlen < TCP_HDR_SIZE || IP_HDR_SIZE + hlen > len)
+		return;
+	src = net_read_ip(&ip->ip_src);
+	if (src.s_addr != conn.ip.s_addr ||
+	    ntohs(ip->tcp_src) != conn.dport ||
+	    ntohs(ip->tcp_dst) != conn.sport)
+		return;
+	if (tcp_checksum(ip, len - IP_HDR_SIZE)) {
+		debug("%s: bad checksum\n", __func__);
+		return;
+	}
+
+	seq = ntohl(ip->tcp_seq);
+	ack = ntohl(ip->tcp_ack);
+	flags = ip->tcp_flags;
+	data = (uchar *)ip + IP_HDR_SIZE + hlen;
+	plen = len - IP_HDR_SIZE - hlen;
+	conn.rx_time = get_timer(0);
+
+	if (flags & TCP_RST) {
+		if (conn.state == TCP_SYN_SENT ?
+		    (flags & TCP_ACK) && ack == conn.snd_nxt :
+		    !tcp_seq_before(seq, conn.rcv_nxt) &&
+		    tcp_seq_before(seq, conn.rcv_nxt + conn.rcv_wnd)) {
+			debug("%s: connection reset\n", __func__);
+			tcp_fail();
+		}
+		return;
+	}
+
+	if (conn.state == TCP_SYN_SENT) {
+		if (!(flags & TCP_SYN) || !(flags & TCP_ACK) ||
+		    ack != conn.snd_nxt)
+			return;
+		tcp_parse_syn_options((uchar *)ip + IP_TCP_HDR_SIZE,
+				      hlen - TCP_HDR_SIZE);
+		conn.irs = seq;
+		conn.rcv_nxt = seq + 1;
+		conn.snd_una = ack;
+		conn.snd_wnd = ntohs(ip->tcp_win);
+		conn.retries = 0;
+		conn.rto = TCP_RTO_MIN_MS;
+		conn.state = TCP_ESTABLISHED;
+		conn.ack_now = true;
+		debug("%s: connected, mss %u, wscale %u/%u\n", __func__,
+		      conn.mss, conn.snd_wscale, conn.rcv_wscale);
+		conn.event(TCP_EV_CONNECTED);
+	} else if (flags & TCP_SYN) {
+		/* A repeated SYN-ACK: the peer did not see our ACK */
+		conn.ack_now = true;
+	} else if (flags & TCP_ACK) {
+		tcp_ack_rcvd(ack, ntohs(ip->tcp_win) << conn.snd_wscale,
+			     plen || (flags & TCP_FIN));
+		if (plen)
+			tcp_data_rcvd(seq, data, plen, flags & TCP_PSH);
+		if (flags & TCP_FIN)
+			tcp_fin_rcvd(seq + plen);
+		if (conn.state == TCP_CLOSED)
+			return;
+		if (conn.peer_fin && !conn.peer_closed &&
+		    conn.rcv_nxt == conn.peer_fin_seq) {
+			conn.rcv_nxt++;
+			conn.peer_closed = true;
+			conn.ack_now = true;
+			conn.event(TCP_EV_CLOSED);
+		}
+	}
+	if (conn.state == TCP_CLOSED)
+		return;
+
+	tcp_output();
+	if (conn.ack_now)
+		tcp_send_ack();
+	if (conn.peer_closed && conn.fin_acked)
+		conn.state = TCP_CLOSED;
+}
@@ -0,0 +1,330 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * HTTP download over TCP
+ *
+ * This sends a single HTTP/1.1 GET request and stores the body of the
+ * response at the load address. Each segment is copied straight to its
+ * place in the file as it arrives, including those that arrive out of
+ * order, so the transfer runs at whatever rate TCP manages. The server is
+ * asked to close the connection after the response, which marks the end of
+ * the file.
+ */
+
+#include <common.h>
+#include <command.h>
+#include <env.h>
+#include <image.h>
+#include <lmb.h>
+#include <mapmem.h>
+#include <net.h>
+#include <net/tcp.h>
+#include <net/wget.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+#define HASHES_PER_LINE		65	/* Number of "loading" hashes per line */
+#define WGET_HASH_BYTES		(64 << 10)	/* Bytes per hash */
+#define WGET_HDR_MAX		2048	/* Largest response header we accept */
+#define HTTP_PORT		80
+
+static struct in_addr wget_server_ip;
+static int wget_server_port;
+static char wget_path[1024];
+
+/* Response header received so far, until the end of it is seen */
+static char wget_hdr[WGET_HDR_MAX + 1];
+static uint wget_hdr_len;
+/* Offset of the body in the stream, or 0 if the header is not complete */
+static ulong wget_body_start;
+/* Length of the body given by the server, or -1 if unknown */
+static long wget_content_len;
+
+static ulong wget_load_addr;
+#ifdef CONFIG_LMB
+static ulong wget_load_size;
+#endif
+static ulong wget_hash_next;
+static int wget_hash_count;
+static ulong wget_time_start;
+
+static void wget_fail(void)
+{
+	tcp_abort();
+	net_set_state(NETLOOP_FAIL);
+}
+
+static int wget_store(ulong offset, const uchar *data, uint len)
+{
+	ulong end = offset + len;
+	void *ptr;
+
+	if (wget_content_len >= 0 && end > wget_content_len) {
+		if (offset >= wget_content_len)
+			return 0;
+		len = wget_content_len - offset;
+		end = wget_content_len;
+	}
+#ifdef CONFIG_LMB
+	if (wget_load_size && end > wget_load_size) {
+		puts("\nwget error: ");
+		puts("trying to overwrite reserved memory...\n");
+		wget_fail();
+		return -ENOSPC;
+	}
+#endif
+	ptr = map_sysmem(wget_load_addr + offset, len);
+	memcpy(ptr, data, len);
+	unmap_sysmem(ptr);
+
+	if (net_boot_file_size < end)
+		net_boot_file_size = end;
+	while (net_boot_file_size >= wget_hash_next) {
+		putc('#');
+		if (++wget_hash_count % HASHES_PER_LINE == 0)
+			puts("\n\t ");
+		wget_hash_next += WGET_HASH_BYTES;
+	}
+
+	return 0;
+}
+
+/* Check the status line and pick out the headers we care about */
+static int wget_parse_header(void)
+{
+	char *line, *next, *val;
+	ulong status;
+
+	if (strncmp(wget_hdr, "HTTP/1.", 7) || wget_hdr[8] != ' ') {
+		puts("\nwget error: bad response from server\n");
+		return -EPROTO;
+	}
+	status = simple_strtoul(wget_hdr + 9, NULL, 10);
+	if (status != 200) {
+		next = strstr(wget_hdr, "\r\n");
+		*next = '\0';
+		printf("\nwget error: %s\n", wget_hdr + 9);
+		return -ENOENT;
+	}
+
+	wget_content_len = -1;
+	for (line = strstr(wget_hdr, "\r\n") + 2; *line != '\r'; line = next) {
+		next = strstr(line, "\r\n");
+		*next = '\0';
+		next += 2;
+		val = strchr(line, ':');
+		if (!val)
+			continue;
+		for (val++; *val == ' ' || *val == '\t'; val++)
+			;
+		if (!strncasecmp(line, "Content-Length:", 15)) {
+			wget_content_len = simple_strtoul(val, NULL, 10);
+		} else if (!strncasecmp(line, "Transfer-Encoding:", 18) &&
+			   strcasecmp(val, "identity")) {
+			printf("\nwget error: unsupported transfer encoding '%s'\n",
+			       val);
+			return -EPROTONOSUPPORT;
+		}
+	}
+#ifdef CONFIG_LMB
+	if (wget_load_size && wget_content_len > (long)wget_load_size) {
+		puts("\nwget error: ");
+		puts("trying to overwrite reserved memory...\n");
+		return -E2BIG;
+	}
+#endif
+
+	return 0;
+}
+
+static int wget_rx(ulong offset, const uchar *data, uint len)
+{
+	uint n, skip;
+	char *end;
+
+	if (wget_body_start)
+		return wget_store(offset - wget_body_start, data, len);
+
+	/* Collect the header in order; anything beyond it comes again later */
+	if (offset != wget_hdr_len)
+		return -EAGAIN;
+	n = min(len, WGET_HDR_MAX - wget_hdr_len);
+	memcpy(wget_hdr + wget_hdr_len, data, n);
+	wget_hdr_len += n;
+	wget_hdr[wget_hdr_len] = '\0';
+
+	end = strstr(wget_hdr, "\r\n\r\n");
+	if (!end) {
+		if (wget_hdr_len == WGET_HDR_MAX) {
+			puts("\nwget error: response header too long\n");
+			wget_fail();
+			return -E2BIG;
+		}
+		return 0;
+	}
+	wget_body_start = end + 4 - wget_hdr;
+	if (wget_parse_header()) {
+		wget_fail();
+		return -EINVAL;
+	}
+
+	/* Store the start of the body if it came with the header */
+	skip = wget_body_start - offset;
+	if (len > skip)
+		return wget_store(0, data + skip, len - skip);
+
+	return 0;
+}
+
+static void wget_send_request(void)
+{
+	char req[sizeof(wget_path) + 256];
+	char host[32];
+	int len;
+
+	if (wget_server_port == HTTP_PORT)
+		sprintf(host, "%pI4", &wget_server_ip);
+	else
+		sprintf(host, "%pI4:%d", &wget_server_ip, wget_server_port);
+	len = snprintf(req, sizeof(req),
+		       "GET %s HTTP/1.1\r\n"
+		       "Host: %s\r\n"
+		       "User-Agent: U-Boot\r\n"
+		       "Accept: */*\r\n"
+		       "Connection: close\r\n"
+		       "\r\n", wget_path, host);
+	if (tcp_send(req, len)) {
+		puts("\nwget error: cannot send request\n");
+		wget_fail();
+	}
+}
+
+static void wget_complete(void)
+{
+	ulong time = get_timer(wget_time_start);
+
+	if (!wget_body_start) {
+		puts("\nwget error: no response from server\n");
+		net_set_state(NETLOOP_FAIL);
+		return;
+	}
+	if (wget_content_len >= 0 && net_boot_file_size != wget_content_len) {
+		printf("\nwget error: received %u of %ld bytes\n",
+		       net_boot_file_size, wget_content_len);
+		net_set_state(NETLOOP_FAIL);
+		return;
+	}
+	if (time > 0) {
+		puts("\n\t ");	/* Line up with "Loading: " */
+		print_size(net_boot_file_size / time * 1000, "/s");
+	}
+	puts("\ndone\n");
+	net_set_state(NETLOOP_SUCCESS);
+}
+
+static void wget_event(enum tcp_event event)
+{
+	switch (event) {
+	case TCP_EV_CONNECTED:
+		wget_send_request();
+		break;
+	case TCP_EV_CLOSED:
+		tcp_close();
+		wget_complete();
+		break;
+	case TCP_EV_RESET:
+		puts("\nwget error: connection lost\n");
+		net_set_state(NETLOOP_FAIL);
+		break;
+	}
+}
+
+/* Split net_boot_file_name into server, port and path */
+static int wget_parse_url(void)
+{
+	const char *name = net_boot_file_name;
+	const char *path, *colon;
+
+	wget_server_ip = net_server_ip;
+	wget_server_port = HTTP_PORT;
+
+	if (!strncmp(name, "http://", 7)) {
+		name += 7;
+		wget_server_ip = string_to_ip(name);
+		path = strchr(name, '/');
+		colon = strchr(name, ':');
+		if (colon && (!path || colon < path))
+			wget_server_port = simple_strtoul(colon + 1, NULL, 10);
+		if (!path)
+			path = "/";
+	} else {
+		colon = strchr(name, ':');
+		if (colon) {
+			wget_server_ip = string_to_ip(name);
+			name = colon + 1;
+		}
+		path = name;
+	}
+	if (!*path) {
+		puts("*** ERROR: no file name given\n");
+		return -EINVAL;
+	}
+	if (!wget_server_ip.s_addr || !wget_server_port) {
+		printf("*** ERROR: bad server address in '%s'\n",
+		       net_boot_file_name);
+		return -EINVAL;
+	}
+	snprintf(wget_path, sizeof(wget_path), "%s%s",
+		 *path == '/' ? "" : "/", path);
+
+	return 0;
+}
+
+/* Initialize wget_load_addr and wget_load_size from image_load_addr and lmb */
+static int wget_init_load_addr(void)
+{
+#ifdef CONFIG_LMB
+	struct lmb lmb;
+	phys_size_t max_size;
+
+	lmb_init_and_reserve(&lmb, gd->bd, (void *)gd->fdt_blob);
+
+	max_size = lmb_get_free_size(&lmb, image_load_addr);
+	lmb_uninit(&lmb);
+	if (!max_size)
+		return -1;
+
+	wget_load_size = max_size;
+#endif
+	wget_load_addr = image_load_addr;
+	return 0;
+}
+
+void wget_start(void)
+{
+	if (wget_parse_url()) {
+		net_set_state(NETLOOP_FAIL);
+		return;
+	}
+	if (wget_init_load_addr()) {
+		eth_halt();
+		net_set_state(NETLOOP_FAIL);
+		puts("\nwget error: ");
+		puts("trying to overwrite reserved memory...\n");
+		return;
+	}
+
+	printf("Using %s device\n", eth_get_name());
+	printf("HTTP from server %pI4; our IP address is %pI4\n",
+	       &wget_server_ip, &net_ip);
+	printf("Filename '%s'.", wget_path);
+	printf("\nLoad address: 0x%lx\nLoading: *\b", image_load_addr);
+
+	wget_hdr_len = 0;
+	wget_body_start = 0;
+	wget_content_len = -1;
+	wget_hash_next = WGET_HASH_BYTES;
+	wget_hash_count = 0;
+	wget_time_start = get_timer(0);
+
+	tcp_connect(wget_server_ip, wget_server_port, wget_rx, wget_event);
+}
@@ -31,6 +31,9 @@ int cmd_ut_category(const char *name, const char *prefix,
 
 		if (argc > 1 && strcmp(argv[1], test_name))
 			continue;
+		/* Manual tests are only run when given by name */
+		if (argc == 1 && (test->flags & UT_TESTF_MANUAL))
+			continue;
 		printf("Test: %s\n", test->name);
 
 		uts.start = mallinfo();
@@ -7,6 +7,7 @@
 #include <bootm.h>
 #include <command.h>
 #include <gzip.h>
+#include <hexdump.h>
 #include <lz4.h>
 #include <malloc.h>
 #include <mapmem.h>
@@ -534,6 +535,68 @@ static int compression_test_bootm_none(struct unit_test_state *uts)
 }
 COMPRESSION_TEST(compression_test_bootm_none, 0);
 
+/* Feed gzip data to the streaming decompressor in pieces of size @step */
+static int gunzip_stream_pieces(struct unit_test_state *uts, void *in,
+				ulong in_size, void *out, ulong out_max,
+				ulong step, ulong *out_size)
+{
+	struct gunzip_stream *gz;
+	ulong ofs;
+	int ret = 0;
+
+	gz = gunzip_stream_start(out, out_max);
+	ut_assertnonnull(gz);
+	for (ofs = 0; ofs < in_size && !ret; ofs += step)
+		ret = gunzip_stream_feed(gz, in + ofs,
+					 min(step, in_size - ofs));
+	if (ret < 0) {
+		gunzip_stream_finish(gz, out_size);
+		return ret;
+	}
+
+	return gunzip_stream_finish(gz, out_size);
+}
+
+static int compression_test_gzip_stream(struct unit_test_state *uts)
+{
+	const ulong plain_size = strlen(plain);
+	ulong comp_size = TEST_BUFFER_SIZE;
+	static const ulong steps[] = { 1, 2, 7, 64, TEST_BUFFER_SIZE };
+	char comp[TEST_BUFFER_SIZE];
+	char out[TEST_BUFFER_SIZE];
+	ulong out_size;
+	int i;
+
+	ut_assertok(gzip(comp, &comp_size, (void *)plain, plain_size));
+
+	for (i = 0; i < ARRAY_SIZE(steps); i++) {
+		memset(out, '\0', sizeof(out));
+		ut_assertok(gunzip_stream_pieces(uts, comp, comp_size, out,
+						 sizeof(out), steps[i],
+						 &out_size));
+		ut_asserteq(plain_size, out_size);
+		ut_asserteq_mem(plain, out, plain_size);
+	}
+
+	/* output buffer too small */
+	ut_asserteq(-ENOSPC, gunzip_stream_pieces(uts, comp, comp_size, out,
+						  plain_size - 1, 16,
+						  &out_size));
+
+	/* truncated input */
+	ut_asserteq(-EINVAL, gunzip_stream_pieces(uts, comp, comp_size - 1,
+						  out, sizeof(out), 16,
+						  &out_size));
+
+	/* corrupt CRC in the trailer */
+	comp[comp_size - 8] ^= 0xff;
+	ut_asserteq(-EINVAL, gunzip_stream_pieces(uts, comp, comp_size, out,
+						  sizeof(out), 16, &out_size));
+
+	return 0;
+}
+COMPRESSION_TEST(compression_test_gzip_stream, 0);
+
 int do_ut_compression(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 {
 	struct unit_test *tests = ll_entry_start(struct unit_test,
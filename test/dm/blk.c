@@ -7,6 +7,7 @@
 #include <dm.h>
 #include <usb.h>
 #include <asm/state.h>
+#include <dm/device-internal.h>
 #include <dm/test.h>
 #include <test/ut.h>
 
@@ -162,3 +163,252 @@ static int dm_test_blk_get_from_parent(struct unit_test_state *uts)
 	return 0;
 }
 DM_TEST(dm_test_blk_get_from_parent, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+
+/* Test that the block cache serves partial hits and evicts by size */
+static int dm_test_blk_cache(struct unit_test_state *uts)
+{
+	struct block_cache_stats stats;
+	char buf[16 * 512], data[16 * 512];
+	int i;
+
+	for (i = 0; i < sizeof(data); i++)
+		data[i] = i / 512 + 1;
+
+	/* Two pages of eight 512-byte blocks */
+	blkcache_configure(16, 2 * 8 * 512);
+	blkcache_stats(&stats);
+	ut_asserteq(0, stats.entries);
+
+	/* Nothing is cached yet */
+	ut_asserteq(0, blkcache_read(IF_TYPE_HOST, 0, 4, 8, 512, buf));
+	ut_asserteq(8, blkcache_uncached(IF_TYPE_HOST, 0, 4, 8, 512));
+
+	/* Blocks 4-11 straddle two pages */
+	blkcache_fill(IF_TYPE_HOST, 0, 4, 8, 512, data + 4 * 512);
+	blkcache_stats(&stats);
+	ut_asserteq(2, stats.entries);
+	ut_asserteq(8, stats.misses);
+
+	/* Blocks 6-13: the first six come from the cache, the rest do not */
+	memset(buf, '\0', sizeof(buf));
+	ut_asserteq(6, blkcache_read(IF_TYPE_HOST, 0, 6, 8, 512, buf));
+	ut_assertok(memcmp(buf, data + 6 * 512, 6 * 512));
+	ut_asserteq(2, blkcache_uncached(IF_TYPE_HOST, 0, 12, 2, 512));
+
+	/* Another device does not see this data */
+	ut_asserteq(0, blkcache_read(IF_TYPE_HOST, 1, 6, 1, 512, buf));
+
+	/* Complete the first page, then evict the second for another device */
+	blkcache_fill(IF_TYPE_HOST, 0, 0, 4, 512, data);
+	blkcache_fill(IF_TYPE_HOST, 1, 0, 1, 512, data);
+	blkcache_stats(&stats);
+	ut_asserteq(2, stats.entries);
+	ut_asserteq(1, stats.evictions);
+	ut_asserteq(6, stats.hits);
+	ut_asserteq(0, blkcache_read(IF_TYPE_HOST, 0, 8, 1, 512, buf));
+	ut_asserteq(8, blkcache_read(IF_TYPE_HOST, 0, 0, 8, 512, buf));
+	ut_assertok(memcmp(buf, data, 8 * 512));
+
+	/* Reads larger than the limit bypass the cache */
+	ut_asserteq(0, blkcache_read(IF_TYPE_HOST, 0, 0, 17, 512, buf));
+
+	/* Invalidating a device drops only its pages */
+	blkcache_invalidate(IF_TYPE_HOST, 0);
+	blkcache_stats(&stats);
+	ut_asserteq(1, stats.entries);
+	ut_asserteq(1, blkcache_read(IF_TYPE_HOST, 1, 0, 1, 512, buf));
+
+	blkcache_configure(CONFIG_BLOCK_CACHE_MAX_BLOCKS,
+			   CONFIG_BLOCK_CACHE_SIZE);
+
+	return 0;
+}
+DM_TEST(dm_test_blk_cache, 0);
+
+#if CONFIG_IS_ENABLED(BLK_READAHEAD)
+#define RA_TEST_BLOCKS	64
+
+/* A block device in memory whose queued reads complete in read_wait() */
+struct ra_test_priv {
+	u8 data[RA_TEST_BLOCKS * 512];
+	lbaint_t start;		/* read in flight */
+	lbaint_t blkcnt;
+	void *buffer;
+	bool busy;
+	int errors;		/* requests made while a read is in flight */
+};
+
+static ulong ra_test_read(struct udevice *dev, lbaint_t start,
+			  lbaint_t blkcnt, void *buffer)
+{
+	struct ra_test_priv *priv = dev_get_priv(dev);
+
+	if (priv->busy)
+		priv->errors++;
+	memcpy(buffer, priv->data + start * 512, blkcnt * 512);
+
+	return blkcnt;
+}
+
+static ulong ra_test_write(struct udevice *dev, lbaint_t start,
+			   lbaint_t blkcnt, const void *buffer)
+{
+	struct ra_test_priv *priv = dev_get_priv(dev);
+
+	if (priv->busy)
+		priv->errors++;
+	memcpy(priv->data + start * 512, buffer, blkcnt * 512);
+
+	return blkcnt;
+}
+
+static int ra_test_read_start(struct udevice *dev, lbaint_t start,
+			      lbaint_t blkcnt, void *buffer)
+{
+	struct ra_test_priv *priv = dev_get_priv(dev);
+
+	if (priv->busy) {
+		priv->errors++;
+		return -EBUSY;
+	}
+	priv->start = start;
+	priv->blkcnt = blkcnt;
+	priv->buffer = buffer;
+	priv->busy = true;
+
+	return 0;
+}
+
+static ulong ra_test_read_wait(struct udevice *dev)
+{
+	struct ra_test_priv *priv = dev_get_priv(dev);
+
+	if (!priv->busy) {
+		priv->errors++;
+		return -EINVAL;
+	}
+	priv->busy = false;
+	memcpy(priv->buffer, priv->data + priv->start * 512,
+	       priv->blkcnt * 512);
+
+	return priv->blkcnt;
+}
+
+static const struct blk_ops ra_test_blk_ops = {
+	.read		= ra_test_read,
+	.write		= ra_test_write,
+	.read_start	= ra_test_read_start,
+	.read_wait	= ra_test_read_wait,
+};
+
+U_BOOT_DRIVER(ra_test_blk) = {
+	.name		= "ra_test_blk",
+	.id		= UCLASS_BLK,
+	.ops		= &ra_test_blk_ops,
+	.priv_auto_alloc_size = sizeof(struct ra_test_priv),
+};
+
+/* Test that sequential reads are served from windows read in the background */
+static int dm_test_blk_readahead(struct unit_test_state *uts)
+{
+	struct blk_readahead_stats stats;
+	struct ra_test_priv *priv;
+	struct blk_desc *desc;
+	struct udevice *dev;
+	u8 buf[8 * 512];
+	int i;
+
+	ut_assertok(blk_create_device(gd->dm_root, "ra_test_blk", "ra",
+				      IF_TYPE_HOST, 0, 512, RA_TEST_BLOCKS,
+				      &dev));
+	ut_assertok(device_probe(dev));
+	desc = dev_get_uclass_platdata(dev);
+	priv = dev_get_priv(dev);
+	for (i = 0; i < sizeof(priv->data); i++)
+		priv->data[i] = i / 512 * 3 + i;
+
+	/* Keep the block cache out of the way */
+	blkcache_configure(0, 0);
+	blk_readahead_configure(8);
+
+	/* A sequential miss starts reading the next window */
+	ut_asserteq(2, blk_dread(desc, 0, 2, buf));
+	ut_assertok(memcmp(buf, priv->data, 2 * 512));
+	ut_assert(priv->busy);
+	ut_asserteq(2, priv->start);
+	ut_asserteq(8, priv->blkcnt);
+
+	/* Reading from it waits for it and starts the one after */
+	ut_asserteq(4, blk_dread(desc, 2, 4, buf));
+	ut_assertok(memcmp(buf, priv->data + 2 * 512, 4 * 512));
+	ut_assert(priv->busy);
+	ut_asserteq(10, priv->start);
+
+	/* A read across two windows */
+	ut_asserteq(8, blk_dread(desc, 6, 8, buf));
+	ut_assertok(memcmp(buf, priv->data + 6 * 512, 8 * 512));
+	ut_asserteq(18, priv->start);
+
+	blk_readahead_stats(&stats);
+	ut_asserteq(12, stats.hits);
+	ut_asserteq(2, stats.misses);
+	ut_asserteq(24, stats.fetched);
+	ut_asserteq(3, stats.windows);
+
+	/* Another read waits for the window in flight, which is kept */
+	ut_asserteq(1, blk_dread(desc, 40, 1, buf));
+	ut_assertok(memcmp(buf, priv->data + 40 * 512, 512));
+	ut_assert(!priv->busy);
+	ut_asserteq(8, blk_dread(desc, 14, 8, buf));
+	ut_assertok(memcmp(buf, priv->data + 14 * 512, 8 * 512));
+	ut_assert(priv->busy);
+	ut_asserteq(26, priv->start);
+
+	blk_readahead_stats(&stats);
+	ut_asserteq(8, stats.hits);
+	ut_asserteq(1, stats.misses);
+	ut_asserteq(8, stats.fetched);
+	ut_asserteq(1, stats.windows);
+
+	/* A write waits for the window in flight and drops the windows */
+	memset(buf, 0xaa, 512);
+	ut_asserteq(1, blk_dwrite(desc, 23, 1, buf));
+	ut_assert(!priv->busy);
+	ut_asserteq(4, blk_dread(desc, 22, 4, buf));
+	ut_assertok(memcmp(buf, priv->data + 22 * 512, 4 * 512));
+	ut_asserteq(0xaa, buf[512]);
+	ut_assert(priv->busy);
+
+	/* A new window size applies to the next read */
+	blk_readahead_configure(4);
+	ut_assert(!priv->busy);
+	ut_asserteq(2, blk_dread(desc, 26, 2, buf));
+	ut_assertok(memcmp(buf, priv->data + 26 * 512, 2 * 512));
+	ut_asserteq(28, priv->start);
+	ut_asserteq(4, priv->blkcnt);
+
+	/* Windows stop at the end of the device */
+	ut_asserteq(3, blk_dread(desc, 56, 3, buf));
+	ut_asserteq(2, blk_dread(desc, 59, 2, buf));
+	ut_asserteq(61, priv->start);
+	ut_asserteq(3, priv->blkcnt);
+	ut_asserteq(3, blk_dread(desc, 61, 3, buf));
+	ut_assertok(memcmp(buf, priv->data + 61 * 512, 3 * 512));
+	ut_assert(!priv->busy);
+
+	blk_readahead_stats(&stats);
+	ut_asserteq(3, stats.hits);
+	ut_asserteq(7, stats.misses);
+	ut_asserteq(7, stats.fetched);
+	ut_asserteq(2, stats.windows);
+
+	ut_asserteq(0, priv->errors);
+
+	blk_readahead_configure(CONFIG_BLK_READAHEAD_BLOCKS);
+	blkcache_configure(CONFIG_BLOCK_CACHE_MAX_BLOCKS,
+			   CONFIG_BLOCK_CACHE_SIZE);
+
+	return 0;
+}
+DM_TEST(dm_test_blk_readahead, 0);
+#endif
@@ -11,6 +11,7 @@
 #include <fdtdec.h>
 #include <malloc.h>
 #include <dm/device-internal.h>
+#include <dm/lists.h>
 #include <dm/root.h>
 #include <dm/util.h>
 #include <dm/test.h>
@@ -904,3 +905,42 @@ static int dm_test_inactive_child(struct unit_test_state *uts)
 	return 0;
 }
 DM_TEST(dm_test_inactive_child, DM_TESTF_SCAN_PDATA);
+
+/* Test that the compatible index agrees with a scan of the drivers */
+static int dm_test_compat_index(struct unit_test_state *uts)
+{
+	struct driver *driver = ll_entry_start(struct driver, driver);
+	const int n_ents = ll_entry_count(struct driver, driver);
+	const struct udevice_id *id, *of_match, *found_id;
+	struct driver *drv, *entry, *found;
+
+	ut_assertnonnull(gd->dm_compat_index);
+	for (drv = driver; drv != driver + n_ents; drv++) {
+		for (id = drv->of_match; id && id->compatible; id++) {
+			/* The first driver with the string must be returned */
+			found = NULL;
+			found_id = NULL;
+			for (entry = driver; !found; entry++) {
+				for (of_match = entry->of_match;
+				     of_match && of_match->compatible;
+				     of_match++) {
+					if (!strcmp(of_match->compatible,
+						    id->compatible)) {
+						found = entry;
+						found_id = of_match;
+						break;
+					}
+				}
+			}
+			ut_assertok(lists_driver_lookup_compatible(
+					id->compatible, &entry, &of_match));
+			ut_asserteq_ptr(found, entry);
+			ut_asserteq_ptr(found_id, of_match);
+		}
+	}
+	ut_asserteq(-ENOENT, lists_driver_lookup_compatible("not,a-device",
+							    &entry, &id));
+
+	return 0;
+}
+DM_TEST(dm_test_compat_index, 0);
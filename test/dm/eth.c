@@ -429,3 +429,35 @@ static int dm_test_eth_async_ping_reply(struct unit_test_state *uts)
 }
 
 DM_TEST(dm_test_eth_async_ping_reply, DM_TESTF_SCAN_FDT);
+
+static int dm_test_eth_rx_batch(struct unit_test_state *uts)
+{
+	struct eth_sandbox_priv *priv;
+	struct udevice *dev;
+	int i;
+
+	net_init();
+	env_set("ethact", "eth@10002000");
+	ut_assertok(eth_init());
+	dev = eth_get_dev();
+	priv = dev_get_priv(dev);
+
+	/* Fill every receive buffer; the next packet has to be dropped */
+	priv->fake_host_ipaddr = string_to_ip("1.1.2.4");
+	for (i = 0; i < PKTBUFSRX; i++)
+		ut_assertok(sandbox_eth_recv_arp_req(dev));
+	ut_asserteq(-EOVERFLOW, sandbox_eth_recv_arp_req(dev));
+	ut_asserteq(1, priv->rx_dropped);
+
+	/* A single poll takes all of them and frees every buffer */
+	ut_asserteq(PKTBUFSRX, eth_rx());
+	ut_asserteq(0, priv->recv_packets);
+	ut_assertok(sandbox_eth_recv_arp_req(dev));
+	ut_asserteq(1, priv->rx_dropped);
+
+	eth_halt();
+
+	return 0;
+}
+
+DM_TEST(dm_test_eth_rx_batch, DM_TESTF_SCAN_FDT);
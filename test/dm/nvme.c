@@ -0,0 +1,86 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests for the NVMe command id bookkeeping
+ */
+
+#include <common.h>
+#include <dm.h>
+#include <dm/test.h>
+#include <test/ut.h>
+
+#include "../../drivers/nvme/nvme.h"
+
+#define SLOTS	7
+
+/* Test that command ids are handed out once and can be freed in any order */
+static int dm_test_nvme_slots(struct unit_test_state *uts)
+{
+	struct nvme_slots slots;
+	bool seen[SLOTS] = { };
+	int ids[SLOTS];
+	int i;
+
+	ut_assertok(nvme_slots_init(&slots, SLOTS));
+	ut_assert(nvme_slots_idle(&slots));
+
+	for (i = 0; i < SLOTS; i++) {
+		ids[i] = nvme_slot_get(&slots);
+		ut_assert(ids[i] >= 0 && ids[i] < SLOTS);
+		ut_assert(!seen[ids[i]]);
+		seen[ids[i]] = true;
+		ut_assert(!nvme_slots_idle(&slots));
+	}
+	ut_asserteq(-EBUSY, nvme_slot_get(&slots));
+
+	/* Completions arrive out of order; a freed id is handed out again */
+	ut_assertok(nvme_slot_put(&slots, ids[3]));
+	ut_assertok(nvme_slot_put(&slots, ids[0]));
+	ut_asserteq(ids[0], nvme_slot_get(&slots));
+	ut_asserteq(ids[3], nvme_slot_get(&slots));
+	ut_asserteq(-EBUSY, nvme_slot_get(&slots));
+
+	/* A repeated or bogus completion must not free an id twice */
+	ut_assertok(nvme_slot_put(&slots, ids[5]));
+	ut_asserteq(-EINVAL, nvme_slot_put(&slots, ids[5]));
+	ut_asserteq(-EINVAL, nvme_slot_put(&slots, SLOTS));
+	ut_asserteq(1, slots.nr_free);
+
+	for (i = 0; i < SLOTS; i++) {
+		if (i != 5)
+			ut_assertok(nvme_slot_put(&slots, ids[i]));
+	}
+	ut_assert(nvme_slots_idle(&slots));
+	nvme_slots_uninit(&slots);
+
+	return 0;
+}
+DM_TEST(dm_test_nvme_slots, 0);
+
+/* Test that a reset after a timeout gets back the ids still in flight */
+static int dm_test_nvme_slots_reset(struct unit_test_state *uts)
+{
+	struct nvme_slots slots;
+	int i;
+
+	ut_assertok(nvme_slots_init(&slots, SLOTS));
+	for (i = 0; i < SLOTS - 2; i++)
+		ut_assert(nvme_slot_get(&slots) >= 0);
+	ut_assert(!nvme_slots_idle(&slots));
+
+	/* Nothing in flight is completed, as after a timeout */
+	nvme_slots_reset(&slots);
+	ut_assert(nvme_slots_idle(&slots));
+
+	for (i = 0; i < SLOTS; i++)
+		ut_asserteq(i, nvme_slot_get(&slots));
+	ut_asserteq(-EBUSY, nvme_slot_get(&slots));
+
+	/* A late completion for an id from before the reset is ignored */
+	nvme_slots_reset(&slots);
+	ut_asserteq(-EINVAL, nvme_slot_put(&slots, 2));
+	ut_assert(nvme_slots_idle(&slots));
+	nvme_slots_uninit(&slots);
+
+	return 0;
+}
+DM_TEST(dm_test_nvme_slots_reset, 0);
@@ -5,6 +5,7 @@
 
 #include <common.h>
 #include <lmb.h>
+#include <malloc.h>
 #include <dm/test.h>
 #include <test/ut.h>
 
@@ -655,3 +656,159 @@ static int lib_test_lmb_get_free_size(struct unit_test_state *uts)
 
 DM_TEST(lib_test_lmb_get_free_size,
 	DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+
+/* Check that the reserved table is sorted, coalesced and within RAM */
+static int check_lmb_reserved(struct unit_test_state *uts, struct lmb *lmb,
+			      phys_addr_t ram, phys_size_t ram_size)
+{
+	struct lmb_region *rgn = &lmb->reserved;
+	unsigned long i;
+
+	ut_assert(rgn->cnt <= rgn->max);
+	for (i = 0; i < rgn->cnt; i++) {
+		ut_assert(rgn->region[i].size);
+		ut_assert(rgn->region[i].base >= ram);
+		ut_assert(rgn->region[i].base + rgn->region[i].size <=
+			  ram + ram_size);
+		if (i)
+			ut_assert(rgn->region[i - 1].base +
+				  rgn->region[i - 1].size <
+				  rgn->region[i].base);
+	}
+
+	return 0;
+}
+
+#define STRESS_PAGE		0x1000
+#define STRESS_PAGES		0x4000
+#define STRESS_BLOCKS		2000
+#define STRESS_ROUNDS		20000
+
+/*
+ * Reserve more regions than fit in the initial table, check that best-fit
+ * allocation picks the smallest free range, then compare random reserve and
+ * free operations against a simple page map.
+ */
+static int lib_test_lmb_stress(struct unit_test_state *uts)
+{
+	const phys_addr_t ram = 0x40000000;
+	const phys_size_t ram_size = STRESS_PAGES * STRESS_PAGE;
+	phys_size_t total;
+	phys_addr_t a, b;
+	struct lmb lmb;
+	u8 *map;
+	long ret;
+	int i, j, page, pages, used;
+
+	map = calloc(STRESS_PAGES, 1);
+	ut_assertnonnull(map);
+
+	lmb_init(&lmb);
+	ut_asserteq(lmb_add(&lmb, ram, ram_size), 0);
+
+	/* every other page, so that nothing coalesces */
+	for (i = 0; i < STRESS_BLOCKS; i++) {
+		ret = lmb_reserve(&lmb, ram + i * 2 * STRESS_PAGE, STRESS_PAGE);
+		ut_asserteq(ret, 0);
+	}
+	ut_asserteq(lmb.reserved.cnt, STRESS_BLOCKS);
+	ut_assert(lmb.reserved.max >= STRESS_BLOCKS);
+	ut_assert(!check_lmb_reserved(uts, &lmb, ram, ram_size));
+	ut_asserteq(lmb_is_reserved(&lmb, ram + 100 * STRESS_PAGE), 1);
+	ut_asserteq(lmb_is_reserved(&lmb, ram + 101 * STRESS_PAGE), 0);
+	ut_asserteq(lmb_get_free_size(&lmb, ram + 101 * STRESS_PAGE),
+		    STRESS_PAGE);
+
+	/* one-page holes fill from the top; the big range is left alone */
+	a = lmb_alloc(&lmb, STRESS_PAGE, STRESS_PAGE);
+	ut_asserteq(a, ram + (STRESS_BLOCKS * 2 - 3) * STRESS_PAGE);
+	b = lmb_alloc(&lmb, STRESS_PAGE, STRESS_PAGE);
+	ut_asserteq(b, ram + (STRESS_BLOCKS * 2 - 5) * STRESS_PAGE);
+	ut_asserteq(lmb.reserved.cnt, STRESS_BLOCKS - 2);
+
+	/* a two-page block only fits in the free range at the top of RAM */
+	a = lmb_alloc(&lmb, 2 * STRESS_PAGE, STRESS_PAGE);
+	ut_asserteq(a, ram + ram_size - 2 * STRESS_PAGE);
+
+	/* freeing from the middle of a region splits it */
+	ut_asserteq(lmb_free(&lmb, b, STRESS_PAGE), 0);
+	ut_asserteq(lmb.reserved.cnt, STRESS_BLOCKS);
+	ut_assert(!check_lmb_reserved(uts, &lmb, ram, ram_size));
+
+	/* fill the holes to make one region, then split it up again */
+	for (i = 1; i < STRESS_BLOCKS * 2; i += 2) {
+		if (lmb_is_reserved(&lmb, ram + i * STRESS_PAGE))
+			continue;
+		ret = lmb_reserve(&lmb, ram + i * STRESS_PAGE, STRESS_PAGE);
+		ut_assert(ret > 0);
+	}
+	ut_asserteq(lmb.reserved.cnt, 2);
+	for (i = 0; i < STRESS_BLOCKS * 2; i += 4)
+		ut_asserteq(lmb_free(&lmb, ram + (i + 1) * STRESS_PAGE,
+				     STRESS_PAGE), 0);
+	ut_asserteq(lmb.reserved.cnt, STRESS_BLOCKS / 2 + 2);
+	ut_assert(!check_lmb_reserved(uts, &lmb, ram, ram_size));
+	ut_asserteq(lmb_free(&lmb, ram, STRESS_BLOCKS * 2 * STRESS_PAGE), -1);
+	while (lmb.reserved.cnt)
+		ut_asserteq(lmb_free(&lmb, lmb.reserved.region[0].base,
+				     lmb.reserved.region[0].size), 0);
+
+	/* random operations, checked against the page map */
+	srand(1);
+	used = 0;
+	for (i = 0; i < STRESS_ROUNDS; i++) {
+		page = rand() % STRESS_PAGES;
+		pages = 1 + rand() % 8;
+		if (page + pages > STRESS_PAGES)
+			pages = STRESS_PAGES - page;
+		a = ram + page * STRESS_PAGE;
+
+		for (j = 0; j < pages && map[page + j] == map[page]; j++)
+			;
+		if (j < pages) {
+			/* mixed range, must be refused either way */
+			ut_asserteq(lmb_reserve(&lmb, a, pages * STRESS_PAGE),
+				    -1);
+			continue;
+		}
+		if (!map[page] && (rand() & 3)) {
+			ret = lmb_reserve(&lmb, a, pages * STRESS_PAGE);
+			ut_assert(ret >= 0);
+			memset(map + page, 1, pages);
+			used += pages;
+		} else if (!map[page]) {
+			a = lmb_alloc(&lmb, pages * STRESS_PAGE, STRESS_PAGE);
+			if (!a)
+				continue;
+			page = (a - ram) / STRESS_PAGE;
+			for (j = 0; j < pages; j++)
+				ut_asserteq(map[page + j], 0);
+			memset(map + page, 1, pages);
+			used += pages;
+		} else {
+			ut_asserteq(lmb_free(&lmb, a, pages * STRESS_PAGE), 0);
+			memset(map + page, 0, pages);
+			used -= pages;
+		}
+
+		if (i % 256)
+			continue;
+		ut_assert(!check_lmb_reserved(uts, &lmb, ram, ram_size));
+		for (total = 0, j = 0; j < lmb.reserved.cnt; j++)
+			total += lmb.reserved.region[j].size;
+		ut_asserteq(total, (phys_size_t)used * STRESS_PAGE);
+		for (j = 0; j < STRESS_PAGES; j += 61)
+			ut_asserteq(lmb_is_reserved(&lmb,
+						    ram + j * STRESS_PAGE),
+				    map[j]);
+	}
+
+	lmb_uninit(&lmb);
+	ut_asserteq(lmb.reserved.cnt, 0);
+	ut_assert(lmb.reserved.region == lmb.reserved.initial);
+	free(map);
+
+	return 0;
+}
+
+DM_TEST(lib_test_lmb_stress, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
@@ -0,0 +1,286 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Unit tests and benchmark for the BCH library
+ */
+
+#include <common.h>
+#include <hexdump.h>
+#include <malloc.h>
+#include <time.h>
+#include <linux/bch.h>
+#include <test/lib.h>
+#include <test/test.h>
+#include <test/ut.h>
+
+#define BCH_TEST_ROUNDS		200
+#define BCH_BENCH_PAGES		2000
+
+/* Parameters used by NAND controllers with software BCH */
+static const struct {
+	int m;
+	int t;
+	uint len;
+} bch_params[] = {
+	{ 13, 4, 512 },
+	{ 13, 8, 512 },
+	{ 14, 24, 1024 },
+	{ 14, 40, 1024 },
+};
+
+struct bch_test_buf {
+	struct bch_control *bch;
+	uint len;
+	u8 *data;
+	u8 *page;
+	u8 *ecc;
+	u8 *read_ecc;
+	u8 *calc_ecc;
+	uint *errloc;
+	uint *flipped;
+	u32 *ecc_words;
+	uint *syn;
+};
+
+static int bch_test_alloc(struct bch_test_buf *tb, int m, int t, uint len)
+{
+	uint i;
+
+	tb->bch = init_bch(m, t, 0);
+	if (!tb->bch)
+		return -ENOMEM;
+	tb->len = len;
+	tb->data = malloc(len);
+	tb->page = malloc(len);
+	tb->ecc = calloc(1, tb->bch->ecc_bytes);
+	tb->read_ecc = malloc(tb->bch->ecc_bytes);
+	tb->calc_ecc = malloc(tb->bch->ecc_bytes);
+	tb->errloc = malloc(t * sizeof(*tb->errloc));
+	tb->flipped = malloc(t * sizeof(*tb->flipped));
+	tb->ecc_words = malloc(DIV_ROUND_UP(tb->bch->ecc_bytes, 4) *
+			       sizeof(*tb->ecc_words));
+	tb->syn = malloc(2 * t * sizeof(*tb->syn));
+	if (!tb->data || !tb->page || !tb->ecc || !tb->read_ecc ||
+	    !tb->calc_ecc || !tb->errloc || !tb->flipped || !tb->ecc_words ||
+	    !tb->syn)
+		return -ENOMEM;
+
+	for (i = 0; i < len; i++)
+		tb->data[i] = rand();
+	encode_bch(tb->bch, tb->data, len, tb->ecc);
+
+	return 0;
+}
+
+static void bch_test_free(struct bch_test_buf *tb)
+{
+	free(tb->data);
+	free(tb->page);
+	free(tb->ecc);
+	free(tb->read_ecc);
+	free(tb->calc_ecc);
+	free(tb->errloc);
+	free(tb->flipped);
+	free(tb->ecc_words);
+	free(tb->syn);
+	free_bch(tb->bch);
+}
+
+/* Copy the page and its ecc, flipping @count distinct bits in them */
+static void bch_test_corrupt(struct bch_test_buf *tb, uint count)
+{
+	uint nbits = 8 * tb->len + tb->bch->ecc_bits;
+	uint i, j, bit;
+
+	memcpy(tb->page, tb->data, tb->len);
+	memcpy(tb->read_ecc, tb->ecc, tb->bch->ecc_bytes);
+
+	for (i = 0; i < count; i++) {
+		do {
+			bit = rand() % nbits;
+			for (j = 0; j < i && tb->flipped[j] != bit; j++)
+				;
+		} while (j < i);
+		tb->flipped[i] = bit;
+		if (bit < 8 * tb->len)
+			tb->page[bit / 8] ^= 1 << (bit % 8);
+		else
+			/* ecc bits are stored most-significant first */
+			tb->read_ecc[bit / 8 - tb->len] ^= 0x80 >> (bit % 8);
+	}
+}
+
+/* Correct the page with the error locations found by decode_bch() */
+static void bch_test_correct(struct bch_test_buf *tb, int count)
+{
+	int i;
+
+	for (i = 0; i < count; i++)
+		if (tb->errloc[i] < 8 * tb->len)
+			tb->page[tb->errloc[i] / 8] ^= 1 << (tb->errloc[i] % 8);
+}
+
+/*
+ * Reference syndrome computation, as the library did it before using lookup
+ * tables: the ecc remainder is evaluated one set bit at a time, reducing
+ * each exponent modulo n
+ */
+static uint bch_ref_mod(struct bch_control *bch, uint v)
+{
+	while (v >= bch->n) {
+		v -= bch->n;
+		v = (v & bch->n) + (v >> bch->m);
+	}
+
+	return v;
+}
+
+static uint bch_ref_mul(struct bch_control *bch, uint a, uint b)
+{
+	uint v;
+
+	if (!a || !b)
+		return 0;
+	v = bch->a_log_tab[a] + bch->a_log_tab[b];
+
+	return bch->a_pow_tab[v < bch->n ? v : v - bch->n];
+}
+
+/* Compute the 2t syndromes of tb->read_ecc ^ tb->calc_ecc into tb->syn */
+static void bch_ref_syndromes(struct bch_test_buf *tb)
+{
+	struct bch_control *bch = tb->bch;
+	uint nwords = DIV_ROUND_UP(bch->ecc_bytes, 4);
+	u8 ecc[4];
+	int i, j, s;
+	uint k;
+	u32 poly;
+
+	/* load the ecc remainder into big-endian words, zero-padded */
+	for (i = 0; i < nwords; i++) {
+		for (k = 0; k < 4; k++)
+			ecc[k] = 4 * i + k < bch->ecc_bytes ?
+				tb->read_ecc[4 * i + k] ^
+				tb->calc_ecc[4 * i + k] : 0;
+		tb->ecc_words[i] = (u32)ecc[0] << 24 | ecc[1] << 16 |
+			ecc[2] << 8 | ecc[3];
+	}
+	s = bch->ecc_bits;
+	if (s & 31)
+		tb->ecc_words[s / 32] &= ~((1U << (32 - (s & 31))) - 1);
+	memset(tb->syn, '\0', 2 * bch->t * sizeof(*tb->syn));
+
+	/* compute v(a^j) for j = 1 .. 2t - 1 */
+	for (i = 0; s > 0; i++) {
+		poly = tb->ecc_words[i];
+		s -= 32;
+		while (poly) {
+			k = fls(poly) - 1;
+			for (j = 0; j < 2 * bch->t; j += 2)
+				tb->syn[j] ^= bch->a_pow_tab[bch_ref_mod(bch,
+							(j + 1) * (k + s))];
+			poly ^= 1U << k;
+		}
+	}
+
+	/* v(a^2j) = v(a^j)^2 */
+	for (j = 0; j < bch->t; j++)
+		tb->syn[2 * j + 1] = bch_ref_mul(bch, tb->syn[j], tb->syn[j]);
+}
+
+/* Check that up to t bit errors are found, both ways of calling decode_bch() */
+static int lib_test_bch_decode(struct unit_test_state *uts)
+{
+	struct bch_test_buf tb;
+	uint i, round, count, len;
+	int ret;
+
+	for (i = 0; i < ARRAY_SIZE(bch_params); i++) {
+		memset(&tb, 0, sizeof(tb));
+		ut_assertok(bch_test_alloc(&tb, bch_params[i].m,
+					   bch_params[i].t,
+					   bch_params[i].len));
+
+		for (round = 0; round < BCH_TEST_ROUNDS; round++) {
+			count = round % (bch_params[i].t + 1);
+			bch_test_corrupt(&tb, count);
+
+			ret = decode_bch(tb.bch, tb.page, tb.len, tb.read_ecc,
+					 NULL, NULL, tb.errloc);
+			ut_asserteq(count, ret);
+			bch_test_correct(&tb, ret);
+			ut_asserteq_mem(tb.data, tb.page, tb.len);
+
+			bch_test_corrupt(&tb, count);
+			memset(tb.calc_ecc, 0, tb.bch->ecc_bytes);
+			encode_bch(tb.bch, tb.page, tb.len, tb.calc_ecc);
+			ret = decode_bch(tb.bch, NULL, tb.len, tb.read_ecc,
+					 tb.calc_ecc, NULL, tb.errloc);
+			ut_asserteq(count, ret);
+
+			/* the syndromes must match the reference ones */
+			bch_ref_syndromes(&tb);
+			len = 2 * tb.bch->t * sizeof(*tb.syn);
+			if (count)
+				ut_asserteq_mem(tb.syn, tb.bch->syn, len);
+			ret = decode_bch(tb.bch, NULL, tb.len, NULL, NULL,
+					 tb.syn, tb.errloc);
+			ut_asserteq(count, ret);
+			bch_test_correct(&tb, ret);
+			ut_asserteq_mem(tb.data, tb.page, tb.len);
+		}
+		bch_test_free(&tb);
+	}
+
+	return 0;
+}
+LIB_TEST(lib_test_bch_decode, 0);
+
+/*
+ * Report how many pages with t/2 bit errors are decoded per second, with the
+ * library's syndrome computation and with the reference one. This takes a
+ * while, so it only runs when asked for: ut lib bch_bench
+ */
+static int lib_test_bch_bench(struct unit_test_state *uts)
+{
+	struct bch_test_buf tb;
+	unsigned long start, us, rate[2];
+	uint i, page, ref;
+	int ret;
+
+	for (i = 0; i < ARRAY_SIZE(bch_params); i++) {
+		memset(&tb, 0, sizeof(tb));
+		ut_assertok(bch_test_alloc(&tb, bch_params[i].m,
+					   bch_params[i].t,
+					   bch_params[i].len));
+		bch_test_corrupt(&tb, bch_params[i].t / 2);
+		memset(tb.calc_ecc, 0, tb.bch->ecc_bytes);
+		encode_bch(tb.bch, tb.page, tb.len, tb.calc_ecc);
+
+		for (ref = 0; ref < 2; ref++) {
+			start = timer_get_us();
+			for (page = 0; page < BCH_BENCH_PAGES; page++) {
+				if (ref) {
+					bch_ref_syndromes(&tb);
+					ret = decode_bch(tb.bch, NULL, tb.len,
+							 NULL, NULL, tb.syn,
+							 tb.errloc);
+				} else {
+					ret = decode_bch(tb.bch, NULL, tb.len,
+							 tb.read_ecc,
+							 tb.calc_ecc, NULL,
+							 tb.errloc);
+				}
+				ut_asserteq(bch_params[i].t / 2, ret);
+			}
+			us = max(timer_get_us() - start, 1UL);
+			rate[ref] = (u64)BCH_BENCH_PAGES * 1000000 / us;
+		}
+		printf("bch m=%-2d t=%-2d %4u bytes %8lu pages/s, reference %8lu pages/s\n",
+		       bch_params[i].m, bch_params[i].t, tb.len, rate[0],
+		       rate[1]);
+		bch_test_free(&tb);
+	}
+
+	return 0;
+}
+LIB_TEST(lib_test_bch_bench, UT_TESTF_MANUAL);
@@ -0,0 +1,96 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Unit tests for the crc32 implementations
+ */
+
+#include <common.h>
+#include <malloc.h>
+#include <u-boot/crc.h>
+#include <test/lib.h>
+#include <test/test.h>
+#include <test/ut.h>
+
+#define CRC32_TEST_SIZE		(1 << 20)
+
+/* Compute a CRC with a given implementation, which must be available */
+static uint32_t crc32_with(enum crc32_impl impl, uint32_t crc,
+			   const unsigned char *buf, uint len)
+{
+	crc32_impl_calc(impl, crc, buf, len, &crc);
+
+	return crc;
+}
+
+/* Check the standard test vector and chaining with each implementation */
+static int lib_test_crc32_check(struct unit_test_state *uts)
+{
+	const unsigned char *check = (const unsigned char *)"123456789";
+	enum crc32_impl impl;
+	uint32_t crc;
+
+	ut_assert(crc32_impl_available(CRC32_IMPL_BYTE));
+	ut_assert(crc32_impl_available(crc32_impl_default()));
+	ut_assert(!crc32_impl_available(CRC32_IMPL_COUNT));
+	ut_asserteq(-ENOENT,
+		    crc32_impl_calc(CRC32_IMPL_COUNT, 0, check, 9, &crc));
+	ut_asserteq(0xcbf43926, crc32(0, check, 9));
+
+	for (impl = 0; impl < CRC32_IMPL_COUNT; impl++) {
+		if (!crc32_impl_available(impl))
+			continue;
+		ut_asserteq(0xcbf43926, crc32_with(impl, 0, check, 9));
+		ut_asserteq(0xcbf43926,
+			    crc32_with(impl, crc32_with(impl, 0, check, 4),
+				       check + 4, 5));
+		ut_asserteq(0, crc32_with(impl, 0, check, 0));
+	}
+
+	return 0;
+}
+LIB_TEST(lib_test_crc32_check, 0);
+
+/*
+ * Compare every implementation with the byte-wise one, for all small
+ * lengths and alignments and for a large buffer
+ */
+static int lib_test_crc32_compare(struct unit_test_state *uts)
+{
+	enum crc32_impl impl;
+	unsigned char *buf;
+	uint32_t expect;
+	int i, len, ofs;
+
+	buf = malloc(CRC32_TEST_SIZE);
+	ut_assertnonnull(buf);
+	for (i = 0; i < CRC32_TEST_SIZE; i++)
+		buf[i] = rand();
+
+	for (impl = CRC32_IMPL_SLICE8; impl < CRC32_IMPL_COUNT; impl++) {
+		if (!crc32_impl_available(impl))
+			continue;
+		for (ofs = 0; ofs < 16; ofs++) {
+			for (len = 0; len < 300; len++) {
+				expect = crc32_with(CRC32_IMPL_BYTE, len,
+						    buf + ofs, len);
+				ut_asserteq(expect,
+					    crc32_with(impl, len, buf + ofs,
+						       len));
+			}
+		}
+		for (ofs = 0; ofs < 8; ofs++) {
+			len = CRC32_TEST_SIZE - 8 - ofs * 13;
+			expect = crc32_with(CRC32_IMPL_BYTE, 0, buf + ofs, len);
+			ut_asserteq(expect, crc32_with(impl, 0, buf + ofs, len));
+			ut_asserteq(expect,
+				    crc32_with(impl,
+					       crc32_with(impl, 0, buf + ofs,
+							  len / 3),
+					       buf + ofs + len / 3,
+					       len - len / 3));
+		}
+	}
+	free(buf);
+
+	return 0;
+}
+LIB_TEST(lib_test_crc32_compare, 0);
@@ -0,0 +1,101 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Unit tests for SHA-1 and SHA-256, whichever implementation is in use
+ */
+
+#include <common.h>
+#include <hash.h>
+#include <hexdump.h>
+#include <malloc.h>
+#include <u-boot/sha1.h>
+#include <u-boot/sha256.h>
+#include <test/lib.h>
+#include <test/test.h>
+#include <test/ut.h>
+
+#define SHA_TEST_LEN	1000000
+
+struct sha_test_vector {
+	const char *algo;
+	const char *input;	/* NULL for SHA_TEST_LEN times 'a' */
+	u8 digest[SHA256_SUM_LEN];
+};
+
+/* FIPS 180-2 test vectors */
+static const struct sha_test_vector sha_test_vectors[] = {
+	{ "sha1", "abc",
+	  { 0xa9, 0x99, 0x3e, 0x36, 0x47, 0x06, 0x81, 0x6a, 0xba, 0x3e,
+	    0x25, 0x71, 0x78, 0x50, 0xc2, 0x6c, 0x9c, 0xd0, 0xd8, 0x9d } },
+	{ "sha1", "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq",
+	  { 0x84, 0x98, 0x3e, 0x44, 0x1c, 0x3b, 0xd2, 0x6e, 0xba, 0xae,
+	    0x4a, 0xa1, 0xf9, 0x51, 0x29, 0xe5, 0xe5, 0x46, 0x70, 0xf1 } },
+	{ "sha1", NULL,
+	  { 0x34, 0xaa, 0x97, 0x3c, 0xd4, 0xc4, 0xda, 0xa4, 0xf6, 0x1e,
+	    0xeb, 0x2b, 0xdb, 0xad, 0x27, 0x31, 0x65, 0x34, 0x01, 0x6f } },
+	{ "sha256", "abc",
+	  { 0xba, 0x78, 0x16, 0xbf, 0x8f, 0x01, 0xcf, 0xea, 0x41, 0x41,
+	    0x40, 0xde, 0x5d, 0xae, 0x22, 0x23, 0xb0, 0x03, 0x61, 0xa3,
+	    0x96, 0x17, 0x7a, 0x9c, 0xb4, 0x10, 0xff, 0x61, 0xf2, 0x00,
+	    0x15, 0xad } },
+	{ "sha256", "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq",
+	  { 0x24, 0x8d, 0x6a, 0x61, 0xd2, 0x06, 0x38, 0xb8, 0xe5, 0xc0,
+	    0x26, 0x93, 0x0c, 0x3e, 0x60, 0x39, 0xa3, 0x3c, 0xe4, 0x59,
+	    0x64, 0xff, 0x21, 0x67, 0xf6, 0xec, 0xed, 0xd4, 0x19, 0xdb,
+	    0x06, 0xc1 } },
+	{ "sha256", NULL,
+	  { 0xcd, 0xc7, 0x6e, 0x5c, 0x99, 0x14, 0xfb, 0x92, 0x81, 0xa1,
+	    0xc7, 0xe2, 0x84, 0xd7, 0x3e, 0x67, 0xf1, 0x80, 0x9a, 0x48,
+	    0xa4, 0x97, 0x20, 0x0e, 0x04, 0x6d, 0x39, 0xcc, 0xc7, 0x11,
+	    0x2c, 0xd0 } },
+};
+
+/*
+ * Hash each vector in one go and then progressively, in pieces of
+ * varying size so that the block code sees all alignments and run lengths
+ */
+static int lib_test_sha_vectors(struct unit_test_state *uts)
+{
+	const struct sha_test_vector *vec;
+	struct hash_algo *algo;
+	u8 digest[SHA256_SUM_LEN];
+	char *buf;
+	uint len, ofs, step;
+	void *ctx;
+	int i;
+
+	buf = malloc(SHA_TEST_LEN);
+	ut_assertnonnull(buf);
+
+	for (i = 0; i < ARRAY_SIZE(sha_test_vectors); i++) {
+		vec = &sha_test_vectors[i];
+		if (hash_lookup_algo(vec->algo, &algo))
+			continue;
+		if (vec->input) {
+			strcpy(buf, vec->input);
+			len = strlen(vec->input);
+		} else {
+			memset(buf, 'a', SHA_TEST_LEN);
+			len = SHA_TEST_LEN;
+		}
+
+		memset(digest, '\0', sizeof(digest));
+		ut_assertok(hash_block(vec->algo, buf, len, digest, NULL));
+		ut_asserteq_mem(vec->digest, digest, algo->digest_size);
+
+		ut_assertok(hash_progressive_lookup_algo(vec->algo, &algo));
+		ut_assertok(algo->hash_init(algo, &ctx));
+		for (ofs = 0, step = 1; ofs < len; ofs += step, step += 37) {
+			step = min(step, len - ofs);
+			ut_assertok(algo->hash_update(algo, ctx, buf + ofs,
+						      step, 0));
+		}
+		memset(digest, '\0', sizeof(digest));
+		ut_assertok(algo->hash_finish(algo, ctx, digest,
+					      sizeof(digest)));
+		ut_asserteq_mem(vec->digest, digest, algo->digest_size);
+	}
+	free(buf);
+
+	return 0;
+}
+LIB_TEST(lib_test_sha_vectors, 0);
@@ -0,0 +1,78 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests for the worker pool
+ */
+
+#include <common.h>
+#include <malloc.h>
+#include <worker.h>
+#include <test/lib.h>
+#include <test/test.h>
+#include <test/ut.h>
+
+#define WORKER_TEST_JOBS	32
+#define WORKER_TEST_SIZE	(256 << 10)
+
+struct worker_test {
+	u8 *buf;
+	int seed;
+	u32 sum;
+};
+
+/* Fill a buffer and checksum it, touching nothing else */
+static int worker_test_job(void *arg)
+{
+	struct worker_test *test = arg;
+	u32 sum = 0;
+	int i;
+
+	memset(test->buf, test->seed, WORKER_TEST_SIZE);
+	for (i = 0; i < WORKER_TEST_SIZE; i++)
+		sum = sum * 31 + test->buf[i];
+	test->sum = sum;
+
+	return test->seed;
+}
+
+static int lib_test_worker(struct unit_test_state *uts)
+{
+	struct worker_job jobs[WORKER_TEST_JOBS];
+	struct worker_test tests[WORKER_TEST_JOBS];
+	struct worker_test expect;
+	u8 *buf;
+	int i, pass;
+
+	buf = malloc(WORKER_TEST_SIZE * (WORKER_TEST_JOBS + 1));
+	ut_assertnonnull(buf);
+
+	/* sandbox always has at least one worker */
+	ut_assert(worker_init() > 0);
+	ut_asserteq(worker_init(), worker_count());
+
+	/*
+	 * run twice, restarting the workers in between; the second time,
+	 * stop them before waiting, which must still finish every job
+	 */
+	for (pass = 0; pass < 2; pass++) {
+		for (i = 0; i < WORKER_TEST_JOBS; i++) {
+			tests[i].buf = buf + i * WORKER_TEST_SIZE;
+			tests[i].seed = i + 1;
+			worker_submit(&jobs[i], worker_test_job, &tests[i]);
+		}
+		if (pass)
+			worker_uninit();
+		for (i = 0; i < WORKER_TEST_JOBS; i++) {
+			ut_asserteq(i + 1, worker_wait(&jobs[i]));
+			expect.buf = buf + WORKER_TEST_JOBS * WORKER_TEST_SIZE;
+			expect.seed = i + 1;
+			worker_test_job(&expect);
+			ut_asserteq(expect.sum, tests[i].sum);
+		}
+		worker_uninit();
+		ut_asserteq(0, worker_count());
+	}
+	free(buf);
+
+	return 0;
+}
+LIB_TEST(lib_test_worker, 0);
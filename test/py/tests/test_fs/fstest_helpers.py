@@ -11,3 +11,17 @@ def assert_fs_integrity(fs_type, fs_img):
             check_call('fsck.ext4 -n -f %s' % fs_img, shell=True)
     except CalledProcessError:
         raise
+
+def make_text(rand, size):
+    """Return size bytes of text which compresses well.
+
+    Args:
+        rand: random.Random() instance to pick the words with.
+        size: Number of bytes.
+    """
+    words = [b'block', b'extent', b'fragment', b'worker', b'u-boot',
+             b'lz4', b'inode', b'kernel', b'\n']
+    out = bytearray()
+    while len(out) < size:
+        out += rand.choice(words) + b' %d ' % rand.randrange(1000)
+    return bytes(out[:size])
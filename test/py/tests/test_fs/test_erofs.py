@@ -0,0 +1,116 @@
+# SPDX-License-Identifier:      GPL-2.0+
+#
+# U-Boot File System: EROFS Test
+
+"""
+This test reads files from EROFS images made by mkfs.erofs, in full and in
+ranges, with:
+- compact and extended inodes,
+- uncompressed files with and without an inline tail,
+- LZ4 compressed files with the compacted (4B/2B) and the full cluster
+  index.
+
+Compressed extents hold a variable amount of data, so the ranges use a
+mix of lengths: the short ones mostly fit in one extent, the long ones
+cross several extent boundaries.
+"""
+
+import hashlib
+import os
+import pytest
+import random
+import shutil
+from subprocess import check_call
+from fstest_defs import ADDR
+from fstest_helpers import make_text
+
+# mkfs.erofs options for each image
+IMAGES = {
+    'lz4_compact': ['-zlz4', '-Eforce-inode-compact'],
+    'lz4_extended': ['-zlz4', '-Eforce-inode-extended'],
+    'lz4_full_index': ['-zlz4', '-Elegacy-compress'],
+    'inline': ['-Eforce-inode-extended'],
+    'noinline': ['-Enoinline_data'],
+}
+
+RANGES = [
+    ('big.txt', 0, 1),
+    ('big.txt', 1, 100),
+    ('big.txt', 4095, 2),
+    ('big.txt', 5000, 5000),
+    ('big.txt', 123457, 70000),
+    ('big.txt', 400001, 600000),
+    ('big.txt', 1500000 - 3000, 3000),
+    ('random.bin', 4000, 200),
+    ('random.bin', 20000 - 500, 500),
+    ('sub/nested.txt', 33333, 33333),
+]
+
+@pytest.fixture(scope='module', params=sorted(IMAGES))
+def erofs_obj(request, u_boot_config):
+    rand = random.Random(7)
+    files = {
+        'big.txt': make_text(rand, 1500000),
+        'small.txt': make_text(rand, 10000),
+        'random.bin': bytes(rand.randrange(256) for i in range(20000)),
+        'tiny': make_text(rand, 100),
+        'sub/nested.txt': make_text(rand, 70000),
+    }
+    data_dir = u_boot_config.persistent_data_dir
+    src = os.path.join(data_dir, 'erofs_src')
+    fname = os.path.join(data_dir, 'erofs_%s.img' % request.param)
+    shutil.rmtree(src, ignore_errors=True)
+    for name, data in files.items():
+        path = os.path.join(src, name)
+        if not os.path.isdir(os.path.dirname(path)):
+            os.makedirs(os.path.dirname(path))
+        with open(path, 'wb') as fd:
+            fd.write(data)
+    if os.path.exists(fname):
+        os.remove(fname)
+    check_call(['mkfs.erofs'] + IMAGES[request.param] + [fname, src])
+    return fname, files
+
+def md5(data):
+    return hashlib.md5(data).hexdigest()
+
+@pytest.mark.boardspec('sandbox')
+@pytest.mark.buildconfigspec('fs_erofs')
+@pytest.mark.buildconfigspec('cmd_md5sum')
+@pytest.mark.requiredtool('mkfs.erofs')
+class TestErofs(object):
+    def test_erofs_ls(self, u_boot_console, erofs_obj):
+        """Test that the files are listed with their sizes."""
+        fname, files = erofs_obj
+        output = u_boot_console.run_command_list([
+            'host bind 0 %s' % fname,
+            'ls host 0:0 /'])
+        for name in ('big.txt', 'small.txt', 'random.bin', 'tiny'):
+            assert(' %8d   %s' % (len(files[name]), name) in ''.join(output))
+        assert('sub/' in ''.join(output))
+
+    def test_erofs_load_full(self, u_boot_console, erofs_obj):
+        """Test that whole files are read correctly."""
+        fname, files = erofs_obj
+        u_boot_console.run_command('host bind 0 %s' % fname)
+        for name, data in files.items():
+            output = u_boot_console.run_command_list([
+                'load host 0:0 %x /%s' % (ADDR, name),
+                'printenv filesize',
+                'md5sum %x $filesize' % ADDR])
+            assert('filesize=%x' % len(data) in ''.join(output))
+            assert(md5(data) in ''.join(output))
+
+    @pytest.mark.parametrize('name,offset,length', RANGES)
+    def test_erofs_load_range(self, u_boot_console, erofs_obj, name, offset,
+                              length):
+        """Test that ranges of a file are read correctly."""
+        fname, files = erofs_obj
+        data = files[name][offset:offset + length]
+        output = u_boot_console.run_command_list([
+            'host bind 0 %s' % fname,
+            'load host 0:0 %x /%s %x %x' % (ADDR, name, length, offset),
+            'printenv filesize',
+            'md5sum %x $filesize' % ADDR])
+        assert('filesize=%x' % len(data) in ''.join(output))
+        assert(md5(data) in ''.join(output))
@@ -0,0 +1,275 @@
+# SPDX-License-Identifier:      GPL-2.0+
+#
+# U-Boot File System: squashfs Test
+
+"""
+This test reads files from an lz4-compressed squashfs image, in full and
+in ranges which start and end inside data blocks, cover whole blocks only,
+or reach into the fragment holding the tail of a file. Whole compressed
+blocks are decompressed by worker jobs, partly wanted blocks on the boot
+CPU.
+
+mksquashfs is not needed: the image is written here, with a small lz4
+block compressor.
+"""
+
+import hashlib
+import itertools
+import os
+import pytest
+import random
+import struct
+from fstest_defs import ADDR
+from fstest_helpers import make_text
+
+BLOCK_LOG = 17
+BLOCK_SIZE = 1 << BLOCK_LOG
+METADATA_SIZE = 8192
+COMP_LZ4 = 5
+NO_FRAGMENT = 0xffffffff
+NO_TABLE = 0xffffffffffffffff
+
+def lz4_compress(data):
+    """Compress data as a raw lz4 block, greedily matching 4-byte runs."""
+    out = bytearray()
+
+    def put_len(n):
+        while n >= 255:
+            out.append(255)
+            n -= 255
+        out.append(n)
+
+    def put_seq(lit, offset=0, mlen=0):
+        ml = mlen - 4 if offset else 0
+        out.append(min(len(lit), 15) << 4 | min(ml, 15))
+        if len(lit) >= 15:
+            put_len(len(lit) - 15)
+        out.extend(lit)
+        if offset:
+            out.extend(struct.pack('<H', offset))
+            if ml >= 15:
+                put_len(ml - 15)
+
+    # The last match starts 12 bytes before the end, and 5 bytes are left
+    last = len(data) - 12
+    table = {}
+    anchor = pos = 0
+    while pos < last:
+        key = data[pos:pos + 4]
+        ref = table.get(key)
+        table[key] = pos
+        if ref is None or pos - ref > 0xffff:
+            pos += 1
+            continue
+        mlen = 4
+        while (mlen < len(data) - 5 - pos and
+               data[ref + mlen] == data[pos + mlen]):
+            mlen += 1
+        put_seq(data[anchor:pos], pos - ref, mlen)
+        pos += mlen
+        anchor = pos
+    put_seq(data[anchor:])
+
+    return bytes(out)
+
+class Metadata(object):
+    """A squashfs metadata table: blocks of up to 8 KiB, each compressed."""
+    def __init__(self):
+        self.out = bytearray()
+        self.buf = bytearray()
+
+    def ref(self):
+        """Return the block position and offset where the next data goes."""
+        return len(self.out), len(self.buf)
+
+    def add(self, data):
+        self.buf += data
+        while len(self.buf) >= METADATA_SIZE:
+            self.flush(self.buf[:METADATA_SIZE])
+            self.buf = self.buf[METADATA_SIZE:]
+
+    def flush(self, chunk):
+        comp = lz4_compress(bytes(chunk))
+        if len(comp) < len(chunk):
+            self.out += struct.pack('<H', len(comp)) + comp
+        else:
+            self.out += struct.pack('<H', len(chunk) | 0x8000) + chunk
+
+    def finish(self):
+        if self.buf:
+            self.flush(self.buf)
+            self.buf = bytearray()
+        return self.out
+
+def make_squashfs(fname, tree):
+    """Write a squashfs image holding tree.
+
+    Args:
+        fname: Image file to write.
+        tree: Dict of names to file contents (bytes) or subtrees (dict).
+    """
+    # Superblock, then the compression options: lz4 version 1, no flags
+    img = bytearray(96)
+    img += struct.pack('<HII', 8 | 0x8000, 1, 0)
+    inodes = Metadata()
+    dirs = Metadata()
+    frags = []
+    fragbuf = bytearray()
+    count = [1]
+
+    def put_block(data):
+        comp = lz4_compress(data)
+        if len(comp) < len(data):
+            img.extend(comp)
+            return len(comp)
+        img.extend(data)
+        return len(data) | 1 << 24
+
+    def flush_frag():
+        if fragbuf:
+            frags.append((len(img), put_block(bytes(fragbuf))))
+            del fragbuf[:]
+
+    def base(itype, mode, num):
+        return struct.pack('<HHHHII', itype, mode, 0, 0, 0, num)
+
+    def add_file(data, num):
+        start = len(img)
+        nfull = len(data) // BLOCK_SIZE
+        sizes = [put_block(data[i * BLOCK_SIZE:(i + 1) * BLOCK_SIZE])
+                 for i in range(nfull)]
+        tail = data[nfull * BLOCK_SIZE:]
+        frag, offset = NO_FRAGMENT, 0
+        if tail:
+            if len(fragbuf) + len(tail) > BLOCK_SIZE:
+                flush_frag()
+            frag, offset = len(frags), len(fragbuf)
+            fragbuf.extend(tail)
+        ref = inodes.ref()
+        inodes.add(base(2, 0o644, num) +
+                   struct.pack('<IIII', start, frag, offset, len(data)) +
+                   b''.join(struct.pack('<I', s) for s in sizes))
+        return ref
+
+    # Children are written before their directory, as mksquashfs does
+    def add_dir(subtree, num, parent):
+        ents = []
+        for name in sorted(subtree):
+            count[0] += 1
+            n = count[0]
+            if isinstance(subtree[name], dict):
+                ents.append((name, add_dir(subtree[name], n, num), 1, n))
+            else:
+                ents.append((name, add_file(subtree[name], n), 2, n))
+        dref = dirs.ref()
+        listing = bytearray()
+        i = 0
+        while i < len(ents):
+            # One header per run of inodes in the same metadata block
+            group = list(itertools.takewhile(
+                lambda e: e[1][0] == ents[i][1][0], ents[i:i + 256]))
+            listing += struct.pack('<III', len(group) - 1, group[0][1][0],
+                                   group[0][3])
+            for name, ref, itype, n in group:
+                listing += struct.pack('<HhHH', ref[1], n - group[0][3],
+                                       itype, len(name) - 1)
+                listing += name.encode()
+            i += len(group)
+        dirs.add(listing)
+        ref = inodes.ref()
+        inodes.add(base(1, 0o755, num) +
+                   struct.pack('<IIHHI', dref[0], 2, len(listing) + 3,
+                               dref[1], parent))
+        return ref
+
+    root = add_dir(tree, 1, 0)
+    flush_frag()
+
+    inode_start = len(img)
+    img += inodes.finish()
+    dir_start = len(img)
+    img += dirs.finish()
+
+    # Fragment entries and ids: metadata blocks, then an index to them
+    frag_table = Metadata()
+    for start, size in frags:
+        frag_table.add(struct.pack('<QII', start, size, 0))
+    frag_start = len(img) + len(frag_table.finish())
+    img += frag_table.out + struct.pack('<Q', len(img))
+    id_start = len(img) + 6
+    img += struct.pack('<HI', 4 | 0x8000, 0) + struct.pack('<Q', len(img))
+
+    struct.pack_into('<IIIIIHHHHHHQQQQQQQQ', img, 0, 0x73717368, count[0],
+                     0, BLOCK_SIZE, len(frags), COMP_LZ4, BLOCK_LOG, 0x0400,
+                     1, 4, 0, root[0] << 16 | root[1], len(img), id_start,
+                     NO_TABLE, inode_start, dir_start, frag_start, NO_TABLE)
+    img += bytes(-len(img) % 4096)
+    with open(fname, 'wb') as fd:
+        fd.write(img)
+
+@pytest.fixture(scope='module')
+def sqfs_obj(u_boot_config):
+    rand = random.Random(5)
+    files = {
+        'big': make_text(rand, 8 * BLOCK_SIZE + 12345),
+        'small': make_text(rand, 3000),
+        'raw': bytes(rand.randrange(256) for i in range(BLOCK_SIZE + 100)),
+        'sub': {'medium': make_text(rand, 2 * BLOCK_SIZE)},
+    }
+    fname = os.path.join(u_boot_config.persistent_data_dir, 'sqfs_lz4.img')
+    make_squashfs(fname, files)
+    files['sub/medium'] = files.pop('sub')['medium']
+    return fname, files
+
+def md5(data):
+    return hashlib.md5(data).hexdigest()
+
+@pytest.mark.boardspec('sandbox')
+@pytest.mark.buildconfigspec('fs_squashfs')
+@pytest.mark.buildconfigspec('lz4')
+@pytest.mark.buildconfigspec('worker')
+@pytest.mark.buildconfigspec('cmd_md5sum')
+class TestSquashfs(object):
+    def test_sqfs_ls(self, u_boot_console, sqfs_obj):
+        """Test that the files are listed with their sizes."""
+        fname, files = sqfs_obj
+        output = u_boot_console.run_command_list([
+            'host bind 0 %s' % fname,
+            'ls host 0:0 /'])
+        for name in ('big', 'small', 'raw'):
+            assert(' %8d   %s' % (len(files[name]), name) in ''.join(output))
+        assert('sub/' in ''.join(output))
+
+    def test_sqfs_load_full(self, u_boot_console, sqfs_obj):
+        """Test that whole files are read correctly."""
+        fname, files = sqfs_obj
+        u_boot_console.run_command('host bind 0 %s' % fname)
+        for name, data in files.items():
+            output = u_boot_console.run_command_list([
+                'load host 0:0 %x /%s' % (ADDR, name),
+                'printenv filesize',
+                'md5sum %x $filesize' % ADDR])
+            assert('filesize=%x' % len(data) in ''.join(output))
+            assert(md5(data) in ''.join(output))
+
+    @pytest.mark.parametrize('name,offset,length', [
+        ('big', 0x100, 0x1000),                   # inside one block
+        ('big', 100000, 500000),                  # partial, whole, partial
+        ('big', 3 * BLOCK_SIZE, 2 * BLOCK_SIZE),  # whole blocks only
+        ('big', 8 * BLOCK_SIZE - 20000, 20000 + 12345),  # into the fragment
+        ('big', 8 * BLOCK_SIZE + 100, 1000),      # fragment only
+        ('raw', 1000, BLOCK_SIZE),                # uncompressed blocks
+        ('sub/medium', BLOCK_SIZE - 1, 2),        # across two blocks
+    ])
+    def test_sqfs_load_range(self, u_boot_console, sqfs_obj, name, offset,
+                             length):
+        """Test that ranges of a file are read correctly."""
+        fname, files = sqfs_obj
+        data = files[name][offset:offset + length]
+        output = u_boot_console.run_command_list([
+            'host bind 0 %s' % fname,
+            'load host 0:0 %x /%s %x %x' % (ADDR, name, length, offset),
+            'printenv filesize',
+            'md5sum %x $filesize' % ADDR])
+        assert('filesize=%x' % len(data) in ''.join(output))
+        assert(md5(data) in ''.join(output))
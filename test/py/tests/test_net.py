@@ -4,7 +4,13 @@
 # Test various network-related functionality, such as the dhcp, ping, and
 # tftpboot commands.
 
+import binascii
+import functools
+import http.server
+import os
 import pytest
+import threading
+import time
 import u_boot_utils
 
 """
@@ -47,6 +53,11 @@ env__net_tftp_readable_file = {
     'crc32': 'c2244b26',
 }
 
+# TFTP window sizes (RFC 7440) to compare when reading the file above. The
+# server must support the windowsize option (e.g. tftp-hpa 5.3 or later).
+# This variable may be omitted to skip the test.
+env__net_tftp_window_sizes = [1, 8, 32]
+
 # Details regarding a file that may be read from a NFS server. This variable
 # may be omitted or set to None if NFS testing is not possible or desired.
 env__net_nfs_readable_file = {
@@ -55,6 +66,18 @@ env__net_nfs_readable_file = {
     'size': 5058624,
     'crc32': 'c2244b26',
 }
+
+# Address and port on this machine, reachable from U-Boot, on which the test
+# runs an HTTP server for the wget command. 'addr' and 'size' are optional.
+# With sandbox this needs a raw-socket Ethernet device (eth-raw) bound to a
+# real host interface, e.g. one end of a veth pair; TCP does not work over
+# the loopback interface. This variable may be omitted to skip the test.
+env__net_http_server = {
+    'ip': '10.0.0.1',
+    'port': 8000,
+    'addr': 0x10000000,
+    'size': 5058624,
+}
 """
 
 net_set_up = False
@@ -167,6 +190,59 @@ def test_net_tftpboot(u_boot_console):
     output = u_boot_console.run_command('crc32 $fileaddr $filesize')
     assert expected_crc in output
 
+@pytest.mark.buildconfigspec('cmd_net')
+def test_net_tftpboot_windowsize(u_boot_console):
+    """Test the tftpboot command with various TFTP window sizes.
+
+    The file used by test_net_tftpboot is downloaded once for each window
+    size, and its CRC32 validated. The time taken is logged, so the effect of
+    the window size on throughput can be seen.
+
+    The details of the file and the window sizes are provided by the
+    boardenv_* file; see the comment at the beginning of this file.
+    """
+
+    if not net_set_up:
+        pytest.skip('Network not initialized')
+
+    f = u_boot_console.config.env.get('env__net_tftp_readable_file', None)
+    if not f:
+        pytest.skip('No TFTP readable file to read')
+
+    sizes = u_boot_console.config.env.get('env__net_tftp_window_sizes', None)
+    if not sizes:
+        pytest.skip('No TFTP window sizes to test')
+
+    addr = f.get('addr', None)
+    if not addr:
+        addr = u_boot_utils.find_ram_base(u_boot_console)
+
+    fn = f['fn']
+    expected_text = 'Bytes transferred = '
+    sz = f.get('size', None)
+    if sz:
+        expected_text += '%d' % sz
+    expected_crc = f.get('crc32', None)
+    check_crc = expected_crc and \
+        u_boot_console.config.buildconfig.get('config_cmd_crc32', 'n') == 'y'
+
+    try:
+        for size in sizes:
+            u_boot_console.run_command('setenv tftpwindowsize %d' % size)
+            start = time.time()
+            output = u_boot_console.run_command('tftpboot %x %s' % (addr, fn))
+            elapsed = time.time() - start
+            assert expected_text in output
+            u_boot_console.log.info('TFTP window size %d: %f seconds' %
+                                    (size, elapsed))
+
+            if check_crc:
+                output = u_boot_console.run_command(
+                    'crc32 $fileaddr $filesize')
+                assert expected_crc in output
+    finally:
+        u_boot_console.run_command('setenv tftpwindowsize')
+
 @pytest.mark.buildconfigspec('cmd_nfs')
 def test_net_nfs(u_boot_console):
     """Test the nfs command.
@@ -206,3 +282,64 @@ def test_net_nfs(u_boot_console):
 
     output = u_boot_console.run_command('crc32 %x $filesize' % addr)
     assert expected_crc in output
+
+class QuietHTTPRequestHandler(http.server.SimpleHTTPRequestHandler):
+    """Serve files without logging every request to stderr"""
+
+    def log_message(self, format, *args):
+        pass
+
+@pytest.mark.buildconfigspec('cmd_wget')
+def test_net_wget(u_boot_console):
+    """Test the wget command.
+
+    A file of random data is served over HTTP by this test and downloaded by
+    the wget command. Its size and optionally its CRC32 are validated.
+
+    The server details are provided by the boardenv_* file; see the comment at
+    the beginning of this file.
+    """
+
+    if not net_set_up:
+        pytest.skip('Network not initialized')
+
+    srv = u_boot_console.config.env.get('env__net_http_server', None)
+    if not srv:
+        pytest.skip('No HTTP server address to use')
+
+    addr = srv.get('addr', None)
+    if not addr:
+        addr = u_boot_utils.find_ram_base(u_boot_console)
+    sz = srv.get('size', 1024 * 1024)
+
+    fn = 'ubtest-wget.bin'
+    path = os.path.join(u_boot_console.config.build_dir, fn)
+    data = os.urandom(sz)
+    with open(path, 'wb') as fd:
+        fd.write(data)
+    expected_crc = '%08x' % (binascii.crc32(data) & 0xffffffff)
+
+    handler = functools.partial(QuietHTTPRequestHandler,
+                                directory=u_boot_console.config.build_dir)
+    httpd = http.server.HTTPServer((srv['ip'], srv['port']), handler)
+    thread = threading.Thread(target=httpd.serve_forever)
+    thread.start()
+    try:
+        start = time.time()
+        output = u_boot_console.run_command('wget %x http://%s:%d/%s' %
+                                            (addr, srv['ip'], srv['port'], fn))
+        elapsed = time.time() - start
+    finally:
+        httpd.shutdown()
+        thread.join()
+        httpd.server_close()
+        os.remove(path)
+
+    assert 'Bytes transferred = %d' % sz in output
+    u_boot_console.log.info('wget of %d bytes: %f seconds' % (sz, elapsed))
+
+    if u_boot_console.config.buildconfig.get('config_cmd_crc32', 'n') != 'y':
+        return
+
+    output = u_boot_console.run_command('crc32 %x $filesize' % addr)
+    assert expected_crc in output